@@ -19,6 +19,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gst/imx/video/gstimxvideoorientationmeta.h"
 #include "gst/imx/video/gstimxvideouploader.h"
 #include "gstimx2dcompositor.h"
 #include "gstimx2dmisc.h"
@@ -128,6 +129,10 @@ struct _GstImx2dCompositorPad
 	Imx2dBlitMargin combined_margin;
 
 	GstVideoOrientationMethod tag_video_direction;
+	/* Orientation method from the GstImxVideoOrientationMeta of the
+	 * current input buffer. It is applied before video_direction /
+	 * tag_video_direction. */
+	GstVideoOrientationMethod meta_video_direction;
 
 	GstImxVideoUploader *uploader;
 
@@ -164,7 +169,8 @@ enum
 	PROP_PAD_VIDEO_DIRECTION,
 	PROP_PAD_FORCE_ASPECT_RATIO,
 	PROP_PAD_INPUT_CROP,
-	PROP_PAD_ALPHA
+	PROP_PAD_ALPHA,
+	PROP_PAD_UPLOAD_STATS
 };
 
 #define DEFAULT_PAD_XPOS 0
@@ -202,6 +208,7 @@ static void gst_imx_2d_compositor_pad_get_property(GObject *object, guint prop_i
 
 static GstPadProbeReturn gst_imx_2d_compositor_downstream_event_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
 
+static void gst_imx_2d_compositor_pad_update_meta_video_direction(GstImx2dCompositorPad *self, GstBuffer *input_buffer);
 static void gst_imx_2d_compositor_pad_recalculate_regions_if_needed(GstImx2dCompositorPad *self, GstVideoInfo *output_video_info);
 static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_direction(GstImx2dCompositorPad *self);
 
@@ -368,6 +375,17 @@ static void gst_imx_2d_compositor_pad_class_init(GstImx2dCompositorPadClass *kla
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_CONTROLLABLE
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PAD_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how this pad's input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
@@ -388,6 +406,7 @@ static void gst_imx_2d_compositor_pad_init(GstImx2dCompositorPad *self)
 	self->alpha = DEFAULT_PAD_ALPHA;
 
 	self->tag_video_direction = DEFAULT_PAD_VIDEO_DIRECTION;
+	self->meta_video_direction = GST_VIDEO_ORIENTATION_IDENTITY;
 
 	self->uploader = NULL;
 
@@ -607,6 +626,22 @@ static void gst_imx_2d_compositor_pad_get_property(GObject *object, guint prop_i
 			GST_OBJECT_UNLOCK(self);
 			break;
 
+		case PROP_PAD_UPLOAD_STATS:
+		{
+			/* The uploader is created right after the pad itself
+			 * and destroyed in finalize, so no locking is needed. */
+			GstImxDmaBufferUploaderStats stats;
+
+			if (self->uploader != NULL)
+			{
+				gst_imx_video_uploader_get_stats(self->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -713,6 +748,29 @@ static GstPadProbeReturn gst_imx_2d_compositor_downstream_event_probe(GstPad *pa
 }
 
 
+static void gst_imx_2d_compositor_pad_update_meta_video_direction(GstImx2dCompositorPad *self, GstBuffer *input_buffer)
+{
+	GstImxVideoOrientationMeta *orientation_meta;
+	GstVideoOrientationMethod meta_video_direction = GST_VIDEO_ORIENTATION_IDENTITY;
+
+	/* Pads without a current buffer keep their previous
+	 * orientation, since they may show an earlier frame. */
+	if (input_buffer == NULL)
+		return;
+
+	orientation_meta = gst_buffer_get_imx_video_orientation_meta(input_buffer);
+	if (orientation_meta != NULL)
+		meta_video_direction = orientation_meta->method;
+
+	if (meta_video_direction != self->meta_video_direction)
+	{
+		GST_DEBUG_OBJECT(self, "video direction from orientation meta changed to %d", (gint)meta_video_direction);
+		self->meta_video_direction = meta_video_direction;
+		self->region_coords_need_update = TRUE;
+	}
+}
+
+
 static void gst_imx_2d_compositor_pad_recalculate_regions_if_needed(GstImx2dCompositorPad *self, GstVideoInfo *output_video_info)
 {
 	GstVideoInfo *input_video_info;
@@ -853,7 +911,8 @@ static void gst_imx_2d_compositor_pad_recalculate_regions_if_needed(GstImx2dComp
 
 static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_direction(GstImx2dCompositorPad *self)
 {
-	return (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
+	GstVideoOrientationMethod video_direction = (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
+	return gst_imx_video_orientation_method_combine(self->meta_video_direction, video_direction);
 }
 
 
@@ -864,10 +923,39 @@ static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_dir
 enum
 {
 	PROP_0,
-	PROP_BACKGROUND_COLOR
+	PROP_BACKGROUND_COLOR,
+	PROP_PREWARM_BUFFERS,
+	PROP_NUM_THREADS
 };
 
 #define DEFAULT_BACKGROUND_COLOR 0x000000
+#define DEFAULT_PREWARM_BUFFERS 0
+#define DEFAULT_NUM_THREADS 0
+
+#define MAX_NUM_THREADS 64
+
+
+/* Per-frame snapshot of a sinkpad that has an input buffer.
+ * The pad and the buffers are ref'd until the blitter is
+ * finished with the frame. The remaining fields are copies
+ * of the pad's values, taken while the pad is locked, so
+ * blitting does not have to lock the pad. */
+typedef struct
+{
+	GstImx2dCompositorPad *compositor_pad;
+	GstBuffer *input_buffer;
+	GstBuffer *uploaded_input_buffer;
+	GstFlowReturn flow_ret;
+
+	gboolean input_crop;
+	GstVideoOrientationMethod video_direction;
+	gdouble alpha;
+	Imx2dRegion inner_region;
+	Imx2dBlitMargin combined_margin;
+	gboolean inner_region_fills_output_frame;
+	gboolean total_region_fills_output_frame;
+}
+GstImx2dCompositorPadJob;
 
 
 
@@ -889,6 +977,7 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
 
 /* General element operations. */
 static void gst_imx_2d_compositor_dispose(GObject *object);
+static void gst_imx_2d_compositor_finalize(GObject *object);
 static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_2d_compositor_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstPad* gst_imx_2d_compositor_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, GstCaps const *caps);
@@ -911,6 +1000,10 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 /* Misc GstImx2dCompositor functionality. */
 static gboolean gst_imx_2d_compositor_create_blitter(GstImx2dCompositor *self);
+static void gst_imx_2d_compositor_prepare_pad_inputs(GstImx2dCompositor *self);
+static void gst_imx_2d_compositor_prepare_pad_input(GstImx2dCompositor *self, GstImx2dCompositorPadJob *job);
+static void gst_imx_2d_compositor_pad_job_thread_func(gpointer data, gpointer user_data);
+static void gst_imx_2d_compositor_release_pad_jobs(GstImx2dCompositor *self);
 
 
 static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
@@ -930,6 +1023,7 @@ static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
 	video_aggregator_class = GST_VIDEO_AGGREGATOR_CLASS(klass);
 
 	object_class->dispose      = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_dispose);
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_finalize);
 	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_set_property);
 	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_get_property);
 
@@ -960,12 +1054,46 @@ static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PREWARM_BUFFERS,
+		g_param_spec_uint(
+			"prewarm-buffers",
+			"Prewarm buffers",
+			"How many output buffers to allocate as soon as the output buffer pool is set up "
+			"(0 = allocate buffers on demand; higher values avoid allocation stalls during playback)",
+			0, G_MAXUINT,
+			DEFAULT_PREWARM_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_NUM_THREADS,
+		g_param_spec_uint(
+			"num-threads",
+			"Number of threads",
+			"How many threads to use for uploading and preparing input frames "
+			"(0 = one per CPU core; 1 = no worker threads; applied when the compositor starts)",
+			0, MAX_NUM_THREADS,
+			DEFAULT_NUM_THREADS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
 static void gst_imx_2d_compositor_init(GstImx2dCompositor *self)
 {
 	self->background_color = DEFAULT_BACKGROUND_COLOR;
+	self->prewarm_buffers = DEFAULT_PREWARM_BUFFERS;
+	self->num_threads = DEFAULT_NUM_THREADS;
+
+	self->pad_jobs = NULL;
+	self->thread_pool = NULL;
+	g_mutex_init(&(self->pad_jobs_mutex));
+	g_cond_init(&(self->pad_jobs_cond));
+	self->num_pending_pad_jobs = 0;
 
 	/* NOTE: This is created here instead of in start() because new
 	 * compositor pads may appear before start() runs. When a new pad
@@ -1031,6 +1159,17 @@ static void gst_imx_2d_compositor_dispose(GObject *object)
 }
 
 
+static void gst_imx_2d_compositor_finalize(GObject *object)
+{
+	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(object);
+
+	g_mutex_clear(&(self->pad_jobs_mutex));
+	g_cond_clear(&(self->pad_jobs_cond));
+
+	G_OBJECT_CLASS(gst_imx_2d_compositor_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(object);
@@ -1045,6 +1184,22 @@ static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->prewarm_buffers = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_NUM_THREADS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->num_threads = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -1066,6 +1221,22 @@ static void gst_imx_2d_compositor_get_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->prewarm_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_NUM_THREADS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->num_threads);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -1135,6 +1306,7 @@ static void gst_imx_2d_compositor_release_pad(GstElement *element, GstPad *pad)
 static gboolean gst_imx_2d_compositor_decide_allocation(GstAggregator *aggregator, GstQuery *query)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
+	guint prewarm_buffers;
 
 	/* Chain up to the base class.
 	 * We first do that, then modify the query. That way, we can be
@@ -1155,10 +1327,15 @@ static gboolean gst_imx_2d_compositor_decide_allocation(GstAggregator *aggregato
 		self->video_buffer_pool = NULL;
 	}
 
+	GST_OBJECT_LOCK(self);
+	prewarm_buffers = self->prewarm_buffers;
+	GST_OBJECT_UNLOCK(self);
+
 	self->video_buffer_pool = gst_imx_video_buffer_pool_new(
 		self->imx_dma_buffer_allocator,
 		query,
-		&(self->output_video_info)
+		&(self->output_video_info),
+		prewarm_buffers
 	);
 
 	gst_object_ref_sink(self->video_buffer_pool);
@@ -1172,9 +1349,11 @@ static gboolean gst_imx_2d_compositor_propose_allocation(GstAggregator *aggregat
 	if (!GST_AGGREGATOR_CLASS(gst_imx_2d_compositor_parent_class)->propose_allocation(aggregator, pad, decide_query, query))
 		return FALSE;
 
-	/* Let upstream know that we can handle GstVideoMeta and GstVideoCropMeta. */
+	/* Let upstream know that we can handle GstVideoMeta, GstVideoCropMeta,
+	 * and GstImxVideoOrientationMeta. */
 	gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, 0);
 	gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, 0);
+	gst_query_add_allocation_meta(query, GST_IMX_VIDEO_ORIENTATION_META_API_TYPE, 0);
 
 	return TRUE;
 }
@@ -1183,6 +1362,8 @@ static gboolean gst_imx_2d_compositor_propose_allocation(GstAggregator *aggregat
 static gboolean gst_imx_2d_compositor_start(GstAggregator *aggregator)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
+	guint num_threads;
+	GError *error = NULL;
 
 	self->video_buffer_pool = NULL;
 
@@ -1200,6 +1381,30 @@ static gboolean gst_imx_2d_compositor_start(GstAggregator *aggregator)
 	/* imx_2d_surface_create() is never supposed to return NULL. */
 	g_assert(self->output_surface != NULL);
 
+	self->pad_jobs = g_array_new(FALSE, TRUE, sizeof(GstImx2dCompositorPadJob));
+
+	GST_OBJECT_LOCK(self);
+	num_threads = self->num_threads;
+	GST_OBJECT_UNLOCK(self);
+
+	if (num_threads == 0)
+		num_threads = MIN(g_get_num_processors(), MAX_NUM_THREADS);
+
+	/* The aggregator's thread itself prepares one of the
+	 * pads' inputs, so one less worker thread is needed. */
+	if (num_threads > 1)
+	{
+		self->thread_pool = g_thread_pool_new(gst_imx_2d_compositor_pad_job_thread_func, self, num_threads - 1, TRUE, &error);
+		if (self->thread_pool == NULL)
+		{
+			GST_ERROR_OBJECT(self, "could not create thread pool: %s", error->message);
+			g_error_free(error);
+			goto error;
+		}
+	}
+
+	GST_DEBUG_OBJECT(self, "using %u thread(s) for preparing input frames", num_threads);
+
 	return TRUE;
 
 error:
@@ -1212,6 +1417,19 @@ static gboolean gst_imx_2d_compositor_stop(GstAggregator *aggregator)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
 
+	if (self->thread_pool != NULL)
+	{
+		/* Wait for pending work (there should be none at this point). */
+		g_thread_pool_free(self->thread_pool, FALSE, TRUE);
+		self->thread_pool = NULL;
+	}
+
+	if (self->pad_jobs != NULL)
+	{
+		g_array_free(self->pad_jobs, TRUE);
+		self->pad_jobs = NULL;
+	}
+
 	if (self->output_surface != NULL)
 	{
 		imx_2d_surface_destroy(self->output_surface);
@@ -1365,12 +1583,16 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 	GList *walk;
 	Imx2dBlitParams blit_params;
 	gboolean background_needs_to_be_cleared = TRUE;
+	guint32 background_color;
 	gboolean blitting_started = FALSE;
 	GstBuffer *intermediate_buffer = NULL;
+	guint num_jobs;
+	guint job_index;
 
 	GST_LOG_OBJECT(self, "aggregating frames");
 
 	g_assert(self->blitter != NULL);
+	g_assert(self->pad_jobs != NULL);
 
 	/* Acquire an intermediate buffer from the internal DMA buffer pool.
 	 * If the internal DMA buffer pool and the output video buffer pool
@@ -1396,52 +1618,105 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 	memset(&blit_params, 0, sizeof(blit_params));
 
 	/* Lock the compositor to prevent pads from being added/removed
-	 * while we are walking over the existing pads. */
+	 * while we are walking over the existing pads. The lock is only
+	 * held while the pads that have an input buffer are collected.
+	 * The pads and their buffers are ref'd, so they stay valid even
+	 * if a pad is released while its frame is being composited.
+	 * Holding the lock any longer would stall application threads
+	 * that set properties or request / release pads. */
 	GST_OBJECT_LOCK(self);
 
-	/* In this first walk, we look at each compositor sinkpad,
-	 * update their regions if necessary, and determine if at
-	 * least one of them produces frames that are 100% opaque
-	 * and fully cover the screen. If so, we do not need to clear
-	 * the output frame first. */
-	GST_LOG_OBJECT(self, "looking at %" G_GUINT16_FORMAT " sinkpad(s) to see if the background needs to be cleared", GST_ELEMENT_CAST(videoaggregator)->numsinkpads);
+	background_color = self->background_color;
+
+	GST_LOG_OBJECT(self, "collecting input buffers from %" G_GUINT16_FORMAT " sinkpad(s)", GST_ELEMENT_CAST(videoaggregator)->numsinkpads);
+
+	g_array_set_size(self->pad_jobs, GST_ELEMENT_CAST(videoaggregator)->numsinkpads);
+	num_jobs = 0;
+
 	walk = GST_ELEMENT_CAST(videoaggregator)->sinkpads;
 	for (; walk != NULL; walk = g_list_next(walk))
 	{
 		GstVideoAggregatorPad *videoaggregator_pad = walk->data;
-		GstImx2dCompositorPad *compositor_pad = GST_IMX_2D_COMPOSITOR_PAD_CAST(videoaggregator_pad);
+		GstImx2dCompositorPadJob *job;
 		GstBuffer *input_buffer;
 
-		gst_imx_2d_compositor_pad_recalculate_regions_if_needed(compositor_pad, &(self->output_video_info));
-
 		input_buffer = gst_video_aggregator_pad_get_current_buffer(videoaggregator_pad);
+
 		if (G_UNLIKELY(input_buffer == NULL))
 		{
 			GST_LOG_OBJECT(
 				self,
 				"pad %s has no input buffer",
-				GST_PAD_NAME(compositor_pad)
+				GST_PAD_NAME(videoaggregator_pad)
 			);
 			continue;
 		}
 
+		job = &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, num_jobs);
+		memset(job, 0, sizeof(GstImx2dCompositorPadJob));
+		job->compositor_pad = GST_IMX_2D_COMPOSITOR_PAD_CAST(gst_object_ref(videoaggregator_pad));
+		job->input_buffer = gst_buffer_ref(input_buffer);
+		job->flow_ret = GST_FLOW_OK;
+
+		num_jobs++;
+	}
+
+	g_array_set_size(self->pad_jobs, num_jobs);
+
+	GST_OBJECT_UNLOCK(self);
+
+	/* In this first walk, we look at each collected sinkpad, update
+	 * their regions if necessary, take a snapshot of the values that
+	 * are needed for blitting, and determine if at least one of them
+	 * produces frames that are 100% opaque and fully cover the screen.
+	 * If so, we do not need to clear the output frame first. */
+	for (job_index = 0; job_index < num_jobs; ++job_index)
+	{
+		GstImx2dCompositorPadJob *job = &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, job_index);
+		GstImx2dCompositorPad *compositor_pad = job->compositor_pad;
+		GstVideoAggregatorPad *videoaggregator_pad = GST_VIDEO_AGGREGATOR_PAD_CAST(compositor_pad);
+
+		/* These must be called without holding the pad's lock,
+		 * since the region calculation locks the pad itself. */
+		gst_imx_2d_compositor_pad_update_meta_video_direction(compositor_pad, job->input_buffer);
+		gst_imx_2d_compositor_pad_recalculate_regions_if_needed(compositor_pad, &(self->output_video_info));
+
+		{
+			/* Lock the pad so we can get copies of its property
+			 * values safely. Otherwise, the pad's set_property()
+			 * function may be called concurrently, leading to
+			 * race conditions. */
+			GST_OBJECT_LOCK(compositor_pad);
+
+			job->input_crop = compositor_pad->input_crop;
+			job->video_direction = gst_imx_2d_compositor_pad_get_current_video_direction(compositor_pad);
+			job->alpha = compositor_pad->alpha;
+			job->inner_region_fills_output_frame = compositor_pad->inner_region_fills_output_frame;
+			job->total_region_fills_output_frame = compositor_pad->total_region_fills_output_frame;
+
+			memcpy(&(job->inner_region), &(compositor_pad->inner_region), sizeof(job->inner_region));
+			memcpy(&(job->combined_margin), &(compositor_pad->combined_margin), sizeof(job->combined_margin));
+
+			GST_OBJECT_UNLOCK(compositor_pad);
+		}
+
 		GST_LOG_OBJECT(
 			self,
 			"pad %s:  inner/total regions fill output frame: %d/%d  alpha: %f  margin color: %#08" G_GINT32_MODIFIER "x",
 			GST_PAD_NAME(compositor_pad),
-			compositor_pad->inner_region_fills_output_frame,
-			compositor_pad->total_region_fills_output_frame,
-			compositor_pad->alpha,
-			compositor_pad->combined_margin.color
+			job->inner_region_fills_output_frame,
+			job->total_region_fills_output_frame,
+			job->alpha,
+			job->combined_margin.color
 		);
 
-		if (compositor_pad->alpha < 1.0)
+		if (job->alpha < 1.0)
 		{
 			GST_LOG_OBJECT(
 				self,
 				"pad %s's alpha value is %f -> not fully opaque",
 				GST_PAD_NAME(compositor_pad),
-				compositor_pad->alpha
+				job->alpha
 			);
 			continue;
 		}
@@ -1460,7 +1735,7 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 				continue;
 			}
 
-			if (compositor_pad->inner_region_fills_output_frame)
+			if (job->inner_region_fills_output_frame)
 			{
 				GST_LOG_OBJECT(
 					self,
@@ -1479,9 +1754,9 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 			}
 
 
-			if (compositor_pad->total_region_fills_output_frame)
+			if (job->total_region_fills_output_frame)
 			{
-				gint margin_alpha = compositor_pad->combined_margin.color >> 24;
+				gint margin_alpha = job->combined_margin.color >> 24;
 				if (margin_alpha == 255)
 				{
 					GST_LOG_OBJECT(
@@ -1511,109 +1786,65 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 	if (background_needs_to_be_cleared)
 	{
-		GST_LOG_OBJECT(self, "need to clear background with color %#06" G_GINT32_MODIFIER "x", self->background_color & 0xFFFFFF);
+		GST_LOG_OBJECT(self, "need to clear background with color %#06" G_GINT32_MODIFIER "x", background_color & 0xFFFFFF);
 
-		if (!imx_2d_blitter_fill_region(self->blitter, NULL, self->background_color))
+		if (!imx_2d_blitter_fill_region(self->blitter, NULL, background_color))
 		{
 			GST_ERROR_OBJECT(self, "could not clear background");
-			goto error_while_locked;
+			goto error;
 		}
 	}
 
+	/* Upload the input buffers and set up the input surfaces of
+	 * all collected sinkpads. This is done in parallel if worker
+	 * threads are available. */
+	gst_imx_2d_compositor_prepare_pad_inputs(self);
+
 	/* In this second walk, we perform the actual blitting.
 	 * Blitting order is defined by the zorder values of each sinkpad.
 	 * This ordering is taken care of by the GstVideoAggregator base
-	 * class, so we just have to visit each sinkpad sequentially. */
-	GST_LOG_OBJECT(self, "getting input frames from %" G_GUINT16_FORMAT " sinkpad(s)", GST_ELEMENT_CAST(videoaggregator)->numsinkpads);
-	walk = GST_ELEMENT_CAST(videoaggregator)->sinkpads;
-	for (; walk != NULL; walk = g_list_next(walk))
+	 * class, and the jobs were collected in the order of the sinkpads,
+	 * so we just have to visit each job sequentially. */
+	GST_LOG_OBJECT(self, "blitting input frames from %u sinkpad(s)", num_jobs);
+	for (job_index = 0; job_index < num_jobs; ++job_index)
 	{
-		GstVideoAggregatorPad *videoaggregator_pad = walk->data;
-		GstImx2dCompositorPad *compositor_pad = GST_IMX_2D_COMPOSITOR_PAD_CAST(videoaggregator_pad);
-		GstBuffer *input_buffer;
-		gboolean input_crop;
-		Imx2dRegion inner_region;
-		Imx2dBlitMargin combined_margin;
+		GstImx2dCompositorPadJob *job = &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, job_index);
+		GstImx2dCompositorPad *compositor_pad = job->compositor_pad;
 		Imx2dRegion crop_rectangle;
-		GstVideoOrientationMethod video_direction;
 		gint alpha;
-		GstBuffer *uploaded_input_buffer;
-		int blit_ret;
-
-		/* Retrieve the input from the sinkpad, and upload it.
-		 * The uploader is capable of determining whether or not
-		 * it actually needs to upload anything (which would imply
-		 * a CPU based copying of the data). If it is not necessary,
-		 * it will ref the data instead, thus providing zerocopy
-		 * functionality. */
-
-		input_buffer = gst_video_aggregator_pad_get_current_buffer(videoaggregator_pad);
-
-		if (G_UNLIKELY(input_buffer == NULL))
-			continue;
 
+		if (G_UNLIKELY(job->flow_ret != GST_FLOW_OK))
 		{
-			/* Lock the pad so we can get copies of its property
-			 * values safely. Otherwise, the pad's set_property()
-			 * function may be called concurrently, leading to
-			 * race conditions. */
-			GST_OBJECT_LOCK(compositor_pad);
-
-			input_crop = compositor_pad->input_crop;
-			video_direction = gst_imx_2d_compositor_pad_get_current_video_direction(compositor_pad);
-
-			alpha = (gint)(compositor_pad->alpha * 255);
-			alpha = CLAMP(alpha, 0, 255);
-
-			memcpy(&inner_region, &(compositor_pad->inner_region), sizeof(inner_region));
-			memcpy(&combined_margin, &(compositor_pad->combined_margin), sizeof(combined_margin));
-
-			GST_OBJECT_UNLOCK(compositor_pad);
+			flow_ret = job->flow_ret;
+			goto error;
 		}
 
-		/* Upload the input buffer. The uploader creates a deep
-		 * copy if necessary, but tries to avoid that if possible
-		 * by passing through the buffer (if it consists purely
-		 * of imxdmabuffer backeed gstmemory blocks) or by
-		 * duplicating DMA-BUF FDs with dup(). */
-		flow_ret = gst_imx_video_uploader_perform(compositor_pad->uploader, input_buffer, &uploaded_input_buffer);
-		if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
-			goto error_while_locked;
-
-		/* Set up the pad's input surface. */
-
-		gst_imx_2d_assign_input_buffer_to_surface(
-			uploaded_input_buffer,
-			compositor_pad->input_surface,
-			&(compositor_pad->input_surface_desc),
-			&(videoaggregator_pad->info)
-		);
-
-		imx_2d_surface_set_desc(compositor_pad->input_surface, &(compositor_pad->input_surface_desc));
-
 
 		/* Fill the blit parameters. */
 
 		GST_LOG_OBJECT(
 			self,
 			"combined margin: %d/%d/%d/%d  margin color: %#08" G_GINT32_MODIFIER "x",
-			combined_margin.left_margin,
-			combined_margin.top_margin,
-			combined_margin.right_margin,
-			combined_margin.bottom_margin,
-			(guint32)(combined_margin.color)
+			job->combined_margin.left_margin,
+			job->combined_margin.top_margin,
+			job->combined_margin.right_margin,
+			job->combined_margin.bottom_margin,
+			(guint32)(job->combined_margin.color)
 		);
 
-		blit_params.margin = &combined_margin;
+		alpha = (gint)(job->alpha * 255);
+		alpha = CLAMP(alpha, 0, 255);
+
+		blit_params.margin = &(job->combined_margin);
 		blit_params.source_region = NULL;
-		blit_params.dest_region = &inner_region;
-		blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(video_direction);
+		blit_params.dest_region = &(job->inner_region);
+		blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(job->video_direction);
 		blit_params.alpha = alpha;
 		blit_params.colorimetry = compositor_pad->colorimetry;
 
-		if (input_crop)
+		if (job->input_crop)
 		{
-			GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(input_buffer);
+			GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(job->input_buffer);
 
 			if (crop_meta != NULL)
 			{
@@ -1634,24 +1865,17 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 		}
 
 
-		/* Now perform the actual blit. */
-
-		blit_ret = imx_2d_blitter_do_blit(self->blitter, compositor_pad->input_surface, &blit_params);
-
-
-		/* Discard the uploaded version of the input buffer. */
-		gst_buffer_unref(uploaded_input_buffer);
-
+		/* Now perform the actual blit. The uploaded input buffer
+		 * is kept alive until the blitter is finished, since some
+		 * blitters access input surfaces asynchronously until then. */
 
-		if (!blit_ret)
+		if (!imx_2d_blitter_do_blit(self->blitter, compositor_pad->input_surface, &blit_params))
 		{
 			GST_ERROR_OBJECT(self, "blitting failed");
-			goto error_while_locked;
+			goto error;
 		}
 	}
 
-	GST_OBJECT_UNLOCK(self);
-
 
 finish:
 	if (blitting_started && !imx_2d_blitter_finish(self->blitter))
@@ -1660,6 +1884,10 @@ finish:
 		flow_ret = GST_FLOW_ERROR;
 	}
 
+	/* The blitter no longer accesses the input frames
+	 * at this point, so they can be discarded now. */
+	gst_imx_2d_compositor_release_pad_jobs(self);
+
 	if (flow_ret == GST_FLOW_OK)
 	{
 		/* The blitter is done. Transfer the resulting pixels to the output buffer.
@@ -1687,10 +1915,107 @@ error:
 	if (flow_ret != GST_FLOW_OK)
 		flow_ret = GST_FLOW_ERROR;
 	goto finish;
+}
 
-error_while_locked:
-	GST_OBJECT_UNLOCK(self);
-	goto error;
+
+static void gst_imx_2d_compositor_prepare_pad_inputs(GstImx2dCompositor *self)
+{
+	guint num_jobs = self->pad_jobs->len;
+	guint num_local_jobs;
+	guint job_index;
+
+	/* Without worker threads, all jobs are processed by this thread.
+	 * Otherwise, all jobs except for the first one are handed to the
+	 * worker threads, and the first one is processed by this thread
+	 * in the meantime. */
+	num_local_jobs = (self->thread_pool != NULL) ? MIN(num_jobs, 1) : num_jobs;
+
+	g_mutex_lock(&(self->pad_jobs_mutex));
+	self->num_pending_pad_jobs = num_jobs - num_local_jobs;
+	g_mutex_unlock(&(self->pad_jobs_mutex));
+
+	for (job_index = num_local_jobs; job_index < num_jobs; ++job_index)
+		g_thread_pool_push(self->thread_pool, &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, job_index), NULL);
+
+	for (job_index = 0; job_index < num_local_jobs; ++job_index)
+		gst_imx_2d_compositor_prepare_pad_input(self, &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, job_index));
+
+	g_mutex_lock(&(self->pad_jobs_mutex));
+	while (self->num_pending_pad_jobs > 0)
+		g_cond_wait(&(self->pad_jobs_cond), &(self->pad_jobs_mutex));
+	g_mutex_unlock(&(self->pad_jobs_mutex));
+}
+
+
+static void gst_imx_2d_compositor_prepare_pad_input(GstImx2dCompositor *self, GstImx2dCompositorPadJob *job)
+{
+	GstImx2dCompositorPad *compositor_pad = job->compositor_pad;
+	GstVideoAggregatorPad *videoaggregator_pad = GST_VIDEO_AGGREGATOR_PAD_CAST(compositor_pad);
+
+	/* Upload the input buffer. The uploader creates a deep
+	 * copy if necessary, but tries to avoid that if possible
+	 * by passing through the buffer (if it consists purely
+	 * of imxdmabuffer backeed gstmemory blocks) or by
+	 * duplicating DMA-BUF FDs with dup(). Each pad has its
+	 * own uploader, so pads can be uploaded concurrently. */
+	job->flow_ret = gst_imx_video_uploader_perform(compositor_pad->uploader, job->input_buffer, &(job->uploaded_input_buffer));
+	if (G_UNLIKELY(job->flow_ret != GST_FLOW_OK))
+	{
+		GST_ERROR_OBJECT(self, "could not upload input buffer of pad %s: %s", GST_PAD_NAME(compositor_pad), gst_flow_get_name(job->flow_ret));
+		job->uploaded_input_buffer = NULL;
+		return;
+	}
+
+	/* Set up the pad's input surface. The pad is locked since
+	 * the input surface description is also modified when
+	 * new caps arrive at the pad. */
+
+	GST_OBJECT_LOCK(compositor_pad);
+
+	gst_imx_2d_assign_input_buffer_to_surface(
+		job->uploaded_input_buffer,
+		compositor_pad->input_surface,
+		&(compositor_pad->input_surface_desc),
+		&(videoaggregator_pad->info)
+	);
+
+	imx_2d_surface_set_desc(compositor_pad->input_surface, &(compositor_pad->input_surface_desc));
+
+	GST_OBJECT_UNLOCK(compositor_pad);
+}
+
+
+static void gst_imx_2d_compositor_pad_job_thread_func(gpointer data, gpointer user_data)
+{
+	GstImx2dCompositorPadJob *job = (GstImx2dCompositorPadJob *)data;
+	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(user_data);
+
+	gst_imx_2d_compositor_prepare_pad_input(self, job);
+
+	g_mutex_lock(&(self->pad_jobs_mutex));
+	g_assert(self->num_pending_pad_jobs > 0);
+	self->num_pending_pad_jobs--;
+	if (self->num_pending_pad_jobs == 0)
+		g_cond_signal(&(self->pad_jobs_cond));
+	g_mutex_unlock(&(self->pad_jobs_mutex));
+}
+
+
+static void gst_imx_2d_compositor_release_pad_jobs(GstImx2dCompositor *self)
+{
+	guint job_index;
+
+	for (job_index = 0; job_index < self->pad_jobs->len; ++job_index)
+	{
+		GstImx2dCompositorPadJob *job = &g_array_index(self->pad_jobs, GstImx2dCompositorPadJob, job_index);
+
+		if (job->uploaded_input_buffer != NULL)
+			gst_buffer_unref(job->uploaded_input_buffer);
+		gst_buffer_unref(job->input_buffer);
+		gst_object_unref(GST_OBJECT(job->compositor_pad));
+	}
+
+	g_array_set_size(self->pad_jobs, 0);
 }
 
 
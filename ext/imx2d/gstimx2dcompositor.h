@@ -56,7 +56,23 @@ struct _GstImx2dCompositor
 	GstVideoInfo output_video_info;
 	Imx2dSurface *output_surface;
 
+	/* Array of GstImx2dCompositorPadJob instances, one
+	 * for each sinkpad that contributes to the current
+	 * output frame. Empty outside of aggregate_frames(). */
+	GArray *pad_jobs;
+
+	/* Pool of worker threads that upload and prepare the
+	 * input frames of all jobs except for the first one,
+	 * which is handled by the aggregator's thread. NULL
+	 * if only one thread is used. */
+	GThreadPool *thread_pool;
+	GMutex pad_jobs_mutex;
+	GCond pad_jobs_cond;
+	guint num_pending_pad_jobs;
+
 	guint32 background_color;
+	guint prewarm_buffers;
+	guint num_threads;
 };
 
 
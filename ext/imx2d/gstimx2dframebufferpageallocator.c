@@ -0,0 +1,523 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/allocators/allocators.h>
+#include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gstimx2dframebufferpageallocator.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_2d_framebuffer_page_allocator_debug);
+#define GST_CAT_DEFAULT imx_2d_framebuffer_page_allocator_debug
+
+
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_MEMORY_TYPE "Imx2dFramebufferPageMemory"
+
+
+typedef struct _GstImx2dFramebufferPageMemory GstImx2dFramebufferPageMemory;
+
+
+struct _GstImx2dFramebufferPageMemory
+{
+	GstMemory parent;
+	gint page_index;
+
+	/* Copy of the page's physical address and size. Unlike the
+	 * framebuffer's own DMA buffer of that page, this one stays valid
+	 * for as long as the memory block exists, even after the allocator
+	 * was detached. Mapping it is forwarded to the framebuffer, and
+	 * fails once the allocator was detached. Unused in memory blocks
+	 * created by gst_memory_share(); these use their parent's. */
+	ImxWrappedDmaBuffer dma_buffer;
+};
+
+
+struct _GstImx2dFramebufferPageAllocator
+{
+	GstAllocator parent;
+
+	/*< private >*/
+
+	/* Set to NULL by gst_imx_2d_framebuffer_page_allocator_detach().
+	 * Protected by the object lock, like num_pages and page_in_use. */
+	Imx2dLinuxFramebuffer *linux_framebuffer;
+	gint num_pages;
+	gsize page_size;
+	gboolean page_in_use[IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_SCANOUT_PAGES];
+
+	/* The scanout pages are added by add_pages_func on the first
+	 * allocation. This is serialized by add_pages_mutex and not by the
+	 * object lock, since add_pages_func may have to wait for threads
+	 * that map memory blocks from this allocator. If adding the pages
+	 * failed, allocations fall back to system memory. */
+	GMutex add_pages_mutex;
+	GstImx2dFramebufferPageAllocatorAddPagesFunc add_pages_func;
+	gpointer add_pages_func_user_data;
+	gboolean pages_added;
+	gboolean adding_pages_failed;
+};
+
+
+struct _GstImx2dFramebufferPageAllocatorClass
+{
+	GstAllocatorClass parent_class;
+};
+
+
+static void gst_imx_2d_framebuffer_page_allocator_phys_mem_allocator_iface_init(gpointer iface, gpointer iface_data);
+static guintptr gst_imx_2d_framebuffer_page_allocator_get_phys_addr(GstPhysMemoryAllocator *allocator, GstMemory *memory);
+
+static void gst_imx_2d_framebuffer_page_allocator_dma_buffer_allocator_iface_init(gpointer iface, gpointer iface_data);
+static ImxDmaBuffer* gst_imx_2d_framebuffer_page_allocator_get_dma_buffer(GstImxDmaBufferAllocator *allocator, GstMemory *memory);
+
+
+G_DEFINE_TYPE_WITH_CODE(
+	GstImx2dFramebufferPageAllocator, gst_imx_2d_framebuffer_page_allocator, GST_TYPE_ALLOCATOR,
+	G_IMPLEMENT_INTERFACE(GST_TYPE_PHYS_MEMORY_ALLOCATOR,    gst_imx_2d_framebuffer_page_allocator_phys_mem_allocator_iface_init)
+	G_IMPLEMENT_INTERFACE(GST_TYPE_IMX_DMA_BUFFER_ALLOCATOR, gst_imx_2d_framebuffer_page_allocator_dma_buffer_allocator_iface_init)
+)
+
+static void gst_imx_2d_framebuffer_page_allocator_finalize(GObject *object);
+static GstMemory* gst_imx_2d_framebuffer_page_allocator_alloc(GstAllocator *allocator, gsize size, GstAllocationParams *params);
+static void gst_imx_2d_framebuffer_page_allocator_free(GstAllocator *allocator, GstMemory *memory);
+
+static gpointer gst_imx_2d_framebuffer_page_allocator_map(GstMemory *memory, GstMapInfo *info, gsize maxsize);
+static void gst_imx_2d_framebuffer_page_allocator_unmap(GstMemory *memory, GstMapInfo *info);
+static GstMemory * gst_imx_2d_framebuffer_page_allocator_copy(GstMemory *memory, gssize offset, gssize size);
+static GstMemory * gst_imx_2d_framebuffer_page_allocator_share(GstMemory *memory, gssize offset, gssize size);
+static gboolean gst_imx_2d_framebuffer_page_allocator_is_span(GstMemory *memory1, GstMemory *memory2, gsize *offset);
+
+static gboolean gst_imx_2d_framebuffer_page_allocator_add_pages(GstImx2dFramebufferPageAllocator *self);
+static uint8_t* gst_imx_2d_framebuffer_page_allocator_map_dma_buffer(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error);
+static void gst_imx_2d_framebuffer_page_allocator_unmap_dma_buffer(ImxWrappedDmaBuffer *wrapped_dma_buffer);
+
+
+
+
+static void gst_imx_2d_framebuffer_page_allocator_class_init(GstImx2dFramebufferPageAllocatorClass *klass)
+{
+	GObjectClass *object_class;
+	GstAllocatorClass *allocator_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_2d_framebuffer_page_allocator_debug, "imx2dframebufferpageallocator", 0, "NXP i.MX 2D framebuffer scanout page allocator");
+
+	object_class = G_OBJECT_CLASS(klass);
+	allocator_class = GST_ALLOCATOR_CLASS(klass);
+
+	object_class->finalize = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_finalize);
+
+	allocator_class->alloc = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_alloc);
+	allocator_class->free = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_free);
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_init(GstImx2dFramebufferPageAllocator *self)
+{
+	GstAllocator *allocator = GST_ALLOCATOR(self);
+
+	allocator->mem_type       = GST_IMX_2D_FRAMEBUFFER_PAGE_MEMORY_TYPE;
+	allocator->mem_map_full   = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_map);
+	allocator->mem_unmap_full = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_unmap);
+	allocator->mem_copy       = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_copy);
+	allocator->mem_share      = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_share);
+	allocator->mem_is_span    = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_is_span);
+
+	/* Scanout pages are a scarce resource, so they must
+	 * not be handed out by gst_allocator_alloc(NULL, ...)
+	 * if this allocator were ever registered. */
+	GST_OBJECT_FLAG_SET(self, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+
+	self->linux_framebuffer = NULL;
+	self->num_pages = 0;
+	self->page_size = 0;
+	memset(self->page_in_use, 0, sizeof(self->page_in_use));
+
+	g_mutex_init(&(self->add_pages_mutex));
+	self->add_pages_func = NULL;
+	self->add_pages_func_user_data = NULL;
+	self->pages_added = FALSE;
+	self->adding_pages_failed = FALSE;
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_finalize(GObject *object)
+{
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(object);
+
+	g_mutex_clear(&(self->add_pages_mutex));
+
+	G_OBJECT_CLASS(gst_imx_2d_framebuffer_page_allocator_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_phys_mem_allocator_iface_init(gpointer iface, gpointer G_GNUC_UNUSED iface_data)
+{
+	GstPhysMemoryAllocatorInterface *phys_mem_allocator_iface = (GstPhysMemoryAllocatorInterface *)iface;
+	phys_mem_allocator_iface->get_phys_addr = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_get_phys_addr);
+}
+
+
+static guintptr gst_imx_2d_framebuffer_page_allocator_get_phys_addr(GstPhysMemoryAllocator *allocator, GstMemory *memory)
+{
+	ImxDmaBuffer *dma_buffer = gst_imx_2d_framebuffer_page_allocator_get_dma_buffer(GST_IMX_DMA_BUFFER_ALLOCATOR_CAST(allocator), memory);
+	return (dma_buffer != NULL) ? (imx_dma_buffer_get_physical_address(dma_buffer) + memory->offset) : 0;
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_dma_buffer_allocator_iface_init(gpointer iface, gpointer G_GNUC_UNUSED iface_data)
+{
+	GstImxDmaBufferAllocatorInterface *imx_dma_buffer_allocator_iface = (GstImxDmaBufferAllocatorInterface *)iface;
+	imx_dma_buffer_allocator_iface->get_dma_buffer = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_page_allocator_get_dma_buffer);
+}
+
+
+static ImxDmaBuffer* gst_imx_2d_framebuffer_page_allocator_get_dma_buffer(G_GNUC_UNUSED GstImxDmaBufferAllocator *allocator, GstMemory *memory)
+{
+	if (memory->parent != NULL)
+		memory = memory->parent;
+
+	return (ImxDmaBuffer *)&(((GstImx2dFramebufferPageMemory *)memory)->dma_buffer);
+}
+
+
+static GstMemory* gst_imx_2d_framebuffer_page_allocator_alloc(GstAllocator *allocator, gsize size, GstAllocationParams *params)
+{
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(allocator);
+	GstImx2dFramebufferPageMemory *page_memory = NULL;
+	gsize total_size = params->prefix + size + params->padding;
+	gint page_index;
+	ImxDmaBuffer *fb_dma_buffer;
+
+	/* Upstream can still produce frames if the pages could not be
+	 * added. get_page_index() returns -1 for such memory blocks, so
+	 * the sink blits them like any other frame. */
+	if (!gst_imx_2d_framebuffer_page_allocator_add_pages(self))
+		return gst_allocator_alloc(NULL, size, params);
+
+	GST_OBJECT_LOCK(self);
+
+	if (G_UNLIKELY(self->linux_framebuffer == NULL))
+	{
+		GST_ERROR_OBJECT(self, "cannot allocate page: allocator was detached from the framebuffer");
+		goto finish;
+	}
+
+	if (G_UNLIKELY(total_size > self->page_size))
+	{
+		GST_ERROR_OBJECT(self, "cannot allocate %" G_GSIZE_FORMAT " byte(s): pages only have %" G_GSIZE_FORMAT " byte(s)", total_size, self->page_size);
+		goto finish;
+	}
+
+	for (page_index = 0; page_index < self->num_pages; ++page_index)
+	{
+		if (!self->page_in_use[page_index])
+			break;
+	}
+
+	if (G_UNLIKELY(page_index == self->num_pages))
+	{
+		GST_ERROR_OBJECT(self, "cannot allocate page: all %d page(s) are in use", self->num_pages);
+		goto finish;
+	}
+
+	self->page_in_use[page_index] = TRUE;
+
+	page_memory = g_slice_alloc0(sizeof(GstImx2dFramebufferPageMemory));
+	gst_memory_init(GST_MEMORY_CAST(page_memory), params->flags | GST_MEMORY_FLAG_PHYSICALLY_CONTIGUOUS, allocator, NULL, self->page_size, params->align, params->prefix, size);
+	page_memory->page_index = page_index;
+
+	fb_dma_buffer = imx_2d_linux_framebuffer_get_scanout_page_dma_buffer(self->linux_framebuffer, page_index);
+	imx_dma_buffer_init_wrapped_buffer(&(page_memory->dma_buffer));
+	page_memory->dma_buffer.fd = -1;
+	page_memory->dma_buffer.physical_address = imx_dma_buffer_get_physical_address(fb_dma_buffer);
+	page_memory->dma_buffer.size = imx_dma_buffer_get_size(fb_dma_buffer);
+	page_memory->dma_buffer.map = gst_imx_2d_framebuffer_page_allocator_map_dma_buffer;
+	page_memory->dma_buffer.unmap = gst_imx_2d_framebuffer_page_allocator_unmap_dma_buffer;
+
+	GST_DEBUG_OBJECT(self, "allocated page #%d", page_index);
+
+finish:
+	GST_OBJECT_UNLOCK(self);
+	return GST_MEMORY_CAST(page_memory);
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_free(GstAllocator *allocator, GstMemory *memory)
+{
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(allocator);
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)memory;
+
+	/* Shared memory blocks refer to the page of their parent;
+	 * only freeing the parent makes the page available again. */
+	if (memory->parent == NULL)
+	{
+		GST_OBJECT_LOCK(self);
+		self->page_in_use[page_memory->page_index] = FALSE;
+		GST_OBJECT_UNLOCK(self);
+
+		GST_DEBUG_OBJECT(self, "freed page #%d", page_memory->page_index);
+	}
+
+	g_slice_free1(sizeof(GstImx2dFramebufferPageMemory), page_memory);
+}
+
+
+static gpointer gst_imx_2d_framebuffer_page_allocator_map(GstMemory *memory, GstMapInfo *info, gsize maxsize)
+{
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)memory;
+	uint8_t *mapped_virtual_address;
+	unsigned int flags = 0;
+	int error = 0;
+
+	if (memory->parent != NULL)
+		return gst_imx_2d_framebuffer_page_allocator_map(memory->parent, info, maxsize);
+
+	if (info->flags & GST_MAP_READ)
+		flags |= IMX_DMA_BUFFER_MAPPING_FLAG_READ;
+	if (info->flags & GST_MAP_WRITE)
+		flags |= IMX_DMA_BUFFER_MAPPING_FLAG_WRITE;
+
+	mapped_virtual_address = imx_dma_buffer_map((ImxDmaBuffer *)&(page_memory->dma_buffer), flags, &error);
+	if (mapped_virtual_address == NULL)
+		GST_ERROR_OBJECT(memory->allocator, "could not map page #%d: %s (%d)", page_memory->page_index, strerror(error), error);
+
+	return mapped_virtual_address;
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_unmap(GstMemory *memory, G_GNUC_UNUSED GstMapInfo *info)
+{
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)memory;
+
+	if (memory->parent != NULL)
+	{
+		gst_imx_2d_framebuffer_page_allocator_unmap(memory->parent, info);
+		return;
+	}
+
+	imx_dma_buffer_unmap((ImxDmaBuffer *)&(page_memory->dma_buffer));
+}
+
+
+static GstMemory * gst_imx_2d_framebuffer_page_allocator_copy(GstMemory *memory, gssize offset, gssize size)
+{
+	GstMemory *copy = NULL;
+	GstMapInfo src_map_info, dest_map_info;
+
+	/* Copies cannot be placed in another scanout page, since these are
+	 * reserved for the buffer pool. Copy into system memory instead. */
+
+	if (size == -1)
+		size = ((gssize)(memory->size) > offset) ? ((gssize)(memory->size) - offset) : 0;
+
+	if (!gst_memory_map(memory, &src_map_info, GST_MAP_READ))
+	{
+		GST_ERROR_OBJECT(memory->allocator, "could not map page for copy");
+		return NULL;
+	}
+
+	copy = gst_allocator_alloc(NULL, size, NULL);
+	if (G_UNLIKELY(copy == NULL))
+	{
+		GST_ERROR_OBJECT(memory->allocator, "could not allocate system memory for copy");
+		goto finish;
+	}
+
+	if (!gst_memory_map(copy, &dest_map_info, GST_MAP_WRITE))
+	{
+		GST_ERROR_OBJECT(memory->allocator, "could not map system memory for copy");
+		gst_memory_unref(copy);
+		copy = NULL;
+		goto finish;
+	}
+
+	memcpy(dest_map_info.data, src_map_info.data + offset, size);
+
+	gst_memory_unmap(copy, &dest_map_info);
+
+finish:
+	gst_memory_unmap(memory, &src_map_info);
+	return copy;
+}
+
+
+static GstMemory * gst_imx_2d_framebuffer_page_allocator_share(GstMemory *memory, gssize offset, gssize size)
+{
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)memory;
+	GstImx2dFramebufferPageMemory *new_page_memory;
+	GstMemory *parent;
+
+	if (size == -1)
+		size = ((gssize)(memory->size) > offset) ? ((gssize)(memory->size) - offset) : 0;
+
+	if ((parent = memory->parent) == NULL)
+		parent = memory;
+
+	new_page_memory = g_slice_alloc0(sizeof(GstImx2dFramebufferPageMemory));
+	gst_memory_init(GST_MEMORY_CAST(new_page_memory), GST_MINI_OBJECT_FLAGS(parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY | GST_MEMORY_FLAG_PHYSICALLY_CONTIGUOUS, memory->allocator, parent, memory->maxsize, memory->align, memory->offset + offset, size);
+	new_page_memory->page_index = page_memory->page_index;
+
+	return GST_MEMORY_CAST(new_page_memory);
+}
+
+
+static gboolean gst_imx_2d_framebuffer_page_allocator_is_span(G_GNUC_UNUSED GstMemory *memory1, G_GNUC_UNUSED GstMemory *memory2, G_GNUC_UNUSED gsize *offset)
+{
+	/* Each memory block covers a separate page, and
+	 * pages are never treated as one contiguous block. */
+	return FALSE;
+}
+
+
+static gboolean gst_imx_2d_framebuffer_page_allocator_add_pages(GstImx2dFramebufferPageAllocator *self)
+{
+	gboolean detached;
+	gboolean ret;
+
+	g_mutex_lock(&(self->add_pages_mutex));
+
+	if (self->pages_added || self->adding_pages_failed)
+		goto finish;
+
+	/* detach() also locks add_pages_mutex, so if the allocator is
+	 * still attached here, the framebuffer stays valid until the
+	 * pages were added. */
+	GST_OBJECT_LOCK(self);
+	detached = (self->linux_framebuffer == NULL);
+	GST_OBJECT_UNLOCK(self);
+
+	if (detached)
+	{
+		GST_ERROR_OBJECT(self, "cannot add scanout pages: allocator was detached from the framebuffer");
+		self->adding_pages_failed = TRUE;
+		goto finish;
+	}
+
+	if (!self->add_pages_func(self->add_pages_func_user_data))
+	{
+		GST_WARNING_OBJECT(self, "could not add scanout pages to framebuffer; allocating system memory instead");
+		self->adding_pages_failed = TRUE;
+		goto finish;
+	}
+
+	GST_OBJECT_LOCK(self);
+	self->num_pages = imx_2d_linux_framebuffer_get_num_scanout_pages(self->linux_framebuffer);
+	GST_OBJECT_UNLOCK(self);
+
+	self->pages_added = TRUE;
+
+	GST_DEBUG_OBJECT(self, "added %d scanout page(s) of %" G_GSIZE_FORMAT " byte(s) each", self->num_pages, self->page_size);
+
+finish:
+	ret = self->pages_added;
+	g_mutex_unlock(&(self->add_pages_mutex));
+	return ret;
+}
+
+
+static uint8_t* gst_imx_2d_framebuffer_page_allocator_map_dma_buffer(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error)
+{
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)((guint8 *)wrapped_dma_buffer - G_STRUCT_OFFSET(GstImx2dFramebufferPageMemory, dma_buffer));
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(GST_MEMORY_CAST(page_memory)->allocator);
+	uint8_t *mapped_virtual_address = NULL;
+
+	GST_OBJECT_LOCK(self);
+
+	if (G_LIKELY(self->linux_framebuffer != NULL))
+	{
+		ImxDmaBuffer *fb_dma_buffer = imx_2d_linux_framebuffer_get_scanout_page_dma_buffer(self->linux_framebuffer, page_memory->page_index);
+		mapped_virtual_address = imx_dma_buffer_map(fb_dma_buffer, flags, error);
+	}
+	else
+	{
+		GST_ERROR_OBJECT(self, "cannot map page #%d: allocator was detached from the framebuffer", page_memory->page_index);
+		if (error != NULL)
+			*error = ENODEV;
+	}
+
+	GST_OBJECT_UNLOCK(self);
+
+	return mapped_virtual_address;
+}
+
+
+static void gst_imx_2d_framebuffer_page_allocator_unmap_dma_buffer(ImxWrappedDmaBuffer *wrapped_dma_buffer)
+{
+	GstImx2dFramebufferPageMemory *page_memory = (GstImx2dFramebufferPageMemory *)((guint8 *)wrapped_dma_buffer - G_STRUCT_OFFSET(GstImx2dFramebufferPageMemory, dma_buffer));
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(GST_MEMORY_CAST(page_memory)->allocator);
+
+	GST_OBJECT_LOCK(self);
+	if (self->linux_framebuffer != NULL)
+		imx_dma_buffer_unmap(imx_2d_linux_framebuffer_get_scanout_page_dma_buffer(self->linux_framebuffer, page_memory->page_index));
+	GST_OBJECT_UNLOCK(self);
+}
+
+
+GstAllocator* gst_imx_2d_framebuffer_page_allocator_new(Imx2dLinuxFramebuffer *linux_framebuffer, GstImx2dFramebufferPageAllocatorAddPagesFunc add_pages_func, gpointer user_data)
+{
+	GstImx2dFramebufferPageAllocator *self;
+	Imx2dSurfaceDesc const *fb_surface_desc;
+
+	g_assert(linux_framebuffer != NULL);
+	g_assert(add_pages_func != NULL);
+
+	self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_CAST(g_object_new(gst_imx_2d_framebuffer_page_allocator_get_type(), NULL));
+
+	fb_surface_desc = imx_2d_surface_get_desc(imx_2d_linux_framebuffer_get_surface(linux_framebuffer));
+
+	self->linux_framebuffer = linux_framebuffer;
+	self->page_size = (gsize)(fb_surface_desc->plane_strides[0]) * fb_surface_desc->height;
+	self->add_pages_func = add_pages_func;
+	self->add_pages_func_user_data = user_data;
+
+	GST_DEBUG_OBJECT(self, "created new framebuffer page allocator with pages of %" G_GSIZE_FORMAT " byte(s) each", self->page_size);
+
+	/* Clear floating flag */
+	gst_object_ref_sink(GST_OBJECT(self));
+
+	return GST_ALLOCATOR_CAST(self);
+}
+
+
+void gst_imx_2d_framebuffer_page_allocator_detach(GstAllocator *allocator)
+{
+	GstImx2dFramebufferPageAllocator *self = GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(allocator);
+
+	/* Wait until pages that are currently being added are added. */
+	g_mutex_lock(&(self->add_pages_mutex));
+	GST_OBJECT_LOCK(self);
+	self->linux_framebuffer = NULL;
+	GST_OBJECT_UNLOCK(self);
+	g_mutex_unlock(&(self->add_pages_mutex));
+
+	GST_DEBUG_OBJECT(self, "detached allocator from framebuffer");
+}
+
+
+gint gst_imx_2d_framebuffer_page_allocator_get_page_index(GstAllocator *allocator, GstMemory *memory)
+{
+	g_assert(allocator != NULL);
+	g_assert(memory != NULL);
+
+	if ((memory->allocator != allocator) || (memory->offset != 0))
+		return -1;
+
+	return ((GstImx2dFramebufferPageMemory *)memory)->page_index;
+}
@@ -0,0 +1,95 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_H
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_H
+
+#include <gst/gst.h>
+#include "imx2d/linux_framebuffer.h"
+
+
+G_BEGIN_DECLS
+
+
+/* The GstImx2dFramebufferPageAllocator is an internal object used
+ * by the imx2d video sinks. It hands out the scanout pages of an
+ * Imx2dLinuxFramebuffer (see imx_2d_linux_framebuffer_add_scanout_pages())
+ * as GstMemory blocks. Each allocation occupies one page; if all
+ * pages are in use, allocations fail. Sinks put this allocator into
+ * a buffer pool that they propose to upstream. Frames that upstream
+ * writes into buffers from that pool already reside in framebuffer
+ * memory, so the sink can show them by panning the display to their
+ * page instead of blitting them.
+ *
+ * The memory blocks implement the GstImxDmaBufferAllocator interface,
+ * so other imx elements and the sink's uploader treat them just like
+ * any other DMA buffer memory (for example, when the sink has to fall
+ * back to blitting).
+ *
+ * The scanout pages are not added to the framebuffer right away,
+ * since that enlarges the virtual framebuffer. Instead, the allocator
+ * calls add_pages_func on its first allocation, that is, once upstream
+ * actually uses the pool. add_pages_func adds the pages (for example
+ * with imx_2d_linux_framebuffer_add_scanout_pages()) and returns TRUE
+ * on success. It is called from whatever thread allocates, without
+ * the allocator's object lock held, so it may wait for threads that
+ * map memory blocks from this allocator. If it fails, the allocator
+ * hands out system memory instead, and the sink blits these frames.
+ *
+ * The allocator does not own the framebuffer. Before the framebuffer
+ * is destroyed, gst_imx_2d_framebuffer_page_allocator_detach() must
+ * be called. Memory blocks that still exist after that cannot be
+ * mapped anymore, but their DMA buffers stay valid, so their physical
+ * address can still be queried.
+ */
+
+
+#define GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR             (gst_imx_2d_framebuffer_page_allocator_get_type())
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR, GstImx2dFramebufferPageAllocator))
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR, GstImx2dFramebufferPageAllocatorClass))
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR, GstImx2dFramebufferPageAllocatorClass))
+#define GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_CAST(obj)        ((GstImx2dFramebufferPageAllocator *)(obj))
+#define GST_IS_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR))
+#define GST_IS_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR))
+
+
+typedef struct _GstImx2dFramebufferPageAllocator GstImx2dFramebufferPageAllocator;
+typedef struct _GstImx2dFramebufferPageAllocatorClass GstImx2dFramebufferPageAllocatorClass;
+
+typedef gboolean (*GstImx2dFramebufferPageAllocatorAddPagesFunc)(gpointer user_data);
+
+
+GType gst_imx_2d_framebuffer_page_allocator_get_type(void);
+
+GstAllocator* gst_imx_2d_framebuffer_page_allocator_new(Imx2dLinuxFramebuffer *linux_framebuffer, GstImx2dFramebufferPageAllocatorAddPagesFunc add_pages_func, gpointer user_data);
+
+/* Detaches the allocator from the framebuffer. If add_pages_func is
+ * running in another thread, this waits until it finished. */
+void gst_imx_2d_framebuffer_page_allocator_detach(GstAllocator *allocator);
+
+/* Returns the scanout page number of the given memory block, or -1 if
+ * the memory block was not allocated by the given allocator, or if
+ * it does not cover its entire page (for example because it was
+ * created by gst_memory_share() with a nonzero offset). */
+gint gst_imx_2d_framebuffer_page_allocator_get_page_index(GstAllocator *allocator, GstMemory *memory);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_FRAMEBUFFER_PAGE_ALLOCATOR_H */
@@ -0,0 +1,1519 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gst/imx/video/gstimxvideobufferpool.h"
+#include "gstimx2dvideofanout.h"
+#include "gstimx2dmisc.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_2d_video_fanout_debug);
+#define GST_CAT_DEFAULT imx_2d_video_fanout_debug
+
+
+
+
+/********** GstImx2dVideoFanoutSrcPad **********/
+
+
+#define GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD             (gst_imx_2d_video_fanout_src_pad_get_type())
+#define GST_IMX_2D_VIDEO_FANOUT_SRC_PAD(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD, GstImx2dVideoFanoutSrcPad))
+#define GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD, GstImx2dVideoFanoutSrcPadClass))
+#define GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(obj)        ((GstImx2dVideoFanoutSrcPad *)(obj))
+#define GST_IS_IMX_2D_VIDEO_FANOUT_SRC_PAD(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD))
+#define GST_IS_IMX_2D_VIDEO_FANOUT_SRC_PAD_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD))
+
+
+typedef struct _GstImx2dVideoFanoutSrcPad GstImx2dVideoFanoutSrcPad;
+typedef struct _GstImx2dVideoFanoutSrcPadClass GstImx2dVideoFanoutSrcPadClass;
+
+
+GType gst_imx_2d_video_fanout_src_pad_get_type(void);
+
+
+struct _GstImx2dVideoFanoutSrcPad
+{
+	GstPad parent;
+
+	/* imx2d output surface. This is created once per pad,
+	 * and gets the DMA buffer of the current intermediate
+	 * buffer assigned for each input buffer. */
+	Imx2dSurface *output_surface;
+
+	/* Set up by gst_imx_2d_video_fanout_negotiate_src_pad().
+	 * These are only accessed by the streaming thread. */
+	GstImxVideoBufferPool *video_buffer_pool;
+	GstVideoInfo output_video_info;
+	gboolean negotiated;
+	gboolean negotiated_transposed;
+
+	GstVideoOrientationMethod video_direction;
+};
+
+
+struct _GstImx2dVideoFanoutSrcPadClass
+{
+	GstPadClass parent_class;
+};
+
+
+enum
+{
+	PROP_PAD_0,
+	PROP_PAD_VIDEO_DIRECTION
+};
+
+#define DEFAULT_PAD_VIDEO_DIRECTION GST_VIDEO_ORIENTATION_IDENTITY
+
+
+static void gst_imx_2d_video_fanout_src_pad_video_direction_interface_init(G_GNUC_UNUSED GstVideoDirectionInterface *iface)
+{
+	/* We implement the video-direction property */
+}
+
+
+G_DEFINE_TYPE_WITH_CODE(
+	GstImx2dVideoFanoutSrcPad,
+	gst_imx_2d_video_fanout_src_pad,
+	GST_TYPE_PAD,
+	G_IMPLEMENT_INTERFACE(GST_TYPE_VIDEO_DIRECTION, gst_imx_2d_video_fanout_src_pad_video_direction_interface_init)
+)
+
+static void gst_imx_2d_video_fanout_src_pad_finalize(GObject *object);
+
+static void gst_imx_2d_video_fanout_src_pad_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_2d_video_fanout_src_pad_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+
+static void gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(GstImx2dVideoFanoutSrcPad *self);
+
+
+static void gst_imx_2d_video_fanout_src_pad_class_init(GstImx2dVideoFanoutSrcPadClass *klass)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS(klass);
+
+	object_class->finalize      = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_src_pad_finalize);
+	object_class->set_property  = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_src_pad_set_property);
+	object_class->get_property  = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_src_pad_get_property);
+
+	g_object_class_override_property(object_class, PROP_PAD_VIDEO_DIRECTION, "video-direction");
+}
+
+
+static void gst_imx_2d_video_fanout_src_pad_init(GstImx2dVideoFanoutSrcPad *self)
+{
+	self->output_surface = imx_2d_surface_create(NULL);
+
+	self->video_buffer_pool = NULL;
+	gst_video_info_init(&(self->output_video_info));
+	self->negotiated = FALSE;
+	self->negotiated_transposed = FALSE;
+
+	self->video_direction = DEFAULT_PAD_VIDEO_DIRECTION;
+}
+
+
+static void gst_imx_2d_video_fanout_src_pad_finalize(GObject *object)
+{
+	GstImx2dVideoFanoutSrcPad *self = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD(object);
+
+	gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(self);
+
+	if (self->output_surface != NULL)
+		imx_2d_surface_destroy(self->output_surface);
+
+	G_OBJECT_CLASS(gst_imx_2d_video_fanout_src_pad_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_video_fanout_src_pad_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImx2dVideoFanoutSrcPad *self = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD(object);
+
+	switch (prop_id)
+	{
+		case PROP_PAD_VIDEO_DIRECTION:
+			GST_OBJECT_LOCK(self);
+			self->video_direction = g_value_get_enum(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_2d_video_fanout_src_pad_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImx2dVideoFanoutSrcPad *self = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD(object);
+
+	switch (prop_id)
+	{
+		case PROP_PAD_VIDEO_DIRECTION:
+			GST_OBJECT_LOCK(self);
+			g_value_set_enum(value, self->video_direction);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(GstImx2dVideoFanoutSrcPad *self)
+{
+	if (self->video_buffer_pool == NULL)
+		return;
+
+	gst_buffer_pool_set_active(gst_imx_video_buffer_pool_get_output_video_buffer_pool(self->video_buffer_pool), FALSE);
+	gst_object_unref(GST_OBJECT(self->video_buffer_pool));
+	self->video_buffer_pool = NULL;
+}
+
+
+
+
+/********** GstImx2dVideoFanout **********/
+
+
+enum
+{
+	PROP_0,
+	PROP_INPUT_CROP,
+	PROP_PREWARM_BUFFERS,
+	PROP_UPLOAD_STATS
+};
+
+
+#define DEFAULT_INPUT_CROP TRUE
+#define DEFAULT_PREWARM_BUFFERS 0
+
+
+
+
+/* We must implement the GstChildProxy interface to allow
+ * access to the custom src pad properties (video-direction). */
+static void gst_imx_2d_video_fanout_child_proxy_iface_init(gpointer iface, gpointer iface_data);
+static GObject* gst_imx_2d_video_fanout_child_proxy_get_child_by_index(GstChildProxy *child_proxy, guint index);
+static guint gst_imx_2d_video_fanout_child_proxy_get_children_count(GstChildProxy *child_proxy);
+
+
+G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
+	GstImx2dVideoFanout, gst_imx_2d_video_fanout, GST_TYPE_ELEMENT,
+	G_IMPLEMENT_INTERFACE(GST_TYPE_CHILD_PROXY, gst_imx_2d_video_fanout_child_proxy_iface_init)
+)
+
+
+/* Base class function overloads. */
+
+/* General element operations. */
+static void gst_imx_2d_video_fanout_finalize(GObject *object);
+static void gst_imx_2d_video_fanout_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_2d_video_fanout_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+static GstStateChangeReturn gst_imx_2d_video_fanout_change_state(GstElement *element, GstStateChange transition);
+static GstPad* gst_imx_2d_video_fanout_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, GstCaps const *caps);
+static void gst_imx_2d_video_fanout_release_pad(GstElement *element, GstPad *pad);
+
+/* Pad functions. */
+static gboolean gst_imx_2d_video_fanout_sink_event(GstPad *pad, GstObject *parent, GstEvent *event);
+static gboolean gst_imx_2d_video_fanout_sink_query(GstPad *pad, GstObject *parent, GstQuery *query);
+static GstFlowReturn gst_imx_2d_video_fanout_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *input_buffer);
+static gboolean gst_imx_2d_video_fanout_src_query(GstPad *pad, GstObject *parent, GstQuery *query);
+static gboolean gst_imx_2d_video_fanout_copy_sticky_event(GstPad *pad, GstEvent **event, gpointer user_data);
+
+
+/* GstImx2dVideoFanout specific functions. */
+
+static gboolean gst_imx_2d_video_fanout_start(GstImx2dVideoFanout *self);
+static void gst_imx_2d_video_fanout_stop(GstImx2dVideoFanout *self);
+static void gst_imx_2d_video_fanout_reset(GstImx2dVideoFanout *self);
+static gboolean gst_imx_2d_video_fanout_set_input_caps(GstImx2dVideoFanout *self, GstCaps *input_caps);
+static GstCaps* gst_imx_2d_video_fanout_get_src_caps(GstImx2dVideoFanout *self, GstPad *src_pad, GstCaps *filter);
+static GstCaps* gst_imx_2d_video_fanout_fixate_src_caps(GstImx2dVideoFanout *self, GstCaps *caps, gboolean transposed);
+static gboolean gst_imx_2d_video_fanout_negotiate_src_pad(GstImx2dVideoFanout *self, GstImx2dVideoFanoutSrcPad *src_pad, gboolean transposed);
+static void gst_imx_2d_video_fanout_negotiate_src_pads(GstImx2dVideoFanout *self, gboolean only_unnegotiated);
+static GstFlowReturn gst_imx_2d_video_fanout_process_src_pad(GstImx2dVideoFanout *self, GstImx2dVideoFanoutSrcPad *src_pad, GstBuffer *input_buffer, Imx2dRegion const *source_region, GstVideoOrientationMethod tag_video_direction);
+static gboolean gst_imx_2d_video_fanout_create_blitter(GstImx2dVideoFanout *self);
+static gboolean gst_imx_2d_video_fanout_is_transposed(GstVideoOrientationMethod video_direction);
+
+
+
+
+static void gst_imx_2d_video_fanout_class_init(GstImx2dVideoFanoutClass *klass)
+{
+	GObjectClass *object_class;
+	GstElementClass *element_class;
+
+	gst_imx_2d_setup_logging();
+
+	GST_DEBUG_CATEGORY_INIT(imx_2d_video_fanout_debug, "imx2dvideofanout", 0, "NXP i.MX 2D video fan-out base class");
+
+	object_class = G_OBJECT_CLASS(klass);
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_finalize);
+	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_set_property);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_get_property);
+
+	element_class->change_state    = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_change_state);
+	element_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_request_new_pad);
+	element_class->release_pad     = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_release_pad);
+
+	klass->create_blitter = NULL;
+
+	g_object_class_install_property(
+		object_class,
+		PROP_INPUT_CROP,
+		g_param_spec_boolean(
+			"input-crop",
+			"Input crop",
+			"Whether or not to crop input frames based on their video crop metadata",
+			DEFAULT_INPUT_CROP,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PREWARM_BUFFERS,
+		g_param_spec_uint(
+			"prewarm-buffers",
+			"Prewarm buffers",
+			"How many output buffers to allocate per src pad as soon as its output buffer pool is set up "
+			"(0 = allocate buffers on demand; higher values avoid allocation stalls during playback)",
+			0, G_MAXUINT,
+			DEFAULT_PREWARM_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+}
+
+
+static void gst_imx_2d_video_fanout_init(GstImx2dVideoFanout *self)
+{
+	GstPadTemplate *sink_template;
+
+	sink_template = gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(self), "sink");
+	self->sinkpad = gst_pad_new_from_template(sink_template, "sink");
+	gst_pad_set_event_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_sink_event));
+	gst_pad_set_query_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_sink_query));
+	gst_pad_set_chain_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_sink_chain));
+	gst_element_add_pad(GST_ELEMENT(self), self->sinkpad);
+
+	self->uploader = NULL;
+	self->imx_dma_buffer_allocator = NULL;
+
+	self->blitter = NULL;
+
+	/* NOTE: This is created here instead of in start() because
+	 * src pads may be requested before start() runs, and
+	 * request_new_pad() adds these pads to the combiner. */
+	self->flow_combiner = gst_flow_combiner_new();
+	self->next_src_pad_index = 0;
+
+	self->input_info_set = FALSE;
+	gst_video_info_init(&(self->input_video_info));
+	self->input_caps = NULL;
+
+	self->input_surface = NULL;
+	memset(&(self->input_surface_desc), 0, sizeof(self->input_surface_desc));
+
+	self->input_crop = DEFAULT_INPUT_CROP;
+	self->prewarm_buffers = DEFAULT_PREWARM_BUFFERS;
+
+	self->tag_video_direction = DEFAULT_PAD_VIDEO_DIRECTION;
+}
+
+
+static void gst_imx_2d_video_fanout_child_proxy_iface_init(gpointer iface, G_GNUC_UNUSED gpointer iface_data)
+{
+	GstChildProxyInterface *child_proxy_iface = (GstChildProxyInterface *)iface;
+
+	child_proxy_iface->get_child_by_index = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_child_proxy_get_child_by_index);
+	child_proxy_iface->get_children_count = GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_child_proxy_get_children_count);
+}
+
+
+static GObject* gst_imx_2d_video_fanout_child_proxy_get_child_by_index(GstChildProxy *child_proxy, guint index)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(child_proxy);
+	GObject *obj = NULL;
+
+	/* Lock the element to make sure that src pads aren't
+	 * added/removed while we access the srcpads list. */
+	GST_OBJECT_LOCK(self);
+	obj = g_list_nth_data(GST_ELEMENT_CAST(self)->srcpads, index);
+	if (obj != NULL)
+		gst_object_ref(obj);
+	GST_OBJECT_UNLOCK(self);
+
+	return obj;
+}
+
+
+static guint gst_imx_2d_video_fanout_child_proxy_get_children_count(GstChildProxy *child_proxy)
+{
+	guint count = 0;
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(child_proxy);
+
+	/* Lock the element to make sure that src pads aren't
+	 * added/removed while we access the srcpads list. */
+	GST_OBJECT_LOCK(self);
+	count = GST_ELEMENT_CAST(self)->numsrcpads;
+	GST_OBJECT_UNLOCK(self);
+
+	return count;
+}
+
+
+static void gst_imx_2d_video_fanout_finalize(GObject *object)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(object);
+
+	if (self->flow_combiner != NULL)
+		gst_flow_combiner_free(self->flow_combiner);
+
+	G_OBJECT_CLASS(gst_imx_2d_video_fanout_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_video_fanout_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(object);
+
+	switch (prop_id)
+	{
+		case PROP_INPUT_CROP:
+		{
+			GST_OBJECT_LOCK(self);
+			self->input_crop = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->prewarm_buffers = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_2d_video_fanout_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(object);
+
+	switch (prop_id)
+	{
+		case PROP_INPUT_CROP:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->input_crop);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->prewarm_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_UPLOAD_STATS:
+		{
+			GstImxDmaBufferUploaderStats stats;
+
+			GST_OBJECT_LOCK(self);
+			if (self->uploader != NULL)
+			{
+				gst_imx_video_uploader_get_stats(self->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static GstStateChangeReturn gst_imx_2d_video_fanout_change_state(GstElement *element, GstStateChange transition)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(element);
+	GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+
+	g_assert(self != NULL);
+
+	switch (transition)
+	{
+		case GST_STATE_CHANGE_NULL_TO_READY:
+		{
+			if (!gst_imx_2d_video_fanout_start(self))
+				return GST_STATE_CHANGE_FAILURE;
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	ret = GST_ELEMENT_CLASS(gst_imx_2d_video_fanout_parent_class)->change_state(element, transition);
+	if (ret == GST_STATE_CHANGE_FAILURE)
+		return ret;
+
+	switch (transition)
+	{
+		case GST_STATE_CHANGE_PAUSED_TO_READY:
+			gst_imx_2d_video_fanout_reset(self);
+			break;
+
+		case GST_STATE_CHANGE_READY_TO_NULL:
+			gst_imx_2d_video_fanout_stop(self);
+			break;
+
+		default:
+			break;
+	}
+
+	return ret;
+}
+
+
+static GstPad* gst_imx_2d_video_fanout_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, G_GNUC_UNUSED GstCaps const *caps)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(element);
+	GstPad *new_pad;
+	gchar *name;
+	guint index;
+
+	GST_OBJECT_LOCK(self);
+	if ((req_name != NULL) && (sscanf(req_name, "src_%u", &index) == 1))
+	{
+		if (index >= self->next_src_pad_index)
+			self->next_src_pad_index = index + 1;
+		name = g_strdup(req_name);
+	}
+	else
+		name = g_strdup_printf("src_%u", self->next_src_pad_index++);
+	GST_OBJECT_UNLOCK(self);
+
+	new_pad = GST_PAD_CAST(g_object_new(
+		GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD,
+		"name", name,
+		"direction", GST_PAD_SRC,
+		"template", templ,
+		NULL
+	));
+	g_free(name);
+
+	if (G_UNLIKELY(GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(new_pad)->output_surface == NULL))
+	{
+		GST_ERROR_OBJECT(self, "new request pad has no imx2d output surface");
+		gst_object_unref(GST_OBJECT(gst_object_ref_sink(new_pad)));
+		return NULL;
+	}
+
+	gst_pad_set_query_function(new_pad, GST_DEBUG_FUNCPTR(gst_imx_2d_video_fanout_src_query));
+
+	/* If adding the pad fails (for example because a pad with
+	 * the same name exists already), the pad is discarded by
+	 * gst_element_add_pad(), so don't unref it here. */
+	if (!gst_element_add_pad(element, new_pad))
+	{
+		GST_ERROR_OBJECT(self, "could not add new request pad");
+		return NULL;
+	}
+
+	GST_OBJECT_LOCK(self);
+	gst_flow_combiner_add_pad(self->flow_combiner, new_pad);
+	GST_OBJECT_UNLOCK(self);
+
+	/* If the pad is requested while the element is streaming, the
+	 * stream-start and segment events already went past. Copy them
+	 * to the new pad so they get pushed before its first buffer.
+	 * Storing them does not push them. The pad pushes its sticky
+	 * events in stream order, so the caps that are negotiated
+	 * for its first frame still go out before the segment. */
+	gst_pad_sticky_events_foreach(self->sinkpad, gst_imx_2d_video_fanout_copy_sticky_event, new_pad);
+
+	GST_DEBUG_OBJECT(element, "created and added new request pad %s:%s", GST_DEBUG_PAD_NAME(new_pad));
+
+	gst_child_proxy_child_added(GST_CHILD_PROXY(element), G_OBJECT(new_pad), GST_OBJECT_NAME(new_pad));
+
+	return new_pad;
+}
+
+
+static void gst_imx_2d_video_fanout_release_pad(GstElement *element, GstPad *pad)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(element);
+
+	GST_DEBUG_OBJECT(element, "releasing request pad %s:%s", GST_DEBUG_PAD_NAME(pad));
+
+	GST_OBJECT_LOCK(self);
+	gst_flow_combiner_remove_pad(self->flow_combiner, pad);
+	GST_OBJECT_UNLOCK(self);
+
+	gst_child_proxy_child_removed(GST_CHILD_PROXY(element), G_OBJECT(pad), GST_OBJECT_NAME(pad));
+
+	/* The pad's buffer pool is cleaned up when the pad is finalized.
+	 * If the chain function is currently producing a frame for this
+	 * pad, it holds a reference to it, so this happens afterwards. */
+	gst_pad_set_active(pad, FALSE);
+	gst_element_remove_pad(element, pad);
+}
+
+
+static gboolean gst_imx_2d_video_fanout_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(parent);
+
+	switch (GST_EVENT_TYPE(event))
+	{
+		case GST_EVENT_CAPS:
+		{
+			GstCaps *caps;
+			gboolean ret;
+
+			/* The caps are not forwarded. Instead, each src pad
+			 * negotiates its own caps with its downstream peer.
+			 * This is done right away, so that the src pads push
+			 * their caps before the segment event is forwarded. */
+			gst_event_parse_caps(event, &caps);
+			ret = gst_imx_2d_video_fanout_set_input_caps(self, caps);
+			gst_event_unref(event);
+
+			if (ret)
+				gst_imx_2d_video_fanout_negotiate_src_pads(self, FALSE);
+
+			return ret;
+		}
+
+		case GST_EVENT_SEGMENT:
+		{
+			/* Src pads that were requested after the caps event
+			 * arrived have no caps yet. Negotiate them now, since
+			 * downstream must get caps before the segment. */
+			gst_imx_2d_video_fanout_negotiate_src_pads(self, TRUE);
+			break;
+		}
+
+		case GST_EVENT_TAG:
+		{
+			GstTagList *taglist;
+			GstVideoOrientationMethod new_tag_video_direction;
+
+			gst_event_parse_tag(event, &taglist);
+
+			if (gst_imx_2d_orientation_from_image_direction_tag(taglist, &new_tag_video_direction))
+			{
+				GST_OBJECT_LOCK(self);
+				self->tag_video_direction = new_tag_video_direction;
+				GST_OBJECT_UNLOCK(self);
+			}
+
+			break;
+		}
+
+		case GST_EVENT_FLUSH_STOP:
+		{
+			GST_OBJECT_LOCK(self);
+			gst_flow_combiner_reset(self->flow_combiner);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	/* Forward all other events to all src pads. */
+	return gst_pad_event_default(pad, parent, event);
+}
+
+
+static gboolean gst_imx_2d_video_fanout_sink_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(parent);
+
+	switch (GST_QUERY_TYPE(query))
+	{
+		case GST_QUERY_CAPS:
+		{
+			GstCaps *filter, *caps;
+
+			/* The blitter can convert any of the supported input formats
+			 * and sizes to whatever the individual src pads need, so the
+			 * template caps are what we can accept. */
+			gst_query_parse_caps(query, &filter);
+			caps = gst_pad_get_pad_template_caps(pad);
+
+			if (filter != NULL)
+			{
+				GstCaps *filtered_caps = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
+				gst_caps_unref(caps);
+				caps = filtered_caps;
+			}
+
+			GST_DEBUG_OBJECT(self, "responding to sink caps query with caps %" GST_PTR_FORMAT, (gpointer)caps);
+
+			gst_query_set_caps_result(query, caps);
+			gst_caps_unref(caps);
+
+			return TRUE;
+		}
+
+		case GST_QUERY_ALLOCATION:
+		{
+			/* The query is not forwarded, since the input frames are never
+			 * passed downstream directly. Let upstream know that we can
+			 * handle GstVideoMeta and GstVideoCropMeta. */
+			gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, 0);
+			gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, 0);
+			return TRUE;
+		}
+
+		default:
+			return gst_pad_query_default(pad, parent, query);
+	}
+}
+
+
+static GstFlowReturn gst_imx_2d_video_fanout_sink_chain(G_GNUC_UNUSED GstPad *pad, GstObject *parent, GstBuffer *input_buffer)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(parent);
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	gboolean input_crop;
+	GstVideoOrientationMethod tag_video_direction;
+	Imx2dRegion crop_rectangle;
+	Imx2dRegion const *source_region = NULL;
+	GstBuffer *uploaded_input_buffer = NULL;
+	GList *src_pads = NULL;
+	GList *walk;
+
+	/* Initial checks. */
+
+	if (G_UNLIKELY(!self->input_info_set))
+	{
+		GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL), ("unknown format"));
+		flow_ret = GST_FLOW_NOT_NEGOTIATED;
+		goto error;
+	}
+
+	if (!gst_imx_2d_check_input_buffer_structure(input_buffer, GST_VIDEO_INFO_N_PLANES(&(self->input_video_info))))
+		goto error;
+
+
+	/* Create local copies of the property values and of the src pad
+	 * list so that we can use them without risking race conditions
+	 * if another thread is setting new values or requesting/releasing
+	 * src pads while this function is running. */
+	GST_OBJECT_LOCK(self);
+	input_crop = self->input_crop;
+	tag_video_direction = self->tag_video_direction;
+	for (walk = GST_ELEMENT_CAST(self)->srcpads; walk != NULL; walk = walk->next)
+		src_pads = g_list_prepend(src_pads, gst_object_ref(walk->data));
+	GST_OBJECT_UNLOCK(self);
+
+	src_pads = g_list_reverse(src_pads);
+
+	if (src_pads == NULL)
+	{
+		GST_LOG_OBJECT(self, "there are no src pads; dropping input buffer");
+		goto finish;
+	}
+
+
+	/* Upload the input buffer and set up the input surface. This
+	 * is done only once, and the result is then used for all
+	 * src pads. This is the main benefit of this element compared
+	 * to a tee with one videotransform element per branch. */
+
+	GST_LOG_OBJECT(self, "uploading input buffer");
+
+	flow_ret = gst_imx_video_uploader_perform(self->uploader, input_buffer, &uploaded_input_buffer);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	gst_imx_2d_assign_input_buffer_to_surface(
+		uploaded_input_buffer,
+		self->input_surface,
+		&(self->input_surface_desc),
+		&(self->input_video_info)
+	);
+
+	imx_2d_surface_set_desc(self->input_surface, &(self->input_surface_desc));
+
+	if (input_crop)
+	{
+		GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(input_buffer);
+
+		if (crop_meta != NULL)
+		{
+			crop_rectangle.x1 = crop_meta->x;
+			crop_rectangle.y1 = crop_meta->y;
+			crop_rectangle.x2 = crop_meta->x + crop_meta->width;
+			crop_rectangle.y2 = crop_meta->y + crop_meta->height;
+
+			source_region = &crop_rectangle;
+
+			GST_LOG_OBJECT(
+				self,
+				"using crop rectangle (%d, %d) - (%d, %d)",
+				crop_rectangle.x1, crop_rectangle.y1,
+				crop_rectangle.x2, crop_rectangle.y2
+			);
+		}
+	}
+
+
+	/* Produce and push the output frames. */
+
+	for (walk = src_pads; walk != NULL; walk = walk->next)
+	{
+		GstImx2dVideoFanoutSrcPad *src_pad = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(walk->data);
+		GstFlowReturn pad_flow_ret;
+
+		pad_flow_ret = gst_imx_2d_video_fanout_process_src_pad(self, src_pad, input_buffer, source_region, tag_video_direction);
+
+		GST_OBJECT_LOCK(self);
+		flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD_CAST(src_pad), pad_flow_ret);
+		GST_OBJECT_UNLOCK(self);
+	}
+
+	GST_LOG_OBJECT(self, "processed input buffer; combined flow return: %s", gst_flow_get_name(flow_ret));
+
+
+finish:
+	if (uploaded_input_buffer != NULL)
+		gst_buffer_unref(uploaded_input_buffer);
+	g_list_free_full(src_pads, (GDestroyNotify)gst_object_unref);
+	gst_buffer_unref(input_buffer);
+	return flow_ret;
+
+error:
+	if (flow_ret == GST_FLOW_OK)
+		flow_ret = GST_FLOW_ERROR;
+	goto finish;
+}
+
+
+static gboolean gst_imx_2d_video_fanout_src_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+	GstImx2dVideoFanout *self = GST_IMX_2D_VIDEO_FANOUT(parent);
+
+	switch (GST_QUERY_TYPE(query))
+	{
+		case GST_QUERY_CAPS:
+		{
+			GstCaps *filter, *caps;
+
+			gst_query_parse_caps(query, &filter);
+			caps = gst_imx_2d_video_fanout_get_src_caps(self, pad, filter);
+
+			GST_DEBUG_OBJECT(pad, "responding to src caps query with caps %" GST_PTR_FORMAT, (gpointer)caps);
+
+			gst_query_set_caps_result(query, caps);
+			gst_caps_unref(caps);
+
+			return TRUE;
+		}
+
+		default:
+			return gst_pad_query_default(pad, parent, query);
+	}
+}
+
+
+static gboolean gst_imx_2d_video_fanout_copy_sticky_event(G_GNUC_UNUSED GstPad *pad, GstEvent **event, gpointer user_data)
+{
+	GstPad *src_pad = GST_PAD_CAST(user_data);
+
+	/* Caps are negotiated separately for each src pad. */
+	if (GST_EVENT_TYPE(*event) != GST_EVENT_CAPS)
+		gst_pad_store_sticky_event(src_pad, *event);
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_video_fanout_start(GstImx2dVideoFanout *self)
+{
+	GstImx2dVideoFanoutClass *klass = GST_IMX_2D_VIDEO_FANOUT_CLASS(G_OBJECT_GET_CLASS(self));
+
+	self->input_info_set = FALSE;
+
+	self->tag_video_direction = DEFAULT_PAD_VIDEO_DIRECTION;
+
+	self->imx_dma_buffer_allocator = gst_imx_allocator_new();
+	if (self->imx_dma_buffer_allocator == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating DMA buffer allocator failed");
+		goto error;
+	}
+
+	self->uploader = gst_imx_video_uploader_new(self->imx_dma_buffer_allocator, klass->hardware_capabilities->stride_alignment, klass->hardware_capabilities->total_row_count_alignment);
+	if (self->uploader == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating DMA video uploader failed");
+		goto error;
+	}
+
+	if (!gst_imx_2d_video_fanout_create_blitter(self))
+	{
+		GST_ERROR_OBJECT(self, "creating blitter failed");
+		goto error;
+	}
+
+	self->input_surface = imx_2d_surface_create(NULL);
+	if (self->input_surface == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating input surface failed");
+		goto error;
+	}
+
+	return TRUE;
+
+error:
+	gst_imx_2d_video_fanout_stop(self);
+	return FALSE;
+}
+
+
+static void gst_imx_2d_video_fanout_stop(GstImx2dVideoFanout *self)
+{
+	gst_imx_2d_video_fanout_reset(self);
+
+	if (self->input_surface != NULL)
+	{
+		imx_2d_surface_destroy(self->input_surface);
+		self->input_surface = NULL;
+	}
+
+	if (self->blitter != NULL)
+	{
+		imx_2d_blitter_destroy(self->blitter);
+		self->blitter = NULL;
+	}
+
+	/* See gst_imx_video_uploader_get_stats() for why the object lock is needed here. */
+	GST_OBJECT_LOCK(self);
+	if (self->uploader != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->uploader));
+		self->uploader = NULL;
+	}
+	GST_OBJECT_UNLOCK(self);
+
+	if (self->imx_dma_buffer_allocator != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->imx_dma_buffer_allocator));
+		self->imx_dma_buffer_allocator = NULL;
+	}
+}
+
+
+static void gst_imx_2d_video_fanout_reset(GstImx2dVideoFanout *self)
+{
+	GList *walk;
+
+	/* Streaming has stopped at this point, so the src pads'
+	 * buffer pools can be safely discarded. Src pads persist
+	 * across state changes, so they renegotiate as soon as
+	 * streaming resumes. */
+
+	GST_OBJECT_LOCK(self);
+
+	for (walk = GST_ELEMENT_CAST(self)->srcpads; walk != NULL; walk = walk->next)
+	{
+		GstImx2dVideoFanoutSrcPad *src_pad = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(walk->data);
+		gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(src_pad);
+		src_pad->negotiated = FALSE;
+	}
+
+	gst_flow_combiner_reset(self->flow_combiner);
+
+	self->input_info_set = FALSE;
+	gst_caps_replace(&(self->input_caps), NULL);
+
+	GST_OBJECT_UNLOCK(self);
+}
+
+
+static gboolean gst_imx_2d_video_fanout_set_input_caps(GstImx2dVideoFanout *self, GstCaps *input_caps)
+{
+	GstImx2dVideoFanoutClass *klass = GST_IMX_2D_VIDEO_FANOUT_CLASS(G_OBJECT_GET_CLASS(self));
+	GstVideoInfo input_video_info;
+	GstImx2dTileLayout input_video_tile_layout;
+	GList *walk;
+
+	g_assert(self->blitter != NULL);
+
+	GST_DEBUG_OBJECT(self, "setting input caps: %" GST_PTR_FORMAT, (gpointer)input_caps);
+
+	if (!gst_imx_video_info_from_caps(&input_video_info, input_caps, &input_video_tile_layout, NULL))
+	{
+		GST_ERROR_OBJECT(self, "cannot convert input caps to video info; input caps: %" GST_PTR_FORMAT, (gpointer)input_caps);
+		self->input_info_set = FALSE;
+		return FALSE;
+	}
+
+	/* Fill the input surface description with values that can't change
+	 * in between buffers. (Plane stride and offset values can change.
+	 * This is unlikely to happen, but it is not impossible.) */
+	self->input_surface_desc.width = GST_VIDEO_INFO_WIDTH(&input_video_info);
+	self->input_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&input_video_info);
+	self->input_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&input_video_info), &input_video_tile_layout);
+
+	/* Set the alignment _before_ the input video info,
+	 * since the latter needs to be aligned to the former. */
+	gst_imx_video_uploader_set_alignments(
+		self->uploader,
+		gst_imx_2d_get_stride_alignment_for(
+			self->input_surface_desc.format,
+			klass->hardware_capabilities
+		),
+		klass->hardware_capabilities->total_row_count_alignment
+	);
+
+	if (!gst_imx_video_uploader_set_input_video_info(self->uploader, &input_video_info))
+	{
+		GST_ERROR_OBJECT(self, "could not configure uploader with new caps / video info");
+		self->input_info_set = FALSE;
+		return FALSE;
+	}
+
+	GST_OBJECT_LOCK(self);
+
+	self->input_video_info = input_video_info;
+	self->input_info_set = TRUE;
+	gst_caps_replace(&(self->input_caps), input_caps);
+
+	/* The output caps of all src pads may depend on the input
+	 * caps, so all of them have to renegotiate. */
+	for (walk = GST_ELEMENT_CAST(self)->srcpads; walk != NULL; walk = walk->next)
+		GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(walk->data)->negotiated = FALSE;
+
+	GST_OBJECT_UNLOCK(self);
+
+	return TRUE;
+}
+
+
+static GstCaps* gst_imx_2d_video_fanout_get_src_caps(GstImx2dVideoFanout *self, GstPad *src_pad, GstCaps *filter)
+{
+	GstCaps *template_caps;
+	GstCaps *input_caps = NULL;
+	GstCaps *caps;
+
+	template_caps = gst_pad_get_pad_template_caps(src_pad);
+
+	GST_OBJECT_LOCK(self);
+	if (self->input_caps != NULL)
+		input_caps = gst_caps_ref(self->input_caps);
+	GST_OBJECT_UNLOCK(self);
+
+	if (input_caps != NULL)
+	{
+		GstCaps *transformed_caps;
+		guint caps_idx, num_caps;
+
+		/* Derive the src caps from the input caps. Since the blitter
+		 * can perform scaling and format conversion, the size and
+		 * format fields are not restricted. Other fields like the
+		 * framerate are retained. */
+
+		transformed_caps = gst_caps_copy(input_caps);
+		num_caps = gst_caps_get_size(transformed_caps);
+
+		for (caps_idx = 0; caps_idx < num_caps; ++caps_idx)
+		{
+			GstStructure *structure = gst_caps_get_structure(transformed_caps, caps_idx);
+
+			gst_structure_set(
+				structure,
+				"width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+				"height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+				NULL
+			);
+
+			gst_structure_remove_fields(structure, "format", "colorimetry", "chroma-site", NULL);
+
+			if (gst_structure_has_field(structure, "pixel-aspect-ratio"))
+			{
+				gst_structure_set(
+					structure,
+					"pixel-aspect-ratio", GST_TYPE_FRACTION_RANGE, 1, G_MAXINT, G_MAXINT, 1,
+					NULL
+				);
+			}
+		}
+
+		/* The caps features of the input caps (for example, the
+		 * Amphion tile layout) do not apply to the output frames.
+		 * Intersecting with the template caps takes care of that. */
+		caps = gst_caps_intersect_full(transformed_caps, template_caps, GST_CAPS_INTERSECT_FIRST);
+
+		gst_caps_unref(transformed_caps);
+		gst_caps_unref(template_caps);
+		gst_caps_unref(input_caps);
+	}
+	else
+		caps = template_caps;
+
+	if (filter != NULL)
+	{
+		GstCaps *filtered_caps = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
+		gst_caps_unref(caps);
+		caps = filtered_caps;
+	}
+
+	return caps;
+}
+
+
+static GstCaps* gst_imx_2d_video_fanout_fixate_src_caps(GstImx2dVideoFanout *self, GstCaps *caps, gboolean transposed)
+{
+	GstStructure *structure;
+	GstVideoInfo *input_video_info = &(self->input_video_info);
+	gint in_width, in_height;
+	gint in_par_n, in_par_d;
+	gint out_width, out_height;
+	gboolean width_fixed, height_fixed;
+	gchar const *input_format_str;
+
+	GST_DEBUG_OBJECT(self, "trying to fixate src caps %" GST_PTR_FORMAT, (gpointer)caps);
+
+	caps = gst_caps_truncate(caps);
+	caps = gst_caps_make_writable(caps);
+	structure = gst_caps_get_structure(caps, 0);
+
+	/* If the video direction transposes the frame, then the
+	 * output frame's width corresponds to the input frame's
+	 * height and vice versa. */
+	in_width = transposed ? GST_VIDEO_INFO_HEIGHT(input_video_info) : GST_VIDEO_INFO_WIDTH(input_video_info);
+	in_height = transposed ? GST_VIDEO_INFO_WIDTH(input_video_info) : GST_VIDEO_INFO_HEIGHT(input_video_info);
+	in_par_n = transposed ? GST_VIDEO_INFO_PAR_D(input_video_info) : GST_VIDEO_INFO_PAR_N(input_video_info);
+	in_par_d = transposed ? GST_VIDEO_INFO_PAR_N(input_video_info) : GST_VIDEO_INFO_PAR_D(input_video_info);
+
+	/* If downstream restricts only one of the dimensions (for
+	 * example with a capsfilter that only sets the width),
+	 * pick the other one such that the aspect ratio of the
+	 * input frame is retained. Otherwise, stay as close to
+	 * the input frame size as possible. */
+	width_fixed = gst_structure_get_int(structure, "width", &out_width);
+	height_fixed = gst_structure_get_int(structure, "height", &out_height);
+
+	if (width_fixed && !height_fixed)
+		gst_structure_fixate_field_nearest_int(structure, "height", gst_util_uint64_scale_int(out_width, in_height, in_width));
+	else if (!width_fixed && height_fixed)
+		gst_structure_fixate_field_nearest_int(structure, "width", gst_util_uint64_scale_int(out_height, in_width, in_height));
+	else if (!width_fixed && !height_fixed)
+	{
+		gst_structure_fixate_field_nearest_int(structure, "width", in_width);
+		gst_structure_fixate_field_nearest_int(structure, "height", in_height);
+	}
+
+	if (gst_structure_has_field(structure, "pixel-aspect-ratio"))
+		gst_structure_fixate_field_nearest_fraction(structure, "pixel-aspect-ratio", in_par_n, in_par_d);
+
+	/* Prefer the input format to avoid unnecessary conversions. */
+	input_format_str = gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(input_video_info));
+	if ((input_format_str != NULL) && gst_structure_has_field(structure, "format"))
+		gst_structure_fixate_field_string(structure, "format", input_format_str);
+
+	caps = gst_caps_fixate(caps);
+
+	GST_DEBUG_OBJECT(self, "fixated src caps to %" GST_PTR_FORMAT, (gpointer)caps);
+
+	return caps;
+}
+
+
+static gboolean gst_imx_2d_video_fanout_negotiate_src_pad(GstImx2dVideoFanout *self, GstImx2dVideoFanoutSrcPad *src_pad, gboolean transposed)
+{
+	guint i;
+	gboolean ret = TRUE;
+	GstPad *pad = GST_PAD_CAST(src_pad);
+	GstCaps *filter_caps;
+	GstCaps *peer_caps;
+	GstCaps *output_caps = NULL;
+	GstQuery *allocation_query = NULL;
+	GstVideoInfo output_video_info;
+	gint num_padding_rows;
+	guint prewarm_buffers;
+	Imx2dSurfaceDesc output_surface_desc;
+
+	GST_DEBUG_OBJECT(pad, "negotiating src pad");
+
+	/* Find out what downstream supports, and pick output caps out of that. */
+
+	filter_caps = gst_imx_2d_video_fanout_get_src_caps(self, pad, NULL);
+	peer_caps = gst_pad_peer_query_caps(pad, filter_caps);
+	gst_caps_unref(filter_caps);
+
+	if (gst_caps_is_empty(peer_caps))
+	{
+		GST_ERROR_OBJECT(pad, "downstream does not support any of the caps this src pad can produce");
+		gst_caps_unref(peer_caps);
+		goto error;
+	}
+
+	output_caps = gst_imx_2d_video_fanout_fixate_src_caps(self, peer_caps, transposed);
+
+	if (!gst_video_info_from_caps(&output_video_info, output_caps))
+	{
+		GST_ERROR_OBJECT(pad, "cannot convert output caps to video info; output caps: %" GST_PTR_FORMAT, (gpointer)output_caps);
+		goto error;
+	}
+
+	/* The stride values may require alignment according to the blitter's
+	 * capabilities. Adjust the output video's fields to match those. */
+	gst_imx_2d_align_output_video_info(&output_video_info, &num_padding_rows, imx_2d_blitter_get_hardware_capabilities(self->blitter));
+
+	/* Fill the output surface description. None of its values can change
+	 * in between buffers, since we allocate the output buffers ourselves. */
+	memset(&output_surface_desc, 0, sizeof(output_surface_desc));
+	output_surface_desc.width = GST_VIDEO_INFO_WIDTH(&output_video_info);
+	output_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&output_video_info);
+	output_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&output_video_info), NULL);
+
+	for (i = 0; i < GST_VIDEO_INFO_N_PLANES(&output_video_info); ++i)
+		output_surface_desc.plane_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE(&output_video_info, i);
+
+	output_surface_desc.num_padding_rows = num_padding_rows;
+
+	imx_2d_surface_set_desc(src_pad->output_surface, &output_surface_desc);
+
+	if (!gst_pad_push_event(pad, gst_event_new_caps(output_caps)))
+	{
+		GST_ERROR_OBJECT(pad, "downstream did not accept caps %" GST_PTR_FORMAT, (gpointer)output_caps);
+		goto error;
+	}
+
+
+	/* Set up the buffer pool for this src pad. This works just like
+	 * the decide_allocation vmethod of GstImx2dVideoTransform, except
+	 * that we have to run the allocation query and activate the
+	 * output video buffer pool ourselves. */
+
+	gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(src_pad);
+
+	GST_OBJECT_LOCK(self);
+	prewarm_buffers = self->prewarm_buffers;
+	GST_OBJECT_UNLOCK(self);
+
+	allocation_query = gst_query_new_allocation(output_caps, TRUE);
+	if (!gst_pad_peer_query(pad, allocation_query))
+		GST_DEBUG_OBJECT(pad, "downstream did not answer the allocation query");
+
+	src_pad->video_buffer_pool = gst_imx_video_buffer_pool_new(
+		self->imx_dma_buffer_allocator,
+		allocation_query,
+		&output_video_info,
+		prewarm_buffers
+	);
+	if (src_pad->video_buffer_pool == NULL)
+	{
+		GST_ERROR_OBJECT(pad, "could not create video buffer pool");
+		goto error;
+	}
+
+	gst_object_ref_sink(src_pad->video_buffer_pool);
+
+	if (!gst_buffer_pool_set_active(gst_imx_video_buffer_pool_get_output_video_buffer_pool(src_pad->video_buffer_pool), TRUE))
+	{
+		GST_ERROR_OBJECT(pad, "could not activate output video buffer pool");
+		goto error;
+	}
+
+	src_pad->output_video_info = output_video_info;
+	src_pad->negotiated = TRUE;
+	src_pad->negotiated_transposed = transposed;
+
+	GST_DEBUG_OBJECT(pad, "negotiated output caps %" GST_PTR_FORMAT, (gpointer)output_caps);
+
+
+finish:
+	if (allocation_query != NULL)
+		gst_query_unref(allocation_query);
+	if (output_caps != NULL)
+		gst_caps_unref(output_caps);
+	return ret;
+
+error:
+	gst_imx_2d_video_fanout_src_pad_clear_video_buffer_pool(src_pad);
+	src_pad->negotiated = FALSE;
+	ret = FALSE;
+	goto finish;
+}
+
+
+/* Negotiates all linked src pads, or only those that aren't negotiated
+ * yet if only_unnegotiated is TRUE. Unlinked src pads are skipped; they
+ * are negotiated once they are linked and produce their first frame.
+ * If negotiation fails, the pad is marked for reconfiguration, so it
+ * is retried in gst_imx_2d_video_fanout_process_src_pad(). */
+static void gst_imx_2d_video_fanout_negotiate_src_pads(GstImx2dVideoFanout *self, gboolean only_unnegotiated)
+{
+	GstVideoOrientationMethod tag_video_direction;
+	GList *src_pads = NULL;
+	GList *walk;
+
+	if (!self->input_info_set)
+		return;
+
+	GST_OBJECT_LOCK(self);
+	tag_video_direction = self->tag_video_direction;
+	for (walk = GST_ELEMENT_CAST(self)->srcpads; walk != NULL; walk = walk->next)
+		src_pads = g_list_prepend(src_pads, gst_object_ref(walk->data));
+	GST_OBJECT_UNLOCK(self);
+
+	for (walk = src_pads; walk != NULL; walk = walk->next)
+	{
+		GstImx2dVideoFanoutSrcPad *src_pad = GST_IMX_2D_VIDEO_FANOUT_SRC_PAD_CAST(walk->data);
+		GstPad *pad = GST_PAD_CAST(src_pad);
+		GstVideoOrientationMethod video_direction;
+
+		if (!gst_pad_is_linked(pad) || (only_unnegotiated && src_pad->negotiated))
+			continue;
+
+		GST_OBJECT_LOCK(src_pad);
+		video_direction = (src_pad->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? tag_video_direction : src_pad->video_direction;
+		GST_OBJECT_UNLOCK(src_pad);
+
+		if (!gst_imx_2d_video_fanout_negotiate_src_pad(self, src_pad, gst_imx_2d_video_fanout_is_transposed(video_direction)))
+			gst_pad_mark_reconfigure(pad);
+	}
+
+	g_list_free_full(src_pads, (GDestroyNotify)gst_object_unref);
+}
+
+
+static GstFlowReturn gst_imx_2d_video_fanout_process_src_pad(GstImx2dVideoFanout *self, GstImx2dVideoFanoutSrcPad *src_pad, GstBuffer *input_buffer, Imx2dRegion const *source_region, GstVideoOrientationMethod tag_video_direction)
+{
+	Imx2dBlitParams blit_params;
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstPad *pad = GST_PAD_CAST(src_pad);
+	GstVideoOrientationMethod video_direction;
+	gboolean transposed;
+	GstBuffer *output_buffer = NULL;
+	GstBuffer *intermediate_buffer = NULL;
+
+	/* Don't spend blitter time on frames nobody consumes. */
+	if (!gst_pad_is_linked(pad))
+		return GST_FLOW_NOT_LINKED;
+
+	GST_OBJECT_LOCK(src_pad);
+	video_direction = (src_pad->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? tag_video_direction : src_pad->video_direction;
+	GST_OBJECT_UNLOCK(src_pad);
+
+	transposed = gst_imx_2d_video_fanout_is_transposed(video_direction);
+
+	/* (Re)negotiate if the pad has no caps yet, the input caps changed,
+	 * downstream requested a reconfiguration, or the video direction
+	 * changed in a way that swaps the output width and height. */
+	if (gst_pad_check_reconfigure(pad) || !src_pad->negotiated || (transposed != src_pad->negotiated_transposed))
+	{
+		if (!gst_imx_2d_video_fanout_negotiate_src_pad(self, src_pad, transposed))
+		{
+			gst_pad_mark_reconfigure(pad);
+			return GST_PAD_IS_FLUSHING(pad) ? GST_FLOW_FLUSHING : GST_FLOW_NOT_NEGOTIATED;
+		}
+	}
+
+
+	/* Acquire the output buffer and the intermediate buffer. See
+	 * gst_imx_2d_video_transform_transform_frame() for details
+	 * about the intermediate buffer. */
+
+	flow_ret = gst_buffer_pool_acquire_buffer(gst_imx_video_buffer_pool_get_output_video_buffer_pool(src_pad->video_buffer_pool), &output_buffer, NULL);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+	{
+		GST_DEBUG_OBJECT(pad, "could not acquire output buffer: %s", gst_flow_get_name(flow_ret));
+		goto error;
+	}
+
+	flow_ret = gst_imx_video_buffer_pool_acquire_intermediate_buffer(src_pad->video_buffer_pool, output_buffer, &intermediate_buffer);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	gst_imx_2d_assign_output_buffer_to_surface(src_pad->output_surface, intermediate_buffer, &(src_pad->output_video_info));
+
+
+	/* Fill the blit parameters and perform the blit. The blitter
+	 * API binds one destination surface per start/finish sequence,
+	 * so each src pad gets its own sequence. The input surface is
+	 * the same for all of them. */
+
+	memset(&blit_params, 0, sizeof(blit_params));
+	blit_params.source_region = source_region;
+	blit_params.dest_region = NULL;
+	blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(video_direction);
+	blit_params.alpha = 255;
+	blit_params.colorimetry = gst_imx_2d_convert_colorimetry(&(GST_VIDEO_INFO_COLORIMETRY(&(self->input_video_info))));
+
+	if (!imx_2d_blitter_start(self->blitter, src_pad->output_surface))
+	{
+		GST_ERROR_OBJECT(pad, "starting blitter failed");
+		goto error;
+	}
+
+	if (!imx_2d_blitter_do_blit(self->blitter, self->input_surface, &blit_params))
+	{
+		GST_ERROR_OBJECT(pad, "blitting failed");
+		imx_2d_blitter_finish(self->blitter);
+		goto error;
+	}
+
+	if (!imx_2d_blitter_finish(self->blitter))
+	{
+		GST_ERROR_OBJECT(pad, "finishing blitter failed");
+		goto error;
+	}
+
+	if (!gst_imx_video_buffer_pool_transfer_to_output_buffer(src_pad->video_buffer_pool, intermediate_buffer, output_buffer))
+	{
+		GST_ERROR_OBJECT(pad, "could not transfer intermediate buffer contents to output buffer");
+		goto error;
+	}
+
+	intermediate_buffer = NULL;
+
+
+	/* Copy PTS, DTS, duration, offset, offset-end. Make sure the
+	 * GST_BUFFER_FLAG_TAG_MEMORY flag isn't copied, otherwise the
+	 * output buffer will be reallocated all the time. */
+
+	GST_BUFFER_DTS(output_buffer) = GST_BUFFER_DTS(input_buffer);
+	GST_BUFFER_PTS(output_buffer) = GST_BUFFER_PTS(input_buffer);
+	GST_BUFFER_DURATION(output_buffer) = GST_BUFFER_DURATION(input_buffer);
+	GST_BUFFER_OFFSET(output_buffer) = GST_BUFFER_OFFSET(input_buffer);
+	GST_BUFFER_OFFSET_END(output_buffer) = GST_BUFFER_OFFSET_END(input_buffer);
+	GST_BUFFER_FLAGS(output_buffer) = GST_BUFFER_FLAGS(input_buffer);
+	GST_BUFFER_FLAG_UNSET(output_buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+
+	GST_LOG_OBJECT(pad, "pushing output buffer %" GST_PTR_FORMAT, (gpointer)output_buffer);
+
+	flow_ret = gst_pad_push(pad, output_buffer);
+	output_buffer = NULL;
+
+
+finish:
+	if (intermediate_buffer != NULL)
+		gst_buffer_unref(intermediate_buffer);
+	if (output_buffer != NULL)
+		gst_buffer_unref(output_buffer);
+	return flow_ret;
+
+error:
+	if (flow_ret == GST_FLOW_OK)
+		flow_ret = GST_FLOW_ERROR;
+	goto finish;
+}
+
+
+static gboolean gst_imx_2d_video_fanout_create_blitter(GstImx2dVideoFanout *self)
+{
+	GstImx2dVideoFanoutClass *klass = GST_IMX_2D_VIDEO_FANOUT_CLASS(G_OBJECT_GET_CLASS(self));
+
+	g_assert(klass->create_blitter != NULL);
+	g_assert(self->blitter == NULL);
+
+	if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+	{
+		GST_ERROR_OBJECT(self, "could not create blitter");
+		return FALSE;
+	}
+
+	GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_video_fanout_is_transposed(GstVideoOrientationMethod video_direction)
+{
+	switch (video_direction)
+	{
+		case GST_VIDEO_ORIENTATION_90R:
+		case GST_VIDEO_ORIENTATION_90L:
+		case GST_VIDEO_ORIENTATION_UL_LR:
+		case GST_VIDEO_ORIENTATION_UR_LL:
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+
+void gst_imx_2d_video_fanout_common_class_init(GstImx2dVideoFanoutClass *klass, Imx2dHardwareCapabilities const *capabilities)
+{
+	GstElementClass *element_class;
+	GstCaps *sink_template_caps;
+	GstCaps *src_template_caps;
+	GstPadTemplate *sink_template;
+	GstPadTemplate *src_template;
+
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	klass->hardware_capabilities = capabilities;
+
+	sink_template_caps = gst_imx_2d_get_caps_from_imx2d_capabilities(capabilities, GST_PAD_SINK);
+	src_template_caps = gst_imx_2d_get_caps_from_imx2d_capabilities(capabilities, GST_PAD_SRC);
+
+	sink_template = gst_pad_template_new("sink", GST_PAD_SINK, GST_PAD_ALWAYS, sink_template_caps);
+	src_template = gst_pad_template_new_with_gtype("src_%u", GST_PAD_SRC, GST_PAD_REQUEST, src_template_caps, GST_TYPE_IMX_2D_VIDEO_FANOUT_SRC_PAD);
+
+	gst_element_class_add_pad_template(element_class, sink_template);
+	gst_element_class_add_pad_template(element_class, src_template);
+}
@@ -0,0 +1,113 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_VIDEO_FANOUT_H
+#define GST_IMX_2D_VIDEO_FANOUT_H
+
+#include <gst/gst.h>
+#include <gst/base/gstflowcombiner.h>
+#include <gst/video/video.h>
+#include "gst/imx/video/gstimxvideouploader.h"
+#include "imx2d/imx2d.h"
+#include "gstimx2dmisc.h"
+
+
+G_BEGIN_DECLS
+
+
+#define GST_TYPE_IMX_2D_VIDEO_FANOUT             (gst_imx_2d_video_fanout_get_type())
+#define GST_IMX_2D_VIDEO_FANOUT(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_VIDEO_FANOUT, GstImx2dVideoFanout))
+#define GST_IMX_2D_VIDEO_FANOUT_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_VIDEO_FANOUT, GstImx2dVideoFanoutClass))
+#define GST_IMX_2D_VIDEO_FANOUT_GET_CLASS(klass) (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_IMX_2D_VIDEO_FANOUT, GstImx2dVideoFanoutClass))
+#define GST_IMX_2D_VIDEO_FANOUT_CAST(obj)        ((GstImx2dVideoFanout *)(obj))
+#define GST_IS_IMX_2D_VIDEO_FANOUT(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_VIDEO_FANOUT))
+#define GST_IS_IMX_2D_VIDEO_FANOUT_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_VIDEO_FANOUT))
+
+
+typedef struct _GstImx2dVideoFanout GstImx2dVideoFanout;
+typedef struct _GstImx2dVideoFanoutClass GstImx2dVideoFanoutClass;
+
+
+/**
+ * GstImx2dVideoFanout:
+ *
+ * Base class for elements that produce several differently sized and/or
+ * formatted output frames out of one input frame. Each output is a
+ * "src_%u" request pad. The output size and format of a src pad are
+ * determined by what its downstream peer accepts (typically by placing
+ * a capsfilter after the src pad).
+ *
+ * Compared to a tee followed by one video transform element per branch,
+ * the input frame is uploaded into DMA memory only once, the input
+ * surface is set up only once, and all outputs are produced by the
+ * same blitter right after each other.
+ */
+struct _GstImx2dVideoFanout
+{
+	GstElement parent;
+
+	/*< private >*/
+
+	GstPad *sinkpad;
+
+	GstImxVideoUploader *uploader;
+	GstAllocator *imx_dma_buffer_allocator;
+
+	Imx2dBlitter *blitter;
+
+	/* Combines the flow returns of the src pads into the
+	 * one that is returned by the sink pad's chain function.
+	 * Protected by the object lock, since src pads can be
+	 * added and removed while the chain function runs. */
+	GstFlowCombiner *flow_combiner;
+	guint next_src_pad_index;
+
+	gboolean input_info_set;
+	GstVideoInfo input_video_info;
+	GstCaps *input_caps;
+
+	Imx2dSurface *input_surface;
+	Imx2dSurfaceDesc input_surface_desc;
+
+	gboolean input_crop;
+	guint prewarm_buffers;
+
+	GstVideoOrientationMethod tag_video_direction;
+};
+
+
+struct _GstImx2dVideoFanoutClass
+{
+	GstElementClass parent_class;
+
+	Imx2dBlitter* (*create_blitter)(GstImx2dVideoFanout *imx_2d_video_fanout);
+
+	Imx2dHardwareCapabilities const *hardware_capabilities;
+};
+
+
+GType gst_imx_2d_video_fanout_get_type(void);
+
+
+void gst_imx_2d_video_fanout_common_class_init(GstImx2dVideoFanoutClass *klass, Imx2dHardwareCapabilities const *capabilities);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_VIDEO_FANOUT_H */
@@ -16,9 +16,12 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <config.h>
 #include <gst/gst.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gst/imx/video/gstimxvideoorientationmeta.h"
 #include "gstimx2dvideosink.h"
+#include "gstimx2dframebufferpageallocator.h"
 #include "gstimx2dmisc.h"
 
 
@@ -45,7 +48,17 @@ enum
 	PROP_LEFT_MARGIN,
 	PROP_TOP_MARGIN,
 	PROP_RIGHT_MARGIN,
-	PROP_BOTTOM_MARGIN
+	PROP_BOTTOM_MARGIN,
+	PROP_UPLOAD_STATS,
+	PROP_DRM_DEVICE_NAME,
+	PROP_DRM_CONNECTOR_ID,
+	PROP_DRM_PLANE_ID,
+	PROP_DIRECT_SCANOUT,
+	PROP_FRAMES_PRESENTED,
+	PROP_FRAMES_DROPPED,
+	PROP_FRAMES_LATE,
+	PROP_FRAMES_REPEATED,
+	PROP_PRESENT_LATENCY_HISTOGRAM
 };
 
 
@@ -66,6 +79,39 @@ enum
 #define DEFAULT_TOP_MARGIN 0
 #define DEFAULT_RIGHT_MARGIN 0
 #define DEFAULT_BOTTOM_MARGIN 0
+#define DEFAULT_DRM_DEVICE_NAME NULL
+#define DEFAULT_DRM_CONNECTOR_ID 0
+#define DEFAULT_DRM_PLANE_ID 0
+#define DEFAULT_DIRECT_SCANOUT TRUE
+
+
+/* Number of scanout pages to add to the framebuffer when using fbdev.
+ * Two of them can be held by the sink (one shown, one about to be
+ * replaced), the rest can be filled by upstream in the meantime. */
+#define NUM_FRAMEBUFFER_SCANOUT_PAGES 4
+
+
+/* Upper limits of the present latency histogram buckets, in ns. The last
+ * bucket has no upper limit. The limits roughly correspond to multiples
+ * of the refresh period of 60 Hz displays. */
+static gint64 const present_latency_bucket_limits[GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS - 1] =
+{
+	4 * GST_MSECOND,
+	8 * GST_MSECOND,
+	16 * GST_MSECOND,
+	33 * GST_MSECOND,
+	66 * GST_MSECOND
+};
+
+static gchar const *present_latency_bucket_names[GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS] =
+{
+	"up-to-4ms",
+	"up-to-8ms",
+	"up-to-16ms",
+	"up-to-33ms",
+	"up-to-66ms",
+	"over-66ms"
+};
 
 
 static void gst_imx_2d_video_sink_video_direction_interface_init(G_GNUC_UNUSED GstVideoDirectionInterface *iface)
@@ -86,10 +132,13 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
 
 /* General element operations. */
 static void gst_imx_2d_video_sink_dispose(GObject *object);
+static void gst_imx_2d_video_sink_finalize(GObject *object);
 static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_2d_video_sink_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstStateChangeReturn gst_imx_2d_video_sink_change_state(GstElement *element, GstStateChange transition);
 static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event);
+static gboolean gst_imx_2d_video_sink_unlock(GstBaseSink *sink);
+static gboolean gst_imx_2d_video_sink_unlock_stop(GstBaseSink *sink);
 
 /* Caps handling. */
 static gboolean gst_imx_2d_video_sink_set_caps(GstBaseSink *sink, GstCaps *caps);
@@ -106,7 +155,24 @@ static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self);
 static gboolean gst_imx_2d_video_sink_create_blitter(GstImx2dVideoSink *self);
 static GstVideoOrientationMethod gst_imx_2d_video_sink_get_current_video_direction(GstImx2dVideoSink *self);
 static gboolean gst_imx_2d_video_sink_flip_pages(GstImx2dVideoSink *self);
+static void gst_imx_2d_video_sink_set_write_page(GstImx2dVideoSink *self, int page);
+static gboolean gst_imx_2d_video_sink_show_page(GstImx2dVideoSink *self, int page);
+static void gst_imx_2d_video_sink_update_scanout_held_buffers(GstImx2dVideoSink *self, GstBuffer *shown_buffer);
+static void gst_imx_2d_video_sink_propose_scanout_pool(GstImx2dVideoSink *self, GstQuery *query);
+static gboolean gst_imx_2d_video_sink_add_scanout_pages(gpointer user_data);
+static gboolean gst_imx_2d_video_sink_start_presentation_thread(GstImx2dVideoSink *self);
+static void gst_imx_2d_video_sink_stop_presentation_thread(GstImx2dVideoSink *self);
+static gpointer gst_imx_2d_video_sink_presentation_thread_func(gpointer user_data);
+static gboolean gst_imx_2d_video_sink_queue_presentation(GstImx2dVideoSink *self, int page, gboolean is_scanout_page, GstBuffer *buffer);
+static gboolean gst_imx_2d_video_sink_select_next_write_page(GstImx2dVideoSink *self);
+static void gst_imx_2d_video_sink_update_frame_pacing_stats(GstImx2dVideoSink *self, gint64 queue_time, gint64 present_time);
+static void gst_imx_2d_video_sink_reset_frame_pacing_stats(GstImx2dVideoSink *self);
+static gboolean gst_imx_2d_video_sink_try_framebuffer_scanout(GstImx2dVideoSink *self, GstBuffer *input_buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, gboolean *frame_shown);
+#ifdef WITH_IMX2D_LINUX_DRM
+static Imx2dLinuxDrmScanoutResult gst_imx_2d_video_sink_try_direct_scanout(GstImx2dVideoSink *self, GstBuffer *uploaded_input_buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region);
+#endif
 static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gboolean clear_on_all_pages);
+static gboolean gst_imx_2d_video_clear_region(GstImx2dVideoSink *self, Imx2dRegion const *region, gboolean clear_on_all_pages);
 static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSink *self);
 
 
@@ -129,6 +195,7 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 	video_sink_class = GST_VIDEO_SINK_CLASS(klass);
 
 	object_class->dispose               = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_dispose);
+	object_class->finalize              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_finalize);
 	object_class->set_property          = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_set_property);
 	object_class->get_property          = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_get_property);
 
@@ -136,6 +203,8 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 
 	base_sink_class->set_caps           = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_set_caps);
 	base_sink_class->event              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_event);
+	base_sink_class->unlock             = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_unlock);
+	base_sink_class->unlock_stop        = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_unlock_stop);
 	base_sink_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_propose_allocation);
 
 	video_sink_class->show_frame        = GST_DEBUG_FUNCPTR(gst_imx_blitter_video_sink_show_frame);
@@ -325,6 +394,124 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+#ifdef WITH_IMX2D_LINUX_DRM
+	g_object_class_install_property(
+		object_class,
+		PROP_DRM_DEVICE_NAME,
+		g_param_spec_string(
+			"drm-device",
+			"DRM device name",
+			"The device name of the DRM device to render to; if set, DRM/KMS is used instead of the framebuffer (NULL = use the framebuffer)",
+			DEFAULT_DRM_DEVICE_NAME,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_DRM_CONNECTOR_ID,
+		g_param_spec_uint(
+			"drm-connector-id",
+			"DRM connector ID",
+			"ID of the DRM connector to render to (0 = use the first connected one)",
+			0, G_MAXUINT32,
+			DEFAULT_DRM_CONNECTOR_ID,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_DRM_PLANE_ID,
+		g_param_spec_uint(
+			"drm-plane-id",
+			"DRM plane ID",
+			"ID of the DRM plane to render to (0 = use the primary plane)",
+			0, G_MAXUINT32,
+			DEFAULT_DRM_PLANE_ID,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+#endif
+	g_object_class_install_property(
+		object_class,
+		PROP_DIRECT_SCANOUT,
+		g_param_spec_boolean(
+			"direct-scanout",
+			"Direct scanout",
+			"Show frames without blitting them if possible; with DRM/KMS, frames are put on the DRM plane if it supports them as-is, with fbdev, upstream is offered a buffer pool whose buffers can be panned to if their format and size match the framebuffer's",
+			DEFAULT_DIRECT_SCANOUT,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_FRAMES_PRESENTED,
+		g_param_spec_uint64(
+			"frames-presented",
+			"Frames presented",
+			"Number of frames that were shown on screen (only counted with fbdev and vsync enabled)",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_FRAMES_DROPPED,
+		g_param_spec_uint64(
+			"frames-dropped",
+			"Frames dropped",
+			"Number of frames that were replaced by a newer frame before they could be shown (only counted with fbdev and vsync enabled)",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_FRAMES_LATE,
+		g_param_spec_uint64(
+			"frames-late",
+			"Frames late",
+			"Number of frames that were not shown at the first vsync after they were rendered (only counted with fbdev and vsync enabled, and if the refresh rate is known)",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_FRAMES_REPEATED,
+		g_param_spec_uint64(
+			"frames-repeated",
+			"Frames repeated",
+			"Number of display refreshes that repeated the previous frame because no new frame was ready in time (only counted with fbdev and vsync enabled, and if the refresh rate is known)",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PRESENT_LATENCY_HISTOGRAM,
+		g_param_spec_boxed(
+			"present-latency-histogram",
+			"Present latency histogram",
+			"Histogram of the time between the end of rendering a frame and the vsync at which it was shown (only recorded with fbdev and vsync enabled)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
@@ -339,11 +526,29 @@ static void gst_imx_2d_video_sink_init(GstImx2dVideoSink *self)
 	self->input_surface = NULL;
 
 	self->framebuffer = NULL;
+	self->drm_output = NULL;
+
+	self->scanout_displayed_buffer = NULL;
+	self->scanout_pending_buffer = NULL;
+	self->direct_frame_shown = FALSE;
+
+	self->scanout_page_allocator = NULL;
+	self->scanout_pool = NULL;
+
+	self->presentation_thread = NULL;
+
+	g_mutex_init(&(self->stats_mutex));
+	self->refresh_period = 0;
+	gst_imx_2d_video_sink_reset_frame_pacing_stats(self);
 
 	self->overlay_handler = NULL;
 
 	self->drop_frames = DEFAULT_DROP_FRAMES;
 	self->framebuffer_name = g_strdup(DEFAULT_FRAMEBUFFER_NAME);
+	self->drm_device_name = g_strdup(DEFAULT_DRM_DEVICE_NAME);
+	self->drm_connector_id = DEFAULT_DRM_CONNECTOR_ID;
+	self->drm_plane_id = DEFAULT_DRM_PLANE_ID;
+	self->direct_scanout = DEFAULT_DIRECT_SCANOUT;
 	self->input_crop = DEFAULT_INPUT_CROP;
 	self->video_direction = DEFAULT_VIDEO_DIRECTION;
 	self->clear_at_null = DEFAULT_CLEAR_AT_NULL;
@@ -361,10 +566,13 @@ static void gst_imx_2d_video_sink_init(GstImx2dVideoSink *self)
 	self->extra_margin.bottom_margin = DEFAULT_BOTTOM_MARGIN;
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
+	self->meta_video_direction = GST_VIDEO_ORIENTATION_IDENTITY;
 
 	self->drop_frames_changed = FALSE;
 
 	self->region_coords_need_update = TRUE;
+	self->total_region_clear_pending = FALSE;
+	self->pages_with_valid_margin = 0;
 }
 
 
@@ -373,11 +581,22 @@ static void gst_imx_2d_video_sink_dispose(GObject *object)
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
 
 	g_free(self->framebuffer_name);
+	g_free(self->drm_device_name);
 
 	G_OBJECT_CLASS(gst_imx_2d_video_sink_parent_class)->dispose(object);
 }
 
 
+static void gst_imx_2d_video_sink_finalize(GObject *object)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
+
+	g_mutex_clear(&(self->stats_mutex));
+
+	G_OBJECT_CLASS(gst_imx_2d_video_sink_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
@@ -539,6 +758,46 @@ static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_DRM_DEVICE_NAME:
+		{
+			gchar const *new_drm_device_name = g_value_get_string(value);
+
+			GST_OBJECT_LOCK(self);
+			g_free(self->drm_device_name);
+			/* Treat empty strings like NULL, that is, as a
+			 * request to use the framebuffer instead. */
+			if ((new_drm_device_name != NULL) && (new_drm_device_name[0] != '\0'))
+				self->drm_device_name = g_strdup(new_drm_device_name);
+			else
+				self->drm_device_name = NULL;
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DRM_CONNECTOR_ID:
+		{
+			GST_OBJECT_LOCK(self);
+			self->drm_connector_id = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DRM_PLANE_ID:
+		{
+			GST_OBJECT_LOCK(self);
+			self->drm_plane_id = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DIRECT_SCANOUT:
+		{
+			GST_OBJECT_LOCK(self);
+			self->direct_scanout = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -689,6 +948,102 @@ static void gst_imx_2d_video_sink_get_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_UPLOAD_STATS:
+		{
+			GstImxDmaBufferUploaderStats stats;
+
+			GST_OBJECT_LOCK(self);
+			if (self->uploader != NULL)
+			{
+				gst_imx_video_uploader_get_stats(self->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DRM_DEVICE_NAME:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_string(value, self->drm_device_name);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DRM_CONNECTOR_ID:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->drm_connector_id);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DRM_PLANE_ID:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->drm_plane_id);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DIRECT_SCANOUT:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->direct_scanout);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_FRAMES_PRESENTED:
+		{
+			g_mutex_lock(&(self->stats_mutex));
+			g_value_set_uint64(value, self->num_presented_frames);
+			g_mutex_unlock(&(self->stats_mutex));
+			break;
+		}
+
+		case PROP_FRAMES_DROPPED:
+		{
+			g_mutex_lock(&(self->stats_mutex));
+			g_value_set_uint64(value, self->num_dropped_frames);
+			g_mutex_unlock(&(self->stats_mutex));
+			break;
+		}
+
+		case PROP_FRAMES_LATE:
+		{
+			g_mutex_lock(&(self->stats_mutex));
+			g_value_set_uint64(value, self->num_late_frames);
+			g_mutex_unlock(&(self->stats_mutex));
+			break;
+		}
+
+		case PROP_FRAMES_REPEATED:
+		{
+			g_mutex_lock(&(self->stats_mutex));
+			g_value_set_uint64(value, self->num_repeated_frames);
+			g_mutex_unlock(&(self->stats_mutex));
+			break;
+		}
+
+		case PROP_PRESENT_LATENCY_HISTOGRAM:
+		{
+			GstStructure *histogram;
+			guint bucket;
+
+			histogram = gst_structure_new_empty("present-latency-histogram");
+
+			g_mutex_lock(&(self->stats_mutex));
+			for (bucket = 0; bucket < GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS; ++bucket)
+				gst_structure_set(histogram, present_latency_bucket_names[bucket], G_TYPE_UINT64, self->present_latency_histogram[bucket], NULL);
+			g_mutex_unlock(&(self->stats_mutex));
+
+			g_value_take_boxed(value, histogram);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -712,6 +1067,17 @@ static GstStateChangeReturn gst_imx_2d_video_sink_change_state(GstElement *eleme
 			break;
 		}
 
+		case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+		{
+			/* While paused, the same frame legitimately stays on screen,
+			 * so do not count the time until the next presentation as
+			 * repeated frames. */
+			g_mutex_lock(&(self->stats_mutex));
+			self->last_present_time = -1;
+			g_mutex_unlock(&(self->stats_mutex));
+			break;
+		}
+
 		default:
 			break;
 	}
@@ -765,6 +1131,33 @@ static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event)
 }
 
 
+static gboolean gst_imx_2d_video_sink_unlock(G_GNUC_UNUSED GstBaseSink *sink)
+{
+#ifdef WITH_IMX2D_LINUX_DRM
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(sink);
+
+	/* Wake up the streaming thread if it is waiting for a page flip. */
+	if (self->drm_output != NULL)
+		imx_2d_linux_drm_unlock(self->drm_output);
+#endif
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_video_sink_unlock_stop(G_GNUC_UNUSED GstBaseSink *sink)
+{
+#ifdef WITH_IMX2D_LINUX_DRM
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(sink);
+
+	if (self->drm_output != NULL)
+		imx_2d_linux_drm_unlock_stop(self->drm_output);
+#endif
+
+	return TRUE;
+}
+
+
 static gboolean gst_imx_2d_video_sink_set_caps(GstBaseSink *sink, GstCaps *caps)
 {
 	GstVideoInfo input_video_info;
@@ -854,9 +1247,14 @@ static gboolean gst_imx_2d_video_sink_propose_allocation(GstBaseSink *sink, GstQ
 		gst_structure_free(allocation_meta_structure);
 	}
 
-	/* Let upstream know that we can handle GstVideoMeta and GstVideoCropMeta. */
+	/* Let upstream know that we can handle GstVideoMeta, GstVideoCropMeta,
+	 * and GstImxVideoOrientationMeta. */
 	gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, 0);
 	gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, 0);
+	gst_query_add_allocation_meta(query, GST_IMX_VIDEO_ORIENTATION_META_API_TYPE, 0);
+
+	if (self->scanout_pool != NULL)
+		gst_imx_2d_video_sink_propose_scanout_pool(self, query);
 
 	return TRUE;
 }
@@ -867,23 +1265,43 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	Imx2dBlitParams blit_params;
 	GstFlowReturn flow_ret;
 	gboolean input_crop;
+	gboolean direct_scanout;
 	gboolean drop_frames, drop_frames_changed;
+	gboolean relocation_clear_pending;
+	Imx2dRegion relocation_clear_region;
+	gboolean total_region_clear_pending;
 	Imx2dRegion inner_region;
 	Imx2dBlitMargin combined_margin;
 	Imx2dRegion crop_rectangle;
 	GstVideoOrientationMethod video_direction;
+	GstVideoOrientationMethod meta_video_direction;
+	GstImxVideoOrientationMeta *orientation_meta;
 	GstBuffer *uploaded_input_buffer = NULL;
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK_CAST(video_sink);
 
 	g_assert(self->blitter != NULL);
 
 
+	/* If upstream handed off a rotation to us, pick it up here. It
+	 * affects the region calculations, so these need to be updated
+	 * if the orientation from the meta changed. */
+	orientation_meta = gst_buffer_get_imx_video_orientation_meta(input_buffer);
+	meta_video_direction = (orientation_meta != NULL) ? orientation_meta->method : GST_VIDEO_ORIENTATION_IDENTITY;
+
 	/* Create local copies of the property values so that we can use them
 	 * without risking race conditions if another thread is setting new
 	 * values while this function is running. */
 	GST_OBJECT_LOCK(self);
 
+	if (meta_video_direction != self->meta_video_direction)
+	{
+		GST_DEBUG_OBJECT(self, "video direction from orientation meta changed to %d", (gint)meta_video_direction);
+		self->meta_video_direction = meta_video_direction;
+		self->region_coords_need_update = TRUE;
+	}
+
 	input_crop = self->input_crop;
+	direct_scanout = self->direct_scanout;
 	video_direction = gst_imx_2d_video_sink_get_current_video_direction(self);
 	drop_frames = self->drop_frames;
 	drop_frames_changed = self->drop_frames_changed;
@@ -892,6 +1310,13 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	/* This must be called with the object lock held. */
 	gst_imx_2d_video_sink_recalculate_regions_if_needed(self);
 
+	relocation_clear_pending = self->relocation_clear_pending;
+	memcpy(&relocation_clear_region, &(self->relocation_clear_region), sizeof(relocation_clear_region));
+	self->relocation_clear_pending = FALSE;
+
+	total_region_clear_pending = self->total_region_clear_pending;
+	self->total_region_clear_pending = FALSE;
+
 	memcpy(&inner_region, &(self->inner_region), sizeof(inner_region));
 	memcpy(&combined_margin, &(self->combined_margin), sizeof(combined_margin));
 	/* NOTE: Alpha is 0xFF. If it were 0x00, the imx2d blitter code would
@@ -901,6 +1326,17 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	GST_OBJECT_UNLOCK(self);
 
 
+	/* If the window was relocated, clear its old location now
+	 * that the object lock is no longer held. */
+	if (relocation_clear_pending && !gst_imx_2d_video_clear_region(self, &relocation_clear_region, TRUE))
+		return GST_FLOW_ERROR;
+
+	/* If scanout pages were added, the framebuffer memory may have been
+	 * relocated, so the pages may now contain garbage. Clear them. */
+	if (total_region_clear_pending && !gst_imx_2d_video_clear_total_region(self, TRUE))
+		return GST_FLOW_ERROR;
+
+
 	/* Check if the drop-frames property changed. If it changed
 	 * from false to true, paint the output region black. */
 	if (drop_frames)
@@ -945,7 +1381,9 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	/* Fill the blit parameters. */
 
 	memset(&blit_params, 0, sizeof(blit_params));
-	blit_params.margin = &combined_margin;
+	/* The margin only needs to be filled if the page does not
+	 * already contain it from an earlier frame. */
+	blit_params.margin = (self->pages_with_valid_margin & (1u << self->write_fb_page)) ? NULL : &combined_margin;
 	blit_params.source_region = NULL;
 	blit_params.dest_region = &inner_region;
 	blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(video_direction);
@@ -975,6 +1413,60 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	}
 
 
+#ifdef WITH_IMX2D_LINUX_DRM
+	/* With DRM, try to show the frame directly on the plane first.
+	 * This is only possible if nothing would be drawn on top of the
+	 * frame and if the frame is not rotated, since KMS planes cannot
+	 * be expected to support rotation. If the plane cannot show the
+	 * frame as-is, fall back to blitting it into a page. */
+	if ((self->drm_output != NULL)
+	 && direct_scanout
+	 && (video_direction == GST_VIDEO_ORIENTATION_IDENTITY)
+	 && (gst_buffer_get_video_overlay_composition_meta(input_buffer) == NULL))
+	{
+		switch (gst_imx_2d_video_sink_try_direct_scanout(self, uploaded_input_buffer, blit_params.source_region, &inner_region))
+		{
+			case IMX_2D_LINUX_DRM_SCANOUT_RESULT_OK:
+				GST_LOG_OBJECT(self, "frame is directly scanned out; frame output complete");
+				goto finish;
+
+			case IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED:
+				GST_LOG_OBJECT(self, "frame cannot be directly scanned out; blitting it instead");
+				break;
+
+			default:
+				GST_ERROR_OBJECT(self, "direct scanout failed");
+				goto error;
+		}
+	}
+#endif
+
+	/* With fbdev, frames can be shown directly if upstream wrote them
+	 * into one of the framebuffer's scanout pages (see the buffer pool
+	 * proposed in gst_imx_2d_video_sink_propose_scanout_pool()). Panning
+	 * the display to that page then replaces the blit. The same
+	 * restrictions as with DRM apply. */
+	if ((self->scanout_page_allocator != NULL)
+	 && direct_scanout
+	 && (video_direction == GST_VIDEO_ORIENTATION_IDENTITY)
+	 && (gst_buffer_get_video_overlay_composition_meta(input_buffer) == NULL))
+	{
+		gboolean frame_shown;
+
+		if (!gst_imx_2d_video_sink_try_framebuffer_scanout(self, input_buffer, blit_params.source_region, &inner_region, &frame_shown))
+		{
+			GST_ERROR_OBJECT(self, "direct scanout failed");
+			goto error;
+		}
+
+		if (frame_shown)
+		{
+			GST_LOG_OBJECT(self, "frame is directly scanned out; frame output complete");
+			goto finish;
+		}
+	}
+
+
 	/* Now perform the actual blit. */
 
 	GST_LOG_OBJECT(self, "beginning blitting procedure to transform the frame");
@@ -988,12 +1480,14 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	if (!imx_2d_blitter_do_blit(self->blitter, self->input_surface, &blit_params))
 	{
 		GST_ERROR_OBJECT(self, "blitting failed");
+		imx_2d_blitter_finish(self->blitter);
 		goto error;
 	}
 
 	if (!gst_imx_2d_video_overlay_handler_render(self->overlay_handler, input_buffer))
 	{
 		GST_ERROR_OBJECT(self, "rendering overlay(s) failed");
+		imx_2d_blitter_finish(self->blitter);
 		goto error;
 	}
 
@@ -1003,6 +1497,14 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 		goto error;
 	}
 
+	/* Overlays may extend into the margin area, so if there
+	 * were any, the margin of this page has to be refilled
+	 * when the page is written into the next time. */
+	if (gst_buffer_get_video_overlay_composition_meta(input_buffer) != NULL)
+		self->pages_with_valid_margin &= ~(1u << self->write_fb_page);
+	else
+		self->pages_with_valid_margin |= (1u << self->write_fb_page);
+
 
 	if (!gst_imx_2d_video_sink_flip_pages(self))
 		goto error;
@@ -1018,7 +1520,11 @@ finish:
 	return flow_ret;
 
 error:
-	if (flow_ret != GST_FLOW_OK)
+	/* Waiting for a page flip fails if unlock() interrupted
+	 * it. That is not an error, since the sink is flushing. */
+	if (GST_PAD_IS_FLUSHING(GST_BASE_SINK_PAD(self)))
+		flow_ret = GST_FLOW_FLUSHING;
+	else
 		flow_ret = GST_FLOW_ERROR;
 	goto finish;
 }
@@ -1029,7 +1535,10 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 	gboolean ret = TRUE;
 	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
 	gboolean use_vsync;
+	gboolean direct_scanout;
 	gchar *framebuffer_name = NULL;
+	gchar *drm_device_name = NULL;
+	guint drm_connector_id, drm_plane_id;
 	GstImxDmaBufferUploader *dma_buffer_uploader;
 
 	self->imx_dma_buffer_allocator = gst_imx_allocator_new();
@@ -1041,14 +1550,26 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 	}
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
+	self->meta_video_direction = GST_VIDEO_ORIENTATION_IDENTITY;
 	self->drop_frames_changed = TRUE;
 
 	self->region_coords_need_update = TRUE;
 	self->total_region_valid = FALSE;
+	self->relocation_clear_pending = FALSE;
+	self->total_region_clear_pending = FALSE;
+	self->pages_with_valid_margin = 0;
+
+	g_mutex_lock(&(self->stats_mutex));
+	gst_imx_2d_video_sink_reset_frame_pacing_stats(self);
+	g_mutex_unlock(&(self->stats_mutex));
 
 	GST_OBJECT_LOCK(self);
 	framebuffer_name = g_strdup(self->framebuffer_name);
+	drm_device_name = g_strdup(self->drm_device_name);
+	drm_connector_id = self->drm_connector_id;
+	drm_plane_id = self->drm_plane_id;
 	use_vsync = self->use_vsync;
+	direct_scanout = self->direct_scanout;
 	GST_OBJECT_UNLOCK(self);
 
 	/* We call start _after_ the allocator & uploader were
@@ -1073,20 +1594,59 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 		goto error;
 	}
 
-	self->framebuffer = imx_2d_linux_framebuffer_create(framebuffer_name, use_vsync);
-	if (self->framebuffer == NULL)
+	if (drm_device_name != NULL)
 	{
-		GST_ERROR_OBJECT(self, "creating output framebuffer using device \"%s\" failed", framebuffer_name);
+#ifdef WITH_IMX2D_LINUX_DRM
+		self->drm_output = imx_2d_linux_drm_create(drm_device_name, drm_connector_id, drm_plane_id, use_vsync);
+		if (self->drm_output == NULL)
+		{
+			GST_ERROR_OBJECT(self, "creating DRM output using device \"%s\" failed", drm_device_name);
+			goto error;
+		}
+
+		self->direct_frame_shown = FALSE;
+
+		self->num_fb_pages = imx_2d_linux_drm_get_num_pages(self->drm_output);
+		self->framebuffer_surface = imx_2d_linux_drm_get_surface(self->drm_output);
+#else
+		(void)drm_connector_id;
+		(void)drm_plane_id;
+		GST_ERROR_OBJECT(self, "cannot use DRM device \"%s\": DRM/KMS output support was not enabled at build time", drm_device_name);
 		goto error;
+#endif
 	}
+	else
+	{
+		self->framebuffer = imx_2d_linux_framebuffer_create(framebuffer_name, use_vsync);
+		if (self->framebuffer == NULL)
+		{
+			GST_ERROR_OBJECT(self, "creating output framebuffer using device \"%s\" failed", framebuffer_name);
+			goto error;
+		}
+
+		/* The scanout pages themselves are only added once upstream
+		 * allocates from the scanout pool, since adding them enlarges
+		 * the virtual framebuffer, and upstream may never use the pool
+		 * (see gst_imx_2d_video_sink_add_scanout_pages()). */
+		if (direct_scanout)
+		{
+			self->scanout_page_allocator = gst_imx_2d_framebuffer_page_allocator_new(self->framebuffer, gst_imx_2d_video_sink_add_scanout_pages, self);
+			self->scanout_pool = gst_video_buffer_pool_new();
+		}
 
+		self->num_fb_pages = imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer);
+		self->framebuffer_surface = imx_2d_linux_framebuffer_get_surface(self->framebuffer);
+	}
+
+	/* The DRM output already shows page 0 after it was created,
+	 * so (re)showing page 0 is harmless. */
 	if (use_vsync)
 	{
 		self->write_fb_page = 1;
 		self->display_fb_page = 0;
 
-		imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, self->write_fb_page);
-		if (!imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, self->display_fb_page))
+		gst_imx_2d_video_sink_set_write_page(self, self->write_fb_page);
+		if (!gst_imx_2d_video_sink_show_page(self, self->display_fb_page))
 		{
 			GST_ERROR_OBJECT(self, "could not set initial framebuffer display page");
 			goto error;
@@ -1098,13 +1658,19 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 		self->display_fb_page = 0;
 	}
 
-	self->num_fb_pages = imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer);
-
-	self->framebuffer_surface = imx_2d_linux_framebuffer_get_surface(self->framebuffer);
 	g_assert(self->framebuffer_surface != NULL);
 
 	self->framebuffer_surface_desc = imx_2d_surface_get_desc(self->framebuffer_surface);
 
+	/* The presentation thread is started only after the initial
+	 * page was shown above, since until then, the streaming
+	 * thread is the only one that accesses the framebuffer. */
+	if ((self->framebuffer != NULL) && use_vsync)
+	{
+		if (!gst_imx_2d_video_sink_start_presentation_thread(self))
+			goto error;
+	}
+
 	dma_buffer_uploader = gst_imx_video_uploader_get_dma_buffer_uploader(self->uploader);
 	self->overlay_handler = gst_imx_2d_video_overlay_handler_new(dma_buffer_uploader, self->blitter);
 	gst_object_unref(GST_OBJECT(dma_buffer_uploader));
@@ -1114,10 +1680,14 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 		goto error;
 	}
 
-	GST_INFO_OBJECT(self, "framebuffer using device \"%s\" set up", framebuffer_name);
+	if (drm_device_name != NULL)
+		GST_INFO_OBJECT(self, "DRM output using device \"%s\" set up", drm_device_name);
+	else
+		GST_INFO_OBJECT(self, "framebuffer using device \"%s\" set up", framebuffer_name);
 
 finish:
 	g_free(framebuffer_name);
+	g_free(drm_device_name);
 	return ret;
 
 error:
@@ -1146,7 +1716,7 @@ static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self)
 		self->input_surface = NULL;
 	}
 
-	if (self->framebuffer != NULL)
+	if ((self->framebuffer != NULL) || (self->drm_output != NULL))
 	{
 		gboolean clear_at_null;
 
@@ -1159,22 +1729,71 @@ static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self)
 			GST_DEBUG_OBJECT(self, "clearing window in framebuffer with black pixels at the READY->NULL state change as requested");
 			gst_imx_2d_video_clear_total_region(self, FALSE);
 		}
+	}
+
+	/* Upstream may still hold buffers with scanout pages. Detach
+	 * the allocator so that their memory blocks do not access the
+	 * framebuffer anymore once it is destroyed below. This is done
+	 * before stopping the presentation thread, since detaching waits
+	 * for gst_imx_2d_video_sink_add_scanout_pages(), which uses it. */
+	if (self->scanout_page_allocator != NULL)
+		gst_imx_2d_framebuffer_page_allocator_detach(self->scanout_page_allocator);
+
+	/* This presents any still queued frame (like the cleared
+	 * window from above) before the thread finishes. */
+	gst_imx_2d_video_sink_stop_presentation_thread(self);
+
+	if (self->scanout_pool != NULL)
+	{
+		gst_buffer_pool_set_active(self->scanout_pool, FALSE);
+		gst_object_unref(GST_OBJECT(self->scanout_pool));
+		self->scanout_pool = NULL;
+	}
+
+	if (self->scanout_page_allocator != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->scanout_page_allocator));
+		self->scanout_page_allocator = NULL;
+	}
 
+	if (self->framebuffer != NULL)
+	{
 		imx_2d_linux_framebuffer_destroy(self->framebuffer);
 		self->framebuffer = NULL;
 	}
 
+#ifdef WITH_IMX2D_LINUX_DRM
+	if (self->drm_output != NULL)
+	{
+		/* Destroying the DRM output waits until the last commit
+		 * finished and restores the previous display setup, so
+		 * afterwards, the held buffers are no longer scanned out. */
+		imx_2d_linux_drm_destroy(self->drm_output);
+		self->drm_output = NULL;
+	}
+#endif
+
+	gst_buffer_replace(&(self->scanout_displayed_buffer), NULL);
+	gst_buffer_replace(&(self->scanout_pending_buffer), NULL);
+	self->direct_frame_shown = FALSE;
+
+	self->framebuffer_surface = NULL;
+	self->framebuffer_surface_desc = NULL;
+
 	if (self->blitter != NULL)
 	{
 		imx_2d_blitter_destroy(self->blitter);
 		self->blitter = NULL;
 	}
 
+	/* See gst_imx_video_uploader_get_stats() for why the object lock is needed here. */
+	GST_OBJECT_LOCK(self);
 	if (self->uploader != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->uploader));
 		self->uploader = NULL;
 	}
+	GST_OBJECT_UNLOCK(self);
 
 	if (self->imx_dma_buffer_allocator != NULL)
 	{
@@ -1205,45 +1824,727 @@ static gboolean gst_imx_2d_video_sink_create_blitter(GstImx2dVideoSink *self)
 
 static GstVideoOrientationMethod gst_imx_2d_video_sink_get_current_video_direction(GstImx2dVideoSink *self)
 {
-	return (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
+	GstVideoOrientationMethod video_direction = (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
+	return gst_imx_video_orientation_method_combine(self->meta_video_direction, video_direction);
 }
 
 
 static gboolean gst_imx_2d_video_sink_flip_pages(GstImx2dVideoSink *self)
 {
 	if (!self->use_vsync)
-		return TRUE;
+	{
+		/* Without vsync, there is only one page, and blits into it
+		 * are visible right away. However, if a frame was directly
+		 * scanned out, that page is currently not shown, so show
+		 * it again. */
+		if (self->direct_frame_shown)
+		{
+			if (!gst_imx_2d_video_sink_show_page(self, 0))
+			{
+				GST_ERROR_OBJECT(self, "could not show framebuffer page again after direct scanout");
+				return FALSE;
+			}
+		}
 
-	self->display_fb_page = self->write_fb_page;
-	self->write_fb_page = (self->write_fb_page + 1) % self->num_fb_pages;
+		return TRUE;
+	}
 
-	imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, self->write_fb_page);
-	if (!imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, self->display_fb_page))
+	if (self->presentation_thread != NULL)
 	{
-		GST_ERROR_OBJECT(self, "could not set new framebuffer display page");
-		return FALSE;
-	}
+		if (!gst_imx_2d_video_sink_queue_presentation(self, self->write_fb_page, FALSE, NULL))
+		{
+			GST_ERROR_OBJECT(self, "could not queue framebuffer page for presentation");
+			return FALSE;
+		}
+
+		return gst_imx_2d_video_sink_select_next_write_page(self);
+	}
+
+	self->display_fb_page = self->write_fb_page;
+	self->write_fb_page = (self->write_fb_page + 1) % self->num_fb_pages;
+
+	gst_imx_2d_video_sink_set_write_page(self, self->write_fb_page);
+	if (!gst_imx_2d_video_sink_show_page(self, self->display_fb_page))
+	{
+		GST_ERROR_OBJECT(self, "could not set new framebuffer display page");
+		return FALSE;
+	}
 	else
 		return TRUE;
 }
 
 
-static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gboolean clear_on_all_pages)
+static void gst_imx_2d_video_sink_set_write_page(GstImx2dVideoSink *self, int page)
 {
-	int page_index;
-	int num_pages;
+#ifdef WITH_IMX2D_LINUX_DRM
+	if (self->drm_output != NULL)
+	{
+		imx_2d_linux_drm_set_write_page(self->drm_output, page);
+		return;
+	}
+#endif
+
+	imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, page);
+}
+
+
+static gboolean gst_imx_2d_video_sink_show_page(GstImx2dVideoSink *self, int page)
+{
+#ifdef WITH_IMX2D_LINUX_DRM
+	if (self->drm_output != NULL)
+	{
+		if (!imx_2d_linux_drm_show_page(self->drm_output, page))
+			return FALSE;
+	}
+	else
+#endif
+	if (!imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, page))
+		return FALSE;
+
+	self->direct_frame_shown = FALSE;
+	gst_imx_2d_video_sink_update_scanout_held_buffers(self, NULL);
+
+	return TRUE;
+}
+
+
+static void gst_imx_2d_video_sink_update_scanout_held_buffers(GstImx2dVideoSink *self, GstBuffer *shown_buffer)
+{
+	/* Called after each page flip. Before performing a flip, the
+	 * DRM output waits until the previous flip took effect, and with
+	 * fbdev, panning the display waits for vsync (if enabled). At that
+	 * point, the buffer that was shown before the previous flip is no
+	 * longer scanned out, so it can be released. The buffer of the
+	 * previous flip may still be shown until the flip that just
+	 * happened takes effect, so keep it around. */
+
+	if (self->scanout_displayed_buffer != NULL)
+		gst_buffer_unref(self->scanout_displayed_buffer);
+
+	self->scanout_displayed_buffer = self->scanout_pending_buffer;
+	self->scanout_pending_buffer = (shown_buffer != NULL) ? gst_buffer_ref(shown_buffer) : NULL;
+}
+
+
+static void gst_imx_2d_video_sink_propose_scanout_pool(GstImx2dVideoSink *self, GstQuery *query)
+{
+	GstCaps *caps;
+	gboolean need_pool;
+	GstVideoInfo video_info;
+	GstVideoAlignment video_alignment;
+	GstStructure *config;
+	Imx2dSurfaceDesc const *fb_desc = self->framebuffer_surface_desc;
+	/* The pages are only added once upstream allocates from
+	 * the pool, so get_num_scanout_pages() may still return 0. */
+	guint num_pages = NUM_FRAMEBUFFER_SCANOUT_PAGES;
+	gint pixel_stride;
+
+	g_assert(self->scanout_pool != NULL);
+
+	gst_query_parse_allocation(query, &caps, &need_pool);
+
+	if (!need_pool || (caps == NULL) || !gst_video_info_from_caps(&video_info, caps))
+		return;
+
+	/* Panning shows entire pages, so only frames that look exactly
+	 * like a framebuffer page can be scanned out directly. */
+	if ((GST_VIDEO_INFO_FORMAT(&video_info) != gst_imx_2d_convert_to_gst_video_format(fb_desc->format))
+	 || (GST_VIDEO_INFO_WIDTH(&video_info) != (gint)(fb_desc->width))
+	 || (GST_VIDEO_INFO_HEIGHT(&video_info) != (gint)(fb_desc->height)))
+	{
+		GST_DEBUG_OBJECT(self, "caps %" GST_PTR_FORMAT " do not match the framebuffer format and size; not proposing scanout pool", (gpointer)caps);
+		return;
+	}
+
+	/* Framebuffer rows may be padded. Use the video alignment to
+	 * make the pool's buffers have the framebuffer's stride. */
+	pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE(&video_info, 0);
+	if ((fb_desc->plane_strides[0] % pixel_stride) != 0)
+	{
+		GST_DEBUG_OBJECT(self, "framebuffer stride %d is not a multiple of the pixel size; not proposing scanout pool", fb_desc->plane_strides[0]);
+		return;
+	}
+
+	gst_video_alignment_reset(&video_alignment);
+	video_alignment.padding_right = fb_desc->plane_strides[0] / pixel_stride - fb_desc->width;
+	gst_video_info_align(&video_info, &video_alignment);
+
+	if (GST_VIDEO_INFO_PLANE_STRIDE(&video_info, 0) != fb_desc->plane_strides[0])
+	{
+		GST_DEBUG_OBJECT(self, "cannot produce frames with the framebuffer stride %d; not proposing scanout pool", fb_desc->plane_strides[0]);
+		return;
+	}
+
+	if (gst_buffer_pool_is_active(self->scanout_pool))
+	{
+		GstCaps *pool_caps;
+		gboolean same_caps;
+
+		/* An active pool cannot be reconfigured. If upstream still
+		 * uses it with the same caps, it can keep using it. */
+		config = gst_buffer_pool_get_config(self->scanout_pool);
+		gst_buffer_pool_config_get_params(config, &pool_caps, NULL, NULL, NULL);
+		same_caps = (pool_caps != NULL) && gst_caps_is_equal(pool_caps, caps);
+		gst_structure_free(config);
+
+		if (!same_caps)
+		{
+			GST_DEBUG_OBJECT(self, "scanout pool is active with different caps; not proposing it");
+			return;
+		}
+	}
+	else
+	{
+		config = gst_buffer_pool_get_config(self->scanout_pool);
+		gst_buffer_pool_config_set_params(config, caps, GST_VIDEO_INFO_SIZE(&video_info), 0, num_pages);
+		gst_buffer_pool_config_set_allocator(config, self->scanout_page_allocator, NULL);
+		gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+		gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+		gst_buffer_pool_config_set_video_alignment(config, &video_alignment);
+
+		if (!gst_buffer_pool_set_config(self->scanout_pool, config))
+		{
+			GST_WARNING_OBJECT(self, "could not configure scanout pool; not proposing it");
+			return;
+		}
+	}
+
+	GST_DEBUG_OBJECT(self, "proposing scanout pool with %u page(s) for caps %" GST_PTR_FORMAT, num_pages, (gpointer)caps);
+
+	gst_query_add_allocation_pool(query, self->scanout_pool, GST_VIDEO_INFO_SIZE(&video_info), 0, num_pages);
+}
+
 
+static gboolean gst_imx_2d_video_sink_add_scanout_pages(gpointer user_data)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK_CAST(user_data);
+	gboolean ret;
+
+	/* This is called by the scanout page allocator when upstream
+	 * allocates from the scanout pool for the first time, in upstream's
+	 * thread. Adding pages reconfigures the framebuffer and may relocate
+	 * its memory, so nothing else may access the framebuffer meanwhile.
+	 * The stream lock keeps the streaming thread out of show_frame()
+	 * (it is recursive, so this also works if upstream allocates in
+	 * the streaming thread). The presentation thread has to finish
+	 * any queued presentation first. */
+	GST_PAD_STREAM_LOCK(GST_BASE_SINK_PAD(self));
+
+	if (self->presentation_thread != NULL)
+	{
+		g_mutex_lock(&(self->presentation_mutex));
+		while ((self->presentation_queued || self->presentation_in_progress) && !self->presentation_failed)
+			g_cond_wait(&(self->presentation_cond), &(self->presentation_mutex));
+	}
+
+	ret = imx_2d_linux_framebuffer_add_scanout_pages(self->framebuffer, NUM_FRAMEBUFFER_SCANOUT_PAGES);
+	if (ret)
+	{
+		GST_DEBUG_OBJECT(self, "added %d scanout pages to framebuffer", NUM_FRAMEBUFFER_SCANOUT_PAGES);
+
+		/* Adding the pages involves FBIOPUT_VSCREENINFO, which may
+		 * reallocate or move the framebuffer memory. The margins that
+		 * were already drawn into the pages are then gone, and so is
+		 * the rest of their contents. Have show_frame() redraw them. */
+		GST_OBJECT_LOCK(self);
+		self->pages_with_valid_margin = 0;
+		self->total_region_clear_pending = TRUE;
+		GST_OBJECT_UNLOCK(self);
+	}
+	else
+		GST_WARNING_OBJECT(self, "could not add scanout pages to framebuffer; frames will always be blitted");
+
+	if (self->presentation_thread != NULL)
+		g_mutex_unlock(&(self->presentation_mutex));
+
+	GST_PAD_STREAM_UNLOCK(GST_BASE_SINK_PAD(self));
+
+	return ret;
+}
+
+
+static gboolean gst_imx_2d_video_sink_try_framebuffer_scanout(GstImx2dVideoSink *self, GstBuffer *input_buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, gboolean *frame_shown)
+{
+	Imx2dSurfaceDesc const *fb_desc = self->framebuffer_surface_desc;
+	GstVideoMeta *videometa;
+	gint page_index;
+	gsize plane_offset;
+	gint plane_stride;
+
+	*frame_shown = FALSE;
+
+	if (gst_buffer_n_memory(input_buffer) != 1)
+		return TRUE;
+
+	page_index = gst_imx_2d_framebuffer_page_allocator_get_page_index(self->scanout_page_allocator, gst_buffer_peek_memory(input_buffer, 0));
+	if (page_index < 0)
+		return TRUE;
+
+	/* Panning always shows an entire page, so the frame must fill
+	 * the screen, must not be cropped, and must be laid out exactly
+	 * like the page. Otherwise, it gets blitted like any other frame
+	 * (the page memory is DMA memory, so that is still cheap). */
+
+	if ((dest_region->x1 != 0) || (dest_region->y1 != 0)
+	 || (dest_region->x2 != (int)(fb_desc->width)) || (dest_region->y2 != (int)(fb_desc->height)))
+	{
+		GST_LOG_OBJECT(self, "frame from scanout page #%d does not fill the screen; blitting it instead", page_index);
+		return TRUE;
+	}
+
+	if ((source_region != NULL)
+	 && ((source_region->x1 != 0) || (source_region->y1 != 0)
+	  || (source_region->x2 != (int)(fb_desc->width)) || (source_region->y2 != (int)(fb_desc->height))))
+	{
+		GST_LOG_OBJECT(self, "frame from scanout page #%d is cropped; blitting it instead", page_index);
+		return TRUE;
+	}
+
+	videometa = gst_buffer_get_video_meta(input_buffer);
+	plane_offset = (videometa != NULL) ? videometa->offset[0] : GST_VIDEO_INFO_PLANE_OFFSET(&(self->input_video_info), 0);
+	plane_stride = (videometa != NULL) ? videometa->stride[0] : GST_VIDEO_INFO_PLANE_STRIDE(&(self->input_video_info), 0);
+
+	if ((self->input_surface_desc.format != fb_desc->format)
+	 || (self->input_surface_desc.width != fb_desc->width)
+	 || (self->input_surface_desc.height != fb_desc->height)
+	 || (plane_offset != 0)
+	 || (plane_stride != fb_desc->plane_strides[0]))
+	{
+		GST_LOG_OBJECT(self, "layout of frame from scanout page #%d does not match the framebuffer; blitting it instead", page_index);
+		return TRUE;
+	}
+
+	if (self->presentation_thread != NULL)
+	{
+		/* The presentation thread takes care of holding the buffer. */
+		if (!gst_imx_2d_video_sink_queue_presentation(self, page_index, TRUE, input_buffer))
+			return FALSE;
+	}
+	else
+	{
+		if (!imx_2d_linux_framebuffer_show_scanout_page(self->framebuffer, page_index))
+			return FALSE;
+
+		self->direct_frame_shown = TRUE;
+		gst_imx_2d_video_sink_update_scanout_held_buffers(self, input_buffer);
+	}
+
+	*frame_shown = TRUE;
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_video_sink_start_presentation_thread(GstImx2dVideoSink *self)
+{
+	gint64 refresh_period;
+	GError *error = NULL;
+
+	g_assert(self->framebuffer != NULL);
+	g_assert(self->presentation_thread == NULL);
+
+	refresh_period = imx_2d_linux_framebuffer_get_refresh_period(self->framebuffer);
+	if (refresh_period > 0)
+		GST_DEBUG_OBJECT(self, "display refresh period: %" GST_TIME_FORMAT, GST_TIME_ARGS(refresh_period));
+	else
+		GST_DEBUG_OBJECT(self, "display refresh period is unknown; late and repeated frames will not be counted");
+
+	g_mutex_lock(&(self->stats_mutex));
+	self->refresh_period = refresh_period;
+	g_mutex_unlock(&(self->stats_mutex));
+
+	g_mutex_init(&(self->presentation_mutex));
+	g_cond_init(&(self->presentation_cond));
+	self->presentation_thread_quit = FALSE;
+	self->presentation_failed = FALSE;
+	self->presentation_queued = FALSE;
+	self->presentation_in_progress = FALSE;
+	memset(&(self->queued_presentation), 0, sizeof(self->queued_presentation));
+	self->presenting_fb_page = -1;
+
+	self->presentation_thread = g_thread_try_new("imx2dvideosink-present", gst_imx_2d_video_sink_presentation_thread_func, self, &error);
+	if (self->presentation_thread == NULL)
+	{
+		GST_ERROR_OBJECT(self, "could not start presentation thread: %s", error->message);
+		g_error_free(error);
+		g_cond_clear(&(self->presentation_cond));
+		g_mutex_clear(&(self->presentation_mutex));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static void gst_imx_2d_video_sink_stop_presentation_thread(GstImx2dVideoSink *self)
+{
+	if (self->presentation_thread == NULL)
+		return;
+
+	g_mutex_lock(&(self->presentation_mutex));
+	self->presentation_thread_quit = TRUE;
+	g_cond_broadcast(&(self->presentation_cond));
+	g_mutex_unlock(&(self->presentation_mutex));
+
+	g_thread_join(self->presentation_thread);
+	self->presentation_thread = NULL;
+
+	/* The thread always picks up queued frames before
+	 * finishing, unless presenting failed earlier. */
+	if (self->queued_presentation.buffer != NULL)
+	{
+		gst_buffer_unref(self->queued_presentation.buffer);
+		self->queued_presentation.buffer = NULL;
+	}
+
+	g_cond_clear(&(self->presentation_cond));
+	g_mutex_clear(&(self->presentation_mutex));
+
+	GST_DEBUG_OBJECT(self, "presentation thread stopped");
+}
+
+
+static gpointer gst_imx_2d_video_sink_presentation_thread_func(gpointer user_data)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK_CAST(user_data);
+	GstImx2dVideoSinkPresentation presentation;
+	gint64 pan_start_time, pan_end_time;
+	gint64 vsync_time = 0;
+	gint64 refresh_period;
+	int vsync_waited;
+	gboolean ok;
+
+	GST_DEBUG_OBJECT(self, "presentation thread started");
+
+	g_mutex_lock(&(self->stats_mutex));
+	refresh_period = self->refresh_period;
+	g_mutex_unlock(&(self->stats_mutex));
+
+	g_mutex_lock(&(self->presentation_mutex));
+
+	while (!self->presentation_failed)
+	{
+		while (!self->presentation_queued && !self->presentation_thread_quit)
+			g_cond_wait(&(self->presentation_cond), &(self->presentation_mutex));
+
+		/* Frames that were queued before the thread was told
+		 * to quit are still shown (see stop()). */
+		if (!self->presentation_queued)
+			break;
+
+		presentation = self->queued_presentation;
+		self->queued_presentation.buffer = NULL;
+		self->presentation_queued = FALSE;
+		self->presentation_in_progress = TRUE;
+		self->presenting_fb_page = presentation.is_scanout_page ? -1 : presentation.page;
+
+		g_mutex_unlock(&(self->presentation_mutex));
+
+		pan_start_time = g_get_monotonic_time() * 1000;
+
+		if (presentation.is_scanout_page)
+			ok = imx_2d_linux_framebuffer_show_scanout_page(self->framebuffer, presentation.page);
+		else
+			ok = imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, presentation.page);
+
+		pan_end_time = g_get_monotonic_time() * 1000;
+
+		/* Some drivers (like the MXC framebuffer driver) already block
+		 * in FBIOPAN_DISPLAY until the vsync. Waiting for another vsync
+		 * would then halve the maximum frame rate. If panning took a
+		 * substantial part of a refresh period, assume that this is
+		 * the case and use the time panning finished instead. */
+		if (ok)
+		{
+			if ((refresh_period > 0) && ((pan_end_time - pan_start_time) >= (refresh_period / 2)))
+			{
+				vsync_time = pan_end_time;
+				vsync_waited = TRUE;
+			}
+			else
+				ok = imx_2d_linux_framebuffer_wait_for_vsync(self->framebuffer, &vsync_time, &vsync_waited);
+		}
+
+		/* Post the error without holding the mutex, since bus
+		 * sync handlers may react to it right away. */
+		if (!ok)
+			GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("could not present frame"), ("showing %s page %d failed", presentation.is_scanout_page ? "scanout" : "framebuffer", presentation.page));
+
+		g_mutex_lock(&(self->presentation_mutex));
+
+		self->presenting_fb_page = -1;
+		self->presentation_in_progress = FALSE;
+
+		if (ok)
+		{
+			self->display_fb_page = presentation.is_scanout_page ? -1 : presentation.page;
+
+			/* After the vsync, the previously shown page is no longer
+			 * scanned out, so only the buffer that is now shown (if any)
+			 * has to be held. If it is unknown whether the vsync already
+			 * happened, the previously shown page may still be scanned
+			 * out, so its buffer is kept until the next flip. */
+			if (vsync_waited)
+				gst_buffer_replace(&(self->scanout_pending_buffer), NULL);
+			gst_imx_2d_video_sink_update_scanout_held_buffers(self, presentation.buffer);
+
+			gst_imx_2d_video_sink_update_frame_pacing_stats(self, presentation.queue_time, vsync_time);
+		}
+		else
+			self->presentation_failed = TRUE;
+
+		if (presentation.buffer != NULL)
+			gst_buffer_unref(presentation.buffer);
+
+		/* Wake up the streaming thread in case it is waiting for a free page. */
+		g_cond_broadcast(&(self->presentation_cond));
+	}
+
+	g_mutex_unlock(&(self->presentation_mutex));
+
+	GST_DEBUG_OBJECT(self, "presentation thread finished");
+
+	return NULL;
+}
+
+
+static gboolean gst_imx_2d_video_sink_queue_presentation(GstImx2dVideoSink *self, int page, gboolean is_scanout_page, GstBuffer *buffer)
+{
+	gboolean ret = TRUE;
+
+	g_mutex_lock(&(self->presentation_mutex));
+
+	if (self->presentation_failed)
+	{
+		ret = FALSE;
+		goto finish;
+	}
+
+	if (self->presentation_queued)
+	{
+		/* The presentation thread did not pick up the previously
+		 * queued frame yet. Replace it with the newer frame instead
+		 * of falling further behind. */
+		GST_LOG_OBJECT(self, "replacing not yet presented frame in %s page %d", self->queued_presentation.is_scanout_page ? "scanout" : "regular", self->queued_presentation.page);
+
+		if (self->queued_presentation.buffer != NULL)
+			gst_buffer_unref(self->queued_presentation.buffer);
+
+		g_mutex_lock(&(self->stats_mutex));
+		self->num_dropped_frames++;
+		g_mutex_unlock(&(self->stats_mutex));
+	}
+
+	self->queued_presentation.page = page;
+	self->queued_presentation.is_scanout_page = is_scanout_page;
+	self->queued_presentation.buffer = (buffer != NULL) ? gst_buffer_ref(buffer) : NULL;
+	self->queued_presentation.queue_time = g_get_monotonic_time() * 1000;
+	self->presentation_queued = TRUE;
+
+	g_cond_broadcast(&(self->presentation_cond));
+
+finish:
+	g_mutex_unlock(&(self->presentation_mutex));
+	return ret;
+}
+
+
+static gboolean gst_imx_2d_video_sink_select_next_write_page(GstImx2dVideoSink *self)
+{
+	int i, page = -1;
+
+	/* Of the three pages, one is shown, one may be queued or about to
+	 * be shown, and one is free to be written into. If the presentation
+	 * thread is panning to a page while another one is queued, there
+	 * is no free page until the pan completes, so wait for it. */
+
+	g_mutex_lock(&(self->presentation_mutex));
+
+	while (!self->presentation_failed)
+	{
+		for (i = 1; i <= self->num_fb_pages; ++i)
+		{
+			int candidate = (self->write_fb_page + i) % self->num_fb_pages;
+
+			if ((candidate != self->display_fb_page)
+			 && (candidate != self->presenting_fb_page)
+			 && !(self->presentation_queued && !(self->queued_presentation.is_scanout_page) && (candidate == self->queued_presentation.page)))
+			{
+				page = candidate;
+				break;
+			}
+		}
+
+		if (page >= 0)
+			break;
+
+		g_cond_wait(&(self->presentation_cond), &(self->presentation_mutex));
+	}
+
+	g_mutex_unlock(&(self->presentation_mutex));
+
+	if (page < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not select next write page since presenting failed");
+		return FALSE;
+	}
+
+	self->write_fb_page = page;
+	gst_imx_2d_video_sink_set_write_page(self, page);
+
+	return TRUE;
+}
+
+
+static void gst_imx_2d_video_sink_update_frame_pacing_stats(GstImx2dVideoSink *self, gint64 queue_time, gint64 present_time)
+{
+	gint64 latency = present_time - queue_time;
+	guint bucket;
+
+	for (bucket = 0; bucket < (GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS - 1); ++bucket)
+	{
+		if (latency <= present_latency_bucket_limits[bucket])
+			break;
+	}
+
+	g_mutex_lock(&(self->stats_mutex));
+
+	self->num_presented_frames++;
+	self->present_latency_histogram[bucket]++;
+
+	if (self->refresh_period > 0)
+	{
+		/* Without delays, a frame is shown at the
+		 * first vsync after it was queued. */
+		if (latency > self->refresh_period)
+			self->num_late_frames++;
+
+		/* If several refresh periods passed since the last
+		 * presentation, the previous frame was shown repeatedly. */
+		if (self->last_present_time >= 0)
+		{
+			gint64 num_periods = (present_time - self->last_present_time + self->refresh_period / 2) / self->refresh_period;
+			if (num_periods > 1)
+				self->num_repeated_frames += num_periods - 1;
+		}
+	}
+
+	self->last_present_time = present_time;
+
+	g_mutex_unlock(&(self->stats_mutex));
+
+	GST_LOG_OBJECT(self, "frame presented with latency %" GST_STIME_FORMAT, GST_STIME_ARGS(latency));
+}
+
+
+static void gst_imx_2d_video_sink_reset_frame_pacing_stats(GstImx2dVideoSink *self)
+{
+	/* Must be called with the stats mutex held (or from init). */
+
+	self->last_present_time = -1;
+	self->num_presented_frames = 0;
+	self->num_dropped_frames = 0;
+	self->num_late_frames = 0;
+	self->num_repeated_frames = 0;
+	memset(self->present_latency_histogram, 0, sizeof(self->present_latency_histogram));
+}
+
+
+#ifdef WITH_IMX2D_LINUX_DRM
+
+static Imx2dLinuxDrmScanoutResult gst_imx_2d_video_sink_try_direct_scanout(GstImx2dVideoSink *self, GstBuffer *uploaded_input_buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region)
+{
+	Imx2dLinuxDrmDmaBufFrame frame;
+	Imx2dLinuxDrmScanoutResult result;
+	GstVideoMeta *videometa;
+	guint num_memory_blocks;
+	guint num_planes;
+	guint plane_index;
+
+	g_assert(self->drm_output != NULL);
+
+	memset(&frame, 0, sizeof(frame));
+	frame.format = self->input_surface_desc.format;
+	frame.width = self->input_surface_desc.width;
+	frame.height = self->input_surface_desc.height;
+
+	num_memory_blocks = gst_buffer_n_memory(uploaded_input_buffer);
+	videometa = gst_buffer_get_video_meta(uploaded_input_buffer);
+	num_planes = (videometa != NULL) ? videometa->n_planes : GST_VIDEO_INFO_N_PLANES(&(self->input_video_info));
+
+	if (num_planes > G_N_ELEMENTS(frame.dmabuf_fds))
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+
+	/* The uploaded buffer has the same layout that is used for
+	 * filling the input surface: either one gstmemory per plane
+	 * (then, plane offsets are not needed), or one gstmemory that
+	 * contains all planes. See gst_imx_2d_assign_input_buffer_to_surface(). */
+	for (plane_index = 0; plane_index < num_planes; ++plane_index)
+	{
+		ImxDmaBuffer *dma_buffer;
+
+		if (num_memory_blocks > 1)
+		{
+			GstMemory *memory = gst_buffer_peek_memory(uploaded_input_buffer, plane_index);
+			g_assert(gst_imx_is_imx_dma_buffer_memory(memory));
+			dma_buffer = gst_imx_get_dma_buffer_from_memory(memory);
+			frame.plane_offsets[plane_index] = 0;
+		}
+		else
+		{
+			dma_buffer = gst_imx_get_dma_buffer_from_buffer(uploaded_input_buffer);
+			frame.plane_offsets[plane_index] = (videometa != NULL) ? videometa->offset[plane_index] : GST_VIDEO_INFO_PLANE_OFFSET(&(self->input_video_info), plane_index);
+		}
+
+		g_assert(dma_buffer != NULL);
+
+		/* Not all DMA buffer allocators produce DMA-BUF backed buffers. */
+		frame.dmabuf_fds[plane_index] = imx_dma_buffer_get_fd(dma_buffer);
+		if (frame.dmabuf_fds[plane_index] < 0)
+		{
+			GST_LOG_OBJECT(self, "plane #%u of frame has no DMA-BUF FD; cannot scan it out directly", plane_index);
+			return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+		}
+
+		frame.plane_strides[plane_index] = self->input_surface_desc.plane_strides[plane_index];
+	}
+
+	result = imx_2d_linux_drm_show_dmabuf_frame(self->drm_output, &frame, source_region, dest_region);
+
+	if (result == IMX_2D_LINUX_DRM_SCANOUT_RESULT_OK)
+	{
+		self->direct_frame_shown = TRUE;
+		gst_imx_2d_video_sink_update_scanout_held_buffers(self, uploaded_input_buffer);
+	}
+
+	return result;
+}
+
+#endif
+
+
+static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gboolean clear_on_all_pages)
+{
 	if (!self->total_region_valid)
 		return TRUE;
 
-	num_pages = clear_on_all_pages ? imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer) : 1;
+	return gst_imx_2d_video_clear_region(self, &(self->total_region), clear_on_all_pages);
+}
+
+
+static gboolean gst_imx_2d_video_clear_region(GstImx2dVideoSink *self, Imx2dRegion const *region, gboolean clear_on_all_pages)
+{
+	int page_index;
+	int num_pages;
+
+	num_pages = clear_on_all_pages ? self->num_fb_pages : 1;
 
 	for (page_index = 0; page_index < num_pages; ++page_index)
 	{
 		if (self->use_vsync && clear_on_all_pages)
 		{
 			GST_DEBUG_OBJECT(self, "clearing FB page %d", page_index);
-			imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, page_index);
+			gst_imx_2d_video_sink_set_write_page(self, page_index);
 		}
 
 		if (!imx_2d_blitter_start(self->blitter, self->framebuffer_surface))
@@ -1252,9 +2553,10 @@ static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gbo
 			return FALSE;
 		}
 
-		if (!imx_2d_blitter_fill_region(self->blitter, &(self->total_region), 0xFF000000))
+		if (!imx_2d_blitter_fill_region(self->blitter, region, 0xFF000000))
 		{
 			GST_ERROR_OBJECT(self, "blitting failed");
+			imx_2d_blitter_finish(self->blitter);
 			return FALSE;
 		}
 
@@ -1282,10 +2584,14 @@ static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSin
 	if (!self->region_coords_need_update)
 		return;
 
-	if (self->clear_on_relocate)
+	/* Clearing involves page flips, which must not be done while
+	 * the object lock is held, so only remember the old region here.
+	 * show_frame() clears it after releasing the lock. */
+	if (self->clear_on_relocate && self->total_region_valid)
 	{
 		GST_TRACE_OBJECT(self, "need to clear total region %" IMX_2D_REGION_FORMAT " before relocating it", IMX_2D_REGION_ARGS(&(self->total_region)));
-		gst_imx_2d_video_clear_total_region(self, TRUE);
+		memcpy(&(self->relocation_clear_region), &(self->total_region), sizeof(Imx2dRegion));
+		self->relocation_clear_pending = TRUE;
 	}
 
 	input_width = GST_VIDEO_INFO_WIDTH(&(self->input_video_info));
@@ -1392,6 +2698,10 @@ static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSin
 	/* Mark the coordinates as updated so they are not
 	 * needlessly recalculated later. */
 	self->region_coords_need_update = FALSE;
+
+	/* The margins may have moved or changed their size,
+	 * so they have to be filled again on all pages. */
+	self->pages_with_valid_margin = 0;
 }
 
 
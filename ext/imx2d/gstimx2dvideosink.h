@@ -24,6 +24,7 @@
 #include "gst/imx/video/gstimxvideouploader.h"
 #include "imx2d/imx2d.h"
 #include "imx2d/linux_framebuffer.h"
+#include "imx2d/linux_drm.h"
 #include "gstimx2dvideooverlayhandler.h"
 
 
@@ -43,6 +44,24 @@ typedef struct _GstImx2dVideoSink GstImx2dVideoSink;
 typedef struct _GstImx2dVideoSinkClass GstImx2dVideoSinkClass;
 
 
+#define GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS 6
+
+
+/* A frame that was queued for the presentation thread. */
+typedef struct
+{
+	/* Page to show. If is_scanout_page is TRUE, this is a
+	 * framebuffer scanout page, otherwise a regular page. */
+	int page;
+	gboolean is_scanout_page;
+	/* Buffer that owns the scanout page, or NULL. */
+	GstBuffer *buffer;
+	/* Monotonic time when the frame was queued, in ns. */
+	gint64 queue_time;
+}
+GstImx2dVideoSinkPresentation;
+
+
 struct _GstImx2dVideoSink
 {
 	GstVideoSink parent;
@@ -58,14 +77,79 @@ struct _GstImx2dVideoSink
 	Imx2dSurface *input_surface;
 	Imx2dSurfaceDesc input_surface_desc;
 
+	/* Only one of these two is non-NULL while the sink is
+	 * running. drm_output is used if drm_device_name is set. */
 	Imx2dLinuxFramebuffer *framebuffer;
+	Imx2dLinuxDrm *drm_output;
 	Imx2dSurface *framebuffer_surface;
 	Imx2dSurfaceDesc const *framebuffer_surface_desc;
 
+	/* Buffers that are directly scanned out, either by the DRM
+	 * plane or (with fbdev) by panning the display to one of the
+	 * framebuffer's scanout pages. scanout_pending_buffer is the
+	 * buffer of the last page flip, scanout_displayed_buffer the
+	 * buffer of the flip before. Both must be kept alive until
+	 * the display stops scanning them out. If the corresponding
+	 * flip showed a regular page instead, the pointer is NULL. */
+	GstBuffer *scanout_displayed_buffer;
+	GstBuffer *scanout_pending_buffer;
+	/* TRUE if the last flip showed a directly scanned out
+	 * buffer instead of a regular page. */
+	gboolean direct_frame_shown;
+
+	/* fbdev only: Allocator that hands out the framebuffer's
+	 * scanout pages, and the pool that is proposed to upstream
+	 * and uses that allocator. Both are NULL if direct-scanout
+	 * was disabled when the sink started. The allocator adds the
+	 * pages to the framebuffer once upstream allocates from the
+	 * pool for the first time. */
+	GstAllocator *scanout_page_allocator;
+	GstBufferPool *scanout_pool;
+
+	/* fbdev with vsync only: The streaming thread blits into a free
+	 * page and queues it. The presentation thread pans the display to
+	 * the queued page and waits for the vsync, so the streaming thread
+	 * does not block on the display. If a new frame is queued before
+	 * the previously queued one was picked up, the new one replaces it.
+	 * The mutex protects the fields below it as well as display_fb_page
+	 * and the scanout_*_buffer fields while the thread is running. */
+	GThread *presentation_thread;
+	GMutex presentation_mutex;
+	GCond presentation_cond;
+	gboolean presentation_thread_quit;
+	gboolean presentation_failed;
+	gboolean presentation_queued;
+	/* TRUE while the thread pans to a page and waits for the vsync. */
+	gboolean presentation_in_progress;
+	GstImx2dVideoSinkPresentation queued_presentation;
+	/* Regular page the presentation thread is panning to, or -1. */
+	int presenting_fb_page;
+
+	/* Frame pacing statistics. Protected by stats_mutex. This is
+	 * not the object lock, since the presentation thread updates
+	 * these while holding presentation_mutex, and the streaming
+	 * thread waits for presentation_mutex while holding the
+	 * object lock. refresh_period is 0 if the display's refresh rate is
+	 * unknown; late and repeated frames are not counted then.
+	 * last_present_time is -1 if no frame was presented since
+	 * the sink started or last switched to PLAYING. */
+	GMutex stats_mutex;
+	gint64 refresh_period;
+	gint64 last_present_time;
+	guint64 num_presented_frames;
+	guint64 num_dropped_frames;
+	guint64 num_late_frames;
+	guint64 num_repeated_frames;
+	guint64 present_latency_histogram[GST_IMX_2D_VIDEO_SINK_NUM_PRESENT_LATENCY_BUCKETS];
+
 	GstImx2dVideoOverlayHandler *overlay_handler;
 
 	gboolean drop_frames;
 	gchar *framebuffer_name;
+	gchar *drm_device_name;
+	guint drm_connector_id;
+	guint drm_plane_id;
+	gboolean direct_scanout;
 	gboolean input_crop;
 	GstVideoOrientationMethod video_direction;
 	gboolean clear_at_null;
@@ -78,6 +162,11 @@ struct _GstImx2dVideoSink
 	Imx2dBlitMargin extra_margin;
 
 	GstVideoOrientationMethod tag_video_direction;
+	/* Orientation method from the GstImxVideoOrientationMeta of the
+	 * most recent frame. Upstream elements attach this meta to let
+	 * this sink perform the rotation as part of its blit. It is
+	 * applied before video_direction / tag_video_direction. */
+	GstVideoOrientationMethod meta_video_direction;
 
 	gboolean drop_frames_changed;
 
@@ -131,6 +220,27 @@ struct _GstImx2dVideoSink
 
 	gboolean region_coords_need_update;
 	gboolean total_region_valid;
+
+	/* If clear-on-relocate is enabled, the total region is cleared
+	 * before it is relocated. Since the region recalculation happens
+	 * with the object lock held, the old region is stored here and
+	 * cleared later, after the lock was released. */
+	Imx2dRegion relocation_clear_region;
+	gboolean relocation_clear_pending;
+
+	/* Set if the framebuffer was reconfigured, which may have relocated
+	 * its memory and lost the contents of its pages. show_frame() then
+	 * clears the total region on all pages before the next blit. */
+	gboolean total_region_clear_pending;
+
+	/* Bitmask of the pages whose combined_margin area was already
+	 * filled with the current region geometry (bit N = page N).
+	 * Blits into such pages skip the margin, so the letterbox is
+	 * drawn once per page instead of with every frame. Cleared
+	 * whenever the regions are recalculated, and per page if
+	 * something else (like overlays) may have drawn over the
+	 * margin area. */
+	guint pages_with_valid_margin;
 };
 
 
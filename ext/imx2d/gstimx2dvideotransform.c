@@ -20,6 +20,7 @@
 #include <gst/video/video.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gst/imx/video/gstimxvideobufferpool.h"
+#include "gst/imx/video/gstimxvideoorientationmeta.h"
 #include "gstimx2dvideotransform.h"
 #include "gstimx2dmisc.h"
 
@@ -33,13 +34,18 @@ enum
 	PROP_0,
 	PROP_INPUT_CROP,
 	PROP_VIDEO_DIRECTION,
-	PROP_DISABLE_PASSTHROUGH
+	PROP_DISABLE_PASSTHROUGH,
+	PROP_PREWARM_BUFFERS,
+	PROP_UPLOAD_STATS,
+	PROP_META_TRANSFORMS
 };
 
 
 #define DEFAULT_INPUT_CROP TRUE
 #define DEFAULT_VIDEO_DIRECTION GST_VIDEO_ORIENTATION_IDENTITY
 #define DEFAULT_DISABLE_PASSTHROUGH FALSE
+#define DEFAULT_PREWARM_BUFFERS 0
+#define DEFAULT_META_TRANSFORMS FALSE
 
 
 /* Cached quark to avoid contention on the global quark table lock */
@@ -166,6 +172,43 @@ static void gst_imx_2d_video_transform_class_init(GstImx2dVideoTransformClass *k
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PREWARM_BUFFERS,
+		g_param_spec_uint(
+			"prewarm-buffers",
+			"Prewarm buffers",
+			"How many output buffers to allocate as soon as the output buffer pool is set up "
+			"(0 = allocate buffers on demand; higher values avoid allocation stalls during playback)",
+			0, G_MAXUINT,
+			DEFAULT_PREWARM_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_META_TRANSFORMS,
+		g_param_spec_boolean(
+			"meta-transforms",
+			"Meta transforms",
+			"If input and output caps are equal and only cropping and/or rotation/flipping is needed, "
+			"pass through frames with crop/orientation metadata instead of blitting them, provided "
+			"that downstream supports these metas (downstream then performs these operations)",
+			DEFAULT_META_TRANSFORMS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
@@ -180,6 +223,10 @@ void gst_imx_2d_video_transform_init(GstImx2dVideoTransform *self)
 
 	self->passing_through_overlay_meta = FALSE;
 
+	self->downstream_supports_crop_meta = FALSE;
+	self->downstream_supports_orientation_meta = FALSE;
+	self->meta_only_frame = FALSE;
+
 	gst_video_info_init(&(self->input_video_info));
 	gst_video_info_init(&(self->output_video_info));
 
@@ -193,6 +240,8 @@ void gst_imx_2d_video_transform_init(GstImx2dVideoTransform *self)
 	self->input_crop = DEFAULT_INPUT_CROP;
 	self->video_direction = DEFAULT_VIDEO_DIRECTION;
 	self->disable_passthrough = DEFAULT_DISABLE_PASSTHROUGH;
+	self->prewarm_buffers = DEFAULT_PREWARM_BUFFERS;
+	self->meta_transforms = DEFAULT_META_TRANSFORMS;
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
 
@@ -235,6 +284,22 @@ static void gst_imx_2d_video_transform_set_property(GObject *object, guint prop_
 			break;
 		}
 
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->prewarm_buffers = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_META_TRANSFORMS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->meta_transforms = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -272,6 +337,38 @@ static void gst_imx_2d_video_transform_get_property(GObject *object, guint prop_
 			break;
 		}
 
+		case PROP_PREWARM_BUFFERS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->prewarm_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_META_TRANSFORMS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->meta_transforms);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_UPLOAD_STATS:
+		{
+			GstImxDmaBufferUploaderStats stats;
+
+			GST_OBJECT_LOCK(self);
+			if (self->uploader != NULL)
+			{
+				gst_imx_video_uploader_get_stats(self->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -1406,6 +1503,7 @@ static gboolean gst_imx_2d_video_transform_propose_allocation(GstBaseTransform *
 static gboolean gst_imx_2d_video_transform_decide_allocation(GstBaseTransform *transform, GstQuery *query)
 {
 	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
+	guint prewarm_buffers;
 
 	/* We are not chaining up to the base class since the default
 	 * basetransform decide_allocation method is very cautious
@@ -1422,10 +1520,26 @@ static gboolean gst_imx_2d_video_transform_decide_allocation(GstBaseTransform *t
 		self->video_buffer_pool = NULL;
 	}
 
+	GST_OBJECT_LOCK(self);
+	prewarm_buffers = self->prewarm_buffers;
+	GST_OBJECT_UNLOCK(self);
+
+	/* Check if downstream can apply crop and orientation metas
+	 * itself. This is needed for the meta-transforms mode. */
+	self->downstream_supports_crop_meta = gst_query_find_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+	self->downstream_supports_orientation_meta = gst_query_find_allocation_meta(query, GST_IMX_VIDEO_ORIENTATION_META_API_TYPE, NULL);
+	GST_DEBUG_OBJECT(
+		self,
+		"downstream supports crop / orientation metas: %d / %d",
+		self->downstream_supports_crop_meta,
+		self->downstream_supports_orientation_meta
+	);
+
 	self->video_buffer_pool = gst_imx_video_buffer_pool_new(
 		self->imx_dma_buffer_allocator,
 		query,
-		&(self->output_video_info)
+		&(self->output_video_info),
+		prewarm_buffers
 	);
 
 	gst_object_ref_sink(self->video_buffer_pool);
@@ -1442,7 +1556,9 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 	GstVideoOrientationMethod video_direction;
 	gboolean disable_passthrough;
 	gboolean input_crop;
+	gboolean meta_transforms;
 	gboolean has_crop_meta = FALSE;
+	gboolean crop_rect_contains_entire_frame = TRUE;
 
 	/* The code in here has one single purpose: to decide whether or not the input buffer
 	 * is to be passed through. Passthrough is done by setting *output_buffer to input_buffer.
@@ -1455,14 +1571,22 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 	 * - Input crop is disabled, or it is enabled & the input buffer's video
 	 *   crop meta defines a rectangle that contains the entire frame
 	 * - Output rotation is disabled (= set to IMX_2D_ROTATION_NONE)
+	 *
+	 * If the meta-transforms property is enabled, and passthrough is not possible
+	 * only because of cropping and/or rotation, then the frame is passed downstream
+	 * with crop / orientation metas instead of being blitted, provided that downstream
+	 * listed these metas in the allocation query. See the code below for details.
 	 */
 
 	g_assert(self->uploader != NULL);
 
+	self->meta_only_frame = FALSE;
+
 	GST_OBJECT_LOCK(self);
 	input_crop = self->input_crop;
 	video_direction = gst_imx_2d_video_transform_get_current_video_direction(self);
 	disable_passthrough = self->disable_passthrough;
+	meta_transforms = self->meta_transforms;
 	GST_OBJECT_UNLOCK(self);
 
 	{
@@ -1500,10 +1624,9 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 		           && are_both_pools_same
 		           && !disable_passthrough;
 
-		if (passthrough && input_crop && has_crop_meta)
+		if (input_crop && has_crop_meta)
 		{
 			guint in_width, in_height;
-			gboolean crop_rect_contains_entire_frame;
 
 			in_width = GST_VIDEO_INFO_WIDTH(&(self->input_video_info));
 			in_height = GST_VIDEO_INFO_HEIGHT(&(self->input_video_info));
@@ -1515,7 +1638,7 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 
 			GST_LOG_OBJECT(self, "crop rectangle contains whole input frame: %d", crop_rect_contains_entire_frame);
 
-			passthrough = crop_rect_contains_entire_frame;
+			passthrough = passthrough && crop_rect_contains_entire_frame;
 		}
 
 		GST_LOG_OBJECT(self, "=> passthrough: %s", passthrough ? "yes" : "no");
@@ -1527,6 +1650,53 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 		return GST_FLOW_OK;
 	}
 
+	/* Check if the cropping and rotation can be handed off to downstream.
+	 * This requires the same conditions as passthrough, except that
+	 * cropping and rotation are allowed if downstream supports the
+	 * corresponding metas. If the input buffer has a crop meta, then
+	 * it is already present in the output buffer, since the output
+	 * buffer is a copy of the input buffer. This copy is shallow,
+	 * that is, the output buffer refers to the input buffer's memory. */
+	if (meta_transforms && (input_buffer != NULL))
+	{
+		gboolean needs_crop = !crop_rect_contains_entire_frame;
+		gboolean needs_rotation = (video_direction != GST_VIDEO_ORIENTATION_IDENTITY);
+
+		self->meta_only_frame = self->inout_info_equal
+		                     && gst_imx_video_buffer_pool_are_both_pools_same(self->video_buffer_pool)
+		                     && !disable_passthrough
+		                     && (!needs_crop || self->downstream_supports_crop_meta)
+		                     && (!needs_rotation || self->downstream_supports_orientation_meta)
+		                     && (gst_buffer_get_imx_video_orientation_meta(input_buffer) == NULL);
+
+		GST_LOG_OBJECT(
+			self,
+			"needs crop: %d  needs rotation: %d  => pass through with metas instead of blitting: %s",
+			needs_crop,
+			needs_rotation,
+			self->meta_only_frame ? "yes" : "no"
+		);
+
+		if (self->meta_only_frame)
+		{
+			*output_buffer = gst_buffer_copy(input_buffer);
+
+			/* If input cropping is disabled, the crop meta must not
+			 * reach downstream, otherwise downstream would crop. */
+			if (!input_crop)
+			{
+				GstVideoCropMeta *output_crop_meta = gst_buffer_get_video_crop_meta(*output_buffer);
+				if (output_crop_meta != NULL)
+					gst_buffer_remove_meta(*output_buffer, (GstMeta *)output_crop_meta);
+			}
+
+			if (needs_rotation)
+				gst_buffer_add_imx_video_orientation_meta(*output_buffer, video_direction);
+
+			return GST_FLOW_OK;
+		}
+	}
+
 	return GST_BASE_TRANSFORM_CLASS(gst_imx_2d_video_transform_parent_class)->prepare_output_buffer(transform, input_buffer, output_buffer);
 }
 
@@ -1556,6 +1726,12 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 		return GST_FLOW_OK;
 	}
 
+	if (self->meta_only_frame)
+	{
+		GST_LOG_OBJECT(self, "passing buffer through with crop / orientation metas; downstream performs these operations");
+		return GST_FLOW_OK;
+	}
+
 	if (!gst_imx_2d_check_input_buffer_structure(input_buffer, GST_VIDEO_INFO_N_PLANES(&(self->input_video_info))))
 		return GST_FLOW_ERROR;
 
@@ -1651,6 +1827,7 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 	if (!imx_2d_blitter_do_blit(self->blitter, self->input_surface, &blit_params))
 	{
 		GST_ERROR_OBJECT(self, "blitting failed");
+		imx_2d_blitter_finish(self->blitter);
 		goto error;
 	}
 
@@ -1660,6 +1837,7 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 		if (!gst_imx_2d_video_overlay_handler_render(self->overlay_handler, input_buffer))
 		{
 			GST_ERROR_OBJECT(self, "rendering overlay(s) failed");
+			imx_2d_blitter_finish(self->blitter);
 			goto error;
 		}
 	}
@@ -1795,6 +1973,10 @@ static gboolean gst_imx_2d_video_transform_start(GstImx2dVideoTransform *self)
 
 	self->passing_through_overlay_meta = FALSE;
 
+	self->downstream_supports_crop_meta = FALSE;
+	self->downstream_supports_orientation_meta = FALSE;
+	self->meta_only_frame = FALSE;
+
 	self->video_buffer_pool = NULL;
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
@@ -1892,11 +2074,14 @@ static void gst_imx_2d_video_transform_stop(GstImx2dVideoTransform *self)
 		self->blitter = NULL;
 	}
 
+	/* See gst_imx_video_uploader_get_stats() for why the object lock is needed here. */
+	GST_OBJECT_LOCK(self);
 	if (self->uploader != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->uploader));
 		self->uploader = NULL;
 	}
+	GST_OBJECT_UNLOCK(self);
 
 	if (self->imx_dma_buffer_allocator != NULL)
 	{
@@ -63,6 +63,15 @@ struct _GstImx2dVideoTransform
 
 	gboolean passing_through_overlay_meta;
 
+	/* Set in decide_allocation() according to the metas
+	 * that downstream listed in the allocation query. */
+	gboolean downstream_supports_crop_meta;
+	gboolean downstream_supports_orientation_meta;
+	/* Set by prepare_output_buffer() if the current frame is
+	 * handed downstream with crop / orientation metas instead
+	 * of being blitted. */
+	gboolean meta_only_frame;
+
 	GstVideoInfo input_video_info;
 	GstVideoInfo output_video_info;
 
@@ -78,6 +87,8 @@ struct _GstImx2dVideoTransform
 	gboolean input_crop;
 	GstVideoOrientationMethod video_direction;
 	gboolean disable_passthrough;
+	guint prewarm_buffers;
+	gboolean meta_transforms;
 
 	GstVideoOrientationMethod tag_video_direction;
 };
@@ -0,0 +1,80 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "imx2d/backend/pxp/pxp_blitter.h"
+#include "gstimx2dmisc.h"
+#include "gstimx2dvideofanout.h"
+#include "gstimxpxpvideofanout.h"
+
+
+struct _GstImxPxPVideoFanout
+{
+	GstImx2dVideoFanout parent;
+};
+
+
+struct _GstImxPxPVideoFanoutClass
+{
+	GstImx2dVideoFanoutClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxPxPVideoFanout, gst_imx_pxp_video_fanout, GST_TYPE_IMX_2D_VIDEO_FANOUT)
+
+
+static Imx2dBlitter* gst_imx_pxp_video_fanout_create_blitter(GstImx2dVideoFanout *imx_2d_video_fanout);
+
+
+
+
+static void gst_imx_pxp_video_fanout_class_init(GstImxPxPVideoFanoutClass *klass)
+{
+	GstElementClass *element_class;
+	GstImx2dVideoFanoutClass *imx_2d_video_fanout_class;
+
+	element_class = GST_ELEMENT_CLASS(klass);
+	imx_2d_video_fanout_class = GST_IMX_2D_VIDEO_FANOUT_CLASS(klass);
+
+	imx_2d_video_fanout_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_pxp_video_fanout_create_blitter);
+
+	gst_imx_2d_video_fanout_common_class_init(
+		imx_2d_video_fanout_class,
+		imx_2d_backend_pxp_get_hardware_capabilities()
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"i.MX PxP video fan-out",
+		"Filter/Converter/Video/Scaler/Hardware",
+		"Produces multiple differently sized/formatted video outputs from one input using the i.MX Pixel Pipeline (PxP)",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+void gst_imx_pxp_video_fanout_init(G_GNUC_UNUSED GstImxPxPVideoFanout *self)
+{
+}
+
+
+static Imx2dBlitter* gst_imx_pxp_video_fanout_create_blitter(G_GNUC_UNUSED GstImx2dVideoFanout *imx_2d_video_fanout)
+{
+	return imx_2d_backend_pxp_blitter_create();
+}
@@ -29,6 +29,9 @@
 #include "gstimxpxpvideosink.h"
 #endif
 
+#include "gstimxg2dvideofanout.h"
+#include "gstimxipuvideofanout.h"
+#include "gstimxpxpvideofanout.h"
 #include "gstimxg2dvideotransform.h"
 #include "gstimxipuvideotransform.h"
 #include "gstimxpxpvideotransform.h"
@@ -45,6 +48,7 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxg2dvideosink", GST_RANK_NONE, gst_imx_g2d_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxg2dvideofanout", GST_RANK_NONE, gst_imx_g2d_video_fanout_get_type());
 	ret = ret && gst_element_register(plugin, "imxg2dvideotransform", GST_RANK_NONE, gst_imx_g2d_video_transform_get_type());
 #endif
 
@@ -52,6 +56,7 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxipuvideosink", GST_RANK_NONE, gst_imx_ipu_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxipuvideofanout", GST_RANK_NONE, gst_imx_ipu_video_fanout_get_type());
 	ret = ret && gst_element_register(plugin, "imxipuvideotransform", GST_RANK_NONE, gst_imx_ipu_video_transform_get_type());
 #endif
 
@@ -59,6 +64,7 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxpxpvideosink", GST_RANK_NONE, gst_imx_pxp_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxpxpvideofanout", GST_RANK_NONE, gst_imx_pxp_video_fanout_get_type());
 	ret = ret && gst_element_register(plugin, "imxpxpvideotransform", GST_RANK_NONE, gst_imx_pxp_video_transform_get_type());
 #endif
 
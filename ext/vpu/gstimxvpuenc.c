@@ -66,7 +66,8 @@ enum
 	PROP_INTRA_REFRESH,
 	PROP_FIXED_INTRA_QUANTIZATION,
 	PROP_ALLOW_FRAMESKIPPING,
-	PROP_USE_INTRA_REFRESH
+	PROP_USE_INTRA_REFRESH,
+	PROP_UPLOAD_STATS
 };
 
 
@@ -288,6 +289,22 @@ static void gst_imx_vpu_enc_get_property(GObject *object, guint prop_id, GValue
 			GST_OBJECT_UNLOCK(imx_vpu_enc);
 			break;
 
+		case PROP_UPLOAD_STATS:
+		{
+			GstImxDmaBufferUploaderStats stats;
+
+			GST_OBJECT_LOCK(imx_vpu_enc);
+			if (imx_vpu_enc->uploader != NULL)
+			{
+				gst_imx_dma_buffer_uploader_get_stats(imx_vpu_enc->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			GST_OBJECT_UNLOCK(imx_vpu_enc);
+			break;
+		}
+
 		default:
 			if (klass->get_encoder_property != NULL)
 				klass->get_encoder_property(object, prop_id, value, pspec);
@@ -365,11 +382,14 @@ static gboolean gst_imx_vpu_enc_stop(GstVideoEncoder *encoder)
 
 	g_hash_table_remove_all(imx_vpu_enc->uploaded_buffers_table);
 
+	/* See gst_imx_dma_buffer_uploader_get_stats() for why the object lock is needed here. */
+	GST_OBJECT_LOCK(imx_vpu_enc);
 	if (imx_vpu_enc->uploader != NULL)
 	{
 		gst_object_unref(GST_OBJECT(imx_vpu_enc->uploader));
 		imx_vpu_enc->uploader = NULL;
 	}
+	GST_OBJECT_UNLOCK(imx_vpu_enc);
 
 	if (imx_vpu_enc->encoder != NULL)
 	{
@@ -1109,6 +1129,17 @@ void gst_imx_vpu_enc_common_class_init(GstImxVpuEncClass *klass, ImxVpuApiCompre
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 
 	longname = g_strdup_printf("i.MX VPU %s video encoder", codec_details->desc_name);
 	classification = g_strdup("Codec/Encoder/Video/Hardware");
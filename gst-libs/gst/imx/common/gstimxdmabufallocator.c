@@ -125,6 +125,7 @@ static GstMemory* gst_imx_dmabuf_allocator_alloc(GstAllocator *allocator, gsize
 static void gst_imx_dmabuf_allocator_free(GstAllocator* allocator, GstMemory *memory);
 
 static gboolean gst_imx_dmabuf_allocator_activate(GstImxDmaBufAllocator *imx_dmabuf_allocator);
+static GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf_internal(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size, guintptr physical_address, gboolean quiet);
 
 static GstMemory * gst_imx_dmabuf_allocator_mem_copy(GstMemory *memory, gssize offset, gssize size);
 static gboolean gst_imx_dmabuf_allocator_mem_is_span(GstMemory *memory1, GstMemory *memory2, gsize *offset);
@@ -482,45 +483,10 @@ static void gst_imx_dmabuf_allocator_mem_unmap_full(GstMemory *memory, G_GNUC_UN
 }
 
 
-
-
-/**** Public functions ****/
-
-
-guintptr gst_imx_dmabuf_allocator_get_physical_address(GstImxDmaBufAllocator *allocator, int dmabuf_fd)
-{
-	GstImxDmaBufAllocator *self = GST_IMX_DMABUF_ALLOCATOR_CAST(allocator);
-	GstImxDmaBufAllocatorClass *klass = GST_IMX_DMABUF_ALLOCATOR_CLASS(G_OBJECT_GET_CLASS(self));
-
-	g_assert(dmabuf_fd > 0);
-	g_assert(klass->get_physical_address != NULL);
-
-	imx_physical_address_t physical_address = 0;
-
-	GST_OBJECT_LOCK(self);
-
-	if (!gst_imx_dmabuf_allocator_activate(self))
-		goto finish;
-
-	physical_address = klass->get_physical_address(self, dmabuf_fd);
-	if (physical_address == 0)
-	{
-		GST_ERROR_OBJECT(self, "could not open get physical address for DMA-BUF FD %d", dmabuf_fd);
-		goto finish;
-	}
-	GST_DEBUG_OBJECT(self, "got physical address %" IMX_PHYSICAL_ADDRESS_FORMAT " for DMA-BUF FD", physical_address);
-
-finish:
-	GST_OBJECT_UNLOCK(self);
-	return physical_address;
-}
-
-
-GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size)
+static GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf_internal(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size, guintptr physical_address, gboolean quiet)
 {
 	GstImxDmaBufAllocator *self = GST_IMX_DMABUF_ALLOCATOR(allocator);
 	GstImxDmaBufAllocatorClass *klass = GST_IMX_DMABUF_ALLOCATOR_CLASS(G_OBJECT_GET_CLASS(self));
-	imx_physical_address_t physical_address;
 	GstMemory *memory = NULL;
 	ImxWrappedDmaBuffer *wrapped_dma_buffer = NULL;
 
@@ -533,19 +499,28 @@ GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf(GstAllocator *allocator, int dma
 	if (!gst_imx_dmabuf_allocator_activate(self))
 		goto error;
 
-	physical_address = klass->get_physical_address(self, dmabuf_fd);
 	if (physical_address == 0)
 	{
-		GST_ERROR_OBJECT(self, "could not open get physical address for DMA-BUF FD %d", dmabuf_fd);
-		goto error;
+		physical_address = klass->get_physical_address(self, dmabuf_fd);
+		if (physical_address == 0)
+		{
+			/* In quiet mode, the caller expects that some DMA-BUFs
+			 * have no physical address (because they are not
+			 * physically contiguous), and handles that case itself. */
+			if (quiet)
+				GST_DEBUG_OBJECT(self, "could not get physical address for DMA-BUF FD %d", dmabuf_fd);
+			else
+				GST_ERROR_OBJECT(self, "could not get physical address for DMA-BUF FD %d", dmabuf_fd);
+			goto error;
+		}
+		GST_DEBUG_OBJECT(self, "got physical address %" IMX_PHYSICAL_ADDRESS_FORMAT " for DMA-BUF buffer", (imx_physical_address_t)physical_address);
 	}
-	GST_DEBUG_OBJECT(self, "got physical address %" IMX_PHYSICAL_ADDRESS_FORMAT " for DMA-BUF buffer", physical_address);
 
 	wrapped_dma_buffer = g_malloc(sizeof(ImxWrappedDmaBuffer));
 	imx_dma_buffer_init_wrapped_buffer(wrapped_dma_buffer);
 	wrapped_dma_buffer->fd = dmabuf_fd;
 	wrapped_dma_buffer->size = dmabuf_size;
-	wrapped_dma_buffer->physical_address = physical_address;
+	wrapped_dma_buffer->physical_address = (imx_physical_address_t)physical_address;
 
 	/* Use GST_FD_MEMORY_FLAG_DONT_CLOSE since
 	 * libimxdmabuffer takes care of closing the FD. */
@@ -585,6 +560,58 @@ error:
 }
 
 
+
+
+/**** Public functions ****/
+
+
+guintptr gst_imx_dmabuf_allocator_get_physical_address(GstImxDmaBufAllocator *allocator, int dmabuf_fd)
+{
+	GstImxDmaBufAllocator *self = GST_IMX_DMABUF_ALLOCATOR_CAST(allocator);
+	GstImxDmaBufAllocatorClass *klass = GST_IMX_DMABUF_ALLOCATOR_CLASS(G_OBJECT_GET_CLASS(self));
+
+	g_assert(dmabuf_fd > 0);
+	g_assert(klass->get_physical_address != NULL);
+
+	imx_physical_address_t physical_address = 0;
+
+	GST_OBJECT_LOCK(self);
+
+	if (!gst_imx_dmabuf_allocator_activate(self))
+		goto finish;
+
+	physical_address = klass->get_physical_address(self, dmabuf_fd);
+	if (physical_address == 0)
+	{
+		GST_ERROR_OBJECT(self, "could not get physical address for DMA-BUF FD %d", dmabuf_fd);
+		goto finish;
+	}
+	GST_DEBUG_OBJECT(self, "got physical address %" IMX_PHYSICAL_ADDRESS_FORMAT " for DMA-BUF FD", physical_address);
+
+finish:
+	GST_OBJECT_UNLOCK(self);
+	return physical_address;
+}
+
+
+GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size)
+{
+	return gst_imx_dmabuf_allocator_wrap_dmabuf_with_physical_address(allocator, dmabuf_fd, dmabuf_size, 0);
+}
+
+
+GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf_with_physical_address(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size, guintptr physical_address)
+{
+	return gst_imx_dmabuf_allocator_wrap_dmabuf_internal(allocator, dmabuf_fd, dmabuf_size, physical_address, FALSE);
+}
+
+
+GstMemory* gst_imx_dmabuf_allocator_try_wrap_dmabuf(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size)
+{
+	return gst_imx_dmabuf_allocator_wrap_dmabuf_internal(allocator, dmabuf_fd, dmabuf_size, 0, TRUE);
+}
+
+
 gboolean gst_imx_dmabuf_allocator_is_active(GstAllocator *allocator)
 {
 	GstImxDmaBufAllocator *self;
@@ -97,6 +97,39 @@ guintptr gst_imx_dmabuf_allocator_get_physical_address(GstImxDmaBufAllocator *al
  */
 GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size);
 
+/**
+ * gst_imx_dmabuf_allocator_wrap_dmabuf_with_physical_address:
+ * @allocator: Allocator to use.
+ * @dmabuf_fd: DMA-BUF FD to wrap. Must be valid.
+ * @dmabuf_size: Size of the DMA-BUF buffer, in bytes. Must be greater than zero.
+ * @physical_address: Physical address of the DMA-BUF buffer, or 0.
+ *
+ * Like gst_imx_dmabuf_allocator_wrap_dmabuf(), except that the physical
+ * address is not retrieved by the allocator if @physical_address is nonzero.
+ * This is useful for DMA-BUFs whose physical address the allocator cannot
+ * look up, but which is already known to the caller.
+ *
+ * Returns: GstMemory containing an ImxDmaBuffer which in turn wraps the
+ *          @dmabuf_fd duplicate created internally by this function.
+ */
+GstMemory* gst_imx_dmabuf_allocator_wrap_dmabuf_with_physical_address(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size, guintptr physical_address);
+
+/**
+ * gst_imx_dmabuf_allocator_try_wrap_dmabuf:
+ * @allocator: Allocator to use.
+ * @dmabuf_fd: DMA-BUF FD to wrap. Must be valid.
+ * @dmabuf_size: Size of the DMA-BUF buffer, in bytes. Must be greater than zero.
+ *
+ * Like gst_imx_dmabuf_allocator_wrap_dmabuf(), except that failing to
+ * retrieve the physical address is not logged as an error. This is
+ * intended for callers that may legitimately get DMA-BUFs which are
+ * not physically contiguous, and fall back to another code path then.
+ *
+ * Returns: GstMemory containing an ImxDmaBuffer which in turn wraps the
+ *          @dmabuf_fd, or NULL if wrapping failed.
+ */
+GstMemory* gst_imx_dmabuf_allocator_try_wrap_dmabuf(GstAllocator *allocator, int dmabuf_fd, gsize dmabuf_size);
+
 /**
  * gst_imx_dmabuf_allocator_is_active:
  * @allocator: Allocator to check.
@@ -16,6 +16,9 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+/* Needed for F_GET_SEALS and F_SEAL_SHRINK. */
+#define _GNU_SOURCE
+
 #include "config.h"
 
 #include <unistd.h>
@@ -26,10 +29,19 @@
 #ifdef GST_DMABUF_ALLOCATOR_AVAILABLE
 #include "gstimxdmabufallocator.h"
 #endif
+#if defined(GST_DMABUF_ALLOCATOR_AVAILABLE) && defined(WITH_GST_UDMABUF_UPLOAD)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/udmabuf.h>
+#endif
 
 
 
 static GQuark gst_imx_dmabuf_upload_method_refd_memory_quark;
+static GQuark gst_imx_udmabuf_upload_method_input_memory_info_quark;
 
 /* Some variables need to be initialized once, and may be accessed even before
  * the GstImxDmaBufferUploaderClass class_init function is called. Also, since
@@ -53,6 +65,7 @@ static gpointer gst_imx_dma_buffer_uploader_global_init()
 #endif
 
 		gst_imx_dmabuf_upload_method_refd_memory_quark = g_quark_from_static_string("gst-imx-dmabuf-upload-method-refd-memory");
+		gst_imx_udmabuf_upload_method_input_memory_info_quark = g_quark_from_static_string("gst-imx-udmabuf-upload-method-input-memory-info");
 
 		g_once_init_leave(&gonce_result, result);
 	}
@@ -87,6 +100,9 @@ struct _GstImxDmaBufferUploader
 	GstImxDmaBufferUploadMethodContext **upload_method_contexts;
 
 	GstAllocator *imx_dma_buffer_allocator;
+
+	/* Protected by the object lock. */
+	GstImxDmaBufferUploaderStats stats;
 };
 
 
@@ -105,6 +121,8 @@ struct _GstImxDmaBufferUploadMethodType
 	GstImxDmaBufferUploadMethodContext* (*create)(GstImxDmaBufferUploader *uploader);
 	void (*destroy)(GstImxDmaBufferUploadMethodContext *upload_method_context);
 	GstFlowReturn (*perform)(GstImxDmaBufferUploadMethodContext *upload_method_context, GstMemory *input_memory, GstMemory **output_memory);
+	/* can_upload_without_copy can be set to NULL, in which case the method is assumed to always copy bytes. */
+	gboolean (*can_upload_without_copy)(GstImxDmaBufferUploadMethodContext *upload_method_context, GstMemory *input_memory);
 };
 
 
@@ -185,7 +203,8 @@ static const GstImxDmaBufferUploadMethodType raw_buffer_upload_method_type = {
 	NULL,
 	raw_buffer_upload_method_create,
 	raw_buffer_upload_method_destroy,
-	raw_buffer_upload_method_perform
+	raw_buffer_upload_method_perform,
+	NULL
 };
 
 
@@ -265,10 +284,12 @@ static GstFlowReturn dmabuf_upload_method_perform(GstImxDmaBufferUploadMethodCon
 	dmabuf_fd = gst_dmabuf_memory_get_fd(input_memory);
 	g_assert(dmabuf_fd > 0);
 
-	*output_memory = gst_imx_dmabuf_allocator_wrap_dmabuf(self->parent.uploader->imx_dma_buffer_allocator, dmabuf_fd, size);
+	/* Input DMA-BUFs may not be physically contiguous. Wrapping them
+	 * then fails, and another upload method is tried instead. */
+	*output_memory = gst_imx_dmabuf_allocator_try_wrap_dmabuf(self->parent.uploader->imx_dma_buffer_allocator, dmabuf_fd, size);
 	if (*output_memory == NULL)
 	{
-		GST_ERROR_OBJECT(self, "could not allocate GstMemory for uploading to DMA-BUF");
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not wrap input DMA-BUF FD %d", dmabuf_fd);
 		return GST_FLOW_COULD_NOT_UPLOAD;
 	}
 
@@ -304,13 +325,414 @@ static GstFlowReturn dmabuf_upload_method_perform(GstImxDmaBufferUploadMethodCon
 }
 
 
+static gboolean dmabuf_upload_method_can_upload_without_copy(G_GNUC_UNUSED GstImxDmaBufferUploadMethodContext *upload_method_context, GstMemory *input_memory)
+{
+	return gst_is_dmabuf_memory(input_memory);
+}
+
+
 static const GstImxDmaBufferUploadMethodType dmabuf_upload_method_type = {
 	"DmabufUpload",
 
 	dmabuf_upload_method_check_if_compatible,
 	dmabuf_upload_method_create,
 	dmabuf_upload_method_destroy,
-	dmabuf_upload_method_perform
+	dmabuf_upload_method_perform,
+	dmabuf_upload_method_can_upload_without_copy
+};
+
+
+#endif
+
+
+
+
+#if defined(GST_DMABUF_ALLOCATOR_AVAILABLE) && defined(WITH_GST_UDMABUF_UPLOAD)
+
+
+/* This upload method turns memfd backed system memory (for example, memory
+ * from GStreamer's shared memory allocator, or from custom allocators used
+ * with appsrc) into DMA-BUF memory by using the udmabuf driver. The udmabuf
+ * DMA-BUF is then wrapped into an ImxDmaBuffer, so no bytes are copied.
+ *
+ * ImxDmaBuffer instances must be physically contiguous, since the i.MX
+ * blitters and VPUs access them by their physical address. udmabuf does not
+ * guarantee that, so the pages of the memory block are checked by looking up
+ * their page frame numbers in /proc/self/pagemap. If they aren't contiguous
+ * (or if the page frame numbers can't be looked up), this method declines,
+ * and the raw buffer upload method copies the bytes instead.
+ *
+ * Creating the udmabuf and checking the pages is expensive. Upstream elements
+ * typically reuse their memory blocks, so the result (including the physical
+ * address derived from the first page frame number, and whether wrapping the
+ * udmabuf failed) is attached to the input memory as qdata, and only looked
+ * up in subsequent uploads. */
+
+
+typedef struct
+{
+	/* The udmabuf DMA-BUF FD that wraps the input memory,
+	 * or -1 if the input memory cannot be wrapped. */
+	int dmabuf_fd;
+	gsize dmabuf_size;
+	guintptr physical_address;
+}
+UdmabufInputMemoryInfo;
+
+
+struct UdmabufUploadMethodContext
+{
+	GstImxDmaBufferUploadMethodContext parent;
+
+	/* FD of the /dev/udmabuf device. -1 if the
+	 * device could not be opened. */
+	int udmabuf_device_fd;
+
+	gsize page_size;
+};
+
+
+/* Protects the qdata lookups and insertions, since the same
+ * input memory may be uploaded by multiple uploaders at once
+ * (for example, if a tee precedes multiple imx elements). */
+static GMutex udmabuf_input_memory_info_mutex;
+
+
+static void udmabuf_input_memory_info_free(gpointer data)
+{
+	UdmabufInputMemoryInfo *info = (UdmabufInputMemoryInfo *)data;
+
+	if (info->dmabuf_fd >= 0)
+		close(info->dmabuf_fd);
+
+	g_free(info);
+}
+
+
+static gboolean udmabuf_upload_method_check_if_compatible(GstAllocator *imx_dma_buffer_allocator)
+{
+	return GST_IS_IMX_DMABUF_ALLOCATOR(imx_dma_buffer_allocator);
+}
+
+
+static GstImxDmaBufferUploadMethodContext* udmabuf_upload_method_create(GstImxDmaBufferUploader *uploader)
+{
+	struct UdmabufUploadMethodContext *upload_method_context;
+
+	g_assert(GST_IS_IMX_DMABUF_ALLOCATOR(uploader->imx_dma_buffer_allocator));
+
+	gst_imx_dma_buffer_uploader_global_init();
+
+	upload_method_context = g_new0(struct UdmabufUploadMethodContext, 1);
+
+	upload_method_context->parent.uploader = uploader;
+	upload_method_context->page_size = sysconf(_SC_PAGESIZE);
+
+	/* Not being able to open the device is not an error. It just
+	 * means that this upload method will never be able to upload. */
+	upload_method_context->udmabuf_device_fd = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+	if (upload_method_context->udmabuf_device_fd < 0)
+		GST_DEBUG_OBJECT(uploader, "could not open /dev/udmabuf: %s (%d); udmabuf uploads not possible", strerror(errno), errno);
+
+	return (GstImxDmaBufferUploadMethodContext*)upload_method_context;
+}
+
+
+static void udmabuf_upload_method_destroy(GstImxDmaBufferUploadMethodContext *upload_method_context)
+{
+	struct UdmabufUploadMethodContext *self = (struct UdmabufUploadMethodContext *)upload_method_context;
+
+	if (self != NULL)
+	{
+		if (self->udmabuf_device_fd >= 0)
+			close(self->udmabuf_device_fd);
+
+		g_free(self);
+	}
+}
+
+
+/* Checks that the pages of input_memory are physically contiguous. If so,
+ * the physical address of the first page is written to *physical_address. */
+static gboolean udmabuf_upload_method_is_physically_contiguous(struct UdmabufUploadMethodContext *self, GstMemory *input_memory, gsize size, guintptr *physical_address)
+{
+	GstMapInfo map_info;
+	guint8 const *base;
+	guint64 *pagemap_entries = NULL;
+	gsize num_pages, page_idx;
+	int pagemap_fd = -1;
+	gssize num_read_bytes;
+	gboolean ret = FALSE;
+	/* Bit 63 = page present; bits 0-54 = page frame number. */
+	guint64 const pfn_mask = (G_GUINT64_CONSTANT(1) << 55) - 1;
+
+	if (!gst_memory_map(input_memory, &map_info, GST_MAP_READ))
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not map input memory %p", (gpointer)input_memory);
+		return FALSE;
+	}
+
+	/* The mapping starts at the beginning of the memfd, so
+	 * undo the memory offset to get to the mapping's start. */
+	base = map_info.data - input_memory->offset;
+	num_pages = size / self->page_size;
+
+	/* Page frame numbers are only listed for pages that are
+	 * mapped into this process, so touch all of them first. */
+	for (page_idx = 0; page_idx < num_pages; ++page_idx)
+		(void)(((guint8 const volatile *)base)[page_idx * self->page_size]);
+
+	pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (pagemap_fd < 0)
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not open /proc/self/pagemap: %s (%d)", strerror(errno), errno);
+		goto finish;
+	}
+
+	pagemap_entries = g_new(guint64, num_pages);
+	num_read_bytes = pread(pagemap_fd, pagemap_entries, num_pages * sizeof(guint64), ((guintptr)base / self->page_size) * sizeof(guint64));
+	if (num_read_bytes != (gssize)(num_pages * sizeof(guint64)))
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not read pagemap entries");
+		goto finish;
+	}
+
+	for (page_idx = 0; page_idx < num_pages; ++page_idx)
+	{
+		/* Without CAP_SYS_ADMIN, the kernel reports PFN 0. */
+		gboolean present = (pagemap_entries[page_idx] >> 63) & 1;
+		guint64 pfn = pagemap_entries[page_idx] & pfn_mask;
+
+		if (!present || (pfn == 0))
+		{
+			GST_DEBUG_OBJECT(self->parent.uploader, "page frame number of page #%" G_GSIZE_FORMAT " is not available", page_idx);
+			goto finish;
+		}
+
+		if ((page_idx > 0) && (pfn != ((pagemap_entries[0] & pfn_mask) + page_idx)))
+		{
+			GST_DEBUG_OBJECT(self->parent.uploader, "pages are not physically contiguous (discontinuity at page #%" G_GSIZE_FORMAT ")", page_idx);
+			goto finish;
+		}
+	}
+
+	*physical_address = (guintptr)((pagemap_entries[0] & pfn_mask) * self->page_size);
+	ret = TRUE;
+
+finish:
+	g_free(pagemap_entries);
+	if (pagemap_fd >= 0)
+		close(pagemap_fd);
+	gst_memory_unmap(input_memory, &map_info);
+	return ret;
+}
+
+
+static void udmabuf_upload_method_create_udmabuf(struct UdmabufUploadMethodContext *self, GstMemory *input_memory, UdmabufInputMemoryInfo *info)
+{
+	int memfd;
+	int seals;
+	struct stat memfd_stat;
+	struct udmabuf_create create_params;
+
+	info->dmabuf_fd = -1;
+	info->dmabuf_size = 0;
+	info->physical_address = 0;
+
+	memfd = gst_fd_memory_get_fd(input_memory);
+
+	/* udmabuf only accepts memfds that are sealed against shrinking.
+	 * We do not add that seal ourselves, since the memfd belongs to
+	 * upstream, and we cannot know whether it relies on shrinking. */
+	seals = fcntl(memfd, F_GET_SEALS);
+	if ((seals < 0) || !(seals & F_SEAL_SHRINK))
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "FD %d of memory %p is not a memfd that is sealed against shrinking", memfd, (gpointer)input_memory);
+		return;
+	}
+
+	/* udmabuf sizes must be an integer multiple of the page size.
+	 * Round up the size; this only works if the memfd is big enough. */
+	info->dmabuf_size = (input_memory->maxsize + self->page_size - 1) / self->page_size * self->page_size;
+
+	if ((fstat(memfd, &memfd_stat) < 0) || ((gsize)(memfd_stat.st_size) < info->dmabuf_size))
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "memfd %d is smaller than the page aligned size %" G_GSIZE_FORMAT, memfd, info->dmabuf_size);
+		return;
+	}
+
+	memset(&create_params, 0, sizeof(create_params));
+	create_params.memfd = memfd;
+	create_params.flags = UDMABUF_FLAGS_CLOEXEC;
+	create_params.offset = 0;
+	create_params.size = info->dmabuf_size;
+
+	info->dmabuf_fd = ioctl(self->udmabuf_device_fd, UDMABUF_CREATE, &create_params);
+	if (info->dmabuf_fd < 0)
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not create udmabuf out of memfd %d: %s (%d)", memfd, strerror(errno), errno);
+		info->dmabuf_fd = -1;
+		return;
+	}
+
+	if (!udmabuf_upload_method_is_physically_contiguous(self, input_memory, info->dmabuf_size, &(info->physical_address)))
+	{
+		close(info->dmabuf_fd);
+		info->dmabuf_fd = -1;
+		return;
+	}
+
+	GST_DEBUG_OBJECT(
+		self->parent.uploader,
+		"created udmabuf with DMA-BUF FD %d size %" G_GSIZE_FORMAT " and physical address %" IMX_PHYSICAL_ADDRESS_FORMAT " out of memfd %d from memory %p",
+		info->dmabuf_fd,
+		info->dmabuf_size,
+		(imx_physical_address_t)(info->physical_address),
+		memfd,
+		(gpointer)input_memory
+	);
+}
+
+
+/* Returns a dup()'d DMA-BUF FD of the udmabuf that wraps input_memory,
+ * or -1 if input_memory cannot be wrapped. dmabuf_size and physical_address
+ * may be NULL. */
+static int udmabuf_upload_method_get_dmabuf_fd(struct UdmabufUploadMethodContext *self, GstMemory *input_memory, gsize *dmabuf_size, guintptr *physical_address)
+{
+	UdmabufInputMemoryInfo *info;
+	int dmabuf_fd = -1;
+
+	if (self->udmabuf_device_fd < 0)
+		return -1;
+
+	/* DMA-BUF memory is also FD memory, but it is already handled by the DMA-BUF upload method. */
+	if (!gst_is_fd_memory(input_memory) || gst_is_dmabuf_memory(input_memory))
+		return -1;
+
+	g_mutex_lock(&udmabuf_input_memory_info_mutex);
+
+	info = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(input_memory), gst_imx_udmabuf_upload_method_input_memory_info_quark);
+	if (info == NULL)
+	{
+		info = g_new0(UdmabufInputMemoryInfo, 1);
+		udmabuf_upload_method_create_udmabuf(self, input_memory, info);
+		gst_mini_object_set_qdata(
+			GST_MINI_OBJECT_CAST(input_memory),
+			gst_imx_udmabuf_upload_method_input_memory_info_quark,
+			(gpointer)info,
+			udmabuf_input_memory_info_free
+		);
+	}
+
+	if (info->dmabuf_fd >= 0)
+	{
+		dmabuf_fd = dup(info->dmabuf_fd);
+		if (dmabuf_size != NULL)
+			*dmabuf_size = info->dmabuf_size;
+		if (physical_address != NULL)
+			*physical_address = info->physical_address;
+	}
+
+	g_mutex_unlock(&udmabuf_input_memory_info_mutex);
+
+	return dmabuf_fd;
+}
+
+
+/* Marks input_memory as not wrappable, so that subsequent
+ * uploads don't try to wrap its udmabuf again. */
+static void udmabuf_upload_method_mark_wrapping_failed(GstMemory *input_memory)
+{
+	UdmabufInputMemoryInfo *info;
+
+	g_mutex_lock(&udmabuf_input_memory_info_mutex);
+
+	info = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(input_memory), gst_imx_udmabuf_upload_method_input_memory_info_quark);
+	if ((info != NULL) && (info->dmabuf_fd >= 0))
+	{
+		close(info->dmabuf_fd);
+		info->dmabuf_fd = -1;
+	}
+
+	g_mutex_unlock(&udmabuf_input_memory_info_mutex);
+}
+
+
+static GstFlowReturn udmabuf_upload_method_perform(GstImxDmaBufferUploadMethodContext *upload_method_context, GstMemory *input_memory, GstMemory **output_memory)
+{
+	int dmabuf_fd;
+	gsize dmabuf_size = 0;
+	guintptr physical_address = 0;
+	struct UdmabufUploadMethodContext *self = (struct UdmabufUploadMethodContext *)upload_method_context;
+
+	dmabuf_fd = udmabuf_upload_method_get_dmabuf_fd(self, input_memory, &dmabuf_size, &physical_address);
+	if (dmabuf_fd < 0)
+		return GST_FLOW_COULD_NOT_UPLOAD;
+
+	/* NOTE: The wrap function takes ownership over the dup()'d FD.
+	 * The original FD stays in the qdata of the input memory. The
+	 * physical address was already looked up when the udmabuf was
+	 * created, so the allocator does not have to retrieve it. If
+	 * wrapping fails anyway, the memory is marked as not wrappable,
+	 * and the raw buffer upload method copies the bytes instead. */
+	*output_memory = gst_imx_dmabuf_allocator_wrap_dmabuf_with_physical_address(self->parent.uploader->imx_dma_buffer_allocator, dmabuf_fd, dmabuf_size, physical_address);
+	if (*output_memory == NULL)
+	{
+		GST_DEBUG_OBJECT(self->parent.uploader, "could not wrap udmabuf DMA-BUF FD %d", dmabuf_fd);
+		close(dmabuf_fd);
+		udmabuf_upload_method_mark_wrapping_failed(input_memory);
+		return GST_FLOW_COULD_NOT_UPLOAD;
+	}
+
+	/* The udmabuf covers the memfd from its beginning, so apply
+	 * the input memory's offset and size to the output memory. */
+	gst_memory_resize(*output_memory, input_memory->offset, input_memory->size);
+
+	GST_LOG_OBJECT(
+		self->parent.uploader,
+		"wrapping input memfd gstmemory %p with udmabuf DMA-BUF FD %d and size %" G_GSIZE_FORMAT " offset %" G_GSIZE_FORMAT,
+		(gpointer)input_memory,
+		dmabuf_fd,
+		input_memory->size,
+		input_memory->offset
+	);
+
+	/* Keep the input memory alive for as long as the output memory
+	 * exists, just like the DMA-BUF upload method does. */
+	gst_memory_ref(input_memory);
+	gst_mini_object_set_qdata(
+		GST_MINI_OBJECT_CAST(*output_memory),
+		gst_imx_dmabuf_upload_method_refd_memory_quark,
+		(gpointer)input_memory,
+		(GDestroyNotify)gst_memory_unref
+	);
+
+	return GST_FLOW_OK;
+}
+
+
+static gboolean udmabuf_upload_method_can_upload_without_copy(GstImxDmaBufferUploadMethodContext *upload_method_context, GstMemory *input_memory)
+{
+	struct UdmabufUploadMethodContext *self = (struct UdmabufUploadMethodContext *)upload_method_context;
+	int dmabuf_fd;
+
+	dmabuf_fd = udmabuf_upload_method_get_dmabuf_fd(self, input_memory, NULL, NULL);
+	if (dmabuf_fd < 0)
+		return FALSE;
+
+	close(dmabuf_fd);
+	return TRUE;
+}
+
+
+static const GstImxDmaBufferUploadMethodType udmabuf_upload_method_type = {
+	"UdmabufUpload",
+
+	udmabuf_upload_method_check_if_compatible,
+	udmabuf_upload_method_create,
+	udmabuf_upload_method_destroy,
+	udmabuf_upload_method_perform,
+	udmabuf_upload_method_can_upload_without_copy
 };
 
 
@@ -322,6 +744,9 @@ static const GstImxDmaBufferUploadMethodType dmabuf_upload_method_type = {
 static GstImxDmaBufferUploadMethodType const *upload_method_types[] = {
 #ifdef GST_DMABUF_ALLOCATOR_AVAILABLE
 	&dmabuf_upload_method_type,
+#endif
+#if defined(GST_DMABUF_ALLOCATOR_AVAILABLE) && defined(WITH_GST_UDMABUF_UPLOAD)
+	&udmabuf_upload_method_type,
 #endif
 	&raw_buffer_upload_method_type
 };
@@ -351,6 +776,7 @@ static void gst_imx_dma_buffer_uploader_init(GstImxDmaBufferUploader *uploader)
 {
 	uploader->upload_method_contexts = NULL;
 	uploader->imx_dma_buffer_allocator = NULL;
+	memset(&(uploader->stats), 0, sizeof(uploader->stats));
 }
 
 
@@ -426,6 +852,8 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 {
 	gint memory_idx, method_idx;
 	GstFlowReturn flow_ret = GST_FLOW_OK;
+	guint64 num_copied_bytes = 0;
+	GstClockTime copy_duration = 0;
 
 	g_assert(input_buffer != NULL);
 	g_assert(output_buffer != NULL);
@@ -458,6 +886,11 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 		{
 			GST_LOG_OBJECT(uploader, "input buffer consists only of imxdmabuffer memory blocks; passing through buffer");
 			*output_buffer = gst_buffer_ref(input_buffer);
+
+			GST_OBJECT_LOCK(uploader);
+			uploader->stats.num_passthrough_buffers++;
+			GST_OBJECT_UNLOCK(uploader);
+
 			return GST_FLOW_OK;
 		}
 	}
@@ -475,6 +908,8 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 			GstMemory *input_memory = NULL;
 			GstMemory *output_memory = NULL;
 			GstImxDmaBufferUploadMethodType const *upload_method_type;
+			gboolean is_copying_method;
+			GstClockTime start_time = GST_CLOCK_TIME_NONE;
 
 			/* If the context is NULL, then the associated upload method
 			 * type was found to be incompatible with the allocator. */
@@ -486,9 +921,21 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 
 			input_memory = gst_buffer_peek_memory(input_buffer, memory_idx);
 
+			/* Methods that cannot upload without copying are the ones
+			 * that copy bytes with the CPU. Measure these for the stats. */
+			is_copying_method = (upload_method_type->can_upload_without_copy == NULL);
+			if (is_copying_method)
+				start_time = gst_util_get_timestamp();
+
 			flow_ret = upload_method_type->perform(uploader->upload_method_contexts[method_idx], input_memory, &output_memory);
 			if (flow_ret == GST_FLOW_OK)
 			{
+				if (is_copying_method)
+				{
+					copy_duration += gst_util_get_timestamp() - start_time;
+					num_copied_bytes += input_memory->size;
+				}
+
 				gst_buffer_append_memory(*output_buffer, output_memory);
 				break;
 			}
@@ -508,6 +955,17 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 	gst_buffer_copy_into(*output_buffer, input_buffer, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_META, 0, -1);
 	GST_BUFFER_FLAG_UNSET(*output_buffer, GST_BUFFER_FLAG_TAG_MEMORY);
 
+	GST_OBJECT_LOCK(uploader);
+	if (num_copied_bytes > 0)
+	{
+		uploader->stats.num_copied_buffers++;
+		uploader->stats.num_copied_bytes += num_copied_bytes;
+		uploader->stats.copy_duration += copy_duration;
+	}
+	else
+		uploader->stats.num_imported_buffers++;
+	GST_OBJECT_UNLOCK(uploader);
+
 finish:
 	return flow_ret;
 
@@ -519,12 +977,86 @@ error:
 }
 
 
+gboolean gst_imx_dma_buffer_uploader_can_upload_without_copy(GstImxDmaBufferUploader *uploader, GstBuffer *buffer)
+{
+	guint memory_idx;
+	gint method_idx;
+
+	g_assert(uploader != NULL);
+	g_assert(buffer != NULL);
+
+	for (memory_idx = 0; memory_idx < gst_buffer_n_memory(buffer); ++memory_idx)
+	{
+		GstMemory *memory = gst_buffer_peek_memory(buffer, memory_idx);
+		gboolean can_upload_without_copy = gst_imx_is_imx_dma_buffer_memory(memory);
+
+		for (method_idx = 0; !can_upload_without_copy && (method_idx < num_upload_method_types); ++method_idx)
+		{
+			GstImxDmaBufferUploadMethodType const *upload_method_type = upload_method_types[method_idx];
+
+			if ((uploader->upload_method_contexts[method_idx] == NULL) || (upload_method_type->can_upload_without_copy == NULL))
+				continue;
+
+			can_upload_without_copy = upload_method_type->can_upload_without_copy(uploader->upload_method_contexts[method_idx], memory);
+		}
+
+		if (!can_upload_without_copy)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
 GstAllocator* gst_imx_dma_buffer_uploader_get_allocator(GstImxDmaBufferUploader *uploader)
 {
 	return gst_object_ref(GST_OBJECT(uploader->imx_dma_buffer_allocator));
 }
 
 
+void gst_imx_dma_buffer_uploader_get_stats(GstImxDmaBufferUploader *uploader, GstImxDmaBufferUploaderStats *stats)
+{
+	g_assert(uploader != NULL);
+	g_assert(stats != NULL);
+
+	GST_OBJECT_LOCK(uploader);
+	*stats = uploader->stats;
+	GST_OBJECT_UNLOCK(uploader);
+}
+
+
+void gst_imx_dma_buffer_uploader_reset_stats(GstImxDmaBufferUploader *uploader)
+{
+	g_assert(uploader != NULL);
+
+	GST_OBJECT_LOCK(uploader);
+	memset(&(uploader->stats), 0, sizeof(uploader->stats));
+	GST_OBJECT_UNLOCK(uploader);
+}
+
+
+GstStructure* gst_imx_dma_buffer_uploader_stats_to_structure(GstImxDmaBufferUploaderStats const *stats)
+{
+	GstImxDmaBufferUploaderStats empty_stats;
+
+	if (stats == NULL)
+	{
+		memset(&empty_stats, 0, sizeof(empty_stats));
+		stats = &empty_stats;
+	}
+
+	return gst_structure_new(
+		"GstImxUploadStats",
+		"passthrough", G_TYPE_UINT64, stats->num_passthrough_buffers,
+		"imported", G_TYPE_UINT64, stats->num_imported_buffers,
+		"copied", G_TYPE_UINT64, stats->num_copied_buffers,
+		"copied-bytes", G_TYPE_UINT64, stats->num_copied_bytes,
+		"copy-duration", G_TYPE_UINT64, (guint64)(stats->copy_duration),
+		NULL
+	);
+}
+
+
 static void gst_imx_dma_buffer_uploader_destroy_upload_method_contexts(GstImxDmaBufferUploader *uploader)
 {
 	gint i;
@@ -60,7 +60,9 @@ G_BEGIN_DECLS
  * @GstMemory. Internally, the uploader has "upload methods". The uploader asks each method
  * to try to perform the upload. As soon as one succeeds, the uploader considers the upload
  * to be done. There are upload methods for DMA-BUF buffers, for raw uploads (meaning that
- * the bytes of input buffers are copied into an ImxDmaBuffer-based GstBuffer), etc.
+ * the bytes of input buffers are copied into an ImxDmaBuffer-based GstBuffer), for memfd
+ * backed system memory that can be turned into DMA-BUF memory through the udmabuf driver
+ * (provided that the memory is physically contiguous), etc.
  * The upload is done by calling @gst_imx_dma_buffer_uploader_perform.
  *
  * For output, things are much simpler, since, as described above, ImxDmaBuffer can be used
@@ -82,6 +84,31 @@ typedef struct _GstImxDmaBufferUploadMethodContext GstImxDmaBufferUploadMethodCo
 typedef struct _GstImxDmaBufferUploadMethodType GstImxDmaBufferUploadMethodType;
 
 
+/**
+ * GstImxDmaBufferUploaderStats:
+ * @num_passthrough_buffers: Number of buffers that were passed through as-is,
+ *     since they consisted entirely of ImxDmaBuffer backed memory.
+ * @num_imported_buffers: Number of buffers whose memory was wrapped into ImxDmaBuffer
+ *     backed memory without copying any bytes (for example, DMA-BUF memory).
+ * @num_copied_buffers: Number of buffers with at least one memory block that had
+ *     to be copied with the CPU.
+ * @num_copied_bytes: Total number of bytes that were copied with the CPU.
+ * @copy_duration: Total amount of time spent on copying with the CPU.
+ *
+ * Upload statistics. These are useful for detecting pipelines that unexpectedly
+ * fall back to CPU based copies instead of using zero-copy uploads.
+ */
+typedef struct
+{
+	guint64 num_passthrough_buffers;
+	guint64 num_imported_buffers;
+	guint64 num_copied_buffers;
+	guint64 num_copied_bytes;
+	GstClockTime copy_duration;
+}
+GstImxDmaBufferUploaderStats;
+
+
 
 GType gst_imx_dma_buffer_uploader_get_type(void);
 
@@ -129,6 +156,67 @@ GstAllocator* gst_imx_dma_buffer_uploader_get_allocator(GstImxDmaBufferUploader
  */
 GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploader, GstBuffer *input_buffer, GstBuffer **output_buffer);
 
+/**
+ * gst_imx_dma_buffer_uploader_can_upload_without_copy:
+ * @uploader: Uploader instance to check the buffer with.
+ * @buffer: (transfer-none) Buffer to check.
+ *
+ * Checks if all memory blocks in @buffer can be uploaded without copying their
+ * bytes. This is the case if they are ImxDmaBuffer backed, or if they are DMA-BUF
+ * memory blocks (or memfd memory blocks that can be wrapped with udmabuf) and the
+ * uploader's allocator is DMA-BUF capable. If this returns
+ * FALSE, @gst_imx_dma_buffer_uploader_perform would have to copy at least one of
+ * the memory blocks with the CPU. Callers that know more about the layout of the
+ * data in @buffer (for example, the planes of a video frame) can use this to
+ * decide whether or not to perform that copy on their own instead.
+ *
+ * Returns: TRUE if @buffer can be uploaded without copying any bytes.
+ */
+gboolean gst_imx_dma_buffer_uploader_can_upload_without_copy(GstImxDmaBufferUploader *uploader, GstBuffer *buffer);
+
+/**
+ * gst_imx_dma_buffer_uploader_get_stats:
+ * @uploader: Uploader instance to get the statistics from.
+ * @stats: (out) Statistics structure to fill.
+ *
+ * Retrieves the upload statistics that were accumulated since the uploader
+ * was created or since the last @gst_imx_dma_buffer_uploader_reset_stats call.
+ *
+ * This function is thread safe. However, elements typically call it from
+ * the getter of their "upload-stats" property, which can run in any thread
+ * at any time, including while the element is being stopped. The getter
+ * must therefore read the element's uploader pointer with the element's
+ * object lock held, and the element must hold that lock as well when it
+ * unrefs and clears that pointer. Otherwise, the getter could access an
+ * uploader that was just freed.
+ */
+void gst_imx_dma_buffer_uploader_get_stats(GstImxDmaBufferUploader *uploader, GstImxDmaBufferUploaderStats *stats);
+
+/**
+ * gst_imx_dma_buffer_uploader_reset_stats:
+ * @uploader: Uploader instance whose statistics shall be reset.
+ *
+ * Resets all upload statistics to zero.
+ *
+ * This function is thread safe.
+ */
+void gst_imx_dma_buffer_uploader_reset_stats(GstImxDmaBufferUploader *uploader);
+
+/**
+ * gst_imx_dma_buffer_uploader_stats_to_structure:
+ * @stats: Statistics to convert.
+ *
+ * Converts the statistics to a @GstStructure. Elements use this for
+ * their read-only "upload-stats" property. The structure is named
+ * "GstImxUploadStats", and contains the guint64 fields "passthrough",
+ * "imported", "copied", "copied-bytes", and "copy-duration". If @stats
+ * is NULL, all fields are set to 0. This is useful for when the
+ * element currently has no uploader.
+ *
+ * Returns: (transfer full) New @GstStructure with the statistics.
+ */
+GstStructure* gst_imx_dma_buffer_uploader_stats_to_structure(GstImxDmaBufferUploaderStats const *stats);
+
 
 G_END_DECLS
 
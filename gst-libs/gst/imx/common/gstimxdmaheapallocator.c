@@ -266,7 +266,7 @@ static guintptr gst_imx_dma_heap_allocator_get_physical_address(GstImxDmaBufAllo
 
 	physical_address = imx_dma_buffer_dma_heap_get_physical_address_from_dmabuf_fd(dmabuf_fd, &error);
 	if (physical_address == 0)
-		GST_ERROR_OBJECT(allocator, "could not open get physical address from dmabuf FD: %s (%d)", strerror(error), error);
+		GST_DEBUG_OBJECT(allocator, "could not get physical address from DMA-BUF FD: %s (%d)", strerror(error), error);
 
 	return physical_address;
 }
@@ -271,7 +271,7 @@ static guintptr gst_imx_ion_allocator_get_physical_address(GstImxDmaBufAllocator
 
 	physical_address = imx_dma_buffer_ion_get_physical_address_from_dmabuf_fd(imx_dma_buffer_ion_allocator_get_ion_fd(self->imxdmabuffer_allocator), dmabuf_fd, &error);
 	if (physical_address == 0)
-		GST_ERROR_OBJECT(allocator, "could not open get physical address from dmabuf FD: %s (%d)", strerror(error), error);
+		GST_DEBUG_OBJECT(allocator, "could not get physical address from DMA-BUF FD: %s (%d)", strerror(error), error);
 
 	return physical_address;
 }
@@ -3,6 +3,7 @@
 #include <gst/video/video.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gstimxvideobufferpool.h"
+#include "gstimxvideoutils.h"
 
 
 GST_DEBUG_CATEGORY_STATIC(imx_video_buffer_pool_debug);
@@ -86,10 +87,39 @@ static void gst_imx_video_buffer_pool_dispose(GObject *object)
 }
 
 
+/* Checks if the intermediate frames only differ from the tightly packed output
+ * frames by extra padding rows at the end of the frame. This is the case for
+ * example with single-plane formats whose stride already fulfills the blitter's
+ * alignment requirements, but whose number of rows does not. The blitter can
+ * then render directly into output frames, provided that the output buffers
+ * are DMA buffers with enough extra space at their end for the padding rows. */
+static gboolean intermediate_frames_fit_in_output_frames(GstVideoInfo const *output_video_info, GstVideoInfo const *intermediate_video_info)
+{
+	guint plane_index;
+
+	if (GST_VIDEO_INFO_N_PLANES(output_video_info) != GST_VIDEO_INFO_N_PLANES(intermediate_video_info))
+		return FALSE;
+
+	if (GST_VIDEO_INFO_SIZE(output_video_info) > GST_VIDEO_INFO_SIZE(intermediate_video_info))
+		return FALSE;
+
+	for (plane_index = 0; plane_index < GST_VIDEO_INFO_N_PLANES(output_video_info); ++plane_index)
+	{
+		if (GST_VIDEO_INFO_PLANE_STRIDE(output_video_info, plane_index) != GST_VIDEO_INFO_PLANE_STRIDE(intermediate_video_info, plane_index))
+			return FALSE;
+		if (GST_VIDEO_INFO_PLANE_OFFSET(output_video_info, plane_index) != GST_VIDEO_INFO_PLANE_OFFSET(intermediate_video_info, plane_index))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
 GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 	GstAllocator *imx_dma_buffer_allocator,
 	GstQuery *query,
-	GstVideoInfo const *intermediate_video_info
+	GstVideoInfo const *intermediate_video_info,
+	guint num_prewarm_buffers
 )
 {
 	GstImxVideoBufferPool *self;
@@ -100,6 +130,7 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 	GstCaps *negotiated_caps;
 	GstVideoInfo negotiated_video_info;
 	gboolean intermediate_buffers_are_tightly_packed;
+	gboolean blit_directly_into_output_buffers;
 	guint buffer_size;
 	guint video_meta_index;
 	guint i;
@@ -154,6 +185,16 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 	self->video_meta_supported = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, &video_meta_index);
 	GST_DEBUG_OBJECT(self, "video meta supported by downstream: %d", self->video_meta_supported);
 
+	/* If downstream cannot handle video meta, and the intermediate frames are
+	 * not tightly packed, the blitter output normally has to be copied into
+	 * separate output buffers. But if the only difference are extra padding
+	 * rows at the end, this copy can be avoided. See the comments in
+	 * intermediate_frames_fit_in_output_frames() for details. */
+	blit_directly_into_output_buffers = !(self->video_meta_supported)
+	                                 && !intermediate_buffers_are_tightly_packed
+	                                 && intermediate_frames_fit_in_output_frames(&negotiated_video_info, intermediate_video_info);
+	GST_DEBUG_OBJECT(self, "can blit directly into output buffers: %d", blit_directly_into_output_buffers);
+
 
 	/* Look for an allocator that is an ImxDmaBuffer allocator. */
 	for (i = 0; i < gst_query_get_n_allocation_params(query); ++i)
@@ -194,8 +235,19 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 
 	buffer_size = GST_VIDEO_INFO_SIZE(intermediate_video_info);
 
+	if (blit_directly_into_output_buffers)
+	{
+		/* Allocate the extra padding rows as allocation padding. That way,
+		 * the DMA buffers are large enough for the blitter, while the
+		 * size of the output buffers still matches the negotiated caps. */
+		buffer_size = GST_VIDEO_INFO_SIZE(&negotiated_video_info);
+		allocation_params.padding += GST_VIDEO_INFO_SIZE(intermediate_video_info) - buffer_size;
+	}
+
+	/* The min_buffers value makes the pool preallocate these buffers
+	 * during activation instead of lazily during playback. */
 	pool_config = gst_buffer_pool_get_config(self->internal_dma_buffer_pool);
-	gst_buffer_pool_config_set_params(pool_config, negotiated_caps, buffer_size, 0, 0);
+	gst_buffer_pool_config_set_params(pool_config, negotiated_caps, buffer_size, num_prewarm_buffers, 0);
 	gst_buffer_pool_config_set_allocator(pool_config, dma_buffer_allocator, &allocation_params);
 	if (self->video_meta_supported)
 		gst_buffer_pool_config_add_option(pool_config, GST_BUFFER_POOL_OPTION_VIDEO_META);
@@ -204,7 +256,7 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 
 	/* Now set up the output video buffer pool. */
 
-	if (self->video_meta_supported || intermediate_buffers_are_tightly_packed)
+	if (self->video_meta_supported || intermediate_buffers_are_tightly_packed || blit_directly_into_output_buffers)
 	{
 		/* No need to have a separate pool; just use the internal DMA
 		 * buffer pool as the output video buffer pool. */
@@ -250,6 +302,11 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 
 		gst_buffer_pool_set_active(self->internal_dma_buffer_pool, TRUE);
 
+		/* The internal DMA buffer pool is already active at this point,
+		 * so its prewarmed buffers can be prefaulted right away. Do that
+		 * in the background to not delay the allocation decision. */
+		gst_imx_video_utils_prewarm_buffer_pool(self->internal_dma_buffer_pool, num_prewarm_buffers, TRUE);
+
 		GST_INFO_OBJECT(self, "need to copy blitter output frames since downstream cannot handle those directly; this may impact performance");
 	}
 
@@ -272,12 +329,12 @@ GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 	if (gst_query_get_n_allocation_pools(query) == 0)
 	{
 		GST_DEBUG_OBJECT(self, "there are no allocation pools in the allocation query; adding our buffer pool to it");
-		gst_query_add_allocation_pool(query, self->output_video_buffer_pool, buffer_size, 0, 0);
+		gst_query_add_allocation_pool(query, self->output_video_buffer_pool, buffer_size, num_prewarm_buffers, 0);
 	}
 	else
 	{
 		GST_DEBUG_OBJECT(self, "there are allocation pools in the allocation query; setting our buffer pool as the first one in the query");
-		gst_query_set_nth_allocation_pool(query, 0, self->output_video_buffer_pool, buffer_size, 0, 0);
+		gst_query_set_nth_allocation_pool(query, 0, self->output_video_buffer_pool, buffer_size, num_prewarm_buffers, 0);
 	}
 
 	gst_object_unref(GST_OBJECT(dma_buffer_allocator));
@@ -416,7 +473,11 @@ gboolean gst_imx_video_buffer_pool_transfer_to_output_buffer(GstImxVideoBufferPo
 	}
 	output_video_frame_mapped = TRUE;
 
-	if (!gst_video_frame_copy(&output_video_frame, &intermediate_video_frame))
+	/* The output frames do not fulfill the blitter's alignment requirements
+	 * (otherwise, the blitter would have rendered into them directly), so
+	 * a hardware blit cannot be used here either. Use the optimized frame
+	 * copy instead, which can distribute the work across multiple threads. */
+	if (!gst_imx_video_utils_copy_frame(&output_video_frame, &intermediate_video_frame, 0))
 	{
 		GST_ERROR_OBJECT(imx_video_buffer_pool, "could not copy pixels from intermediate buffer into output buffer");
 		goto error;
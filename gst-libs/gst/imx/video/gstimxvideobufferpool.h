@@ -64,7 +64,17 @@ G_BEGIN_DECLS
  * If downstream can handle video meta, or if the stride / plane offset values are tightly
  * packed, then both buffer pools are the same (that is, there's _one_ pool inside, one
  * that allocates DMA buffers). That's because in such a case, frame copies are unnecessary,
- * so a separate pool for output buffers is not needed.
+ * so a separate pool for output buffers is not needed. The same is true if the stride
+ * and plane offset values of the intermediate frames match those of the tightly packed
+ * frames, and the intermediate frames only have extra padding rows at their end. Then,
+ * the pool allocates DMA buffers whose size matches the negotiated caps, with the
+ * padding rows placed in the allocation padding, so the blitter can render directly
+ * into the output buffers.
+ *
+ * If separate pools are used, gst_imx_video_buffer_pool_transfer_to_output_buffer()
+ * copies the frames with gst_imx_video_utils_copy_frame(). A hardware blit cannot
+ * be used for that transfer, since the output frames do not meet the blitter's
+ * alignment requirements.
  *
  * The GstImxVideoBufferPool is created in the decide_allocation vmethods of the elements
  * (or in the allocation query handler in case the element is not based on a subclass that
@@ -99,13 +109,22 @@ GType gst_imx_video_buffer_pool_get_type(void);
  * @imx_dma_buffer_allocator: ImxDmaBuffer allocator to use for allocating gstbuffers.
  * @query: Allocation query to parse and set up.
  * @intermediate_video_info: Video info of the intermediate frames.
+ * @num_prewarm_buffers: Minimum number of buffers the pools shall allocate
+ *     as soon as they are activated. 0 = allocate buffers lazily.
+ *
+ * @num_prewarm_buffers is used as the min_buffers value in the configuration of
+ * the internal DMA buffer pool and in the pool entry that is placed in @query.
+ * This avoids allocation stalls during the first seconds of playback. If the
+ * internal DMA buffer pool is separate from the output video buffer pool, its
+ * buffers are additionally prefaulted by a background thread.
  *
  * Returns: (transfer floating) A new video buffer pool.
  */
 GstImxVideoBufferPool* gst_imx_video_buffer_pool_new(
 	GstAllocator *imx_dma_buffer_allocator,
 	GstQuery *query,
-	GstVideoInfo const *intermediate_video_info
+	GstVideoInfo const *intermediate_video_info,
+	guint num_prewarm_buffers
 );
 
 GstBufferPool* gst_imx_video_buffer_pool_get_internal_dma_buffer_pool(GstImxVideoBufferPool *imx_video_buffer_pool);
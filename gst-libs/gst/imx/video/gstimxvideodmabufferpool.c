@@ -2,6 +2,7 @@
 #include <gst/video/video.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gstimxvideodmabufferpool.h"
+#include "gstimxvideoutils.h"
 
 
 GST_DEBUG_CATEGORY_STATIC(imx_video_dma_buffer_pool_debug);
@@ -19,6 +20,10 @@ struct _GstImxVideoDmaBufferPool
 
 	gsize plane_offsets[GST_VIDEO_MAX_PLANES];
 	gsize plane_sizes[GST_VIDEO_MAX_PLANES];
+
+	/* If TRUE, the pages of newly allocated buffers are
+	 * touched right away. See gst_imx_video_dma_buffer_pool_set_prewarm(). */
+	gboolean prefault;
 };
 
 
@@ -51,8 +56,9 @@ static void gst_imx_video_dma_buffer_pool_class_init(GstImxVideoDmaBufferPoolCla
 }
 
 
-static void gst_imx_video_dma_buffer_pool_init(G_GNUC_UNUSED GstImxVideoDmaBufferPool *self)
+static void gst_imx_video_dma_buffer_pool_init(GstImxVideoDmaBufferPool *self)
 {
+	self->prefault = FALSE;
 }
 
 
@@ -132,6 +138,17 @@ static GstFlowReturn gst_imx_video_dma_buffer_pool_alloc_buffer(GstBufferPool *p
 		}
 	}
 
+	if (self->prefault)
+	{
+		GST_DEBUG_OBJECT(self, "prefaulting newly allocated buffer");
+
+		if (!gst_imx_video_utils_prefault_buffer(*buffer))
+		{
+			GST_ERROR_OBJECT(self, "could not prefault buffer");
+			goto error;
+		}
+	}
+
 finish:
 	return flow_ret;
 
@@ -284,6 +301,35 @@ gboolean gst_imx_video_dma_buffer_pool_creates_multi_memory_buffers(GstBufferPoo
 }
 
 
+void gst_imx_video_dma_buffer_pool_set_prewarm(GstBufferPool *imx_video_dma_buffer_pool, guint num_buffers, gboolean prefault)
+{
+	GstImxVideoDmaBufferPool *self;
+	GstStructure *pool_config;
+	GstCaps *caps;
+	guint size, max_buffers;
+
+	g_assert(imx_video_dma_buffer_pool != NULL);
+	g_assert(GST_IS_IMX_VIDEO_DMA_BUFFER_POOL(imx_video_dma_buffer_pool));
+	g_assert(!gst_buffer_pool_is_active(imx_video_dma_buffer_pool));
+
+	self = GST_IMX_VIDEO_DMA_BUFFER_POOL_CAST(imx_video_dma_buffer_pool);
+
+	GST_DEBUG_OBJECT(self, "setting number of prewarmed buffers to %u, prefaulting %s", num_buffers, prefault ? "enabled" : "disabled");
+
+	self->prefault = prefault;
+
+	/* GstBufferPool's default start vfunc allocates the configured minimum
+	 * number of buffers, so setting the min_buffers value is sufficient
+	 * for allocating these buffers during the pool activation. */
+	pool_config = gst_buffer_pool_get_config(imx_video_dma_buffer_pool);
+	gst_buffer_pool_config_get_params(pool_config, &caps, &size, NULL, &max_buffers);
+	if ((max_buffers != 0) && (num_buffers > max_buffers))
+		max_buffers = num_buffers;
+	gst_buffer_pool_config_set_params(pool_config, caps, size, num_buffers, max_buffers);
+	gst_buffer_pool_set_config(imx_video_dma_buffer_pool, pool_config);
+}
+
+
 gsize gst_imx_video_dma_buffer_pool_get_plane_offset(GstBufferPool *imx_video_dma_buffer_pool, gint plane_index)
 {
 	GstImxVideoDmaBufferPool *self;
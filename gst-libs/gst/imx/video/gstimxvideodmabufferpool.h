@@ -91,6 +91,22 @@ GstBufferPool* gst_imx_video_dma_buffer_pool_new(
 GstVideoInfo const * gst_imx_video_dma_buffer_pool_get_video_info(GstBufferPool *imx_video_dma_buffer_pool);
 gboolean gst_imx_video_dma_buffer_pool_creates_multi_memory_buffers(GstBufferPool *imx_video_dma_buffer_pool);
 
+/**
+ * gst_imx_video_dma_buffer_pool_set_prewarm:
+ * @imx_video_dma_buffer_pool: Pool to configure.
+ * @num_buffers: Number of buffers to allocate when the pool is activated.
+ * @prefault: If TRUE, the pages of each newly allocated buffer are touched
+ *     with @gst_imx_video_utils_prefault_buffer right after allocation.
+ *
+ * Sets up the pool to allocate @num_buffers buffers as soon as it is activated
+ * instead of lazily during playback. These buffers are never freed until the
+ * pool is deactivated. Allocating (and optionally prefaulting) DMA memory can
+ * take a while, so this avoids stalls during the first seconds of playback.
+ *
+ * This must be called while the pool is inactive.
+ */
+void gst_imx_video_dma_buffer_pool_set_prewarm(GstBufferPool *imx_video_dma_buffer_pool, guint num_buffers, gboolean prefault);
+
 gsize gst_imx_video_dma_buffer_pool_get_plane_offset(GstBufferPool *imx_video_dma_buffer_pool, gint plane_index);
 gsize gst_imx_video_dma_buffer_pool_get_plane_size(GstBufferPool *imx_video_dma_buffer_pool, gint plane_index);
 
@@ -0,0 +1,154 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "gstimxvideoorientationmeta.h"
+
+
+static gboolean gst_imx_video_orientation_meta_init(GstMeta *meta, gpointer params, GstBuffer *buffer);
+static gboolean gst_imx_video_orientation_meta_transform(GstBuffer *dest, GstMeta *meta, GstBuffer *buffer, GQuark type, gpointer data);
+
+
+GType gst_imx_video_orientation_meta_api_get_type(void)
+{
+	static GType type = 0;
+	static gchar const *tags[] = { GST_META_TAG_VIDEO_STR, GST_META_TAG_VIDEO_ORIENTATION_STR, NULL };
+
+	if (g_once_init_enter(&type))
+	{
+		GType _type = gst_meta_api_type_register("GstImxVideoOrientationMetaAPI", tags);
+		g_once_init_leave(&type, _type);
+	}
+
+	return type;
+}
+
+
+GstMetaInfo const * gst_imx_video_orientation_meta_get_info(void)
+{
+	static GstMetaInfo const *meta_info = NULL;
+
+	if (g_once_init_enter(&meta_info))
+	{
+		GstMetaInfo const *mi = gst_meta_register(
+			GST_IMX_VIDEO_ORIENTATION_META_API_TYPE,
+			"GstImxVideoOrientationMeta",
+			sizeof(GstImxVideoOrientationMeta),
+			gst_imx_video_orientation_meta_init,
+			NULL,
+			gst_imx_video_orientation_meta_transform
+		);
+		g_once_init_leave(&meta_info, mi);
+	}
+
+	return meta_info;
+}
+
+
+GstImxVideoOrientationMeta* gst_buffer_add_imx_video_orientation_meta(GstBuffer *buffer, GstVideoOrientationMethod method)
+{
+	GstImxVideoOrientationMeta *meta;
+
+	g_assert(buffer != NULL);
+	g_assert(method != GST_VIDEO_ORIENTATION_AUTO);
+	g_assert(method != GST_VIDEO_ORIENTATION_CUSTOM);
+
+	meta = (GstImxVideoOrientationMeta *)gst_buffer_add_meta(buffer, GST_IMX_VIDEO_ORIENTATION_META_INFO, NULL);
+	meta->method = method;
+
+	return meta;
+}
+
+
+/* The orientation methods form the dihedral group of the square.
+ * Each method is expressed as an optional horizontal flip that is
+ * followed by a number of clockwise 90 degree rotations. This makes
+ * it possible to combine methods with simple integer arithmetic. */
+
+typedef struct
+{
+	gint num_rotations;
+	gboolean flip;
+}
+OrientationComponents;
+
+static OrientationComponents const orientation_components[] =
+{
+	/* GST_VIDEO_ORIENTATION_IDENTITY */ { 0, FALSE },
+	/* GST_VIDEO_ORIENTATION_90R */      { 1, FALSE },
+	/* GST_VIDEO_ORIENTATION_180 */      { 2, FALSE },
+	/* GST_VIDEO_ORIENTATION_90L */      { 3, FALSE },
+	/* GST_VIDEO_ORIENTATION_HORIZ */    { 0, TRUE },
+	/* GST_VIDEO_ORIENTATION_VERT */     { 2, TRUE },
+	/* GST_VIDEO_ORIENTATION_UL_LR */    { 3, TRUE },
+	/* GST_VIDEO_ORIENTATION_UR_LL */    { 1, TRUE }
+};
+
+
+GstVideoOrientationMethod gst_imx_video_orientation_method_combine(GstVideoOrientationMethod first, GstVideoOrientationMethod second)
+{
+	OrientationComponents const *a, *b;
+	gint num_rotations;
+	gboolean flip;
+	guint i;
+
+	g_assert(((guint)first) < G_N_ELEMENTS(orientation_components));
+	g_assert(((guint)second) < G_N_ELEMENTS(orientation_components));
+
+	a = &(orientation_components[first]);
+	b = &(orientation_components[second]);
+
+	/* A flip reverses the direction of the rotations that
+	 * were applied before it, so if the second method has
+	 * a flip, the first method's rotations are subtracted. */
+	num_rotations = (b->flip ? (b->num_rotations - a->num_rotations) : (b->num_rotations + a->num_rotations)) & 3;
+	flip = (a->flip != b->flip);
+
+	for (i = 0; i < G_N_ELEMENTS(orientation_components); ++i)
+	{
+		if ((orientation_components[i].num_rotations == num_rotations) && (orientation_components[i].flip == flip))
+			return (GstVideoOrientationMethod)i;
+	}
+
+	g_assert_not_reached();
+	return GST_VIDEO_ORIENTATION_IDENTITY;
+}
+
+
+static gboolean gst_imx_video_orientation_meta_init(GstMeta *meta, G_GNUC_UNUSED gpointer params, G_GNUC_UNUSED GstBuffer *buffer)
+{
+	GstImxVideoOrientationMeta *orientation_meta = (GstImxVideoOrientationMeta *)meta;
+	orientation_meta->method = GST_VIDEO_ORIENTATION_IDENTITY;
+	return TRUE;
+}
+
+
+static gboolean gst_imx_video_orientation_meta_transform(GstBuffer *dest, GstMeta *meta, G_GNUC_UNUSED GstBuffer *buffer, GQuark type, G_GNUC_UNUSED gpointer data)
+{
+	GstImxVideoOrientationMeta *orientation_meta = (GstImxVideoOrientationMeta *)meta;
+
+	/* Only plain copies retain the meta. Any other transformation
+	 * produces a new frame, and the element that produces it is
+	 * responsible for deciding what happens to the orientation. */
+	if (GST_META_TRANSFORM_IS_COPY(type))
+	{
+		gst_buffer_add_imx_video_orientation_meta(dest, orientation_meta->method);
+		return TRUE;
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,96 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2022  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_VIDEO_ORIENTATION_META_H
+#define GST_IMX_VIDEO_ORIENTATION_META_H
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+
+G_BEGIN_DECLS
+
+
+#define GST_IMX_VIDEO_ORIENTATION_META_API_TYPE (gst_imx_video_orientation_meta_api_get_type())
+#define GST_IMX_VIDEO_ORIENTATION_META_INFO     (gst_imx_video_orientation_meta_get_info())
+
+
+typedef struct _GstImxVideoOrientationMeta GstImxVideoOrientationMeta;
+
+
+/**
+ * GstImxVideoOrientationMeta:
+ * @meta: Parent #GstMeta.
+ * @method: Orientation method that has yet to be applied to the frame.
+ *     Never GST_VIDEO_ORIENTATION_AUTO or GST_VIDEO_ORIENTATION_CUSTOM.
+ *
+ * Metadata that instructs the consumer of the buffer to rotate and/or flip
+ * the frame when it renders it. This allows elements to hand off such
+ * transformations to consumers that perform them anyway while blitting the
+ * frame (for example, video sinks and compositors), instead of performing
+ * an extra blit of their own.
+ *
+ * Consumers announce support for this meta by adding its API type to the
+ * allocation query. Producers must not attach this meta unless downstream
+ * announced that support.
+ *
+ * If the frame also has a #GstVideoCropMeta, the crop rectangle refers to
+ * the frame prior to applying the orientation method.
+ */
+struct _GstImxVideoOrientationMeta
+{
+	GstMeta meta;
+
+	GstVideoOrientationMethod method;
+};
+
+
+GType gst_imx_video_orientation_meta_api_get_type(void);
+GstMetaInfo const * gst_imx_video_orientation_meta_get_info(void);
+
+#define gst_buffer_get_imx_video_orientation_meta(buffer) ((GstImxVideoOrientationMeta *)gst_buffer_get_meta((buffer), GST_IMX_VIDEO_ORIENTATION_META_API_TYPE))
+
+/**
+ * gst_buffer_add_imx_video_orientation_meta:
+ * @buffer: Buffer to add the meta to. Must be writable.
+ * @method: Orientation method to store in the meta.
+ *
+ * Returns: (transfer none) The added meta.
+ */
+GstImxVideoOrientationMeta* gst_buffer_add_imx_video_orientation_meta(GstBuffer *buffer, GstVideoOrientationMethod method);
+
+/**
+ * gst_imx_video_orientation_method_combine:
+ * @first: Orientation method that is applied first.
+ * @second: Orientation method that is applied to the result of @first.
+ *
+ * Combines two orientation methods into one. This is useful for consumers of
+ * #GstImxVideoOrientationMeta that have a video-direction property of their
+ * own. Neither argument may be GST_VIDEO_ORIENTATION_AUTO or
+ * GST_VIDEO_ORIENTATION_CUSTOM.
+ *
+ * Returns: The orientation method that is equivalent to applying @first
+ *     and then @second.
+ */
+GstVideoOrientationMethod gst_imx_video_orientation_method_combine(GstVideoOrientationMethod first, GstVideoOrientationMethod second);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_VIDEO_ORIENTATION_META_H */
@@ -16,8 +16,10 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <string.h>
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/allocators/allocators.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gst/imx/video/gstimxvideoutils.h"
 #include "gstimxvideouploader.h"
@@ -27,6 +29,28 @@ GST_DEBUG_CATEGORY_STATIC(imx_video_uploader_debug);
 #define GST_CAT_DEFAULT imx_video_uploader_debug
 
 
+/* Maximum number of memory blocks a buffer may have for
+ * its upload decision to be stored in the decision cache. */
+#define MAX_NUM_CACHED_MEMORIES GST_VIDEO_MAX_PLANES
+
+
+/* Describes the properties of an input buffer that the upload decision
+ * depends on. Since an allocator always produces the same type of memory,
+ * the allocator pointers also cover the memory types. */
+typedef struct
+{
+	guint num_memories;
+	GstAllocator *allocators[MAX_NUM_CACHED_MEMORIES];
+
+	gboolean has_video_meta;
+	guint num_planes;
+	gint strides[GST_VIDEO_MAX_PLANES];
+	gsize offsets[GST_VIDEO_MAX_PLANES];
+	gsize size;
+}
+UploadDecisionKey;
+
+
 struct _GstImxVideoUploader
 {
 	GstObject parent;
@@ -41,6 +65,21 @@ struct _GstImxVideoUploader
 	GstBufferPool *aligned_frames_buffer_pool;
 
 	GstImxDmaBufferUploader *dma_buffer_uploader;
+
+	/* Deciding whether or not a frame copy is needed involves looking
+	 * at the videometa and at each memory block, so the last decision
+	 * is cached. Input buffers usually come from the same buffer pool,
+	 * so most of the time, the decision can be reused as-is. */
+	UploadDecisionKey cached_decision_key;
+	gboolean cached_decision_valid;
+	gboolean cached_decision_needs_frame_copy;
+
+	/* Statistics of the frame copies done by the video uploader itself.
+	 * Protected by the object lock. Passthrough and import counts come
+	 * from the internal DMA buffer uploader. */
+	guint64 num_copied_frames;
+	guint64 num_copied_bytes;
+	GstClockTime copy_duration;
 };
 
 
@@ -71,6 +110,10 @@ static void gst_imx_video_uploader_init(GstImxVideoUploader *self)
 {
 	self->aligned_frames_buffer_pool = NULL;
 	self->dma_buffer_uploader = NULL;
+	self->cached_decision_valid = FALSE;
+	self->num_copied_frames = 0;
+	self->num_copied_bytes = 0;
+	self->copy_duration = 0;
 }
 
 
@@ -148,35 +191,60 @@ GstImxDmaBufferUploader* gst_imx_video_uploader_get_dma_buffer_uploader(GstImxVi
 }
 
 
-GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstBuffer *input_buffer, GstBuffer **output_buffer)
+static gboolean gst_imx_video_uploader_fill_decision_key(GstBuffer *input_buffer, GstVideoMeta *video_meta, UploadDecisionKey *key)
 {
-	GstFlowReturn flow_ret = GST_FLOW_OK;
 	guint i;
-	GstVideoMeta *video_meta;
-	gboolean needs_frame_copy;
-	GstVideoFrame input_buffer_frame;
-	gboolean input_buffer_frame_mapped;
-	GstVideoFrame uploaded_buffer_frame;
-	gboolean uploaded_buffer_frame_mapped;
 
-	g_assert(uploader != NULL);
-	g_assert(input_buffer != NULL);
-	g_assert(output_buffer != NULL);
+	/* memcmp() is used for comparing keys, so clear the padding bytes as well. */
+	memset(key, 0, sizeof(UploadDecisionKey));
 
-	video_meta = gst_buffer_get_video_meta(input_buffer);
-	needs_frame_copy = FALSE;
+	key->num_memories = gst_buffer_n_memory(input_buffer);
+	if (key->num_memories > MAX_NUM_CACHED_MEMORIES)
+		return FALSE;
 
-	GST_LOG_OBJECT(
-		uploader,
-		"processing input buffer (buffer has video meta: %d); buffer details: %" GST_PTR_FORMAT,
-		(video_meta != NULL),
-		(gpointer)input_buffer
-	);
+	for (i = 0; i < key->num_memories; ++i)
+	{
+		GstMemory *memory = gst_buffer_peek_memory(input_buffer, i);
 
-	*output_buffer = NULL;
+		/* Whether or not non-DMA-BUF FD memory can be uploaded without
+		 * a copy depends on the individual memory block (see the udmabuf
+		 * upload method in the DMA buffer uploader), not just on its
+		 * allocator, so decisions for such buffers cannot be cached. */
+		if (gst_is_fd_memory(memory) && !gst_is_dmabuf_memory(memory))
+			return FALSE;
+
+		key->allocators[i] = memory->allocator;
+	}
+
+	key->has_video_meta = (video_meta != NULL);
+	if (video_meta != NULL)
+	{
+		key->num_planes = video_meta->n_planes;
+		for (i = 0; i < video_meta->n_planes; ++i)
+		{
+			key->strides[i] = video_meta->stride[i];
+			key->offsets[i] = video_meta->offset[i];
+		}
+		key->size = gst_buffer_get_size(input_buffer);
+	}
+
+	return TRUE;
+}
 
-	input_buffer_frame_mapped = FALSE;
-	uploaded_buffer_frame_mapped = FALSE;
+
+static gboolean gst_imx_video_uploader_check_if_frame_copy_needed(GstImxVideoUploader *uploader, GstBuffer *input_buffer, GstVideoMeta *video_meta)
+{
+	gboolean needs_frame_copy;
+	UploadDecisionKey key;
+	gboolean is_cacheable;
+
+	is_cacheable = gst_imx_video_uploader_fill_decision_key(input_buffer, video_meta, &key);
+
+	if (is_cacheable && uploader->cached_decision_valid && (memcmp(&key, &(uploader->cached_decision_key), sizeof(UploadDecisionKey)) == 0))
+	{
+		GST_LOG_OBJECT(uploader, "reusing cached upload decision");
+		return uploader->cached_decision_needs_frame_copy;
+	}
 
 	if (video_meta != NULL)
 	{
@@ -206,6 +274,63 @@ GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstB
 		needs_frame_copy = !(uploader->original_input_video_info_aligned);
 	}
 
+	/* Even if the frame is aligned, the internal DMA buffer uploader may
+	 * still have to copy the bytes, for example because the input buffer
+	 * uses system memory. It would do so with one memcpy() per memory
+	 * block, into newly allocated DMA memory. Doing the copy here instead
+	 * is faster, since the aligned frames buffer pool reuses its DMA
+	 * buffers, and gst_imx_video_utils_copy_frame() can distribute the
+	 * copy across multiple threads. */
+	if (!needs_frame_copy && !gst_imx_dma_buffer_uploader_can_upload_without_copy(uploader->dma_buffer_uploader, input_buffer))
+	{
+		GST_LOG_OBJECT(uploader, "input buffer memory cannot be uploaded without copying it");
+		needs_frame_copy = TRUE;
+	}
+
+	if (is_cacheable)
+	{
+		uploader->cached_decision_key = key;
+		uploader->cached_decision_needs_frame_copy = needs_frame_copy;
+		uploader->cached_decision_valid = TRUE;
+	}
+
+	return needs_frame_copy;
+}
+
+
+GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstBuffer *input_buffer, GstBuffer **output_buffer)
+{
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	guint i;
+	GstVideoMeta *video_meta;
+	gboolean needs_frame_copy;
+	GstVideoFrame input_buffer_frame;
+	gboolean input_buffer_frame_mapped;
+	GstVideoFrame uploaded_buffer_frame;
+	gboolean uploaded_buffer_frame_mapped;
+	GstClockTime copy_start_time;
+
+	g_assert(uploader != NULL);
+	g_assert(input_buffer != NULL);
+	g_assert(output_buffer != NULL);
+
+	video_meta = gst_buffer_get_video_meta(input_buffer);
+	needs_frame_copy = FALSE;
+
+	GST_LOG_OBJECT(
+		uploader,
+		"processing input buffer (buffer has video meta: %d); buffer details: %" GST_PTR_FORMAT,
+		(video_meta != NULL),
+		(gpointer)input_buffer
+	);
+
+	*output_buffer = NULL;
+
+	input_buffer_frame_mapped = FALSE;
+	uploaded_buffer_frame_mapped = FALSE;
+
+	needs_frame_copy = gst_imx_video_uploader_check_if_frame_copy_needed(uploader, input_buffer, video_meta);
+
 	GST_LOG_OBJECT(uploader, "-> GstVideoFrame based frame copy is needed: %d", needs_frame_copy);
 
 	if (needs_frame_copy)
@@ -252,6 +377,8 @@ GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstB
 		 * adjusting the videometa above, since gst_video_frame_map() makes
 		 * use of the videometa's stride and offset values during the copy. */
 
+		copy_start_time = gst_util_get_timestamp();
+
 		if (!gst_video_frame_map(
 			&input_buffer_frame,
 			&(uploader->original_input_video_info),
@@ -276,7 +403,9 @@ GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstB
 		}
 		uploaded_buffer_frame_mapped = TRUE;
 
-		if (!gst_video_frame_copy(&uploaded_buffer_frame, &input_buffer_frame))
+		/* Use the default number of copy threads, which
+		 * is based on the available CPU cores. */
+		if (!gst_imx_video_utils_copy_frame(&uploaded_buffer_frame, &input_buffer_frame, 0))
 		{
 			GST_ERROR_OBJECT(uploader, "could not copy pixels from input buffer into output buffer");
 			goto error;
@@ -291,6 +420,12 @@ GstFlowReturn gst_imx_video_uploader_perform(GstImxVideoUploader *uploader, GstB
 		input_buffer_frame_mapped = FALSE;
 		gst_video_frame_unmap(&uploaded_buffer_frame);
 		uploaded_buffer_frame_mapped = FALSE;
+
+		GST_OBJECT_LOCK(uploader);
+		uploader->num_copied_frames++;
+		uploader->num_copied_bytes += GST_VIDEO_INFO_SIZE(&(uploader->original_input_video_info));
+		uploader->copy_duration += GST_CLOCK_DIFF(copy_start_time, gst_util_get_timestamp());
+		GST_OBJECT_UNLOCK(uploader);
 	}
 	else
 	{
@@ -376,6 +511,7 @@ gboolean gst_imx_video_uploader_set_input_video_info(GstImxVideoUploader *upload
 	GST_DEBUG_OBJECT(uploader, "stride remainder: %d  plane row remainder: %d", stride_remainder, plane_row_remainder);
 
 	uploader->original_input_video_info_aligned = (stride_remainder == 0) && (plane_row_remainder == 0);
+	uploader->cached_decision_valid = FALSE;
 
 
 	/* Align the stride and number of plane rows. */
@@ -451,6 +587,7 @@ void gst_imx_video_uploader_set_alignments(GstImxVideoUploader *uploader, guint
 
 	uploader->stride_alignment = (stride_alignment == 0) ? 1 : stride_alignment;
 	uploader->plane_row_alignment = (plane_row_alignment == 0) ? 1 : plane_row_alignment;
+	uploader->cached_decision_valid = FALSE;
 
 	GST_DEBUG_OBJECT(
 		uploader,
@@ -459,3 +596,32 @@ void gst_imx_video_uploader_set_alignments(GstImxVideoUploader *uploader, guint
 		uploader->plane_row_alignment
 	);
 }
+
+
+void gst_imx_video_uploader_get_stats(GstImxVideoUploader *uploader, GstImxDmaBufferUploaderStats *stats)
+{
+	g_assert(uploader != NULL);
+	g_assert(stats != NULL);
+
+	gst_imx_dma_buffer_uploader_get_stats(uploader->dma_buffer_uploader, stats);
+
+	GST_OBJECT_LOCK(uploader);
+	stats->num_copied_buffers += uploader->num_copied_frames;
+	stats->num_copied_bytes += uploader->num_copied_bytes;
+	stats->copy_duration += uploader->copy_duration;
+	GST_OBJECT_UNLOCK(uploader);
+}
+
+
+void gst_imx_video_uploader_reset_stats(GstImxVideoUploader *uploader)
+{
+	g_assert(uploader != NULL);
+
+	gst_imx_dma_buffer_uploader_reset_stats(uploader->dma_buffer_uploader);
+
+	GST_OBJECT_LOCK(uploader);
+	uploader->num_copied_frames = 0;
+	uploader->num_copied_bytes = 0;
+	uploader->copy_duration = 0;
+	GST_OBJECT_UNLOCK(uploader);
+}
@@ -43,10 +43,11 @@ G_BEGIN_DECLS
  *
  * Internally, this uses a @GstImxDmaBufferUploader if the input frames
  * are already aligned according to the alignment requirements specified
- * by the @gst_imx_video_uploader_new arguments. If a frame is not aligned,
- * the internal uploader is not used. Instead, a custom frame copy is
- * made using @GstVideoFrame and @gst_video_frame_copy to create a copy
- * of the frame that is properly aligned. GstBuffer instances created for
+ * by the @gst_imx_video_uploader_new arguments and if that uploader can
+ * upload the frames without copying bytes. Otherwise, the internal uploader
+ * is not used. Instead, a custom frame copy is made using @GstVideoFrame and
+ * @gst_imx_video_utils_copy_frame to create a copy of the frame that is
+ * properly aligned. GstBuffer instances created for
  * this custom frame copy use the same allocator that the internal uploader
  * uses (that is, the allocator pased to @gst_imx_video_uploader_new).
  * For these custom copies, there is also an intenal buffer pool to be able
@@ -116,13 +117,14 @@ GstImxDmaBufferUploader* gst_imx_video_uploader_get_dma_buffer_uploader(GstImxVi
  * @output_buffer: (out) (transfer-full) Uploaded version of @input_buffer.
  *
  * The main uploading function. As mentioned in the @GstImxVideoUploader, this
- * uploads by performing a CPU- and @gst_video_frame_copy based upload into DMA
- * memory, creating a copy of @input_buffer that fulfills the alignment requirements
- * that were specified in the @gst_imx_video_uploader_new call. If the video frame
- * in @input_buffer already fulfills the alignment requirements, then the internal
- * uploader's @gst_imx_dma_buffer_uploader_perform is used instead.
+ * uploads by performing a CPU- and @gst_imx_video_utils_copy_frame based upload
+ * into DMA memory, creating a copy of @input_buffer that fulfills the alignment
+ * requirements that were specified in the @gst_imx_video_uploader_new call. If the
+ * video frame in @input_buffer already fulfills the alignment requirements, and if
+ * @gst_imx_dma_buffer_uploader_can_upload_without_copy returns TRUE for it, then
+ * the internal uploader's @gst_imx_dma_buffer_uploader_perform is used instead.
  *
- * @gst_video_frame_copy based copies always also contain a @GstVideoMeta.
+ * Frame copies always also contain a @GstVideoMeta.
  *
  * This must not be called before @gst_imx_video_uploader_set_input_video_info,
  * since that function is necessary for setting up the internal buffer pool that
@@ -160,6 +162,32 @@ gboolean gst_imx_video_uploader_set_input_video_info(GstImxVideoUploader *upload
  */
 void gst_imx_video_uploader_set_alignments(GstImxVideoUploader *uploader, guint stride_alignment, guint plane_row_alignment);
 
+/**
+ * gst_imx_video_uploader_get_stats:
+ * @uploader: Video uploader instance to get the statistics from.
+ * @stats: (out) Statistics structure to fill.
+ *
+ * Retrieves the upload statistics. These combine the statistics of the internal
+ * @GstImxDmaBufferUploader with those of the frame copies that this video uploader
+ * performs itself. Frame copies are counted as copied buffers.
+ *
+ * This function is thread safe. When calling it from an element's property
+ * getter, the same locking rule as with @gst_imx_dma_buffer_uploader_get_stats
+ * applies to the element's uploader pointer.
+ */
+void gst_imx_video_uploader_get_stats(GstImxVideoUploader *uploader, GstImxDmaBufferUploaderStats *stats);
+
+/**
+ * gst_imx_video_uploader_reset_stats:
+ * @uploader: Video uploader instance whose statistics shall be reset.
+ *
+ * Resets all upload statistics, including those of the internal
+ * @GstImxDmaBufferUploader, to zero.
+ *
+ * This function is thread safe.
+ */
+void gst_imx_video_uploader_reset_stats(GstImxVideoUploader *uploader);
+
 
 G_END_DECLS
 
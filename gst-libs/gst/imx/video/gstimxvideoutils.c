@@ -1,6 +1,72 @@
+#include <string.h>
+#include <unistd.h>
 #include "gstimxvideoutils.h"
 
 
+/* These are free functions, so there is no class_init function where the
+ * debug category could be initialized. Do it on first use instead. */
+
+#ifndef GST_DISABLE_GST_DEBUG
+
+#define GST_CAT_DEFAULT gst_imx_video_utils_ensure_debug_category()
+
+static GstDebugCategory* gst_imx_video_utils_ensure_debug_category(void)
+{
+	static gsize gonce_result = 0;
+
+	if (g_once_init_enter(&gonce_result))
+	{
+		GstDebugCategory *cat = NULL;
+		GST_DEBUG_CATEGORY_INIT(cat, "imxvideoutils", 0, "NXP i.MX video utilities");
+		g_once_init_leave(&gonce_result, (gsize)cat);
+	}
+
+	return (GstDebugCategory *)gonce_result;
+}
+
+#endif
+
+
+/* Frames smaller than this are always copied by the calling thread alone. */
+#define PARALLEL_COPY_MIN_FRAME_SIZE (1024 * 1024)
+/* Upper limit for the number of slices a frame is split into. Beyond
+ * this point, the copy is limited by the memory bandwidth anyway. */
+#define PARALLEL_COPY_MAX_NUM_SLICES 4
+
+
+typedef struct
+{
+	guint8 *dest;
+	guint8 const *src;
+	gint dest_stride;
+	gint src_stride;
+	gsize row_length;
+	guint num_rows;
+}
+FrameCopyPlane;
+
+
+typedef struct
+{
+	FrameCopyPlane planes[GST_VIDEO_MAX_PLANES];
+	guint num_planes;
+	guint num_slices;
+
+	GMutex mutex;
+	GCond cond;
+	guint num_pending_slices;
+}
+FrameCopyJob;
+
+
+typedef struct
+{
+	FrameCopyJob *job;
+	guint slice_index;
+}
+FrameCopySlice;
+
+
 gint gst_imx_video_utils_calculate_total_num_frame_rows(GstBuffer *video_frame_buffer, GstVideoInfo const *video_info)
 {
 	gint total_num_frame_rows;
@@ -32,3 +98,271 @@ gint gst_imx_video_utils_calculate_total_num_frame_rows(GstBuffer *video_frame_b
 
 	return total_num_frame_rows;
 }
+
+
+static gint get_first_component_of_plane(GstVideoFormatInfo const *format_info, guint plane_index)
+{
+	guint component_index;
+
+	for (component_index = 0; component_index < GST_VIDEO_FORMAT_INFO_N_COMPONENTS(format_info); ++component_index)
+	{
+		if (GST_VIDEO_FORMAT_INFO_PLANE(format_info, component_index) == plane_index)
+			return component_index;
+	}
+
+	return -1;
+}
+
+
+static void copy_frame_slice(FrameCopyJob *job, guint slice_index)
+{
+	guint plane_index;
+
+	for (plane_index = 0; plane_index < job->num_planes; ++plane_index)
+	{
+		FrameCopyPlane *plane = &(job->planes[plane_index]);
+		guint first_row = plane->num_rows * slice_index / job->num_slices;
+		guint end_row = plane->num_rows * (slice_index + 1) / job->num_slices;
+		guint8 *dest = plane->dest + (gssize)first_row * plane->dest_stride;
+		guint8 const *src = plane->src + (gssize)first_row * plane->src_stride;
+		guint row;
+
+		if ((plane->dest_stride == plane->src_stride) && (plane->dest_stride > 0) && ((gsize)(plane->dest_stride) == plane->row_length))
+		{
+			/* No padding bytes in between rows, so the rows
+			 * of this slice form one contiguous block. */
+			memcpy(dest, src, plane->row_length * (end_row - first_row));
+			continue;
+		}
+
+		for (row = first_row; row < end_row; ++row)
+		{
+			memcpy(dest, src, plane->row_length);
+			dest += plane->dest_stride;
+			src += plane->src_stride;
+		}
+	}
+}
+
+
+static void frame_copy_thread_func(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	FrameCopySlice *slice = (FrameCopySlice *)data;
+	FrameCopyJob *job = slice->job;
+
+	copy_frame_slice(job, slice->slice_index);
+
+	g_mutex_lock(&(job->mutex));
+	job->num_pending_slices--;
+	if (job->num_pending_slices == 0)
+		g_cond_signal(&(job->cond));
+	g_mutex_unlock(&(job->mutex));
+}
+
+
+static GThreadPool* get_frame_copy_thread_pool(void)
+{
+	static gsize gonce_result = 0;
+
+	if (g_once_init_enter(&gonce_result))
+	{
+		/* The calling thread always copies one slice
+		 * on its own, so one thread less is needed. */
+		GThreadPool *thread_pool = g_thread_pool_new(frame_copy_thread_func, NULL, PARALLEL_COPY_MAX_NUM_SLICES - 1, FALSE, NULL);
+		g_once_init_leave(&gonce_result, (gsize)thread_pool);
+	}
+
+	return (GThreadPool *)gonce_result;
+}
+
+
+gboolean gst_imx_video_utils_copy_frame(GstVideoFrame *dest_frame, GstVideoFrame const *src_frame, guint num_threads)
+{
+	FrameCopyJob job;
+	FrameCopySlice slices[PARALLEL_COPY_MAX_NUM_SLICES];
+	GstVideoFormatInfo const *format_info;
+	guint plane_index, slice_index;
+
+	g_assert(dest_frame != NULL);
+	g_assert(src_frame != NULL);
+
+	if ((GST_VIDEO_FRAME_FORMAT(dest_frame) != GST_VIDEO_FRAME_FORMAT(src_frame))
+	 || (GST_VIDEO_FRAME_WIDTH(dest_frame) != GST_VIDEO_FRAME_WIDTH(src_frame))
+	 || (GST_VIDEO_FRAME_HEIGHT(dest_frame) != GST_VIDEO_FRAME_HEIGHT(src_frame)))
+		return FALSE;
+
+	format_info = dest_frame->info.finfo;
+
+	if (GST_VIDEO_FORMAT_INFO_IS_TILED(format_info) || GST_VIDEO_FORMAT_INFO_HAS_PALETTE(format_info))
+		return gst_video_frame_copy(dest_frame, src_frame);
+
+	job.num_planes = GST_VIDEO_FRAME_N_PLANES(dest_frame);
+
+	for (plane_index = 0; plane_index < job.num_planes; ++plane_index)
+	{
+		FrameCopyPlane *plane = &(job.planes[plane_index]);
+		gint component_index = get_first_component_of_plane(format_info, plane_index);
+
+		g_assert(component_index >= 0);
+
+		plane->dest = GST_VIDEO_FRAME_PLANE_DATA(dest_frame, plane_index);
+		plane->src = GST_VIDEO_FRAME_PLANE_DATA(src_frame, plane_index);
+		plane->dest_stride = GST_VIDEO_FRAME_PLANE_STRIDE(dest_frame, plane_index);
+		plane->src_stride = GST_VIDEO_FRAME_PLANE_STRIDE(src_frame, plane_index);
+		plane->num_rows = GST_VIDEO_FRAME_COMP_HEIGHT(dest_frame, component_index);
+		plane->row_length = GST_VIDEO_FRAME_COMP_WIDTH(dest_frame, component_index) * GST_VIDEO_FRAME_COMP_PSTRIDE(dest_frame, component_index);
+
+		/* Some packed formats (v210 for example) have no
+		 * well-defined pixel stride. Copy entire rows instead. */
+		if (plane->row_length == 0)
+			plane->row_length = MIN(ABS(plane->dest_stride), ABS(plane->src_stride));
+	}
+
+	if (num_threads == 0)
+		num_threads = g_get_num_processors();
+	job.num_slices = CLAMP(num_threads, 1, PARALLEL_COPY_MAX_NUM_SLICES);
+	if (GST_VIDEO_FRAME_SIZE(dest_frame) < PARALLEL_COPY_MIN_FRAME_SIZE)
+		job.num_slices = 1;
+
+	if (job.num_slices == 1)
+	{
+		copy_frame_slice(&job, 0);
+		return TRUE;
+	}
+
+	g_mutex_init(&(job.mutex));
+	g_cond_init(&(job.cond));
+	job.num_pending_slices = job.num_slices - 1;
+
+	for (slice_index = 1; slice_index < job.num_slices; ++slice_index)
+	{
+		slices[slice_index].job = &job;
+		slices[slice_index].slice_index = slice_index;
+		g_thread_pool_push(get_frame_copy_thread_pool(), &(slices[slice_index]), NULL);
+	}
+
+	copy_frame_slice(&job, 0);
+
+	/* The slices and the job are located on the stack,
+	 * so we must wait until all workers are done. */
+	g_mutex_lock(&(job.mutex));
+	while (job.num_pending_slices > 0)
+		g_cond_wait(&(job.cond), &(job.mutex));
+	g_mutex_unlock(&(job.mutex));
+
+	g_mutex_clear(&(job.mutex));
+	g_cond_clear(&(job.cond));
+
+	return TRUE;
+}
+
+
+gboolean gst_imx_video_utils_prefault_buffer(GstBuffer *buffer)
+{
+	guint memory_index;
+	gsize page_size = sysconf(_SC_PAGESIZE);
+
+	g_assert(buffer != NULL);
+
+	for (memory_index = 0; memory_index < gst_buffer_n_memory(buffer); ++memory_index)
+	{
+		GstMemory *memory = gst_buffer_peek_memory(buffer, memory_index);
+		GstMapInfo map_info;
+		gsize offset;
+
+		if (!gst_memory_map(memory, &map_info, GST_MAP_WRITE))
+		{
+			GST_ERROR("could not map memory block #%u of buffer %" GST_PTR_FORMAT " for prefaulting", memory_index, (gpointer)buffer);
+			return FALSE;
+		}
+
+		/* Write one byte per page to make the kernel set up all the
+		 * page table entries now instead of during playback. The
+		 * buffer contents are undefined at this point anyway. */
+		for (offset = 0; offset < map_info.size; offset += page_size)
+			((volatile guint8 *)(map_info.data))[offset] = 0;
+
+		gst_memory_unmap(memory, &map_info);
+	}
+
+	return TRUE;
+}
+
+
+typedef struct
+{
+	GstBufferPool *pool;
+	guint num_buffers;
+}
+BufferPoolPrewarmJob;
+
+
+static void prewarm_buffer_pool(GstBufferPool *pool, guint num_buffers)
+{
+	GstBuffer **buffers;
+	guint num_acquired_buffers = 0;
+	guint i;
+	GstBufferPoolAcquireParams acquire_params = {
+		.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT
+	};
+
+	/* All buffers are held until the end. Otherwise, the pool
+	 * would just hand out the same buffer over and over again. */
+	buffers = g_new0(GstBuffer *, num_buffers);
+
+	for (i = 0; i < num_buffers; ++i)
+	{
+		/* DONTWAIT makes sure that this stops early instead of blocking
+		 * if the pool's maximum number of buffers is reached. If the pool
+		 * got deactivated in the meantime, this returns GST_FLOW_FLUSHING. */
+		if (gst_buffer_pool_acquire_buffer(pool, &(buffers[i]), &acquire_params) != GST_FLOW_OK)
+			break;
+
+		num_acquired_buffers++;
+
+		if (!gst_imx_video_utils_prefault_buffer(buffers[i]))
+			break;
+	}
+
+	GST_DEBUG_OBJECT(pool, "prewarmed %u of %u requested buffers", num_acquired_buffers, num_buffers);
+
+	for (i = 0; i < num_acquired_buffers; ++i)
+		gst_buffer_unref(buffers[i]);
+
+	g_free(buffers);
+}
+
+
+static gpointer buffer_pool_prewarm_thread_func(gpointer data)
+{
+	BufferPoolPrewarmJob *job = (BufferPoolPrewarmJob *)data;
+
+	prewarm_buffer_pool(job->pool, job->num_buffers);
+
+	gst_object_unref(GST_OBJECT(job->pool));
+	g_slice_free(BufferPoolPrewarmJob, job);
+
+	return NULL;
+}
+
+
+void gst_imx_video_utils_prewarm_buffer_pool(GstBufferPool *pool, guint num_buffers, gboolean in_background)
+{
+	g_assert(pool != NULL);
+
+	if (num_buffers == 0)
+		return;
+
+	if (in_background)
+	{
+		BufferPoolPrewarmJob *job = g_slice_new(BufferPoolPrewarmJob);
+		job->pool = gst_object_ref(pool);
+		job->num_buffers = num_buffers;
+
+		/* The thread is not joined. It holds a reference to the pool
+		 * and finishes on its own once all buffers are prewarmed. */
+		g_thread_unref(g_thread_new("imxpoolprewarm", buffer_pool_prewarm_thread_func, job));
+	}
+	else
+		prewarm_buffer_pool(pool, num_buffers);
+}
@@ -28,6 +28,64 @@ G_BEGIN_DECLS
 
 gint gst_imx_video_utils_calculate_total_num_frame_rows(GstBuffer *video_frame_buffer, GstVideoInfo const *video_info);
 
+/**
+ * gst_imx_video_utils_copy_frame:
+ * @dest_frame: Mapped video frame to copy pixels into.
+ * @src_frame: Mapped video frame to copy pixels from.
+ * @num_threads: Maximum number of threads to use for copying.
+ *     0 picks a number based on the available CPU cores.
+ *
+ * Copies the pixels of @src_frame into @dest_frame. This is an alternative to
+ * @gst_video_frame_copy that is meant for copying large frames into DMA memory.
+ * All planes are processed in one pass, converting between the stride and plane
+ * offset values of the two frames, and taking chroma subsampling into account
+ * when computing the number of rows per plane. If the stride values of a plane
+ * are equal and contain no padding, the plane rows are transferred with one
+ * single memcpy() call instead of one call per row.
+ *
+ * Large frames are split into horizontal slices, which are then copied in
+ * parallel by a process-wide pool of worker threads. The calling thread copies
+ * one of the slices itself and blocks until the others are done. Small frames
+ * are always copied by the calling thread alone, since distributing their
+ * slices would cost more than it would save.
+ *
+ * Both frames must have the same format, width, and height. Tiled formats and
+ * formats with a palette are passed on to @gst_video_frame_copy.
+ *
+ * Returns: TRUE if the copy succeeded, FALSE otherwise.
+ */
+gboolean gst_imx_video_utils_copy_frame(GstVideoFrame *dest_frame, GstVideoFrame const *src_frame, guint num_threads);
+
+/**
+ * gst_imx_video_utils_prefault_buffer:
+ * @buffer: Buffer whose memory blocks shall be prefaulted.
+ *
+ * Maps each memory block of @buffer for writing and touches each of its
+ * pages. This moves the cost of setting up the CPU mapping and the page
+ * table entries to the time of the call instead of the first use of the
+ * buffer. The previous buffer contents are overwritten.
+ *
+ * Returns: TRUE if all memory blocks could be prefaulted, FALSE otherwise.
+ */
+gboolean gst_imx_video_utils_prefault_buffer(GstBuffer *buffer);
+
+/**
+ * gst_imx_video_utils_prewarm_buffer_pool:
+ * @pool: Active buffer pool to prewarm.
+ * @num_buffers: Number of buffers to prewarm.
+ * @in_background: If TRUE, the prewarming is done by a separate thread.
+ *
+ * Acquires up to @num_buffers buffers from @pool, prefaults them with
+ * @gst_imx_video_utils_prefault_buffer, and then releases them back into
+ * the pool. This makes the pool allocate its buffers right away instead
+ * of lazily during playback. Prewarming stops early if the pool reaches
+ * its maximum number of buffers or gets deactivated.
+ *
+ * If @in_background is TRUE, this function returns immediately. The
+ * background thread keeps a reference to @pool until it is done.
+ */
+void gst_imx_video_utils_prewarm_buffer_pool(GstBufferPool *pool, guint num_buffers, gboolean in_background);
+
 
 G_END_DECLS
 
@@ -203,13 +203,16 @@ static char const * g2d_tile_layout_to_string(enum g2d_tiling tiling)
 }
 
 
-static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
+/* Filling the G2D surface description is split into two parts: the
+ * layout (format, stride, size, tiling), which only depends on the
+ * imx2d surface description, and the plane addresses, which depend on
+ * the DMA buffers that are currently assigned to the surface. The
+ * former rarely changes between frames, so it is cached by the blitter
+ * (see G2DBlitCache below). The latter needs to be updated every time. */
+
+static BOOL fill_g2d_surface_layout(struct g2d_surface *g2d_surface, Imx2dSurfaceDesc const *desc)
 {
-	int i;
-	imx_physical_address_t physical_address;
-	ImxDmaBuffer *dma_buffer;
 	Imx2dPixelFormatInfo const *fmt_info;
-	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
 
 	fmt_info = imx_2d_get_pixel_format_info(desc->format);
 	if (fmt_info == NULL)
@@ -230,6 +233,20 @@ static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface
 	g2d_surface->width = g2d_surface->stride;
 	g2d_surface->height = desc->height + desc->num_padding_rows;
 
+	return TRUE;
+}
+
+
+static BOOL fill_g2d_surface_planes(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
+{
+	int i;
+	imx_physical_address_t physical_address;
+	ImxDmaBuffer *dma_buffer;
+	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
+	Imx2dPixelFormatInfo const *fmt_info = imx_2d_get_pixel_format_info(desc->format);
+
+	assert(fmt_info != NULL);
+
 	for (i = 0; i < fmt_info->num_planes; ++i)
 	{
 		dma_buffer = imx_2d_surface_get_dma_buffer(imx_2d_surface, i);
@@ -264,11 +281,16 @@ static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface
 }
 
 
-static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSurface *imx_2d_surface)
+static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
 {
-	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
+	return fill_g2d_surface_layout(g2d_surface, imx_2d_surface_get_desc(imx_2d_surface))
+	    && fill_g2d_surface_planes(g2d_surface, imx_2d_surface);
+}
 
-	if (!fill_g2d_surface_info(&(g2d_surfaceEx->base), imx_2d_surface))
+
+static BOOL fill_g2d_surfaceEx_layout(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSurfaceDesc const *desc)
+{
+	if (!fill_g2d_surface_layout(&(g2d_surfaceEx->base), desc))
 		return FALSE;
 
 	switch (desc->format)
@@ -316,12 +338,35 @@ static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSu
 typedef struct _Imx2dG2DBlitter Imx2dG2DBlitter;
 
 
+/* G2D source and dest surface descriptions from the last blit, along
+ * with the parameters they were built from. Typically, the surface
+ * descriptions and blit parameters are the same for many frames in a
+ * row; only the DMA buffers change. If the parameters of a blit match
+ * the cached ones, the cached descriptions are reused, and only their
+ * plane addresses are updated. */
+typedef struct
+{
+	BOOL valid;
+
+	Imx2dSurfaceDesc source_desc, dest_desc;
+	Imx2dRegion source_region, dest_region;
+	Imx2dRotation rotation;
+	int dest_surface_alpha;
+
+	struct g2d_surfaceEx source_surf, dest_surf;
+	BOOL do_alpha;
+}
+G2DBlitCache;
+
+
 struct _Imx2dG2DBlitter
 {
 	Imx2dBlitter parent;
 
 	void *g2d_handle;
 
+	G2DBlitCache blit_cache;
+
 	struct g2d_surface fill_g2d_surface;
 	ImxDmaBuffer *fill_g2d_surface_dmabuffer;
 
@@ -342,6 +387,7 @@ static int imx_2d_backend_g2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 static Imx2dHardwareCapabilities const * imx_2d_backend_g2d_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
 
 static void imx_2d_backend_g2d_blitter_set_colorimetry(Imx2dG2DBlitter *g2d_blitter);
+static BOOL imx_2d_backend_g2d_blitter_update_blit_cache(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalBlitParams *internal_blit_params, Imx2dRegion const *source_region);
 
 
 static Imx2dBlitterClass imx_2d_backend_g2d_blitter_class =
@@ -462,45 +508,41 @@ static int imx_2d_backend_g2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	BOOL do_alpha;
 	int g2d_ret;
 	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	G2DBlitCache *blit_cache = &(g2d_blitter->blit_cache);
 	struct g2d_surfaceEx g2d_source_surf, g2d_dest_surf;
+	Imx2dRegion const *source_region;
 
 	assert(blitter != NULL);
 	assert(blitter->dest != NULL);
 	assert(internal_blit_params != NULL);
 	assert(internal_blit_params->source != NULL);
+	assert(internal_blit_params->dest_region != NULL);
 
 	assert(g2d_blitter->g2d_handle != NULL);
 
-
-	if (!fill_g2d_surfaceEx_info(&g2d_source_surf, internal_blit_params->source) || !fill_g2d_surfaceEx_info(&g2d_dest_surf, blitter->dest))
-		return FALSE;
-
-	copy_region_to_g2d_surface(&(g2d_source_surf.base), internal_blit_params->source, internal_blit_params->source_region);
-	copy_region_to_g2d_surface(&(g2d_dest_surf.base), blitter->dest, internal_blit_params->dest_region);
-
-	g2d_source_surf.base.clrcolor = g2d_dest_surf.base.clrcolor = 0xFF000000;
-
-	do_alpha = (internal_blit_params->dest_surface_alpha != 255) || g2d_format_has_alpha(g2d_source_surf.base.format);
-
-	g2d_source_surf.base.rot = g2d_dest_surf.base.rot = G2D_ROTATION_0;
-	switch (internal_blit_params->rotation)
+	source_region = (internal_blit_params->source_region != NULL) ? internal_blit_params->source_region : imx_2d_surface_get_region(internal_blit_params->source);
+
+	/* Only rebuild the G2D surface descriptions if something other
+	 * than the DMA buffers changed since the last blit. */
+	if (!blit_cache->valid
+	 || !imx_2d_surface_desc_check_if_equal(&(blit_cache->source_desc), imx_2d_surface_get_desc(internal_blit_params->source))
+	 || !imx_2d_surface_desc_check_if_equal(&(blit_cache->dest_desc), imx_2d_surface_get_desc(blitter->dest))
+	 || !imx_2d_region_check_if_equal(&(blit_cache->source_region), source_region)
+	 || !imx_2d_region_check_if_equal(&(blit_cache->dest_region), internal_blit_params->dest_region)
+	 || (blit_cache->rotation != internal_blit_params->rotation)
+	 || (blit_cache->dest_surface_alpha != internal_blit_params->dest_surface_alpha))
 	{
-		case IMX_2D_ROTATION_90:  g2d_dest_surf.base.rot = G2D_ROTATION_90; break;
-		case IMX_2D_ROTATION_180: g2d_dest_surf.base.rot = G2D_ROTATION_180; break;
-		case IMX_2D_ROTATION_270: g2d_dest_surf.base.rot = G2D_ROTATION_270; break;
-		case IMX_2D_ROTATION_FLIP_HORIZONTAL: g2d_source_surf.base.rot = G2D_FLIP_H; break;
-		case IMX_2D_ROTATION_FLIP_VERTICAL: g2d_source_surf.base.rot = G2D_FLIP_V; break;
-		case IMX_2D_ROTATION_UL_LR:
-			g2d_source_surf.base.rot = G2D_FLIP_V;
-			g2d_dest_surf.base.rot = G2D_ROTATION_90;
-			break;
-		case IMX_2D_ROTATION_UR_LL:
-			g2d_source_surf.base.rot = G2D_FLIP_H;
-			g2d_dest_surf.base.rot = G2D_ROTATION_90;
-			break;
-		default: break;
+		if (!imx_2d_backend_g2d_blitter_update_blit_cache(g2d_blitter, internal_blit_params, source_region))
+			return FALSE;
 	}
 
+	memcpy(&g2d_source_surf, &(blit_cache->source_surf), sizeof(struct g2d_surfaceEx));
+	memcpy(&g2d_dest_surf, &(blit_cache->dest_surf), sizeof(struct g2d_surfaceEx));
+	do_alpha = blit_cache->do_alpha;
+
+	if (!fill_g2d_surface_planes(&(g2d_source_surf.base), internal_blit_params->source) || !fill_g2d_surface_planes(&(g2d_dest_surf.base), blitter->dest))
+		return FALSE;
+
 	DUMP_G2D_SURFACE_TO_LOG("blit source", &g2d_source_surf);
 	DUMP_G2D_SURFACE_TO_LOG("blit dest", &g2d_dest_surf);
 
@@ -635,27 +677,20 @@ static int imx_2d_backend_g2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 		}
 	}
 
+	/* The blend functions and global alpha values are part of
+	 * the cached surface descriptions. The G2D blend states
+	 * however belong to the G2D handle and are set here. */
 	if (do_alpha)
 	{
-		g2d_source_surf.base.blendfunc = G2D_SRC_ALPHA;
-		g2d_dest_surf.base.blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
 		g2d_enable(g2d_blitter->g2d_handle, G2D_BLEND);
 
 		if (internal_blit_params->dest_surface_alpha != 255)
-		{
 			g2d_enable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-			g2d_source_surf.base.global_alpha = internal_blit_params->dest_surface_alpha;
-			g2d_dest_surf.base.global_alpha = 255 - internal_blit_params->dest_surface_alpha;
-		}
 		else
 			g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
 	}
 	else
 	{
-		g2d_source_surf.base.blendfunc = G2D_ONE;
-		g2d_dest_surf.base.blendfunc = G2D_ZERO;
-		g2d_source_surf.base.global_alpha = 0;
-		g2d_dest_surf.base.global_alpha = 0;
 		g2d_disable(g2d_blitter->g2d_handle, G2D_BLEND);
 		g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
 	}
@@ -718,6 +753,82 @@ static Imx2dHardwareCapabilities const * imx_2d_backend_g2d_blitter_get_hardware
 }
 
 
+static BOOL imx_2d_backend_g2d_blitter_update_blit_cache(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalBlitParams *internal_blit_params, Imx2dRegion const *source_region)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)g2d_blitter;
+	G2DBlitCache *blit_cache = &(g2d_blitter->blit_cache);
+	struct g2d_surfaceEx *g2d_source_surf = &(blit_cache->source_surf);
+	struct g2d_surfaceEx *g2d_dest_surf = &(blit_cache->dest_surf);
+
+	IMX_2D_LOG(DEBUG, "surface descriptions or blit parameters changed; rebuilding G2D surface descriptions");
+
+	/* Mark the cache as invalid first in case one
+	 * of the calls below fails half-way through. */
+	blit_cache->valid = FALSE;
+
+	memset(g2d_source_surf, 0, sizeof(struct g2d_surfaceEx));
+	memset(g2d_dest_surf, 0, sizeof(struct g2d_surfaceEx));
+
+	if (!fill_g2d_surfaceEx_layout(g2d_source_surf, imx_2d_surface_get_desc(internal_blit_params->source)) || !fill_g2d_surfaceEx_layout(g2d_dest_surf, imx_2d_surface_get_desc(blitter->dest)))
+		return FALSE;
+
+	copy_region_to_g2d_surface(&(g2d_source_surf->base), internal_blit_params->source, source_region);
+	copy_region_to_g2d_surface(&(g2d_dest_surf->base), blitter->dest, internal_blit_params->dest_region);
+
+	g2d_source_surf->base.clrcolor = g2d_dest_surf->base.clrcolor = 0xFF000000;
+
+	blit_cache->do_alpha = (internal_blit_params->dest_surface_alpha != 255) || g2d_format_has_alpha(g2d_source_surf->base.format);
+
+	g2d_source_surf->base.rot = g2d_dest_surf->base.rot = G2D_ROTATION_0;
+	switch (internal_blit_params->rotation)
+	{
+		case IMX_2D_ROTATION_90:  g2d_dest_surf->base.rot = G2D_ROTATION_90; break;
+		case IMX_2D_ROTATION_180: g2d_dest_surf->base.rot = G2D_ROTATION_180; break;
+		case IMX_2D_ROTATION_270: g2d_dest_surf->base.rot = G2D_ROTATION_270; break;
+		case IMX_2D_ROTATION_FLIP_HORIZONTAL: g2d_source_surf->base.rot = G2D_FLIP_H; break;
+		case IMX_2D_ROTATION_FLIP_VERTICAL: g2d_source_surf->base.rot = G2D_FLIP_V; break;
+		case IMX_2D_ROTATION_UL_LR:
+			g2d_source_surf->base.rot = G2D_FLIP_V;
+			g2d_dest_surf->base.rot = G2D_ROTATION_90;
+			break;
+		case IMX_2D_ROTATION_UR_LL:
+			g2d_source_surf->base.rot = G2D_FLIP_H;
+			g2d_dest_surf->base.rot = G2D_ROTATION_90;
+			break;
+		default: break;
+	}
+
+	if (blit_cache->do_alpha)
+	{
+		g2d_source_surf->base.blendfunc = G2D_SRC_ALPHA;
+		g2d_dest_surf->base.blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
+
+		if (internal_blit_params->dest_surface_alpha != 255)
+		{
+			g2d_source_surf->base.global_alpha = internal_blit_params->dest_surface_alpha;
+			g2d_dest_surf->base.global_alpha = 255 - internal_blit_params->dest_surface_alpha;
+		}
+	}
+	else
+	{
+		g2d_source_surf->base.blendfunc = G2D_ONE;
+		g2d_dest_surf->base.blendfunc = G2D_ZERO;
+		g2d_source_surf->base.global_alpha = 0;
+		g2d_dest_surf->base.global_alpha = 0;
+	}
+
+	memcpy(&(blit_cache->source_desc), imx_2d_surface_get_desc(internal_blit_params->source), sizeof(Imx2dSurfaceDesc));
+	memcpy(&(blit_cache->dest_desc), imx_2d_surface_get_desc(blitter->dest), sizeof(Imx2dSurfaceDesc));
+	blit_cache->source_region = *source_region;
+	blit_cache->dest_region = *(internal_blit_params->dest_region);
+	blit_cache->rotation = internal_blit_params->rotation;
+	blit_cache->dest_surface_alpha = internal_blit_params->dest_surface_alpha;
+	blit_cache->valid = TRUE;
+
+	return TRUE;
+}
+
+
 static void imx_2d_backend_g2d_blitter_set_colorimetry(Imx2dG2DBlitter *g2d_blitter)
 {
 #ifdef IMX2D_G2D_COLORIMETRY_SUPPORTED
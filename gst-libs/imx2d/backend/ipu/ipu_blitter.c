@@ -39,6 +39,66 @@
  */
 
 
+/* Rotations by 90 degrees (with or without an additional flip) are
+ * performed by the IPU's image rotator (IRT). The IRT can handle at
+ * most 1024x1024 pixels in one task, and the IPU kernel driver cannot
+ * split rotated tasks on its own. Flipping and 180 degree rotation
+ * are done by the IPU's image converter instead, without involving
+ * the IRT, and the driver can split such tasks by itself if needed. */
+#define IPU_MAX_IRT_TILE_LENGTH 1024
+/* Tile sizes are aligned to this many pixels, since the IRT
+ * works on blocks of 8x8 pixels. */
+#define IPU_IRT_TILE_ALIGNMENT 8
+
+
+static BOOL rotation_requires_irt(Imx2dRotation rotation)
+{
+	switch (rotation)
+	{
+		case IMX_2D_ROTATION_90:
+		case IMX_2D_ROTATION_270:
+		case IMX_2D_ROTATION_UL_LR:
+		case IMX_2D_ROTATION_UR_LL:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+
+typedef struct
+{
+	int num_tiles;
+	int tile_length;
+	int last_tile_length;
+}
+IpuTileAxisPlan;
+
+
+/* Plans how to split one axis of the output region into IRT tiles.
+ * The smallest possible number of tiles is used, since each tile
+ * costs one ioctl. The length is then distributed evenly across the
+ * tiles, with all tiles except the last one aligned. Simply using
+ * 1024-pixel tiles would instead produce very thin last tiles in
+ * common cases (for example, 1080 rows would be split into 1024 + 56
+ * rows), which the IRT processes inefficiently, and which can run
+ * into the IRT's alignment restrictions. */
+static void plan_ipu_tile_axis(IpuTileAxisPlan *plan, int length)
+{
+	assert(plan != NULL);
+	assert(length > 0);
+
+	plan->num_tiles = (length + (IPU_MAX_IRT_TILE_LENGTH - 1)) / IPU_MAX_IRT_TILE_LENGTH;
+
+	plan->tile_length = (length + (plan->num_tiles - 1)) / plan->num_tiles;
+	plan->tile_length = (plan->tile_length + (IPU_IRT_TILE_ALIGNMENT - 1)) & ~(IPU_IRT_TILE_ALIGNMENT - 1);
+	plan->tile_length = MIN(plan->tile_length, IPU_MAX_IRT_TILE_LENGTH);
+
+	plan->last_tile_length = length - (plan->num_tiles - 1) * plan->tile_length;
+	assert(plan->last_tile_length > 0);
+}
+
+
 static Imx2dPixelFormat const supported_source_pixel_formats[] =
 {
 	IMX_2D_PIXEL_FORMAT_BGRX8888,
@@ -150,6 +210,12 @@ struct _Imx2dIPUBlitter
 	int ipu_fd;
 
 	struct ipu_task main_task;
+
+	/* Copy of main_task (with the physical addresses set to 0) from
+	 * the last blit whose task(s) passed the IPU_CHECK_TASK ioctl.
+	 * See imx_2d_backend_ipu_blitter_do_blit() for details. */
+	struct ipu_task checked_task_layout;
+	BOOL task_layout_checked;
 };
 
 
@@ -296,6 +362,8 @@ static int imx_2d_backend_ipu_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	int output_width, output_height;
 	uint32_t ipu_format;
 	int ioctl_ret;
+	struct ipu_task task_layout;
+	BOOL check_task;
 
 	src_surface_desc = imx_2d_surface_get_desc(internal_blit_params->source);
 	fmt_info = imx_2d_get_pixel_format_info(src_surface_desc->format);
@@ -371,17 +439,37 @@ static int imx_2d_backend_ipu_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 
 	ipu_blitter->main_task.input.format = ipu_format;
 
-	if ((internal_blit_params->rotation == IMX_2D_ROTATION_NONE) || (internal_blit_params->rotation == IMX_2D_ROTATION_180))
+	/* IPU_CHECK_TASK is only used for getting more detailed feedback
+	 * about what is wrong with a task, since IPU_QUEUE_TASK validates
+	 * tasks anyway. The task layout (= everything except the physical
+	 * addresses) rarely changes between frames, so the check is only
+	 * done if the layout differs from the one that was last checked.
+	 * (All fields of main_task, including padding bytes, start out
+	 * zeroed by memset(), so memcmp() can be used here.) */
+	memcpy(&task_layout, &(ipu_blitter->main_task), sizeof(struct ipu_task));
+	task_layout.input.paddr = 0;
+	task_layout.output.paddr = 0;
+	check_task = !(ipu_blitter->task_layout_checked) || (memcmp(&task_layout, &(ipu_blitter->checked_task_layout), sizeof(struct ipu_task)) != 0);
+	if (check_task)
 	{
-		IMX_2D_LOG(TRACE, "rotation \"%s\" requested; the IPU can handle this in one ioctl, no manual tiling required", imx_2d_rotation_to_string(internal_blit_params->rotation));
+		IMX_2D_LOG(DEBUG, "IPU task layout changed; checking task(s) before queuing them");
+		ipu_blitter->task_layout_checked = FALSE;
+	}
+
+	if (!rotation_requires_irt(internal_blit_params->rotation) || ((output_width <= IPU_MAX_IRT_TILE_LENGTH) && (output_height <= IPU_MAX_IRT_TILE_LENGTH)))
+	{
+		IMX_2D_LOG(TRACE, "rotation \"%s\" requested with output size %dx%d; the IPU can handle this in one ioctl, no manual tiling required", imx_2d_rotation_to_string(internal_blit_params->rotation), output_width, output_height);
 
 		/* Do a task check before actually trying to queue the task for blitting.
 		 * This gives us more detailed feedback if something is wrong with the task. */
-		ioctl_ret = ioctl(ipu_blitter->ipu_fd, IPU_CHECK_TASK, &(ipu_blitter->main_task));
-		if (ioctl_ret != IPU_CHECK_OK)
+		if (check_task)
 		{
-			IMX_2D_LOG(ERROR, "check-task ioctl detected error: %s (%d)", ipu_error_to_string(ioctl_ret), ioctl_ret);
-			return FALSE;
+			ioctl_ret = ioctl(ipu_blitter->ipu_fd, IPU_CHECK_TASK, &(ipu_blitter->main_task));
+			if (ioctl_ret != IPU_CHECK_OK)
+			{
+				IMX_2D_LOG(ERROR, "check-task ioctl detected error: %s (%d)", ipu_error_to_string(ioctl_ret), ioctl_ret);
+				return FALSE;
+			}
 		}
 
 		if (ioctl(ipu_blitter->ipu_fd, IPU_QUEUE_TASK, &(ipu_blitter->main_task)) < 0)
@@ -393,44 +481,34 @@ static int imx_2d_backend_ipu_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	else
 	{
 		int tile_x, tile_y;
-		int num_x_tiles, num_y_tiles;
-		int last_tile_width, last_tile_height;
-
-		/* The IPU expects tiles with up to 1024x1024 pixels. */
-		int const max_tile_width = 1024;
-		int const max_tile_height = 1024;
+		IpuTileAxisPlan x_plan, y_plan;
 
-		/* Calculate number of tiling with rounding up (so, for example, "5.1 tiles" -> "6 tiles").
-		 * The last "partial" tiles are handled separately by the code below. */
-		num_x_tiles = (output_width + (max_tile_width - 1)) / max_tile_width;
-		num_y_tiles = (output_height + (max_tile_height - 1)) / max_tile_height;
-
-		last_tile_width = output_width - (num_x_tiles - 1) * max_tile_width;
-		last_tile_height = output_height - (num_y_tiles - 1) * max_tile_height;
+		plan_ipu_tile_axis(&x_plan, output_width);
+		plan_ipu_tile_axis(&y_plan, output_height);
 
 		IMX_2D_LOG(TRACE, "rotation \"%s\" requested; the IPU cannot handle this in one ioctl; manual tiling required", imx_2d_rotation_to_string(internal_blit_params->rotation));
 		IMX_2D_LOG(
 			TRACE,
-			"max tile width/height: %d/%d  last tile width/height: %d/%d  num x/y tiles: %d/%d",
-			max_tile_width, max_tile_height,
-			last_tile_width, last_tile_height,
-			num_x_tiles, num_y_tiles
+			"tile width/height: %d/%d  last tile width/height: %d/%d  num x/y tiles: %d/%d",
+			x_plan.tile_length, y_plan.tile_length,
+			x_plan.last_tile_length, y_plan.last_tile_length,
+			x_plan.num_tiles, y_plan.num_tiles
 		);
 
-		for (tile_y = 0; tile_y < num_y_tiles; ++tile_y)
+		for (tile_y = 0; tile_y < y_plan.num_tiles; ++tile_y)
 		{
-			int output_y = tile_y * max_tile_height;
-			int tile_height = (tile_y == (num_y_tiles - 1)) ? last_tile_height : max_tile_height;
+			int output_y = tile_y * y_plan.tile_length;
+			int tile_height = (tile_y == (y_plan.num_tiles - 1)) ? y_plan.last_tile_length : y_plan.tile_length;
 
-			ipu_blitter->main_task.output.crop.pos.y = tile_y * max_tile_height;
+			ipu_blitter->main_task.output.crop.pos.y = dest_region->y1 + output_y;
 			ipu_blitter->main_task.output.crop.h = tile_height;
 
-			for (tile_x = 0; tile_x < num_x_tiles; ++tile_x)
+			for (tile_x = 0; tile_x < x_plan.num_tiles; ++tile_x)
 			{
-				int output_x = tile_x * max_tile_width;
-				int tile_width = (tile_x == (num_x_tiles - 1)) ? last_tile_width : max_tile_width;
+				int output_x = tile_x * x_plan.tile_length;
+				int tile_width = (tile_x == (x_plan.num_tiles - 1)) ? x_plan.last_tile_length : x_plan.tile_length;
 
-				ipu_blitter->main_task.output.crop.pos.x = tile_x * max_tile_width;
+				ipu_blitter->main_task.output.crop.pos.x = dest_region->x1 + output_x;
 				ipu_blitter->main_task.output.crop.w = tile_width;
 
 				/* Calculate the region in the source surface that corresponds
@@ -514,12 +592,17 @@ static int imx_2d_backend_ipu_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 				);
 
 				/* Do a task check before actually trying to queue the task for blitting.
-				 * This gives us more detailed feedback if something is wrong with the task. */
-				ioctl_ret = ioctl(ipu_blitter->ipu_fd, IPU_CHECK_TASK, &(ipu_blitter->main_task));
-				if (ioctl_ret != IPU_CHECK_OK)
+				 * This gives us more detailed feedback if something is wrong with the task.
+				 * The tiles are derived from the task layout, so if the layout did not
+				 * change, the tiles did not change either. */
+				if (check_task)
 				{
-					IMX_2D_LOG(ERROR, "check-task ioctl detected error for tile (%d, %d): %s (%d)", tile_x, tile_y, ipu_error_to_string(ioctl_ret), ioctl_ret);
-					return FALSE;
+					ioctl_ret = ioctl(ipu_blitter->ipu_fd, IPU_CHECK_TASK, &(ipu_blitter->main_task));
+					if (ioctl_ret != IPU_CHECK_OK)
+					{
+						IMX_2D_LOG(ERROR, "check-task ioctl detected error for tile (%d, %d): %s (%d)", tile_x, tile_y, ipu_error_to_string(ioctl_ret), ioctl_ret);
+						return FALSE;
+					}
 				}
 
 				if (ioctl(ipu_blitter->ipu_fd, IPU_QUEUE_TASK, &(ipu_blitter->main_task)) < 0)
@@ -531,6 +614,12 @@ static int imx_2d_backend_ipu_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 		}
 	}
 
+	if (check_task)
+	{
+		memcpy(&(ipu_blitter->checked_task_layout), &task_layout, sizeof(struct ipu_task));
+		ipu_blitter->task_layout_checked = TRUE;
+	}
+
 	return TRUE;
 }
 
@@ -112,6 +112,19 @@ struct _Imx2dPxPBlitter
 	struct pxp_config_data pxp_config;
 	struct pxp_chan_handle pxp_channel;
 	BOOL pxp_channel_requested;
+
+	/* PxP jobs are not submitted right away. Instead, the job that is
+	 * configured in pxp_config is kept back until the next operation
+	 * or until finish() is called. This way, if the next blit can be
+	 * rendered by the PxP's overlay layer, it is merged into that job
+	 * instead of requiring a job of its own. */
+	BOOL job_pending;
+	BOOL pending_job_accepts_overlay;
+
+	/* Number of started jobs whose completion has not been waited for
+	 * yet. The PxP processes the jobs of a channel in order, so waiting
+	 * for their completion is deferred until finish() is called. */
+	int num_started_jobs;
 };
 
 
@@ -125,6 +138,10 @@ static int imx_2d_backend_pxp_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 
 static Imx2dHardwareCapabilities const * imx_2d_backend_pxp_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
 
+static BOOL imx_2d_backend_pxp_blitter_submit_pending_job(Imx2dPxPBlitter *pxp_blitter);
+static BOOL imx_2d_backend_pxp_blitter_wait_for_started_jobs(Imx2dPxPBlitter *pxp_blitter);
+static BOOL imx_2d_backend_pxp_blitter_merge_overlay(Imx2dPxPBlitter *pxp_blitter, Imx2dInternalBlitParams *internal_blit_params);
+
 
 static Imx2dBlitterClass imx_2d_backend_pxp_blitter_class =
 {
@@ -146,6 +163,11 @@ static void imx_2d_backend_pxp_blitter_destroy(Imx2dBlitter *blitter)
 
 	assert(blitter != NULL);
 
+	/* Make sure the PxP is not using any buffers anymore
+	 * in case the blitter is destroyed without finishing. */
+	if (pxp_blitter->num_started_jobs > 0)
+		imx_2d_backend_pxp_blitter_wait_for_started_jobs(pxp_blitter);
+
 	if (pxp_blitter->pxp_channel_requested)
 	{
 		assert(pxp_blitter->pxp_fd > 0);
@@ -190,6 +212,20 @@ static int imx_2d_backend_pxp_blitter_start(Imx2dBlitter *blitter)
 	phys_address = imx_dma_buffer_get_physical_address(dest_dma_buffer);
 	assert(phys_address != 0);
 
+	/* If the previous blitting sequence was not finished (for example
+	 * because the caller hit an error), drop the job that was never
+	 * submitted, and wait for the started jobs, since the PxP may still
+	 * be writing into the previous destination. */
+	if (pxp_blitter->job_pending)
+	{
+		IMX_2D_LOG(DEBUG, "previous blitting sequence was not finished; dropping pending PxP job");
+		pxp_blitter->job_pending = FALSE;
+		pxp_blitter->pending_job_accepts_overlay = FALSE;
+	}
+
+	if (pxp_blitter->num_started_jobs > 0)
+		imx_2d_backend_pxp_blitter_wait_for_started_jobs(pxp_blitter);
+
 	memset(&(pxp_blitter->pxp_config), 0, sizeof(pxp_blitter->pxp_config));
 	pxp_blitter->pxp_config.handle = pxp_blitter->pxp_channel.handle;
 
@@ -222,8 +258,15 @@ static int imx_2d_backend_pxp_blitter_start(Imx2dBlitter *blitter)
 
 static int imx_2d_backend_pxp_blitter_finish(Imx2dBlitter *blitter)
 {
-	IMX_2D_UNUSED_PARAM(blitter);
-	return TRUE;
+	Imx2dPxPBlitter *pxp_blitter = (Imx2dPxPBlitter *)blitter;
+	BOOL ret;
+
+	ret = imx_2d_backend_pxp_blitter_submit_pending_job(pxp_blitter);
+	/* Wait even if submitting failed, since
+	 * earlier jobs may still be in progress. */
+	ret = imx_2d_backend_pxp_blitter_wait_for_started_jobs(pxp_blitter) && ret;
+
+	return ret;
 }
 
 
@@ -247,6 +290,15 @@ static int imx_2d_backend_pxp_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 		return FALSE;
 	}
 
+	if (pxp_blitter->job_pending && pxp_blitter->pending_job_accepts_overlay)
+	{
+		if (imx_2d_backend_pxp_blitter_merge_overlay(pxp_blitter, internal_blit_params))
+			return TRUE;
+	}
+
+	if (!imx_2d_backend_pxp_blitter_submit_pending_job(pxp_blitter))
+		return FALSE;
+
 	src_surface_desc = imx_2d_surface_get_desc(internal_blit_params->source);
 	fmt_info = imx_2d_get_pixel_format_info(src_surface_desc->format);
 
@@ -290,6 +342,9 @@ static int imx_2d_backend_pxp_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	pconf->proc_data.bgcolor = internal_blit_params->margin_fill_color;
 	pconf->proc_data.fill_en = 0;
 
+	/* Disable the overlay layer. A width and height of 0 does that. */
+	memset(&(pconf->ol_param[0]), 0, sizeof(struct pxp_layer_param));
+
 	pconf->proc_data.scaling = (pconf->proc_data.srect.width != pconf->proc_data.drect.width)
 	                        || (pconf->proc_data.srect.height != pconf->proc_data.drect.height);
 
@@ -360,23 +415,11 @@ static int imx_2d_backend_pxp_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	}
 	src_param->pixel_fmt = pxp_format;
 
-	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_CONFIG_CHAN, pconf) != 0)
-	{
-		IMX_2D_LOG(ERROR, "could not configure PxP channel: %s", strerror(errno));
-		return FALSE;
-	}
-
-	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_START_CHAN, &(pxp_blitter->pxp_channel.handle)) != 0)
-	{
-		IMX_2D_LOG(ERROR, "could not start PxP channel: %s", strerror(errno));
-		return FALSE;
-	}
-
-	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_WAIT4CMPLT, &(pxp_blitter->pxp_channel)) != 0)
-	{
-		IMX_2D_LOG(ERROR, "could not wait for PxP channel completion: %s", strerror(errno));
-		return FALSE;
-	}
+	/* Keep the job back in case the next blit can be merged into it.
+	 * The PxP rotates and flips the combined output of the S0 and
+	 * overlay layers, so only unrotated jobs can accept an overlay. */
+	pxp_blitter->job_pending = TRUE;
+	pxp_blitter->pending_job_accepts_overlay = (internal_blit_params->rotation == IMX_2D_ROTATION_NONE);
 
 	return TRUE;
 }
@@ -394,6 +437,9 @@ static int imx_2d_backend_pxp_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 		return FALSE;
 	}
 
+	if (!imx_2d_backend_pxp_blitter_submit_pending_job(pxp_blitter))
+		return FALSE;
+
 	dest_region = internal_fill_region_params->dest_region;
 
 	pconf = &(pxp_blitter->pxp_config);
@@ -406,7 +452,32 @@ static int imx_2d_backend_pxp_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 	pconf->proc_data.bgcolor = internal_fill_region_params->fill_color;
 	pconf->proc_data.fill_en = 1;
 
-	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_CONFIG_CHAN, pconf) != 0)
+	memset(&(pconf->ol_param[0]), 0, sizeof(struct pxp_layer_param));
+
+	/* Fill jobs never accept an overlay, so submit right away. */
+	pxp_blitter->job_pending = TRUE;
+	pxp_blitter->pending_job_accepts_overlay = FALSE;
+
+	return imx_2d_backend_pxp_blitter_submit_pending_job(pxp_blitter);
+}
+
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_pxp_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+{
+	IMX_2D_UNUSED_PARAM(blitter);
+	return imx_2d_backend_pxp_get_hardware_capabilities();
+}
+
+
+static BOOL imx_2d_backend_pxp_blitter_submit_pending_job(Imx2dPxPBlitter *pxp_blitter)
+{
+	if (!pxp_blitter->job_pending)
+		return TRUE;
+
+	pxp_blitter->job_pending = FALSE;
+	pxp_blitter->pending_job_accepts_overlay = FALSE;
+
+	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_CONFIG_CHAN, &(pxp_blitter->pxp_config)) != 0)
 	{
 		IMX_2D_LOG(ERROR, "could not configure PxP channel: %s", strerror(errno));
 		return FALSE;
@@ -418,20 +489,118 @@ static int imx_2d_backend_pxp_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 		return FALSE;
 	}
 
-	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_WAIT4CMPLT, &(pxp_blitter->pxp_channel)) != 0)
+	pxp_blitter->num_started_jobs++;
+
+	return TRUE;
+}
+
+
+static BOOL imx_2d_backend_pxp_blitter_wait_for_started_jobs(Imx2dPxPBlitter *pxp_blitter)
+{
+	BOOL ret = TRUE;
+
+	IMX_2D_LOG(TRACE, "waiting for %d started PxP job(s) to complete", pxp_blitter->num_started_jobs);
+
+	/* Each completed job is signaled separately,
+	 * so wait once for each started job. */
+	for (; pxp_blitter->num_started_jobs > 0; pxp_blitter->num_started_jobs--)
 	{
-		IMX_2D_LOG(ERROR, "could not wait for PxP channel completion: %s", strerror(errno));
-		return FALSE;
+		if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_WAIT4CMPLT, &(pxp_blitter->pxp_channel)) != 0)
+		{
+			IMX_2D_LOG(ERROR, "could not wait for PxP channel completion: %s", strerror(errno));
+			ret = FALSE;
+		}
 	}
 
-	return TRUE;
+	return ret;
 }
 
 
-static Imx2dHardwareCapabilities const * imx_2d_backend_pxp_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+/* Tries to render the blit with the overlay layer of the pending job
+ * instead of using a separate job. The overlay layer cannot be scaled,
+ * rotated, or cropped, and the PxP driver always places it in the top
+ * left corner of the output, so this is only possible if the blit does
+ * not require any of these. Such blits are typical for video overlay
+ * compositions that cover the whole frame. Returns FALSE if the blit
+ * cannot be merged; the caller then renders it with its own job. */
+static BOOL imx_2d_backend_pxp_blitter_merge_overlay(Imx2dPxPBlitter *pxp_blitter, Imx2dInternalBlitParams *internal_blit_params)
 {
-	IMX_2D_UNUSED_PARAM(blitter);
-	return imx_2d_backend_pxp_get_hardware_capabilities();
+	Imx2dSurfaceDesc const *src_surface_desc;
+	Imx2dPixelFormatInfo const *fmt_info;
+	Imx2dRegion const *source_region;
+	Imx2dRegion const *dest_region;
+	ImxDmaBuffer *src_dma_buffer;
+	imx_physical_address_t phys_address;
+	unsigned int pxp_format;
+	struct pxp_layer_param *ol_param;
+
+	src_surface_desc = imx_2d_surface_get_desc(internal_blit_params->source);
+	source_region = (internal_blit_params->source_region != NULL) ? internal_blit_params->source_region : &(internal_blit_params->source->region);
+	dest_region = internal_blit_params->dest_region;
+
+	switch (src_surface_desc->format)
+	{
+		case IMX_2D_PIXEL_FORMAT_BGRA8888:
+		case IMX_2D_PIXEL_FORMAT_BGRX8888:
+		case IMX_2D_PIXEL_FORMAT_RGB565:
+			break;
+		default:
+			return FALSE;
+	}
+
+	/* A separate S0 job ignores the blit's global alpha value, so
+	 * only merge opaque blits. Otherwise, the outcome would depend
+	 * on whether or not the blit could be merged. */
+	if ((internal_blit_params->dest_surface_alpha != 255)
+	 || (internal_blit_params->rotation != IMX_2D_ROTATION_NONE)
+	 || (internal_blit_params->expanded_dest_region != NULL)
+	 || (source_region->x1 != 0) || (source_region->y1 != 0)
+	 || (dest_region->x1 != 0) || (dest_region->y1 != 0)
+	 || ((source_region->x2 - source_region->x1) != (dest_region->x2 - dest_region->x1))
+	 || ((source_region->y2 - source_region->y1) != (dest_region->y2 - dest_region->y1)))
+		return FALSE;
+
+	src_dma_buffer = imx_2d_surface_get_dma_buffer(internal_blit_params->source, 0);
+	assert(src_dma_buffer != NULL);
+	phys_address = imx_dma_buffer_get_physical_address(src_dma_buffer);
+	assert(phys_address != 0);
+
+	if (!get_pxp_format(src_surface_desc->format, &pxp_format))
+		return FALSE;
+
+	fmt_info = imx_2d_get_pixel_format_info(src_surface_desc->format);
+
+	IMX_2D_LOG(
+		TRACE,
+		"PxP blitter: merging blit with region %" IMX_2D_REGION_FORMAT " into pending job as overlay layer",
+		IMX_2D_REGION_ARGS(dest_region)
+	);
+
+	ol_param = &(pxp_blitter->pxp_config.ol_param[0]);
+	memset(ol_param, 0, sizeof(struct pxp_layer_param));
+
+	/* The PxP expects the stride in pixels, not bytes. Perform a bytes->pixels conversion. */
+	ol_param->width = dest_region->x2 - dest_region->x1;
+	ol_param->height = dest_region->y2 - dest_region->y1;
+	ol_param->stride = src_surface_desc->plane_strides[0] / fmt_info->pixel_stride;
+	ol_param->pixel_fmt = pxp_format;
+	ol_param->paddr = (dma_addr_t)(phys_address);
+
+	/* A separate S0 job copies the source pixels without blending,
+	 * even if they have per-pixel alpha. Force the overlay to be
+	 * opaque to get the same result. This also keeps the PxP from
+	 * blending with the undefined bits where the alpha channel would
+	 * be in formats without per-pixel alpha. */
+	ol_param->combine_enable = TRUE;
+	ol_param->local_alpha_enable = FALSE;
+	ol_param->global_alpha_enable = TRUE;
+	ol_param->global_override = TRUE;
+	ol_param->global_alpha = 255;
+
+	/* Only one overlay layer is available. */
+	pxp_blitter->pending_job_accepts_overlay = FALSE;
+
+	return TRUE;
 }
 
 
@@ -474,6 +643,10 @@ error:
 }
 
 
+/* The PxP blitter does not blend blits with the destination. Pixels of
+ * sources with per-pixel alpha (BGRA8888) are copied without blending.
+ * This also applies to blits that get merged into a pending job as its
+ * overlay layer, which is made opaque for that reason. */
 static Imx2dHardwareCapabilities const capabilities = {
 	.supported_source_pixel_formats = supported_source_pixel_formats,
 	.num_supported_source_pixel_formats = sizeof(supported_source_pixel_formats) / sizeof(Imx2dPixelFormat),
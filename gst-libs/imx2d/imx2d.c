@@ -248,6 +248,29 @@ Imx2dSurfaceDesc const * imx_2d_surface_get_desc(Imx2dSurface *surface)
 }
 
 
+int imx_2d_surface_desc_check_if_equal(Imx2dSurfaceDesc const *first_desc, Imx2dSurfaceDesc const *second_desc)
+{
+	int i;
+
+	assert(first_desc != NULL);
+	assert(second_desc != NULL);
+
+	if ((first_desc->width != second_desc->width) ||
+	    (first_desc->height != second_desc->height) ||
+	    (first_desc->num_padding_rows != second_desc->num_padding_rows) ||
+	    (first_desc->format != second_desc->format))
+		return FALSE;
+
+	for (i = 0; i < 3; ++i)
+	{
+		if (first_desc->plane_strides[i] != second_desc->plane_strides[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
 void imx_2d_surface_set_dma_buffer(Imx2dSurface *surface, ImxDmaBuffer *dma_buffer, int plane_nr, int offset)
 {
 	assert(surface != NULL);
@@ -116,6 +116,12 @@ struct _Imx2dBlitterClass
 };
 
 
+/* Returns nonzero if both surface descriptions are equal. Backends use
+ * this to check if they can reuse hardware specific descriptions that
+ * they built for an earlier blit operation. */
+int imx_2d_surface_desc_check_if_equal(Imx2dSurfaceDesc const *first_desc, Imx2dSurfaceDesc const *second_desc);
+
+
 #ifdef __cplusplus
 }
 #endif
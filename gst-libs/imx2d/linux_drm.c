@@ -0,0 +1,1381 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm_fourcc.h>
+#include "imx2d.h"
+#include "imx2d_priv.h"
+#include "linux_drm.h"
+
+
+/* Using 3 pages, since while one page is being written to,
+ * one may still be shown, and one may be about to be shown
+ * (its commit is pending until the next vblank). */
+#define NUM_PAGE_FLIPPING_PAGES 3
+
+/* Maximum number of KMS framebuffers that are kept around for
+ * DMA-BUF frames. Buffer pools typically contain much fewer
+ * buffers than this, so all of their frames fit in the cache. */
+#define MAX_NUM_CACHED_FRAMEBUFFERS 16
+
+/* Stride alignment of the pages. 64 bytes satisfy the stride
+ * alignment requirements of all of the imx2d backends. */
+#define PAGE_STRIDE_ALIGNMENT 64
+
+/* How many refresh periods to wait for a page flip event before
+ * giving up. The event normally arrives within one period. */
+#define PAGE_FLIP_TIMEOUT_REFRESH_PERIODS 4
+
+/* Refresh rate that is assumed if the mode does not specify one. */
+#define FALLBACK_REFRESH_RATE 60
+
+
+typedef enum
+{
+	PLANE_PROP_FB_ID = 0,
+	PLANE_PROP_CRTC_ID,
+	PLANE_PROP_SRC_X,
+	PLANE_PROP_SRC_Y,
+	PLANE_PROP_SRC_W,
+	PLANE_PROP_SRC_H,
+	PLANE_PROP_CRTC_X,
+	PLANE_PROP_CRTC_Y,
+	PLANE_PROP_CRTC_W,
+	PLANE_PROP_CRTC_H,
+
+	NUM_PLANE_PROPS
+}
+PlaneProp;
+
+static char const * const plane_prop_names[NUM_PLANE_PROPS] = {
+	"FB_ID",
+	"CRTC_ID",
+	"SRC_X",
+	"SRC_Y",
+	"SRC_W",
+	"SRC_H",
+	"CRTC_X",
+	"CRTC_Y",
+	"CRTC_W",
+	"CRTC_H"
+};
+
+
+typedef struct
+{
+	ImxDmaBuffer *dma_buffer;
+	uint32_t gem_handle;
+	uint32_t fb_id;
+}
+Imx2dLinuxDrmPage;
+
+
+typedef struct
+{
+	uint32_t fb_id;
+	uint32_t gem_handles[3];
+	int num_planes;
+
+	uint32_t drm_format;
+	int width, height;
+	int plane_strides[3];
+	int plane_offsets[3];
+
+	/* Used for finding the least recently used entry. */
+	unsigned long last_use;
+}
+Imx2dLinuxDrmCachedFramebuffer;
+
+
+typedef struct
+{
+	BOOL valid;
+	uint32_t drm_format;
+	int width, height;
+	Imx2dRegion source_region;
+	Imx2dRegion dest_region;
+	BOOL supported;
+}
+Imx2dLinuxDrmScanoutTest;
+
+
+struct _Imx2dLinuxDrm
+{
+	int fd;
+
+	uint32_t connector_id;
+	uint32_t crtc_id;
+	uint32_t plane_id;
+
+	drmModeModeInfo mode;
+	uint32_t mode_blob_id;
+
+	/* The CRTC configuration that was present before the
+	 * output was created. Restored when it is destroyed. */
+	drmModeCrtc *saved_crtc;
+
+	uint32_t plane_prop_ids[NUM_PLANE_PROPS];
+	uint32_t crtc_active_prop_id;
+	uint32_t crtc_mode_id_prop_id;
+	uint32_t connector_crtc_id_prop_id;
+
+	BOOL modeset_done;
+	BOOL page_flip_pending;
+
+	/* Pipe used by imx_2d_linux_drm_unlock() to wake up
+	 * imx_2d_linux_drm_wait_for_page_flip(). While the
+	 * read end contains data, waits return right away. */
+	int control_pipe_fds[2];
+
+	ImxDmaBufferAllocator *dma_buffer_allocator;
+	Imx2dLinuxDrmPage pages[NUM_PAGE_FLIPPING_PAGES];
+	int num_pages;
+	Imx2dSurface *surface;
+
+	uint32_t page_drm_format;
+
+	/* The framebuffers that are currently scanned out or
+	 * about to be scanned out. These must not be removed. */
+	uint32_t displayed_fb_id;
+	uint32_t pending_fb_id;
+
+	Imx2dLinuxDrmCachedFramebuffer cached_framebuffers[MAX_NUM_CACHED_FRAMEBUFFERS];
+	int num_cached_framebuffers;
+	unsigned long use_counter;
+
+	Imx2dLinuxDrmScanoutTest last_scanout_test;
+};
+
+
+static uint32_t imx_2d_linux_drm_get_drm_format(Imx2dPixelFormat format);
+static BOOL imx_2d_linux_drm_plane_supports_format(drmModePlane const *plane, uint32_t drm_format);
+static uint32_t imx_2d_linux_drm_find_property_id(int fd, uint32_t object_id, uint32_t object_type, char const *name);
+static uint64_t imx_2d_linux_drm_get_property_value(int fd, uint32_t object_id, uint32_t object_type, char const *name, uint64_t default_value);
+static BOOL imx_2d_linux_drm_select_connector_and_crtc(Imx2dLinuxDrm *linux_drm, uint32_t connector_id);
+static BOOL imx_2d_linux_drm_select_plane(Imx2dLinuxDrm *linux_drm, uint32_t plane_id);
+static BOOL imx_2d_linux_drm_allocate_pages(Imx2dLinuxDrm *linux_drm, Imx2dPixelFormat format, int num_pages);
+static void imx_2d_linux_drm_free_pages(Imx2dLinuxDrm *linux_drm);
+static void imx_2d_linux_drm_add_plane_props(Imx2dLinuxDrm *linux_drm, drmModeAtomicReq *req, uint32_t fb_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region);
+static int imx_2d_linux_drm_commit(Imx2dLinuxDrm *linux_drm, uint32_t fb_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, BOOL test_only);
+static void imx_2d_linux_drm_page_flip_handler(int fd, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, void *user_data);
+static uint32_t imx_2d_linux_drm_get_framebuffer_for_frame(Imx2dLinuxDrm *linux_drm, Imx2dLinuxDrmDmaBufFrame const *frame, uint32_t drm_format, int num_planes);
+static void imx_2d_linux_drm_remove_cached_framebuffer(Imx2dLinuxDrm *linux_drm, int index);
+
+
+static uint32_t imx_2d_linux_drm_get_drm_format(Imx2dPixelFormat format)
+{
+	/* imx2d pixel format names describe the order of the components
+	 * in memory, while DRM fourCCs describe the order of the components
+	 * in a little endian word, from the most to the least significant
+	 * bits. This is why for example BGRX8888 maps to DRM XRGB8888. */
+	switch (format)
+	{
+		case IMX_2D_PIXEL_FORMAT_RGB565: return DRM_FORMAT_RGB565;
+		case IMX_2D_PIXEL_FORMAT_BGR565: return DRM_FORMAT_BGR565;
+		case IMX_2D_PIXEL_FORMAT_RGB888: return DRM_FORMAT_BGR888;
+		case IMX_2D_PIXEL_FORMAT_BGR888: return DRM_FORMAT_RGB888;
+		case IMX_2D_PIXEL_FORMAT_RGBX8888: return DRM_FORMAT_XBGR8888;
+		case IMX_2D_PIXEL_FORMAT_RGBA8888: return DRM_FORMAT_ABGR8888;
+		case IMX_2D_PIXEL_FORMAT_BGRX8888: return DRM_FORMAT_XRGB8888;
+		case IMX_2D_PIXEL_FORMAT_BGRA8888: return DRM_FORMAT_ARGB8888;
+		case IMX_2D_PIXEL_FORMAT_XRGB8888: return DRM_FORMAT_BGRX8888;
+		case IMX_2D_PIXEL_FORMAT_ARGB8888: return DRM_FORMAT_BGRA8888;
+		case IMX_2D_PIXEL_FORMAT_XBGR8888: return DRM_FORMAT_RGBX8888;
+		case IMX_2D_PIXEL_FORMAT_ABGR8888: return DRM_FORMAT_RGBA8888;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_UYVY: return DRM_FORMAT_UYVY;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YUYV: return DRM_FORMAT_YUYV;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YVYU: return DRM_FORMAT_YVYU;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_VYUY: return DRM_FORMAT_VYUY;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12: return DRM_FORMAT_NV12;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21: return DRM_FORMAT_NV21;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV16: return DRM_FORMAT_NV16;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV61: return DRM_FORMAT_NV61;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_YV12: return DRM_FORMAT_YVU420;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_I420: return DRM_FORMAT_YUV420;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y42B: return DRM_FORMAT_YUV422;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y444: return DRM_FORMAT_YUV444;
+		/* Tiled formats would require format modifiers. */
+		default: return 0;
+	}
+}
+
+
+static BOOL imx_2d_linux_drm_plane_supports_format(drmModePlane const *plane, uint32_t drm_format)
+{
+	uint32_t i;
+
+	for (i = 0; i < plane->count_formats; ++i)
+	{
+		if (plane->formats[i] == drm_format)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+static uint32_t imx_2d_linux_drm_find_property_id(int fd, uint32_t object_id, uint32_t object_type, char const *name)
+{
+	drmModeObjectProperties *props;
+	uint32_t prop_id = 0;
+	uint32_t i;
+
+	props = drmModeObjectGetProperties(fd, object_id, object_type);
+	if (props == NULL)
+		return 0;
+
+	for (i = 0; (i < props->count_props) && (prop_id == 0); ++i)
+	{
+		drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+		if (prop == NULL)
+			continue;
+
+		if (strcmp(prop->name, name) == 0)
+			prop_id = prop->prop_id;
+
+		drmModeFreeProperty(prop);
+	}
+
+	drmModeFreeObjectProperties(props);
+
+	return prop_id;
+}
+
+
+static uint64_t imx_2d_linux_drm_get_property_value(int fd, uint32_t object_id, uint32_t object_type, char const *name, uint64_t default_value)
+{
+	drmModeObjectProperties *props;
+	uint64_t value = default_value;
+	uint32_t i;
+
+	props = drmModeObjectGetProperties(fd, object_id, object_type);
+	if (props == NULL)
+		return value;
+
+	for (i = 0; i < props->count_props; ++i)
+	{
+		drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+		if (prop == NULL)
+			continue;
+
+		if (strcmp(prop->name, name) == 0)
+		{
+			value = props->prop_values[i];
+			drmModeFreeProperty(prop);
+			break;
+		}
+
+		drmModeFreeProperty(prop);
+	}
+
+	drmModeFreeObjectProperties(props);
+
+	return value;
+}
+
+
+static BOOL imx_2d_linux_drm_select_connector_and_crtc(Imx2dLinuxDrm *linux_drm, uint32_t connector_id)
+{
+	drmModeRes *resources;
+	drmModeConnector *connector = NULL;
+	drmModeEncoder *encoder = NULL;
+	BOOL ret = FALSE;
+	int i, j;
+
+	resources = drmModeGetResources(linux_drm->fd);
+	if (resources == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM resources: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	/* Find the connector. */
+
+	for (i = 0; i < resources->count_connectors; ++i)
+	{
+		connector = drmModeGetConnector(linux_drm->fd, resources->connectors[i]);
+		if (connector == NULL)
+			continue;
+
+		if (connector_id != 0)
+		{
+			if (connector->connector_id == connector_id)
+				break;
+		}
+		else if ((connector->connection == DRM_MODE_CONNECTED) && (connector->count_modes > 0))
+			break;
+
+		drmModeFreeConnector(connector);
+		connector = NULL;
+	}
+
+	if (connector == NULL)
+	{
+		if (connector_id != 0)
+			IMX_2D_LOG(ERROR, "DRM connector %" PRIu32 " not found", connector_id);
+		else
+			IMX_2D_LOG(ERROR, "no connected DRM connector found");
+		goto finish;
+	}
+
+	if ((connector->connection != DRM_MODE_CONNECTED) || (connector->count_modes <= 0))
+	{
+		IMX_2D_LOG(ERROR, "DRM connector %" PRIu32 " is not connected or has no modes", connector->connector_id);
+		goto finish;
+	}
+
+	linux_drm->connector_id = connector->connector_id;
+
+	/* Find the CRTC. Prefer the one that currently drives the connector,
+	 * since this avoids a full modeset. Otherwise, pick the first CRTC
+	 * that can be driven by one of the connector's encoders. */
+
+	linux_drm->crtc_id = 0;
+
+	if (connector->encoder_id != 0)
+	{
+		encoder = drmModeGetEncoder(linux_drm->fd, connector->encoder_id);
+		if (encoder != NULL)
+		{
+			linux_drm->crtc_id = encoder->crtc_id;
+			drmModeFreeEncoder(encoder);
+			encoder = NULL;
+		}
+	}
+
+	for (i = 0; (i < connector->count_encoders) && (linux_drm->crtc_id == 0); ++i)
+	{
+		encoder = drmModeGetEncoder(linux_drm->fd, connector->encoders[i]);
+		if (encoder == NULL)
+			continue;
+
+		for (j = 0; j < resources->count_crtcs; ++j)
+		{
+			if (encoder->possible_crtcs & (1u << j))
+			{
+				linux_drm->crtc_id = resources->crtcs[j];
+				break;
+			}
+		}
+
+		drmModeFreeEncoder(encoder);
+		encoder = NULL;
+	}
+
+	if (linux_drm->crtc_id == 0)
+	{
+		IMX_2D_LOG(ERROR, "could not find a CRTC for DRM connector %" PRIu32, linux_drm->connector_id);
+		goto finish;
+	}
+
+	/* Pick the mode. Retain the CRTC's current mode if it has one. */
+
+	linux_drm->saved_crtc = drmModeGetCrtc(linux_drm->fd, linux_drm->crtc_id);
+
+	if ((linux_drm->saved_crtc != NULL) && linux_drm->saved_crtc->mode_valid)
+	{
+		memcpy(&(linux_drm->mode), &(linux_drm->saved_crtc->mode), sizeof(drmModeModeInfo));
+	}
+	else
+	{
+		memcpy(&(linux_drm->mode), &(connector->modes[0]), sizeof(drmModeModeInfo));
+
+		for (i = 0; i < connector->count_modes; ++i)
+		{
+			if (connector->modes[i].type & DRM_MODE_TYPE_PREFERRED)
+			{
+				memcpy(&(linux_drm->mode), &(connector->modes[i]), sizeof(drmModeModeInfo));
+				break;
+			}
+		}
+	}
+
+	IMX_2D_LOG(
+		INFO,
+		"using DRM connector %" PRIu32 " CRTC %" PRIu32 " mode \"%s\" (%ux%u @ %u Hz)",
+		linux_drm->connector_id,
+		linux_drm->crtc_id,
+		linux_drm->mode.name,
+		(unsigned int)(linux_drm->mode.hdisplay),
+		(unsigned int)(linux_drm->mode.vdisplay),
+		(unsigned int)(linux_drm->mode.vrefresh)
+	);
+
+	ret = TRUE;
+
+finish:
+	if (connector != NULL)
+		drmModeFreeConnector(connector);
+	drmModeFreeResources(resources);
+
+	return ret;
+}
+
+
+static BOOL imx_2d_linux_drm_select_plane(Imx2dLinuxDrm *linux_drm, uint32_t plane_id)
+{
+	drmModeRes *resources;
+	drmModePlaneRes *plane_resources;
+	int crtc_index = -1;
+	BOOL ret = FALSE;
+	uint32_t i;
+	int j;
+
+	resources = drmModeGetResources(linux_drm->fd);
+	if (resources == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM resources: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	for (j = 0; j < resources->count_crtcs; ++j)
+	{
+		if (resources->crtcs[j] == linux_drm->crtc_id)
+		{
+			crtc_index = j;
+			break;
+		}
+	}
+
+	drmModeFreeResources(resources);
+
+	if (crtc_index < 0)
+	{
+		IMX_2D_LOG(ERROR, "DRM CRTC %" PRIu32 " not found in resources", linux_drm->crtc_id);
+		return FALSE;
+	}
+
+	plane_resources = drmModeGetPlaneResources(linux_drm->fd);
+	if (plane_resources == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM plane resources: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	linux_drm->plane_id = 0;
+
+	for (i = 0; i < plane_resources->count_planes; ++i)
+	{
+		drmModePlane *plane = drmModeGetPlane(linux_drm->fd, plane_resources->planes[i]);
+		BOOL plane_found = FALSE;
+
+		if (plane == NULL)
+			continue;
+
+		if (plane->possible_crtcs & (1u << crtc_index))
+		{
+			if (plane_id != 0)
+			{
+				plane_found = (plane->plane_id == plane_id);
+			}
+			else
+			{
+				uint64_t plane_type = imx_2d_linux_drm_get_property_value(linux_drm->fd, plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", DRM_PLANE_TYPE_OVERLAY);
+				plane_found = (plane_type == DRM_PLANE_TYPE_PRIMARY);
+			}
+		}
+
+		drmModeFreePlane(plane);
+
+		if (plane_found)
+		{
+			linux_drm->plane_id = plane_resources->planes[i];
+			break;
+		}
+	}
+
+	if (linux_drm->plane_id == 0)
+	{
+		if (plane_id != 0)
+			IMX_2D_LOG(ERROR, "DRM plane %" PRIu32 " not found or cannot be used with CRTC %" PRIu32, plane_id, linux_drm->crtc_id);
+		else
+			IMX_2D_LOG(ERROR, "no primary DRM plane found for CRTC %" PRIu32, linux_drm->crtc_id);
+		goto finish;
+	}
+
+	for (j = 0; j < NUM_PLANE_PROPS; ++j)
+	{
+		linux_drm->plane_prop_ids[j] = imx_2d_linux_drm_find_property_id(linux_drm->fd, linux_drm->plane_id, DRM_MODE_OBJECT_PLANE, plane_prop_names[j]);
+		if (linux_drm->plane_prop_ids[j] == 0)
+		{
+			IMX_2D_LOG(ERROR, "DRM plane %" PRIu32 " has no \"%s\" property", linux_drm->plane_id, plane_prop_names[j]);
+			goto finish;
+		}
+	}
+
+	IMX_2D_LOG(INFO, "using DRM plane %" PRIu32, linux_drm->plane_id);
+
+	ret = TRUE;
+
+finish:
+	drmModeFreePlaneResources(plane_resources);
+	return ret;
+}
+
+
+static BOOL imx_2d_linux_drm_allocate_pages(Imx2dLinuxDrm *linux_drm, Imx2dPixelFormat format, int num_pages)
+{
+	int page_index;
+	int error;
+	int width = linux_drm->mode.hdisplay;
+	int height = linux_drm->mode.vdisplay;
+	Imx2dPixelFormatInfo const *format_info = imx_2d_get_pixel_format_info(format);
+	int stride;
+	size_t page_size;
+	Imx2dSurfaceDesc desc;
+
+	assert(format_info != NULL);
+
+	stride = width * format_info->pixel_stride;
+	stride = (stride + (PAGE_STRIDE_ALIGNMENT - 1)) / PAGE_STRIDE_ALIGNMENT * PAGE_STRIDE_ALIGNMENT;
+	page_size = (size_t)stride * height;
+
+	linux_drm->dma_buffer_allocator = imx_dma_buffer_allocator_new(&error);
+	if (linux_drm->dma_buffer_allocator == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not create DMA buffer allocator: %s (%d)", strerror(error), error);
+		return FALSE;
+	}
+
+	/* The pages are allocated with libimxdmabuffer instead of as DRM
+	 * dumb buffers, since the imx2d backends need physical addresses,
+	 * which dumb buffers do not provide. The pages are then imported
+	 * into DRM by using their DMA-BUF FDs. */
+	for (page_index = 0; page_index < num_pages; ++page_index)
+	{
+		Imx2dLinuxDrmPage *page = &(linux_drm->pages[page_index]);
+		uint32_t handles[4] = { 0, 0, 0, 0 };
+		uint32_t pitches[4] = { 0, 0, 0, 0 };
+		uint32_t offsets[4] = { 0, 0, 0, 0 };
+		uint8_t *mapped_page;
+		int dmabuf_fd;
+
+		page->dma_buffer = imx_dma_buffer_allocate(linux_drm->dma_buffer_allocator, page_size, PAGE_STRIDE_ALIGNMENT, &error);
+		if (page->dma_buffer == NULL)
+		{
+			IMX_2D_LOG(ERROR, "could not allocate DMA buffer for page %d: %s (%d)", page_index, strerror(error), error);
+			return FALSE;
+		}
+
+		/* Clear the page to black. */
+		mapped_page = imx_dma_buffer_map(page->dma_buffer, IMX_DMA_BUFFER_MAPPING_FLAG_WRITE, &error);
+		if (mapped_page == NULL)
+		{
+			IMX_2D_LOG(ERROR, "could not map DMA buffer for page %d: %s (%d)", page_index, strerror(error), error);
+			return FALSE;
+		}
+		memset(mapped_page, 0, page_size);
+		imx_dma_buffer_unmap(page->dma_buffer);
+
+		dmabuf_fd = imx_dma_buffer_get_fd(page->dma_buffer);
+		if (dmabuf_fd < 0)
+		{
+			IMX_2D_LOG(ERROR, "DMA buffer for page %d has no DMA-BUF FD; the DMA buffer allocator cannot be used for DRM output", page_index);
+			return FALSE;
+		}
+
+		if (drmPrimeFDToHandle(linux_drm->fd, dmabuf_fd, &(page->gem_handle)) != 0)
+		{
+			IMX_2D_LOG(ERROR, "could not import DMA-BUF of page %d into DRM: %s (%d)", page_index, strerror(errno), errno);
+			return FALSE;
+		}
+
+		handles[0] = page->gem_handle;
+		pitches[0] = stride;
+
+		if (drmModeAddFB2(linux_drm->fd, width, height, linux_drm->page_drm_format, handles, pitches, offsets, &(page->fb_id), 0) != 0)
+		{
+			IMX_2D_LOG(ERROR, "could not add DRM framebuffer for page %d: %s (%d)", page_index, strerror(errno), errno);
+			return FALSE;
+		}
+	}
+
+	linux_drm->num_pages = num_pages;
+
+	memset(&desc, 0, sizeof(desc));
+	desc.width = width;
+	desc.height = height;
+	desc.format = format;
+	desc.plane_strides[0] = stride;
+	desc.num_padding_rows = 0;
+
+	IMX_2D_LOG(
+		DEBUG,
+		"DRM page surface desc: width: %d height: %d stride: %d format: %s num pages: %d",
+		desc.width, desc.height,
+		desc.plane_strides[0],
+		imx_2d_pixel_format_to_string(desc.format),
+		num_pages
+	);
+
+	linux_drm->surface = imx_2d_surface_create(&desc);
+	if (linux_drm->surface == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not create DRM page surface");
+		return FALSE;
+	}
+
+	imx_2d_surface_set_dma_buffer(linux_drm->surface, linux_drm->pages[0].dma_buffer, 0, 0);
+
+	return TRUE;
+}
+
+
+static void imx_2d_linux_drm_free_pages(Imx2dLinuxDrm *linux_drm)
+{
+	int page_index;
+
+	if (linux_drm->surface != NULL)
+	{
+		imx_2d_surface_destroy(linux_drm->surface);
+		linux_drm->surface = NULL;
+	}
+
+	for (page_index = 0; page_index < NUM_PAGE_FLIPPING_PAGES; ++page_index)
+	{
+		Imx2dLinuxDrmPage *page = &(linux_drm->pages[page_index]);
+
+		if (page->fb_id != 0)
+			drmModeRmFB(linux_drm->fd, page->fb_id);
+
+		if (page->gem_handle != 0)
+		{
+			struct drm_gem_close gem_close;
+			memset(&gem_close, 0, sizeof(gem_close));
+			gem_close.handle = page->gem_handle;
+			drmIoctl(linux_drm->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+		}
+
+		if (page->dma_buffer != NULL)
+			imx_dma_buffer_deallocate(page->dma_buffer);
+
+		memset(page, 0, sizeof(Imx2dLinuxDrmPage));
+	}
+
+	if (linux_drm->dma_buffer_allocator != NULL)
+	{
+		imx_dma_buffer_allocator_destroy(linux_drm->dma_buffer_allocator);
+		linux_drm->dma_buffer_allocator = NULL;
+	}
+}
+
+
+static void imx_2d_linux_drm_add_plane_props(Imx2dLinuxDrm *linux_drm, drmModeAtomicReq *req, uint32_t fb_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region)
+{
+	uint32_t const *ids = linux_drm->plane_prop_ids;
+	uint32_t plane_id = linux_drm->plane_id;
+
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_FB_ID], fb_id);
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_CRTC_ID], linux_drm->crtc_id);
+
+	/* The SRC_* properties use 16.16 fixed point values. */
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_SRC_X], ((uint64_t)(source_region->x1)) << 16);
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_SRC_Y], ((uint64_t)(source_region->y1)) << 16);
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_SRC_W], ((uint64_t)(source_region->x2 - source_region->x1)) << 16);
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_SRC_H], ((uint64_t)(source_region->y2 - source_region->y1)) << 16);
+
+	/* CRTC_X and CRTC_Y are signed values. */
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_CRTC_X], (uint64_t)(int64_t)(dest_region->x1));
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_CRTC_Y], (uint64_t)(int64_t)(dest_region->y1));
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_CRTC_W], dest_region->x2 - dest_region->x1);
+	drmModeAtomicAddProperty(req, plane_id, ids[PLANE_PROP_CRTC_H], dest_region->y2 - dest_region->y1);
+}
+
+
+/* Returns 0 on success, or a negative errno value on failure. */
+static int imx_2d_linux_drm_commit(Imx2dLinuxDrm *linux_drm, uint32_t fb_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, BOOL test_only)
+{
+	drmModeAtomicReq *req;
+	uint32_t flags;
+	int ret;
+
+	req = drmModeAtomicAlloc();
+	assert(req != NULL);
+
+	if (!linux_drm->modeset_done)
+	{
+		drmModeAtomicAddProperty(req, linux_drm->connector_id, linux_drm->connector_crtc_id_prop_id, linux_drm->crtc_id);
+		drmModeAtomicAddProperty(req, linux_drm->crtc_id, linux_drm->crtc_mode_id_prop_id, linux_drm->mode_blob_id);
+		drmModeAtomicAddProperty(req, linux_drm->crtc_id, linux_drm->crtc_active_prop_id, 1);
+		flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+	}
+	else
+		flags = DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+
+	imx_2d_linux_drm_add_plane_props(linux_drm, req, fb_id, source_region, dest_region);
+
+	if (test_only)
+		flags = (flags & DRM_MODE_ATOMIC_ALLOW_MODESET) | DRM_MODE_ATOMIC_TEST_ONLY;
+
+	ret = drmModeAtomicCommit(linux_drm->fd, req, flags, linux_drm);
+	if (ret != 0)
+		ret = -errno;
+
+	drmModeAtomicFree(req);
+
+	if ((ret == 0) && !test_only)
+	{
+		if (linux_drm->modeset_done)
+		{
+			linux_drm->page_flip_pending = TRUE;
+			linux_drm->pending_fb_id = fb_id;
+		}
+		else
+		{
+			/* The modeset commit is blocking, so the
+			 * framebuffer is shown once it finishes. */
+			linux_drm->modeset_done = TRUE;
+			linux_drm->displayed_fb_id = fb_id;
+		}
+	}
+
+	return ret;
+}
+
+
+static void imx_2d_linux_drm_page_flip_handler(int fd, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, void *user_data)
+{
+	Imx2dLinuxDrm *linux_drm = (Imx2dLinuxDrm *)user_data;
+
+	IMX_2D_UNUSED_PARAM(fd);
+	IMX_2D_UNUSED_PARAM(sequence);
+	IMX_2D_UNUSED_PARAM(tv_sec);
+	IMX_2D_UNUSED_PARAM(tv_usec);
+
+	/* The event of a flip that already timed out may still arrive
+	 * later. The framebuffer was already marked as displayed then
+	 * (see imx_2d_linux_drm_wait_for_page_flip()), so ignore it. */
+	if (!linux_drm->page_flip_pending)
+		return;
+
+	linux_drm->page_flip_pending = FALSE;
+	linux_drm->displayed_fb_id = linux_drm->pending_fb_id;
+	linux_drm->pending_fb_id = 0;
+}
+
+
+static uint32_t imx_2d_linux_drm_get_framebuffer_for_frame(Imx2dLinuxDrm *linux_drm, Imx2dLinuxDrmDmaBufFrame const *frame, uint32_t drm_format, int num_planes)
+{
+	uint32_t gem_handles[3] = { 0, 0, 0 };
+	uint32_t handles[4] = { 0, 0, 0, 0 };
+	uint32_t pitches[4] = { 0, 0, 0, 0 };
+	uint32_t offsets[4] = { 0, 0, 0, 0 };
+	Imx2dLinuxDrmCachedFramebuffer *entry;
+	int plane_index;
+	int i;
+
+	/* Importing the same DMA-BUF again always yields the same GEM handle,
+	 * so the GEM handles identify the DMA-BUFs, even if their FDs differ. */
+	for (plane_index = 0; plane_index < num_planes; ++plane_index)
+	{
+		if (drmPrimeFDToHandle(linux_drm->fd, frame->dmabuf_fds[plane_index], &(gem_handles[plane_index])) != 0)
+		{
+			IMX_2D_LOG(DEBUG, "could not import DMA-BUF FD %d into DRM: %s (%d)", frame->dmabuf_fds[plane_index], strerror(errno), errno);
+			goto error;
+		}
+	}
+
+	for (i = 0; i < linux_drm->num_cached_framebuffers; ++i)
+	{
+		entry = &(linux_drm->cached_framebuffers[i]);
+
+		if ((entry->drm_format != drm_format) || (entry->width != frame->width) || (entry->height != frame->height) || (entry->num_planes != num_planes))
+			continue;
+
+		for (plane_index = 0; plane_index < num_planes; ++plane_index)
+		{
+			if ((entry->gem_handles[plane_index] != gem_handles[plane_index])
+			 || (entry->plane_strides[plane_index] != frame->plane_strides[plane_index])
+			 || (entry->plane_offsets[plane_index] != frame->plane_offsets[plane_index]))
+				break;
+		}
+
+		if (plane_index == num_planes)
+		{
+			entry->last_use = ++(linux_drm->use_counter);
+			return entry->fb_id;
+		}
+	}
+
+	/* Not in the cache. Make room by removing the least recently used
+	 * framebuffer that is neither being shown nor about to be shown. */
+	if (linux_drm->num_cached_framebuffers == MAX_NUM_CACHED_FRAMEBUFFERS)
+	{
+		int lru_index = -1;
+
+		for (i = 0; i < linux_drm->num_cached_framebuffers; ++i)
+		{
+			entry = &(linux_drm->cached_framebuffers[i]);
+
+			if ((entry->fb_id == linux_drm->displayed_fb_id) || (entry->fb_id == linux_drm->pending_fb_id))
+				continue;
+
+			if ((lru_index < 0) || (entry->last_use < linux_drm->cached_framebuffers[lru_index].last_use))
+				lru_index = i;
+		}
+
+		assert(lru_index >= 0);
+		imx_2d_linux_drm_remove_cached_framebuffer(linux_drm, lru_index);
+	}
+
+	entry = &(linux_drm->cached_framebuffers[linux_drm->num_cached_framebuffers]);
+	memset(entry, 0, sizeof(Imx2dLinuxDrmCachedFramebuffer));
+
+	for (plane_index = 0; plane_index < num_planes; ++plane_index)
+	{
+		handles[plane_index] = gem_handles[plane_index];
+		pitches[plane_index] = frame->plane_strides[plane_index];
+		offsets[plane_index] = frame->plane_offsets[plane_index];
+	}
+
+	if (drmModeAddFB2(linux_drm->fd, frame->width, frame->height, drm_format, handles, pitches, offsets, &(entry->fb_id), 0) != 0)
+	{
+		IMX_2D_LOG(DEBUG, "could not add DRM framebuffer for DMA-BUF frame: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	memcpy(entry->gem_handles, gem_handles, sizeof(gem_handles));
+	entry->num_planes = num_planes;
+	entry->drm_format = drm_format;
+	entry->width = frame->width;
+	entry->height = frame->height;
+	memcpy(entry->plane_strides, frame->plane_strides, sizeof(entry->plane_strides));
+	memcpy(entry->plane_offsets, frame->plane_offsets, sizeof(entry->plane_offsets));
+	entry->last_use = ++(linux_drm->use_counter);
+
+	linux_drm->num_cached_framebuffers++;
+
+	IMX_2D_LOG(DEBUG, "added DRM framebuffer %" PRIu32 " for DMA-BUF frame; %d framebuffer(s) cached", entry->fb_id, linux_drm->num_cached_framebuffers);
+
+	return entry->fb_id;
+
+error:
+	/* Close GEM handles that are not used by cached framebuffers. */
+	for (plane_index = 0; plane_index < num_planes; ++plane_index)
+	{
+		BOOL handle_in_use = FALSE;
+
+		if (gem_handles[plane_index] == 0)
+			continue;
+
+		for (i = 0; (i < linux_drm->num_cached_framebuffers) && !handle_in_use; ++i)
+		{
+			int j;
+			entry = &(linux_drm->cached_framebuffers[i]);
+			for (j = 0; j < entry->num_planes; ++j)
+				handle_in_use = handle_in_use || (entry->gem_handles[j] == gem_handles[plane_index]);
+		}
+
+		for (i = 0; (i < plane_index) && !handle_in_use; ++i)
+			handle_in_use = (gem_handles[i] == gem_handles[plane_index]);
+
+		if (!handle_in_use)
+		{
+			struct drm_gem_close gem_close;
+			memset(&gem_close, 0, sizeof(gem_close));
+			gem_close.handle = gem_handles[plane_index];
+			drmIoctl(linux_drm->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+		}
+	}
+
+	return 0;
+}
+
+
+static void imx_2d_linux_drm_remove_cached_framebuffer(Imx2dLinuxDrm *linux_drm, int index)
+{
+	Imx2dLinuxDrmCachedFramebuffer removed_entry;
+	int plane_index, i, j;
+
+	assert((index >= 0) && (index < linux_drm->num_cached_framebuffers));
+
+	memcpy(&removed_entry, &(linux_drm->cached_framebuffers[index]), sizeof(Imx2dLinuxDrmCachedFramebuffer));
+
+	/* Fill the gap with the last entry. */
+	linux_drm->num_cached_framebuffers--;
+	if (index != linux_drm->num_cached_framebuffers)
+		memcpy(&(linux_drm->cached_framebuffers[index]), &(linux_drm->cached_framebuffers[linux_drm->num_cached_framebuffers]), sizeof(Imx2dLinuxDrmCachedFramebuffer));
+
+	drmModeRmFB(linux_drm->fd, removed_entry.fb_id);
+
+	/* Planes may share GEM handles, and so may other cached
+	 * framebuffers. Only close handles that are unused now. */
+	for (plane_index = 0; plane_index < removed_entry.num_planes; ++plane_index)
+	{
+		uint32_t handle = removed_entry.gem_handles[plane_index];
+		BOOL handle_in_use = FALSE;
+
+		for (j = 0; (j < plane_index) && !handle_in_use; ++j)
+			handle_in_use = (removed_entry.gem_handles[j] == handle);
+
+		for (i = 0; (i < linux_drm->num_cached_framebuffers) && !handle_in_use; ++i)
+		{
+			Imx2dLinuxDrmCachedFramebuffer const *entry = &(linux_drm->cached_framebuffers[i]);
+			for (j = 0; j < entry->num_planes; ++j)
+				handle_in_use = handle_in_use || (entry->gem_handles[j] == handle);
+		}
+
+		if (!handle_in_use)
+		{
+			struct drm_gem_close gem_close;
+			memset(&gem_close, 0, sizeof(gem_close));
+			gem_close.handle = handle;
+			drmIoctl(linux_drm->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+		}
+	}
+}
+
+
+Imx2dLinuxDrm* imx_2d_linux_drm_create(char const *device_name, uint32_t connector_id, uint32_t plane_id, int enable_page_flipping)
+{
+	Imx2dLinuxDrm *linux_drm;
+	drmModePlane *plane = NULL;
+	Imx2dPixelFormat page_format = IMX_2D_PIXEL_FORMAT_UNKNOWN;
+	Imx2dRegion full_region;
+	int ret;
+
+	/* Page formats to try, in order of preference. */
+	static Imx2dPixelFormat const page_formats[] = {
+		IMX_2D_PIXEL_FORMAT_BGRX8888,
+		IMX_2D_PIXEL_FORMAT_RGBX8888,
+		IMX_2D_PIXEL_FORMAT_RGB565
+	};
+	size_t i;
+
+	assert(device_name != NULL);
+	assert(device_name[0] != '\0');
+
+	linux_drm = malloc(sizeof(Imx2dLinuxDrm));
+	assert(linux_drm != NULL);
+
+	memset(linux_drm, 0, sizeof(Imx2dLinuxDrm));
+	linux_drm->control_pipe_fds[0] = -1;
+	linux_drm->control_pipe_fds[1] = -1;
+
+	if (pipe(linux_drm->control_pipe_fds) < 0)
+	{
+		IMX_2D_LOG(ERROR, "could not create control pipe: %s (%d)", strerror(errno), errno);
+		linux_drm->control_pipe_fds[0] = -1;
+		linux_drm->control_pipe_fds[1] = -1;
+		linux_drm->fd = -1;
+		goto error;
+	}
+
+	linux_drm->fd = open(device_name, O_RDWR | O_CLOEXEC, 0);
+	if (linux_drm->fd < 0)
+	{
+		IMX_2D_LOG(ERROR, "could not open DRM device \"%s\": %s (%d)", device_name, strerror(errno), errno);
+		goto error;
+	}
+
+	if (drmSetClientCap(linux_drm->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0)
+	{
+		IMX_2D_LOG(ERROR, "DRM device \"%s\" does not support universal planes", device_name);
+		goto error;
+	}
+
+	if (drmSetClientCap(linux_drm->fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0)
+	{
+		IMX_2D_LOG(ERROR, "DRM device \"%s\" does not support atomic modesetting", device_name);
+		goto error;
+	}
+
+	if (!imx_2d_linux_drm_select_connector_and_crtc(linux_drm, connector_id))
+		goto error;
+
+	if (!imx_2d_linux_drm_select_plane(linux_drm, plane_id))
+		goto error;
+
+	linux_drm->crtc_active_prop_id = imx_2d_linux_drm_find_property_id(linux_drm->fd, linux_drm->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+	linux_drm->crtc_mode_id_prop_id = imx_2d_linux_drm_find_property_id(linux_drm->fd, linux_drm->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+	linux_drm->connector_crtc_id_prop_id = imx_2d_linux_drm_find_property_id(linux_drm->fd, linux_drm->connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+	if ((linux_drm->crtc_active_prop_id == 0) || (linux_drm->crtc_mode_id_prop_id == 0) || (linux_drm->connector_crtc_id_prop_id == 0))
+	{
+		IMX_2D_LOG(ERROR, "could not find required CRTC / connector DRM properties");
+		goto error;
+	}
+
+	if (drmModeCreatePropertyBlob(linux_drm->fd, &(linux_drm->mode), sizeof(drmModeModeInfo), &(linux_drm->mode_blob_id)) != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not create DRM mode property blob: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	/* Pick a page format the plane supports. */
+	plane = drmModeGetPlane(linux_drm->fd, linux_drm->plane_id);
+	if (plane == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM plane %" PRIu32 ": %s (%d)", linux_drm->plane_id, strerror(errno), errno);
+		goto error;
+	}
+
+	for (i = 0; i < sizeof(page_formats) / sizeof(Imx2dPixelFormat); ++i)
+	{
+		uint32_t drm_format = imx_2d_linux_drm_get_drm_format(page_formats[i]);
+		if (imx_2d_linux_drm_plane_supports_format(plane, drm_format))
+		{
+			page_format = page_formats[i];
+			linux_drm->page_drm_format = drm_format;
+			break;
+		}
+	}
+
+	drmModeFreePlane(plane);
+
+	if (page_format == IMX_2D_PIXEL_FORMAT_UNKNOWN)
+	{
+		IMX_2D_LOG(ERROR, "DRM plane %" PRIu32 " supports none of the page formats", linux_drm->plane_id);
+		goto error;
+	}
+
+	IMX_2D_LOG(INFO, "page flipping enabled: %d", enable_page_flipping);
+
+	if (!imx_2d_linux_drm_allocate_pages(linux_drm, page_format, enable_page_flipping ? NUM_PAGE_FLIPPING_PAGES : 1))
+		goto error;
+
+	/* Perform the initial modeset, showing the first (black) page. */
+	full_region.x1 = 0;
+	full_region.y1 = 0;
+	full_region.x2 = linux_drm->mode.hdisplay;
+	full_region.y2 = linux_drm->mode.vdisplay;
+
+	ret = imx_2d_linux_drm_commit(linux_drm, linux_drm->pages[0].fb_id, &full_region, &full_region, FALSE);
+	if (ret != 0)
+	{
+		IMX_2D_LOG(ERROR, "initial DRM modeset failed: %s (%d)", strerror(-ret), -ret);
+		goto error;
+	}
+
+
+finish:
+	return linux_drm;
+
+error:
+	imx_2d_linux_drm_destroy(linux_drm);
+	linux_drm = NULL;
+
+	goto finish;
+}
+
+
+void imx_2d_linux_drm_destroy(Imx2dLinuxDrm *linux_drm)
+{
+	if (linux_drm == NULL)
+		return;
+
+	if (linux_drm->fd >= 0)
+	{
+		/* The framebuffers must not be removed while they may
+		 * still be scanned out, so make sure that this wait
+		 * is not cut short by an earlier unlock. */
+		imx_2d_linux_drm_unlock_stop(linux_drm);
+		imx_2d_linux_drm_wait_for_page_flip(linux_drm);
+
+		if (linux_drm->modeset_done)
+		{
+			/* Restore the previous CRTC configuration. If there was
+			 * none, disable the plane so that it no longer refers
+			 * to framebuffers that are about to be removed. */
+			if ((linux_drm->saved_crtc != NULL) && (linux_drm->saved_crtc->buffer_id != 0))
+			{
+				IMX_2D_LOG(DEBUG, "restoring previous DRM CRTC configuration");
+				drmModeSetCrtc(
+					linux_drm->fd,
+					linux_drm->saved_crtc->crtc_id,
+					linux_drm->saved_crtc->buffer_id,
+					linux_drm->saved_crtc->x,
+					linux_drm->saved_crtc->y,
+					&(linux_drm->connector_id),
+					1,
+					&(linux_drm->saved_crtc->mode)
+				);
+			}
+			else
+			{
+				drmModeAtomicReq *req = drmModeAtomicAlloc();
+				assert(req != NULL);
+
+				IMX_2D_LOG(DEBUG, "disabling DRM plane");
+				drmModeAtomicAddProperty(req, linux_drm->plane_id, linux_drm->plane_prop_ids[PLANE_PROP_FB_ID], 0);
+				drmModeAtomicAddProperty(req, linux_drm->plane_id, linux_drm->plane_prop_ids[PLANE_PROP_CRTC_ID], 0);
+				drmModeAtomicCommit(linux_drm->fd, req, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+				drmModeAtomicFree(req);
+			}
+		}
+
+		while (linux_drm->num_cached_framebuffers > 0)
+			imx_2d_linux_drm_remove_cached_framebuffer(linux_drm, linux_drm->num_cached_framebuffers - 1);
+
+		imx_2d_linux_drm_free_pages(linux_drm);
+
+		if (linux_drm->mode_blob_id != 0)
+			drmModeDestroyPropertyBlob(linux_drm->fd, linux_drm->mode_blob_id);
+
+		close(linux_drm->fd);
+	}
+
+	if (linux_drm->saved_crtc != NULL)
+		drmModeFreeCrtc(linux_drm->saved_crtc);
+
+	if (linux_drm->control_pipe_fds[0] >= 0)
+		close(linux_drm->control_pipe_fds[0]);
+	if (linux_drm->control_pipe_fds[1] >= 0)
+		close(linux_drm->control_pipe_fds[1]);
+
+	free(linux_drm);
+}
+
+
+Imx2dSurface* imx_2d_linux_drm_get_surface(Imx2dLinuxDrm *linux_drm)
+{
+	assert(linux_drm != NULL);
+	return linux_drm->surface;
+}
+
+
+int imx_2d_linux_drm_get_num_pages(Imx2dLinuxDrm *linux_drm)
+{
+	assert(linux_drm != NULL);
+	return linux_drm->num_pages;
+}
+
+
+void imx_2d_linux_drm_set_write_page(Imx2dLinuxDrm *linux_drm, int page)
+{
+	assert(linux_drm != NULL);
+	assert((page >= 0) && (page < linux_drm->num_pages));
+
+	IMX_2D_LOG(TRACE, "setting DRM page %d as the write target", page);
+
+	imx_2d_surface_set_dma_buffer(linux_drm->surface, linux_drm->pages[page].dma_buffer, 0, 0);
+}
+
+
+int imx_2d_linux_drm_show_page(Imx2dLinuxDrm *linux_drm, int page)
+{
+	Imx2dRegion full_region;
+	int ret;
+
+	assert(linux_drm != NULL);
+	assert((page >= 0) && (page < linux_drm->num_pages));
+
+	if (!imx_2d_linux_drm_wait_for_page_flip(linux_drm))
+		return FALSE;
+
+	full_region.x1 = 0;
+	full_region.y1 = 0;
+	full_region.x2 = linux_drm->mode.hdisplay;
+	full_region.y2 = linux_drm->mode.vdisplay;
+
+	IMX_2D_LOG(TRACE, "showing DRM page %d", page);
+
+	ret = imx_2d_linux_drm_commit(linux_drm, linux_drm->pages[page].fb_id, &full_region, &full_region, FALSE);
+	if (ret != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not commit DRM page %d: %s (%d)", page, strerror(-ret), -ret);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+Imx2dLinuxDrmScanoutResult imx_2d_linux_drm_show_dmabuf_frame(Imx2dLinuxDrm *linux_drm, Imx2dLinuxDrmDmaBufFrame const *frame, Imx2dRegion const *source_region, Imx2dRegion const *dest_region)
+{
+	Imx2dRegion full_source_region, full_dest_region;
+	Imx2dLinuxDrmScanoutTest *test = &(linux_drm->last_scanout_test);
+	Imx2dPixelFormatInfo const *format_info;
+	uint32_t drm_format;
+	uint32_t fb_id;
+	int ret;
+
+	assert(linux_drm != NULL);
+	assert(frame != NULL);
+
+	drm_format = imx_2d_linux_drm_get_drm_format(frame->format);
+	format_info = imx_2d_get_pixel_format_info(frame->format);
+	if ((drm_format == 0) || (format_info == NULL))
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+
+	if (source_region == NULL)
+	{
+		full_source_region.x1 = 0;
+		full_source_region.y1 = 0;
+		full_source_region.x2 = frame->width;
+		full_source_region.y2 = frame->height;
+		source_region = &full_source_region;
+	}
+
+	if (dest_region == NULL)
+	{
+		full_dest_region.x1 = 0;
+		full_dest_region.y1 = 0;
+		full_dest_region.x2 = linux_drm->mode.hdisplay;
+		full_dest_region.y2 = linux_drm->mode.vdisplay;
+		dest_region = &full_dest_region;
+	}
+
+	/* Skip the test commit if an equivalent
+	 * configuration was already tested. */
+	if (test->valid
+	 && (test->drm_format == drm_format)
+	 && (test->width == frame->width)
+	 && (test->height == frame->height)
+	 && imx_2d_region_check_if_equal(&(test->source_region), source_region)
+	 && imx_2d_region_check_if_equal(&(test->dest_region), dest_region)
+	 && !(test->supported))
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+
+	fb_id = imx_2d_linux_drm_get_framebuffer_for_frame(linux_drm, frame, drm_format, format_info->num_planes);
+	if (fb_id == 0)
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+
+	if (!(test->valid
+	   && (test->drm_format == drm_format)
+	   && (test->width == frame->width)
+	   && (test->height == frame->height)
+	   && imx_2d_region_check_if_equal(&(test->source_region), source_region)
+	   && imx_2d_region_check_if_equal(&(test->dest_region), dest_region)))
+	{
+		ret = imx_2d_linux_drm_commit(linux_drm, fb_id, source_region, dest_region, TRUE);
+
+		test->valid = TRUE;
+		test->drm_format = drm_format;
+		test->width = frame->width;
+		test->height = frame->height;
+		memcpy(&(test->source_region), source_region, sizeof(Imx2dRegion));
+		memcpy(&(test->dest_region), dest_region, sizeof(Imx2dRegion));
+		test->supported = (ret == 0);
+
+		IMX_2D_LOG(
+			DEBUG,
+			"test commit for direct scanout of %dx%d %s frame with source region %" IMX_2D_REGION_FORMAT " dest region %" IMX_2D_REGION_FORMAT ": %s",
+			frame->width, frame->height,
+			imx_2d_pixel_format_to_string(frame->format),
+			IMX_2D_REGION_ARGS(source_region),
+			IMX_2D_REGION_ARGS(dest_region),
+			test->supported ? "supported" : strerror(-ret)
+		);
+
+		if (!(test->supported))
+			return IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED;
+	}
+
+	if (!imx_2d_linux_drm_wait_for_page_flip(linux_drm))
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_ERROR;
+
+	ret = imx_2d_linux_drm_commit(linux_drm, fb_id, source_region, dest_region, FALSE);
+	if (ret != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not commit DMA-BUF frame: %s (%d)", strerror(-ret), -ret);
+		return IMX_2D_LINUX_DRM_SCANOUT_RESULT_ERROR;
+	}
+
+	return IMX_2D_LINUX_DRM_SCANOUT_RESULT_OK;
+}
+
+
+int imx_2d_linux_drm_wait_for_page_flip(Imx2dLinuxDrm *linux_drm)
+{
+	drmEventContext event_context;
+	struct pollfd pfd[2];
+	unsigned int refresh_rate;
+	int timeout;
+
+	assert(linux_drm != NULL);
+
+	memset(&event_context, 0, sizeof(event_context));
+	event_context.version = 2;
+	event_context.page_flip_handler = imx_2d_linux_drm_page_flip_handler;
+
+	pfd[0].fd = linux_drm->control_pipe_fds[0];
+	pfd[0].events = POLLIN;
+	pfd[1].fd = linux_drm->fd;
+	pfd[1].events = POLLIN;
+
+	refresh_rate = (linux_drm->mode.vrefresh != 0) ? linux_drm->mode.vrefresh : FALLBACK_REFRESH_RATE;
+	timeout = (PAGE_FLIP_TIMEOUT_REFRESH_PERIODS * 1000 + refresh_rate - 1) / refresh_rate;
+
+	while (linux_drm->page_flip_pending)
+	{
+		int ret = poll(pfd, 2, timeout);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			IMX_2D_LOG(ERROR, "could not poll DRM device: %s (%d)", strerror(errno), errno);
+			return FALSE;
+		}
+
+		if (pfd[0].revents & POLLIN)
+		{
+			IMX_2D_LOG(DEBUG, "waiting for page flip was interrupted");
+			return FALSE;
+		}
+
+		if (ret == 0)
+		{
+			/* The event was lost (for example because the CRTC was
+			 * turned off by someone else). Don't wait for it anymore,
+			 * otherwise every subsequent commit would also time out. */
+			IMX_2D_LOG(ERROR, "page flip did not complete within %d ms", timeout);
+			/* The kernel accepted the commit, so assume that the pending
+			 * framebuffer is shown (or will be as soon as the CRTC is on
+			 * again). This keeps the framebuffer cache from evicting it
+			 * while protecting one that is no longer on screen. */
+			linux_drm->page_flip_pending = FALSE;
+			linux_drm->displayed_fb_id = linux_drm->pending_fb_id;
+			linux_drm->pending_fb_id = 0;
+			return FALSE;
+		}
+
+		if (drmHandleEvent(linux_drm->fd, &event_context) != 0)
+		{
+			IMX_2D_LOG(ERROR, "could not handle DRM event: %s (%d)", strerror(errno), errno);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+void imx_2d_linux_drm_unlock(Imx2dLinuxDrm *linux_drm)
+{
+	static char const dummy = 0;
+
+	assert(linux_drm != NULL);
+
+	IMX_2D_LOG(DEBUG, "unlocking DRM output");
+
+	if (write(linux_drm->control_pipe_fds[1], &dummy, 1) < 0)
+		IMX_2D_LOG(ERROR, "could not write to control pipe: %s (%d)", strerror(errno), errno);
+}
+
+
+void imx_2d_linux_drm_unlock_stop(Imx2dLinuxDrm *linux_drm)
+{
+	struct pollfd pfd;
+	char dummy;
+
+	assert(linux_drm != NULL);
+
+	IMX_2D_LOG(DEBUG, "undoing unlock of DRM output");
+
+	/* Drain the control pipe so that waits block again. */
+	pfd.fd = linux_drm->control_pipe_fds[0];
+	pfd.events = POLLIN;
+	while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN))
+	{
+		if (read(linux_drm->control_pipe_fds[0], &dummy, 1) <= 0)
+			break;
+	}
+}
@@ -0,0 +1,239 @@
+#ifndef IMX_2D_LINUX_DRM_H
+#define IMX_2D_LINUX_DRM_H
+
+#include "imx2d.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Imx2dLinuxDrm:
+ *
+ * Output to a display by using the Linux DRM/KMS API. This is the
+ * counterpart to @Imx2dLinuxFramebuffer for systems where the fbdev
+ * API is not available or deprecated.
+ *
+ * Just like @Imx2dLinuxFramebuffer, this incorporates an Imx2dSurface
+ * that can be used as a target for blitting. The surface is backed by
+ * "pages", which are DMA buffers that get imported into DRM as KMS
+ * framebuffers. Pages are shown by assigning them to a KMS plane with
+ * an atomic commit. The display switches to the new page at the next
+ * vblank, so page flipping is always tied to vsync.
+ *
+ * In addition, DMA-BUF based frames can be shown directly on the
+ * plane without blitting them into a page first (see
+ * @imx_2d_linux_drm_show_dmabuf_frame). This is possible if the
+ * plane supports the frame's pixel format and the required scaling.
+ *
+ * At most one atomic commit is pending at any time. Functions that
+ * perform a commit first wait for the page flip event of the previous
+ * commit. Once that event arrived, whatever was shown before that
+ * previous commit is no longer scanned out.
+ */
+typedef struct _Imx2dLinuxDrm Imx2dLinuxDrm;
+
+
+/**
+ * Imx2dLinuxDrmDmaBufFrame:
+ * @format: Pixel format of the frame.
+ * @width: Width of the frame, in pixels.
+ * @height: Height of the frame, in pixels.
+ * @dmabuf_fds: DMA-BUF FDs of the frame's planes. Planes may
+ *     share the same FD (this is the case if all planes are
+ *     stored in the same DMA-BUF).
+ * @plane_strides: Plane stride values, in bytes.
+ * @plane_offsets: Offsets of the planes within their DMA-BUFs, in bytes.
+ *
+ * Describes a frame whose planes are stored in DMA-BUFs. Only
+ * linear (that is, non-tiled) pixel formats are supported.
+ */
+typedef struct
+{
+	Imx2dPixelFormat format;
+	int width, height;
+	int dmabuf_fds[3];
+	int plane_strides[3];
+	int plane_offsets[3];
+}
+Imx2dLinuxDrmDmaBufFrame;
+
+
+/**
+ * Imx2dLinuxDrmScanoutResult:
+ * @IMX_2D_LINUX_DRM_SCANOUT_RESULT_OK: The frame is being shown.
+ * @IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED: The frame cannot
+ *     be shown directly, for example because the plane does not
+ *     support its format or the required scaling. Nothing was
+ *     changed; the frame has to be blitted into a page instead.
+ * @IMX_2D_LINUX_DRM_SCANOUT_RESULT_ERROR: An error occurred.
+ */
+typedef enum
+{
+	IMX_2D_LINUX_DRM_SCANOUT_RESULT_OK,
+	IMX_2D_LINUX_DRM_SCANOUT_RESULT_UNSUPPORTED,
+	IMX_2D_LINUX_DRM_SCANOUT_RESULT_ERROR
+}
+Imx2dLinuxDrmScanoutResult;
+
+
+/**
+ * imx_2d_linux_drm_create:
+ * @device_name: Device name of the DRM device to access (for example, /dev/dri/card0).
+ * @connector_id: ID of the DRM connector to use, or 0 to use the first connected one.
+ * @plane_id: ID of the DRM plane to use, or 0 to use the primary plane of the CRTC
+ *     that drives the connector.
+ * @enable_page_flipping: Whether or not to use more than one page (nonzero = yes, zero = no).
+ *
+ * Creates a new DRM output. This opens the device, selects the connector,
+ * CRTC and plane, allocates the pages, and performs an initial modeset
+ * that shows the first page. If the CRTC is already active, its current
+ * mode is retained. Otherwise, the connector's preferred mode is used.
+ *
+ * If @enable_page_flipping is nonzero, three pages are allocated, so that
+ * a new frame can be written into one page while the other ones are being
+ * displayed or are about to be displayed. Otherwise, only one page is
+ * allocated, and writes are visible immediately (which can cause tearing).
+ *
+ * Returns: Pointer to new DRM output, or NULL if an error occurred.
+ */
+Imx2dLinuxDrm* imx_2d_linux_drm_create(char const *device_name, uint32_t connector_id, uint32_t plane_id, int enable_page_flipping);
+
+/**
+ * imx_2d_linux_drm_destroy:
+ * @linux_drm: DRM output to destroy.
+ *
+ * Destroys the given DRM output. This waits for any pending page flip,
+ * restores the CRTC configuration that was present before
+ * @imx_2d_linux_drm_create was called, and frees the pages.
+ *
+ * The pointer to the DRM output is invalid after this call
+ * and must not be used anymore.
+ */
+void imx_2d_linux_drm_destroy(Imx2dLinuxDrm *linux_drm);
+
+/**
+ * imx_2d_linux_drm_get_surface:
+ * @linux_drm: DRM output to get a surface from.
+ *
+ * This returns the surface that represents the page that is currently
+ * set as the write target (see @imx_2d_linux_drm_set_write_page).
+ * The surface's size equals the size of the display mode.
+ *
+ * Returns: The @Imx2dSurface that wraps the current write page.
+ */
+Imx2dSurface* imx_2d_linux_drm_get_surface(Imx2dLinuxDrm *linux_drm);
+
+/**
+ * imx_2d_linux_drm_get_num_pages:
+ * @linux_drm: DRM output to get the number of available pages from.
+ *
+ * This return value never changes after creating the DRM output,
+ * so it can be safely cached. If page flipping is not enabled (see
+ * @imx_2d_linux_drm_create), the return value is 1.
+ *
+ * Returns: Number of pages available for writing / displaying.
+ */
+int imx_2d_linux_drm_get_num_pages(Imx2dLinuxDrm *linux_drm);
+
+/**
+ * imx_2d_linux_drm_set_write_page:
+ * @linux_drm: DRM output to set the write target page of.
+ * @page: Page number to set as the write target.
+ *
+ * This sets the target of write (= blit) operations. @page must be a number
+ * in the range 0 .. (num-pages - 1), where num-pages is the return value of
+ * @imx_2d_linux_drm_get_num_pages.
+ *
+ * IMPORTANT: This modifies the DMA buffer of the surface associated with
+ * this DRM output (see @imx_2d_linux_drm_get_surface). Do not call this
+ * while a sequence is ongoing (see @imx_2d_blitter_start).
+ */
+void imx_2d_linux_drm_set_write_page(Imx2dLinuxDrm *linux_drm, int page);
+
+/**
+ * imx_2d_linux_drm_show_page:
+ * @linux_drm: DRM output to show a page on.
+ * @page: Page number to show.
+ *
+ * Assigns the given page to the plane with an atomic commit. The plane
+ * then covers the entire display. The display switches to the page at
+ * the next vblank. @page must be a number in the range 0 .. (num-pages - 1),
+ * where num-pages is the return value of @imx_2d_linux_drm_get_num_pages.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_drm_show_page(Imx2dLinuxDrm *linux_drm, int page);
+
+/**
+ * imx_2d_linux_drm_show_dmabuf_frame:
+ * @linux_drm: DRM output to show the frame on.
+ * @frame: Frame to show.
+ * @source_region: Region within the frame to show. If NULL, the whole frame is shown.
+ * @dest_region: Region on the display to show the frame in. If NULL, the whole
+ *     display is covered.
+ *
+ * Shows the given frame directly on the plane, without any blitting. The
+ * frame is imported into DRM as a KMS framebuffer. Framebuffers are cached,
+ * so showing frames from the same DMA-BUFs again (typically the case with
+ * frames from buffer pools) does not import them again.
+ *
+ * Before the actual commit, a test-only commit checks if the plane can
+ * show the frame. The result is cached and reused as long as the format,
+ * the size and the regions stay the same.
+ *
+ * The caller must make sure that the contents of the DMA-BUFs do not
+ * change until the page flip event of the next commit arrives.
+ *
+ * Returns: Result of the operation. See @Imx2dLinuxDrmScanoutResult.
+ */
+Imx2dLinuxDrmScanoutResult imx_2d_linux_drm_show_dmabuf_frame(Imx2dLinuxDrm *linux_drm, Imx2dLinuxDrmDmaBufFrame const *frame, Imx2dRegion const *source_region, Imx2dRegion const *dest_region);
+
+/**
+ * imx_2d_linux_drm_wait_for_page_flip:
+ * @linux_drm: DRM output to wait on.
+ *
+ * Waits until the page flip event of the last commit arrived. If no
+ * commit is pending, this returns immediately. Commits already wait
+ * for the previous page flip internally, so calling this is only
+ * necessary if the caller needs to know when a previously shown page
+ * or frame is no longer scanned out.
+ *
+ * The wait is bounded to a few refresh periods. If the page flip event
+ * does not arrive by then, it is considered lost, and this returns zero.
+ * This also returns zero right away if imx_2d_linux_drm_unlock() was
+ * called. The page flip is then still pending.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_drm_wait_for_page_flip(Imx2dLinuxDrm *linux_drm);
+
+/**
+ * imx_2d_linux_drm_unlock:
+ * @linux_drm: DRM output to unlock.
+ *
+ * Wakes up an ongoing imx_2d_linux_drm_wait_for_page_flip() call in
+ * another thread. Until imx_2d_linux_drm_unlock_stop() is called,
+ * subsequent waits (and therefore commits that need to wait for a
+ * previous page flip) fail immediately. This is intended for the
+ * unlock / flushing mechanisms of GStreamer sinks.
+ */
+void imx_2d_linux_drm_unlock(Imx2dLinuxDrm *linux_drm);
+
+/**
+ * imx_2d_linux_drm_unlock_stop:
+ * @linux_drm: DRM output to undo the unlock for.
+ *
+ * Undoes the effect of imx_2d_linux_drm_unlock().
+ */
+void imx_2d_linux_drm_unlock_stop(Imx2dLinuxDrm *linux_drm);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* IMX_2D_LINUX_DRM_H */
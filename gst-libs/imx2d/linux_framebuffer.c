@@ -5,12 +5,26 @@
 #include <fcntl.h>
 #include <linux/fb.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <errno.h>
+#include <time.h>
 #include "imx2d.h"
 #include "imx2d_priv.h"
 #include "linux_framebuffer.h"
 
 
+typedef struct
+{
+	/* This must be the first member, since the map function
+	 * of the wrapped DMA buffer casts its argument to
+	 * Imx2dLinuxFramebufferScanoutPage. */
+	ImxWrappedDmaBuffer dma_buffer;
+	Imx2dLinuxFramebuffer *linux_framebuffer;
+	size_t offset_in_bytes;
+}
+Imx2dLinuxFramebufferScanoutPage;
+
+
 struct _Imx2dLinuxFramebuffer
 {
 	int fd;
@@ -29,6 +43,21 @@ struct _Imx2dLinuxFramebuffer
 	int original_fb_virt_height;
 
 	int page_size_in_bytes;
+
+	int current_write_page;
+
+	Imx2dLinuxFramebufferScanoutPage scanout_pages[IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_SCANOUT_PAGES];
+	int num_scanout_pages;
+
+	/* CPU mapping of the framebuffer memory. Only used for
+	 * mapping scanout pages, since the regular pages are only
+	 * accessed by blitters. */
+	uint8_t *mapped_fb_memory;
+	size_t mapped_fb_memory_size;
+
+	/* Set once FBIO_WAITFORVSYNC turned out to be unsupported,
+	 * to avoid repeating the failing ioctl for every frame. */
+	BOOL waitforvsync_unsupported;
 };
 
 
@@ -42,6 +71,9 @@ struct _Imx2dLinuxFramebuffer
 static Imx2dPixelFormat imx_2d_linux_framebuffer_get_format_from_fb(struct fb_var_screeninfo *fb_var, struct fb_fix_screeninfo *fb_fix);
 static BOOL imx_2d_linux_framebuffer_set_virtual_fb_height(Imx2dLinuxFramebuffer *linux_framebuffer, int virtual_fb_height);
 static BOOL imx_2d_linux_framebuffer_restore_original_fb_height(Imx2dLinuxFramebuffer *linux_framebuffer);
+static BOOL imx_2d_linux_framebuffer_pan_to_page(Imx2dLinuxFramebuffer *linux_framebuffer, int total_page_index);
+static uint8_t* imx_2d_linux_framebuffer_map_scanout_page(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error);
+static void imx_2d_linux_framebuffer_unmap_scanout_page(ImxWrappedDmaBuffer *wrapped_dma_buffer);
 
 
 static Imx2dPixelFormat imx_2d_linux_framebuffer_get_format_from_fb(struct fb_var_screeninfo *fb_var, struct fb_fix_screeninfo *fb_fix)
@@ -151,6 +183,45 @@ static BOOL imx_2d_linux_framebuffer_restore_original_fb_height(Imx2dLinuxFrameb
 }
 
 
+static BOOL imx_2d_linux_framebuffer_pan_to_page(Imx2dLinuxFramebuffer *linux_framebuffer, int total_page_index)
+{
+	/* total_page_index counts the regular pages first,
+	 * followed by the scanout pages. */
+
+	linux_framebuffer->fb_var.yoffset = linux_framebuffer->surface->desc.height * total_page_index;
+
+	IMX_2D_LOG(TRACE, "shifting framebuffer display Y offset to %u to show page %d", linux_framebuffer->fb_var.yoffset, total_page_index);
+
+	if (ioctl(linux_framebuffer->fd, FBIOPAN_DISPLAY, &(linux_framebuffer->fb_var)) == -1)
+	{
+		IMX_2D_LOG(ERROR, "FBIOPAN_DISPLAY error: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static uint8_t* imx_2d_linux_framebuffer_map_scanout_page(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error)
+{
+	Imx2dLinuxFramebufferScanoutPage *scanout_page = (Imx2dLinuxFramebufferScanoutPage *)wrapped_dma_buffer;
+
+	IMX_2D_UNUSED_PARAM(flags);
+	IMX_2D_UNUSED_PARAM(error);
+
+	/* The whole framebuffer memory is mapped once when the scanout
+	 * pages are added, so there is nothing to do here other than
+	 * returning the address of the page within that mapping. */
+	return scanout_page->linux_framebuffer->mapped_fb_memory + scanout_page->offset_in_bytes;
+}
+
+
+static void imx_2d_linux_framebuffer_unmap_scanout_page(ImxWrappedDmaBuffer *wrapped_dma_buffer)
+{
+	IMX_2D_UNUSED_PARAM(wrapped_dma_buffer);
+}
+
+
 Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name, int enable_page_flipping)
 {
 	Imx2dLinuxFramebuffer *linux_framebuffer;
@@ -307,8 +378,8 @@ void imx_2d_linux_framebuffer_destroy(Imx2dLinuxFramebuffer *linux_framebuffer)
 	if (linux_framebuffer == NULL)
 		return;
 
-	if (linux_framebuffer->surface != NULL)
-		imx_2d_surface_destroy(linux_framebuffer->surface);
+	if (linux_framebuffer->mapped_fb_memory != NULL)
+		munmap(linux_framebuffer->mapped_fb_memory, linux_framebuffer->mapped_fb_memory_size);
 
 	if (linux_framebuffer->fd > 0)
 	{
@@ -316,6 +387,9 @@ void imx_2d_linux_framebuffer_destroy(Imx2dLinuxFramebuffer *linux_framebuffer)
 		close(linux_framebuffer->fd);
 	}
 
+	if (linux_framebuffer->surface != NULL)
+		imx_2d_surface_destroy(linux_framebuffer->surface);
+
 	free(linux_framebuffer);
 }
 
@@ -334,6 +408,8 @@ void imx_2d_linux_framebuffer_set_write_fb_page(Imx2dLinuxFramebuffer *linux_fra
 	assert(linux_framebuffer->fd > 0);
 	assert((page >= 0) && (page < imx_2d_linux_framebuffer_get_num_fb_pages(linux_framebuffer)));
 
+	linux_framebuffer->current_write_page = page;
+
 	page_offset_in_bytes = linux_framebuffer->page_size_in_bytes * page;
 	linux_framebuffer->dma_buffer.physical_address = linux_framebuffer->basic_physical_address + page_offset_in_bytes;
 
@@ -354,15 +430,195 @@ int imx_2d_linux_framebuffer_set_display_fb_page(Imx2dLinuxFramebuffer *linux_fr
 	assert(linux_framebuffer->fd > 0);
 	assert((page >= 0) && (page < imx_2d_linux_framebuffer_get_num_fb_pages(linux_framebuffer)));
 
-	linux_framebuffer->fb_var.yoffset = linux_framebuffer->surface->desc.height * page;
+	return imx_2d_linux_framebuffer_pan_to_page(linux_framebuffer, page);
+}
 
-	IMX_2D_LOG(TRACE, "shifting framebuffer display Y offset to %u to show page %d", linux_framebuffer->fb_var.yoffset, page);
 
-	if (ioctl(linux_framebuffer->fd, FBIOPAN_DISPLAY, &(linux_framebuffer->fb_var)) == -1)
+int imx_2d_linux_framebuffer_add_scanout_pages(Imx2dLinuxFramebuffer *linux_framebuffer, int num_scanout_pages)
+{
+	int page_index;
+	int num_fb_pages;
+	int num_total_pages;
+	unsigned int min_required_virtual_height;
+	int previous_fb_virt_height;
+	size_t required_memory_size;
+	void *mapped_fb_memory;
+
+	assert(linux_framebuffer != NULL);
+	assert(linux_framebuffer->fd > 0);
+	assert(linux_framebuffer->num_scanout_pages == 0);
+	assert((num_scanout_pages >= 1) && (num_scanout_pages <= IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_SCANOUT_PAGES));
+
+	num_fb_pages = imx_2d_linux_framebuffer_get_num_fb_pages(linux_framebuffer);
+	num_total_pages = num_fb_pages + num_scanout_pages;
+	min_required_virtual_height = linux_framebuffer->fb_var.yres * num_total_pages;
+	previous_fb_virt_height = linux_framebuffer->current_fb_virt_height;
+
+	if (linux_framebuffer->fb_var.yres_virtual < min_required_virtual_height)
 	{
-		IMX_2D_LOG(ERROR, "FBIOPAN_DISPLAY error: %s (%d)", strerror(errno), errno);
-		return FALSE;
+		IMX_2D_LOG(
+			INFO,
+			"min required virtual framebuffer height for %d regular and %d scanout pages: %u  current height: %u  => reconfiguring framebuffer",
+			num_fb_pages, num_scanout_pages,
+			min_required_virtual_height,
+			linux_framebuffer->fb_var.yres_virtual
+		);
+
+		if (!imx_2d_linux_framebuffer_set_virtual_fb_height(linux_framebuffer, min_required_virtual_height))
+		{
+			IMX_2D_LOG(ERROR, "could not reconfigure framebuffer virtual height");
+			goto error;
+		}
+	}
+
+	/* The framebuffer driver may have reallocated the framebuffer
+	 * memory to make room for the larger virtual height, so the
+	 * physical address has to be retrieved again. */
+	if (ioctl(linux_framebuffer->fd, FBIOGET_FSCREENINFO, &(linux_framebuffer->fb_fix)) == -1)
+	{
+		IMX_2D_LOG(ERROR, "could not get fixed screen info: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	required_memory_size = (size_t)(linux_framebuffer->page_size_in_bytes) * num_total_pages;
+	if (linux_framebuffer->fb_fix.smem_len < required_memory_size)
+	{
+		IMX_2D_LOG(ERROR, "framebuffer memory size %u is too small for %d pages (need %zu bytes)", linux_framebuffer->fb_fix.smem_len, num_total_pages, required_memory_size);
+		goto error;
+	}
+
+	linux_framebuffer->basic_physical_address = (imx_physical_address_t)(linux_framebuffer->fb_fix.smem_start);
+	imx_2d_linux_framebuffer_set_write_fb_page(linux_framebuffer, linux_framebuffer->current_write_page);
+
+	mapped_fb_memory = mmap(NULL, required_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, linux_framebuffer->fd, 0);
+	if (mapped_fb_memory == MAP_FAILED)
+	{
+		IMX_2D_LOG(ERROR, "could not map framebuffer memory: %s (%d)", strerror(errno), errno);
+		goto error;
 	}
 
+	linux_framebuffer->mapped_fb_memory = mapped_fb_memory;
+	linux_framebuffer->mapped_fb_memory_size = required_memory_size;
+
+	for (page_index = 0; page_index < num_scanout_pages; ++page_index)
+	{
+		Imx2dLinuxFramebufferScanoutPage *scanout_page = &(linux_framebuffer->scanout_pages[page_index]);
+
+		scanout_page->linux_framebuffer = linux_framebuffer;
+		scanout_page->offset_in_bytes = (size_t)(linux_framebuffer->page_size_in_bytes) * (num_fb_pages + page_index);
+
+		imx_dma_buffer_init_wrapped_buffer(&(scanout_page->dma_buffer));
+		scanout_page->dma_buffer.fd = -1;
+		scanout_page->dma_buffer.physical_address = linux_framebuffer->basic_physical_address + scanout_page->offset_in_bytes;
+		scanout_page->dma_buffer.size = linux_framebuffer->page_size_in_bytes;
+		scanout_page->dma_buffer.map = imx_2d_linux_framebuffer_map_scanout_page;
+		scanout_page->dma_buffer.unmap = imx_2d_linux_framebuffer_unmap_scanout_page;
+
+		IMX_2D_LOG(DEBUG, "scanout page %d physical address: %" IMX_PHYSICAL_ADDRESS_FORMAT, page_index, scanout_page->dma_buffer.physical_address);
+	}
+
+	linux_framebuffer->num_scanout_pages = num_scanout_pages;
+
 	return TRUE;
+
+error:
+	if (linux_framebuffer->current_fb_virt_height != previous_fb_virt_height)
+	{
+		imx_2d_linux_framebuffer_set_virtual_fb_height(linux_framebuffer, previous_fb_virt_height);
+
+		if (ioctl(linux_framebuffer->fd, FBIOGET_FSCREENINFO, &(linux_framebuffer->fb_fix)) != -1)
+		{
+			linux_framebuffer->basic_physical_address = (imx_physical_address_t)(linux_framebuffer->fb_fix.smem_start);
+			imx_2d_linux_framebuffer_set_write_fb_page(linux_framebuffer, linux_framebuffer->current_write_page);
+		}
+	}
+
+	return FALSE;
+}
+
+
+int imx_2d_linux_framebuffer_get_num_scanout_pages(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	assert(linux_framebuffer != NULL);
+	return linux_framebuffer->num_scanout_pages;
+}
+
+
+ImxDmaBuffer* imx_2d_linux_framebuffer_get_scanout_page_dma_buffer(Imx2dLinuxFramebuffer *linux_framebuffer, int scanout_page)
+{
+	assert(linux_framebuffer != NULL);
+	assert((scanout_page >= 0) && (scanout_page < linux_framebuffer->num_scanout_pages));
+
+	return (ImxDmaBuffer *)&(linux_framebuffer->scanout_pages[scanout_page].dma_buffer);
+}
+
+
+int imx_2d_linux_framebuffer_show_scanout_page(Imx2dLinuxFramebuffer *linux_framebuffer, int scanout_page)
+{
+	assert(linux_framebuffer != NULL);
+	assert(linux_framebuffer->fd > 0);
+	assert((scanout_page >= 0) && (scanout_page < linux_framebuffer->num_scanout_pages));
+
+	return imx_2d_linux_framebuffer_pan_to_page(linux_framebuffer, imx_2d_linux_framebuffer_get_num_fb_pages(linux_framebuffer) + scanout_page);
+}
+
+
+int imx_2d_linux_framebuffer_wait_for_vsync(Imx2dLinuxFramebuffer *linux_framebuffer, int64_t *vsync_timestamp, int *vsync_waited)
+{
+	struct timespec ts;
+	__u32 crtc = 0;
+	BOOL waited = FALSE;
+
+	assert(linux_framebuffer != NULL);
+	assert(linux_framebuffer->fd > 0);
+
+	if (!linux_framebuffer->waitforvsync_unsupported)
+	{
+		if (ioctl(linux_framebuffer->fd, FBIO_WAITFORVSYNC, &crtc) == -1)
+		{
+			if ((errno == ENOTTY) || (errno == EINVAL))
+			{
+				IMX_2D_LOG(INFO, "framebuffer driver does not support FBIO_WAITFORVSYNC; using time of return from panning as vsync time");
+				linux_framebuffer->waitforvsync_unsupported = TRUE;
+			}
+			else
+			{
+				IMX_2D_LOG(ERROR, "FBIO_WAITFORVSYNC error: %s (%d)", strerror(errno), errno);
+				return FALSE;
+			}
+		}
+		else
+			waited = TRUE;
+	}
+
+	if (vsync_waited != NULL)
+		*vsync_waited = waited;
+
+	if (vsync_timestamp != NULL)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		*vsync_timestamp = ((int64_t)(ts.tv_sec)) * 1000000000 + ts.tv_nsec;
+	}
+
+	return TRUE;
+}
+
+
+int64_t imx_2d_linux_framebuffer_get_refresh_period(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	struct fb_var_screeninfo const *fb_var;
+	uint64_t htotal, vtotal;
+
+	assert(linux_framebuffer != NULL);
+
+	fb_var = &(linux_framebuffer->fb_var);
+
+	/* pixclock is the duration of one pixel, in picoseconds. */
+	if (fb_var->pixclock == 0)
+		return 0;
+
+	htotal = (uint64_t)(fb_var->xres) + fb_var->left_margin + fb_var->right_margin + fb_var->hsync_len;
+	vtotal = (uint64_t)(fb_var->yres) + fb_var->upper_margin + fb_var->lower_margin + fb_var->vsync_len;
+
+	return (int64_t)(htotal * vtotal * fb_var->pixclock / 1000);
 }
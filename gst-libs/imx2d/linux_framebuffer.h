@@ -28,6 +28,11 @@ extern "C" {
  */
 typedef struct _Imx2dLinuxFramebuffer Imx2dLinuxFramebuffer;
 
+
+/* Maximum number of scanout pages that can be added with
+ * imx_2d_linux_framebuffer_add_scanout_pages(). */
+#define IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_SCANOUT_PAGES 8
+
 /**
  * imx_2d_linux_framebuffer_create:
  * @device_name: Device name of the framebuffer to access.
@@ -123,6 +128,105 @@ void imx_2d_linux_framebuffer_set_write_fb_page(Imx2dLinuxFramebuffer *linux_fra
  */
 int imx_2d_linux_framebuffer_set_display_fb_page(Imx2dLinuxFramebuffer *linux_framebuffer, int page);
 
+/**
+ * imx_2d_linux_framebuffer_add_scanout_pages:
+ * @linux_framebuffer: Framebuffer wrapper to add scanout pages to.
+ * @num_scanout_pages: Number of scanout pages to add. Must be in the range
+ *     1 .. IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_SCANOUT_PAGES.
+ *
+ * Enlarges the virtual framebuffer so that @num_scanout_pages extra pages
+ * fit after the regular pages (see @imx_2d_linux_framebuffer_get_num_fb_pages).
+ * Unlike the regular pages, scanout pages are not used as blitter targets.
+ * Instead, their memory is meant to be handed out as DMA buffers (see
+ * @imx_2d_linux_framebuffer_get_scanout_page_dma_buffer) that get filled
+ * with frames elsewhere. Such frames can then be shown by panning the
+ * display to their page with @imx_2d_linux_framebuffer_show_scanout_page,
+ * which avoids copying them into a regular page.
+ *
+ * Like with page flipping, the virtual framebuffer height is reset to its
+ * original size when this framebuffer wrapper is destroyed. Scanout pages
+ * can only be added once.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure. In case of failure,
+ *     the framebuffer configuration is left unchanged.
+ */
+int imx_2d_linux_framebuffer_add_scanout_pages(Imx2dLinuxFramebuffer *linux_framebuffer, int num_scanout_pages);
+
+/**
+ * imx_2d_linux_framebuffer_get_num_scanout_pages:
+ * @linux_framebuffer: Framebuffer wrapper to get the number of scanout pages from.
+ *
+ * Returns: Number of scanout pages that were added with
+ *     @imx_2d_linux_framebuffer_add_scanout_pages, or 0 if none were added.
+ */
+int imx_2d_linux_framebuffer_get_num_scanout_pages(Imx2dLinuxFramebuffer *linux_framebuffer);
+
+/**
+ * imx_2d_linux_framebuffer_get_scanout_page_dma_buffer:
+ * @linux_framebuffer: Framebuffer wrapper to get a scanout page DMA buffer from.
+ * @scanout_page: Scanout page number. Must be in the range 0 .. (num-scanout-pages - 1),
+ *     where num-scanout-pages is the return value of
+ *     @imx_2d_linux_framebuffer_get_num_scanout_pages.
+ *
+ * The returned DMA buffer covers exactly one page, and its contents are laid out
+ * just like the framebuffer surface (same width, height, stride and format). The
+ * DMA buffer is owned by the framebuffer wrapper and becomes invalid once the
+ * wrapper is destroyed.
+ *
+ * Returns: The DMA buffer of the given scanout page.
+ */
+ImxDmaBuffer* imx_2d_linux_framebuffer_get_scanout_page_dma_buffer(Imx2dLinuxFramebuffer *linux_framebuffer, int scanout_page);
+
+/**
+ * imx_2d_linux_framebuffer_show_scanout_page:
+ * @linux_framebuffer: Framebuffer wrapper to show the scanout page on.
+ * @scanout_page: Scanout page number to show. Must be in the range
+ *     0 .. (num-scanout-pages - 1), where num-scanout-pages is the return value
+ *     of @imx_2d_linux_framebuffer_get_num_scanout_pages.
+ *
+ * Pans the display to the given scanout page. To show regular pages again,
+ * use @imx_2d_linux_framebuffer_set_display_fb_page.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_framebuffer_show_scanout_page(Imx2dLinuxFramebuffer *linux_framebuffer, int scanout_page);
+
+/**
+ * imx_2d_linux_framebuffer_wait_for_vsync:
+ * @linux_framebuffer: Framebuffer wrapper to wait on.
+ * @vsync_timestamp: Pointer to an int64_t that receives the time of the vsync
+ *     (CLOCK_MONOTONIC, in nanoseconds). Can be NULL.
+ * @vsync_waited: Pointer to an int that is set to nonzero if the call actually
+ *     waited for the vsync, and to zero if the driver does not support that.
+ *     Can be NULL.
+ *
+ * Blocks until the next vertical sync by using the FBIO_WAITFORVSYNC ioctl.
+ * Calling this after @imx_2d_linux_framebuffer_set_display_fb_page or
+ * @imx_2d_linux_framebuffer_show_scanout_page returns once the page is
+ * actually shown, and the previously shown page is no longer scanned out.
+ *
+ * Some drivers do not support FBIO_WAITFORVSYNC. Such drivers typically
+ * block inside the pan call until the next vsync instead. In that case,
+ * this returns immediately, @vsync_timestamp is set to the current time, and
+ * @vsync_waited is set to zero. The previously shown page may then still be
+ * scanned out until the next vsync.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_framebuffer_wait_for_vsync(Imx2dLinuxFramebuffer *linux_framebuffer, int64_t *vsync_timestamp, int *vsync_waited);
+
+/**
+ * imx_2d_linux_framebuffer_get_refresh_period:
+ * @linux_framebuffer: Framebuffer wrapper to get the refresh period from.
+ *
+ * Calculates the duration of one display refresh from the framebuffer's
+ * video mode timings.
+ *
+ * Returns: Refresh period in nanoseconds, or 0 if the driver does not
+ *     report a pixel clock.
+ */
+int64_t imx_2d_linux_framebuffer_get_refresh_period(Imx2dLinuxFramebuffer *linux_framebuffer);
+
 
 #ifdef __cplusplus
 }
@@ -1323,7 +1323,8 @@ static gboolean gst_imx_v4l2_amphion_dec_decide_allocation(GstVideoDecoder *deco
 	self->video_buffer_pool = gst_imx_video_buffer_pool_new(
 		self->imx_dma_buffer_allocator,
 		query,
-		&(self->detiler_output_info)
+		&(self->detiler_output_info),
+		0
 	);
 
 	gst_object_ref_sink(self->video_buffer_pool);
@@ -0,0 +1,1001 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2026  gstreamer-imx contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* This element converts 8-bit Bayer frames (as produced by raw sensors
+ * that are captured with imxv4l2videosrc) to RGBx or NV12. The i.MX
+ * capture paths deliver such frames as-is.
+ *
+ * The frame is split into horizontal bands of rows that are demosaiced
+ * in parallel by a thread pool. Each band keeps a small ring of padded
+ * input rows, so every input row is read only once per band and the
+ * per-row kernels do not need any border checks. The kernels process
+ * all pixels of one Bayer site type (color or green) in separate loops.
+ *
+ * Two methods are available:
+ *
+ * - bilinear: Missing color values are the average of the nearest
+ *   neighbors with that color.
+ * - edge-aware: Green at red/blue sites is interpolated along the
+ *   direction with the smaller gradient (Hamilton-Adams). The color
+ *   of the row at green sites is interpolated in the color difference
+ *   domain using the interpolated green values. This greatly reduces
+ *   zipper artifacts at edges, at a small extra cost.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+#include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gstimxv4l2videoformat.h"
+#include "gstimxv4l2bayerdemosaic.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_v4l2_bayer_demosaic_debug);
+#define GST_CAT_DEFAULT imx_v4l2_bayer_demosaic_debug
+
+
+enum
+{
+	PROP_0,
+	PROP_METHOD,
+	PROP_NUM_THREADS
+};
+
+
+#define DEFAULT_METHOD GST_IMX_V4L2_BAYER_DEMOSAIC_METHOD_BILINEAR
+#define DEFAULT_NUM_THREADS 0
+
+/* The edge-aware kernel accesses pixels that are up to 2 rows and
+ * columns away from the current one. Mirroring the borders therefore
+ * requires frames to be at least 4 pixels wide and high (see the
+ * pad templates below). */
+#define NUM_PADDED_ROWS 5
+#define ROW_PADDING 2
+
+#define MAX_NUM_THREADS 64
+
+
+static GstStaticPadTemplate static_sink_template = GST_STATIC_PAD_TEMPLATE(
+	"sink",
+	GST_PAD_SINK,
+	GST_PAD_ALWAYS,
+	GST_STATIC_CAPS(
+		"video/x-bayer, "
+		"format = (string) { rggb, grbg, gbrg, bggr }, "
+		"width = (int) [ 4, MAX ], "
+		"height = (int) [ 4, MAX ], "
+		"framerate = (fraction) [ 0, MAX ]"
+	)
+);
+
+static GstStaticPadTemplate static_src_template = GST_STATIC_PAD_TEMPLATE(
+	"src",
+	GST_PAD_SRC,
+	GST_PAD_ALWAYS,
+	GST_STATIC_CAPS(
+		"video/x-raw, "
+		"format = (string) { RGBx, NV12 }, "
+		"width = (int) [ 4, MAX ], "
+		"height = (int) [ 4, MAX ], "
+		"framerate = (fraction) [ 0, MAX ]"
+	)
+);
+
+
+typedef struct
+{
+	guint8 const *input_data;
+	gint input_stride;
+	GstVideoFrame *output_frame;
+	GstImxV4L2BayerDemosaicMethod method;
+}
+GstImxV4L2BayerDemosaicFrameJob;
+
+
+typedef struct
+{
+	/* Rows [first_row, last_row) are processed by this band.
+	 * first_row is always even, since NV12 output is produced
+	 * from pairs of rows. */
+	gint first_row, last_row;
+
+	/* Ring of mirror-padded input rows. padded_row_indices
+	 * contains the (virtual, possibly out of range) row
+	 * number each slot currently holds. */
+	guint8 *padded_rows[NUM_PADDED_ROWS];
+	gint padded_row_indices[NUM_PADDED_ROWS];
+
+	/* Demosaiced red, green, blue values of two consecutive rows.
+	 * Each line has one extra value on each side for the edge-aware
+	 * color difference interpolation. */
+	guint8 *rgb_lines[2][3];
+
+	GstImxV4L2BayerDemosaicFrameJob const *frame_job;
+}
+GstImxV4L2BayerDemosaicBand;
+
+
+struct _GstImxV4L2BayerDemosaic
+{
+	GstBaseTransform parent;
+
+	/*< private >*/
+
+	/* Allocator for output buffers in case downstream
+	 * does not provide a buffer pool. */
+	GstAllocator *imx_dma_buffer_allocator;
+
+	GstImxV4L2BayerInfo input_bayer_info;
+	/* Row stride that is used if input buffers have no GstVideoMeta. */
+	gint default_input_stride;
+	GstVideoInfo output_video_info;
+
+	/* Position of the red pixel in the 2x2 Bayer tile. The blue
+	 * pixel is located at the diagonally opposite position. */
+	gint red_x, red_y;
+
+	GstImxV4L2BayerDemosaicBand *bands;
+	guint num_bands;
+
+	/* Pool of worker threads for all bands except for the first one,
+	 * which is processed by the streaming thread. */
+	GThreadPool *thread_pool;
+	GMutex bands_mutex;
+	GCond bands_cond;
+	guint num_pending_bands;
+
+	GstImxV4L2BayerDemosaicMethod method;
+	guint num_threads;
+};
+
+
+struct _GstImxV4L2BayerDemosaicClass
+{
+	GstBaseTransformClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxV4L2BayerDemosaic, gst_imx_v4l2_bayer_demosaic, GST_TYPE_BASE_TRANSFORM)
+
+
+static void gst_imx_v4l2_bayer_demosaic_finalize(GObject *object);
+static void gst_imx_v4l2_bayer_demosaic_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_v4l2_bayer_demosaic_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+
+static gboolean gst_imx_v4l2_bayer_demosaic_start(GstBaseTransform *transform);
+static gboolean gst_imx_v4l2_bayer_demosaic_stop(GstBaseTransform *transform);
+static GstCaps* gst_imx_v4l2_bayer_demosaic_transform_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter);
+static gboolean gst_imx_v4l2_bayer_demosaic_set_caps(GstBaseTransform *transform, GstCaps *input_caps, GstCaps *output_caps);
+static gboolean gst_imx_v4l2_bayer_demosaic_transform_size(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, gsize size, GstCaps *othercaps, gsize *othersize);
+static gboolean gst_imx_v4l2_bayer_demosaic_propose_allocation(GstBaseTransform *transform, GstQuery *decide_query, GstQuery *query);
+static gboolean gst_imx_v4l2_bayer_demosaic_decide_allocation(GstBaseTransform *transform, GstQuery *query);
+static GstFlowReturn gst_imx_v4l2_bayer_demosaic_transform(GstBaseTransform *transform, GstBuffer *input_buffer, GstBuffer *output_buffer);
+
+static void gst_imx_v4l2_bayer_demosaic_free_bands(GstImxV4L2BayerDemosaic *self);
+static gboolean gst_imx_v4l2_bayer_demosaic_setup_bands(GstImxV4L2BayerDemosaic *self);
+static void gst_imx_v4l2_bayer_demosaic_thread_func(gpointer data, gpointer user_data);
+static void gst_imx_v4l2_bayer_demosaic_process_band(GstImxV4L2BayerDemosaic *self, GstImxV4L2BayerDemosaicBand *band);
+
+
+
+
+GType gst_imx_v4l2_bayer_demosaic_method_get_type(void)
+{
+	static GType gst_imx_v4l2_bayer_demosaic_method_type = 0;
+
+	if (!gst_imx_v4l2_bayer_demosaic_method_type)
+	{
+		static GEnumValue method_values[] =
+		{
+			{ GST_IMX_V4L2_BAYER_DEMOSAIC_METHOD_BILINEAR, "Bilinear interpolation", "bilinear" },
+			{ GST_IMX_V4L2_BAYER_DEMOSAIC_METHOD_EDGE_AWARE, "Edge-aware interpolation (gradient directed green, color difference chroma)", "edge-aware" },
+			{ 0, NULL, NULL },
+		};
+
+		gst_imx_v4l2_bayer_demosaic_method_type = g_enum_register_static(
+			"GstImxV4L2BayerDemosaicMethod",
+			method_values
+		);
+	}
+
+	return gst_imx_v4l2_bayer_demosaic_method_type;
+}
+
+
+
+
+static void gst_imx_v4l2_bayer_demosaic_class_init(GstImxV4L2BayerDemosaicClass *klass)
+{
+	GObjectClass *object_class;
+	GstElementClass *element_class;
+	GstBaseTransformClass *base_transform_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_v4l2_bayer_demosaic_debug, "imxv4l2bayerdemosaic", 0, "NXP i.MX Bayer demosaicing element");
+
+	object_class = G_OBJECT_CLASS(klass);
+	element_class = GST_ELEMENT_CLASS(klass);
+	base_transform_class = GST_BASE_TRANSFORM_CLASS(klass);
+
+	gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&static_sink_template));
+	gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&static_src_template));
+
+	object_class->finalize = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_finalize);
+	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_set_property);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_get_property);
+
+	base_transform_class->start = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_start);
+	base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_stop);
+	base_transform_class->transform_caps = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_transform_caps);
+	base_transform_class->set_caps = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_set_caps);
+	base_transform_class->transform_size = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_transform_size);
+	base_transform_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_propose_allocation);
+	base_transform_class->decide_allocation = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_decide_allocation);
+	base_transform_class->transform = GST_DEBUG_FUNCPTR(gst_imx_v4l2_bayer_demosaic_transform);
+
+	base_transform_class->passthrough_on_same_caps = FALSE;
+
+	g_object_class_install_property(
+		object_class,
+		PROP_METHOD,
+		g_param_spec_enum(
+			"method",
+			"Method",
+			"Demosaicing method to use",
+			gst_imx_v4l2_bayer_demosaic_method_get_type(),
+			DEFAULT_METHOD,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_NUM_THREADS,
+		g_param_spec_uint(
+			"num-threads",
+			"Number of threads",
+			"How many threads to use for demosaicing (0 = one per CPU core; applied when caps are set)",
+			0, MAX_NUM_THREADS,
+			DEFAULT_NUM_THREADS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"NXP i.MX Bayer demosaicing element",
+		"Filter/Converter/Video",
+		"Converts Bayer frames from raw sensors to RGBx or NV12 video frames",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_init(GstImxV4L2BayerDemosaic *self)
+{
+	self->imx_dma_buffer_allocator = NULL;
+
+	self->bands = NULL;
+	self->num_bands = 0;
+
+	self->thread_pool = NULL;
+	g_mutex_init(&(self->bands_mutex));
+	g_cond_init(&(self->bands_cond));
+	self->num_pending_bands = 0;
+
+	self->method = DEFAULT_METHOD;
+	self->num_threads = DEFAULT_NUM_THREADS;
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_finalize(GObject *object)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(object);
+
+	gst_imx_v4l2_bayer_demosaic_free_bands(self);
+
+	g_mutex_clear(&(self->bands_mutex));
+	g_cond_clear(&(self->bands_cond));
+
+	G_OBJECT_CLASS(gst_imx_v4l2_bayer_demosaic_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(object);
+
+	switch (prop_id)
+	{
+		case PROP_METHOD:
+			GST_OBJECT_LOCK(self);
+			self->method = g_value_get_enum(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_NUM_THREADS:
+			GST_OBJECT_LOCK(self);
+			self->num_threads = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(object);
+
+	switch (prop_id)
+	{
+		case PROP_METHOD:
+			GST_OBJECT_LOCK(self);
+			g_value_set_enum(value, self->method);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_NUM_THREADS:
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->num_threads);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_start(GstBaseTransform *transform)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(transform);
+
+	self->imx_dma_buffer_allocator = gst_imx_allocator_new();
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_stop(GstBaseTransform *transform)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(transform);
+
+	gst_imx_v4l2_bayer_demosaic_free_bands(self);
+
+	if (self->imx_dma_buffer_allocator != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->imx_dma_buffer_allocator));
+		self->imx_dma_buffer_allocator = NULL;
+	}
+
+	return TRUE;
+}
+
+
+static GstCaps* gst_imx_v4l2_bayer_demosaic_transform_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter)
+{
+	GstCaps *transformed_caps;
+	GstCaps *template_caps;
+	GstCaps *result;
+	guint i;
+
+	/* The frame size and framerate are retained; only
+	 * the media type and the format are changed. */
+
+	transformed_caps = gst_caps_new_empty();
+
+	for (i = 0; i < gst_caps_get_size(caps); ++i)
+	{
+		GstStructure *structure = gst_structure_copy(gst_caps_get_structure(caps, i));
+
+		gst_structure_set_name(structure, (direction == GST_PAD_SINK) ? "video/x-raw" : "video/x-bayer");
+		gst_structure_remove_fields(structure, "format", "colorimetry", "chroma-site", NULL);
+
+		gst_caps_append_structure(transformed_caps, structure);
+	}
+
+	/* Fill in the formats by intersecting with the template caps of the other pad. */
+	template_caps = gst_static_pad_template_get_caps((direction == GST_PAD_SINK) ? &static_src_template : &static_sink_template);
+	result = gst_caps_intersect_full(transformed_caps, template_caps, GST_CAPS_INTERSECT_FIRST);
+	gst_caps_unref(template_caps);
+	gst_caps_unref(transformed_caps);
+
+	if (filter != NULL)
+	{
+		GstCaps *filtered_result = gst_caps_intersect_full(filter, result, GST_CAPS_INTERSECT_FIRST);
+		gst_caps_unref(result);
+		result = filtered_result;
+	}
+
+	GST_DEBUG_OBJECT(transform, "transformed caps %" GST_PTR_FORMAT " in %s direction to %" GST_PTR_FORMAT, (gpointer)caps, (direction == GST_PAD_SINK) ? "sink" : "src", (gpointer)result);
+
+	return result;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_set_caps(GstBaseTransform *transform, GstCaps *input_caps, GstCaps *output_caps)
+{
+	GstImxV4L2VideoInfo input_video_info;
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(transform);
+
+	if (!gst_imx_v4l2_video_info_from_caps(&input_video_info, input_caps) || (input_video_info.type != GST_IMX_V4L2_VIDEO_FORMAT_TYPE_BAYER))
+	{
+		GST_ERROR_OBJECT(self, "could not convert input caps %" GST_PTR_FORMAT " to Bayer video info", (gpointer)input_caps);
+		return FALSE;
+	}
+
+	if (!gst_video_info_from_caps(&(self->output_video_info), output_caps))
+	{
+		GST_ERROR_OBJECT(self, "could not convert output caps %" GST_PTR_FORMAT " to video info", (gpointer)output_caps);
+		return FALSE;
+	}
+
+	memcpy(&(self->input_bayer_info), &(input_video_info.info.bayer_info), sizeof(GstImxV4L2BayerInfo));
+
+	/* Bayer caps do not describe the row stride. Unless the input
+	 * buffers carry a GstVideoMeta with the actual stride (like the
+	 * V4L2 bytesperline value), assume the stride that bayer2rgb and
+	 * other GStreamer elements use for 8-bit Bayer frames. */
+	self->default_input_stride = GST_ROUND_UP_4(self->input_bayer_info.width);
+
+	switch (self->input_bayer_info.format)
+	{
+		case GST_IMX_V4L2_BAYER_FORMAT_RGGB: self->red_x = 0; self->red_y = 0; break;
+		case GST_IMX_V4L2_BAYER_FORMAT_GRBG: self->red_x = 1; self->red_y = 0; break;
+		case GST_IMX_V4L2_BAYER_FORMAT_GBRG: self->red_x = 0; self->red_y = 1; break;
+		case GST_IMX_V4L2_BAYER_FORMAT_BGGR: self->red_x = 1; self->red_y = 1; break;
+		default: g_assert_not_reached();
+	}
+
+	if (!gst_imx_v4l2_bayer_demosaic_setup_bands(self))
+		return FALSE;
+
+	GST_DEBUG_OBJECT(
+		self,
+		"configured demosaicing of %dx%d %s Bayer frames to %s with %u band(s)",
+		self->input_bayer_info.width, self->input_bayer_info.height,
+		gst_imx_v4l2_bayer_format_to_string(self->input_bayer_info.format),
+		gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&(self->output_video_info))),
+		self->num_bands
+	);
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_transform_size(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, gsize size, GstCaps *othercaps, gsize *othersize)
+{
+	GstStructure *structure;
+	gint width, height;
+
+	/* Bayer frames from V4L2 devices may be larger than width*height
+	 * bytes (see gst_imx_v4l2_calculate_buffer_size_from_video_info()),
+	 * so the sizes are always computed from the caps. */
+
+	GST_TRACE_OBJECT(transform, "transforming size %" G_GSIZE_FORMAT " in %s direction", size, (direction == GST_PAD_SINK) ? "sink" : "src");
+
+	if (direction == GST_PAD_SINK)
+	{
+		GstVideoInfo video_info;
+
+		if (!gst_video_info_from_caps(&video_info, othercaps))
+			return FALSE;
+
+		*othersize = GST_VIDEO_INFO_SIZE(&video_info);
+	}
+	else
+	{
+		structure = gst_caps_get_structure(othercaps, 0);
+		if (!gst_structure_get_int(structure, "width", &width) || !gst_structure_get_int(structure, "height", &height))
+			return FALSE;
+
+		*othersize = GST_ROUND_UP_4(width) * height;
+	}
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_propose_allocation(GstBaseTransform *transform, GstQuery *decide_query, GstQuery *query)
+{
+	if (!GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_bayer_demosaic_parent_class)->propose_allocation(transform, decide_query, query))
+		return FALSE;
+
+	/* Let upstream know that the input row stride can be
+	 * passed to us with GstVideoMeta (see transform()). */
+	gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_decide_allocation(GstBaseTransform *transform, GstQuery *query)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(transform);
+	GstCaps *output_caps;
+	GstVideoInfo output_video_info;
+
+	gst_query_parse_allocation(query, &output_caps, NULL);
+
+	/* If downstream does not provide a pool, produce the frames in
+	 * DMA memory, so that hardware accelerated elements further
+	 * downstream (encoders, blitters, sinks) can use them directly. */
+
+	if ((gst_query_get_n_allocation_pools(query) == 0) && (output_caps != NULL) && gst_video_info_from_caps(&output_video_info, output_caps))
+	{
+		GstBufferPool *buffer_pool = gst_video_buffer_pool_new();
+		GST_DEBUG_OBJECT(self, "there are no allocation pools in the allocation query; adding video buffer pool %" GST_PTR_FORMAT, (gpointer)buffer_pool);
+		gst_query_add_allocation_pool(query, buffer_pool, GST_VIDEO_INFO_SIZE(&output_video_info), 0, 0);
+		gst_object_unref(GST_OBJECT(buffer_pool));
+	}
+
+	if (gst_query_get_n_allocation_params(query) == 0)
+	{
+		GST_DEBUG_OBJECT(self, "there are no allocation params in the allocation query; adding the ImxDmaBuffer allocator");
+		gst_query_add_allocation_param(query, self->imx_dma_buffer_allocator, NULL);
+	}
+
+	return GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_bayer_demosaic_parent_class)->decide_allocation(transform, query);
+}
+
+
+static GstFlowReturn gst_imx_v4l2_bayer_demosaic_transform(GstBaseTransform *transform, GstBuffer *input_buffer, GstBuffer *output_buffer)
+{
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(transform);
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstMapInfo input_map_info;
+	GstVideoMeta *input_video_meta;
+	gint input_stride;
+	gsize input_offset;
+	gsize min_input_size;
+	GstVideoFrame output_frame;
+	GstImxV4L2BayerDemosaicFrameJob frame_job;
+	gboolean input_mapped = FALSE;
+	gboolean output_mapped = FALSE;
+	guint band_index;
+
+	g_assert(self->bands != NULL);
+
+	if (!gst_buffer_map(input_buffer, &input_map_info, GST_MAP_READ))
+	{
+		GST_ERROR_OBJECT(self, "could not map input buffer");
+		goto error;
+	}
+	input_mapped = TRUE;
+
+	input_video_meta = gst_buffer_get_video_meta(input_buffer);
+	if (input_video_meta != NULL)
+	{
+		input_stride = input_video_meta->stride[0];
+		input_offset = input_video_meta->offset[0];
+	}
+	else
+	{
+		input_stride = self->default_input_stride;
+		input_offset = 0;
+	}
+
+	if (input_stride < self->input_bayer_info.width)
+	{
+		GST_ERROR_OBJECT(self, "input stride %d is smaller than the frame width %d", input_stride, self->input_bayer_info.width);
+		goto error;
+	}
+
+	/* The last row does not have to include the padding bytes. */
+	min_input_size = input_offset + (gsize)input_stride * (self->input_bayer_info.height - 1) + self->input_bayer_info.width;
+	if (input_map_info.size < min_input_size)
+	{
+		GST_ERROR_OBJECT(
+			self,
+			"input buffer too small; expected at least %" G_GSIZE_FORMAT " byte(s), got %" G_GSIZE_FORMAT,
+			min_input_size,
+			input_map_info.size
+		);
+		goto error;
+	}
+
+	if (!gst_video_frame_map(&output_frame, &(self->output_video_info), output_buffer, GST_MAP_WRITE))
+	{
+		GST_ERROR_OBJECT(self, "could not map output buffer");
+		goto error;
+	}
+	output_mapped = TRUE;
+
+	frame_job.input_data = input_map_info.data + input_offset;
+	frame_job.input_stride = input_stride;
+	frame_job.output_frame = &output_frame;
+
+	GST_OBJECT_LOCK(self);
+	frame_job.method = self->method;
+	GST_OBJECT_UNLOCK(self);
+
+	for (band_index = 0; band_index < self->num_bands; ++band_index)
+		self->bands[band_index].frame_job = &frame_job;
+
+	/* Hand all bands except the first one to the worker threads,
+	 * and process the first one in this thread in the meantime. */
+
+	g_mutex_lock(&(self->bands_mutex));
+	self->num_pending_bands = self->num_bands - 1;
+	g_mutex_unlock(&(self->bands_mutex));
+
+	for (band_index = 1; band_index < self->num_bands; ++band_index)
+		g_thread_pool_push(self->thread_pool, &(self->bands[band_index]), NULL);
+
+	gst_imx_v4l2_bayer_demosaic_process_band(self, &(self->bands[0]));
+
+	g_mutex_lock(&(self->bands_mutex));
+	while (self->num_pending_bands > 0)
+		g_cond_wait(&(self->bands_cond), &(self->bands_mutex));
+	g_mutex_unlock(&(self->bands_mutex));
+
+
+finish:
+	if (output_mapped)
+		gst_video_frame_unmap(&output_frame);
+	if (input_mapped)
+		gst_buffer_unmap(input_buffer, &input_map_info);
+
+	return flow_ret;
+
+error:
+	flow_ret = GST_FLOW_ERROR;
+	goto finish;
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_free_bands(GstImxV4L2BayerDemosaic *self)
+{
+	guint band_index;
+	gint i;
+
+	if (self->thread_pool != NULL)
+	{
+		/* Wait for pending work (there should be none at this point). */
+		g_thread_pool_free(self->thread_pool, FALSE, TRUE);
+		self->thread_pool = NULL;
+	}
+
+	for (band_index = 0; band_index < self->num_bands; ++band_index)
+	{
+		GstImxV4L2BayerDemosaicBand *band = &(self->bands[band_index]);
+
+		for (i = 0; i < NUM_PADDED_ROWS; ++i)
+			g_free(band->padded_rows[i]);
+		for (i = 0; i < 2; ++i)
+		{
+			g_free(band->rgb_lines[i][0]);
+			g_free(band->rgb_lines[i][1]);
+			g_free(band->rgb_lines[i][2]);
+		}
+	}
+
+	g_free(self->bands);
+	self->bands = NULL;
+	self->num_bands = 0;
+}
+
+
+static gboolean gst_imx_v4l2_bayer_demosaic_setup_bands(GstImxV4L2BayerDemosaic *self)
+{
+	guint num_threads;
+	guint band_index;
+	gint width = self->input_bayer_info.width;
+	gint height = self->input_bayer_info.height;
+	gint num_row_pairs, row_pairs_per_band, remaining_row_pairs, row;
+	gint i;
+	GError *error = NULL;
+
+	gst_imx_v4l2_bayer_demosaic_free_bands(self);
+
+	GST_OBJECT_LOCK(self);
+	num_threads = self->num_threads;
+	GST_OBJECT_UNLOCK(self);
+
+	if (num_threads == 0)
+		num_threads = MIN(g_get_num_processors(), MAX_NUM_THREADS);
+
+	/* Bands consist of pairs of rows (needed for NV12 chroma
+	 * subsampling), so there can't be more bands than pairs. */
+	num_row_pairs = (height + 1) / 2;
+	self->num_bands = MIN(num_threads, (guint)num_row_pairs);
+	self->bands = g_new0(GstImxV4L2BayerDemosaicBand, self->num_bands);
+
+	row_pairs_per_band = num_row_pairs / self->num_bands;
+	remaining_row_pairs = num_row_pairs % self->num_bands;
+	row = 0;
+
+	for (band_index = 0; band_index < self->num_bands; ++band_index)
+	{
+		GstImxV4L2BayerDemosaicBand *band = &(self->bands[band_index]);
+		gint num_band_row_pairs = row_pairs_per_band + ((band_index < (guint)remaining_row_pairs) ? 1 : 0);
+
+		band->first_row = row;
+		band->last_row = MIN(row + num_band_row_pairs * 2, height);
+		row = band->last_row;
+
+		for (i = 0; i < NUM_PADDED_ROWS; ++i)
+			band->padded_rows[i] = g_malloc(width + ROW_PADDING * 2);
+		for (i = 0; i < 2; ++i)
+		{
+			band->rgb_lines[i][0] = g_malloc(width + 2);
+			band->rgb_lines[i][1] = g_malloc(width + 2);
+			band->rgb_lines[i][2] = g_malloc(width + 2);
+		}
+	}
+
+	if (self->num_bands > 1)
+	{
+		self->thread_pool = g_thread_pool_new(gst_imx_v4l2_bayer_demosaic_thread_func, self, self->num_bands - 1, TRUE, &error);
+		if (self->thread_pool == NULL)
+		{
+			GST_ERROR_OBJECT(self, "could not create thread pool: %s", error->message);
+			g_error_free(error);
+			gst_imx_v4l2_bayer_demosaic_free_bands(self);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_thread_func(gpointer data, gpointer user_data)
+{
+	GstImxV4L2BayerDemosaicBand *band = (GstImxV4L2BayerDemosaicBand *)data;
+	GstImxV4L2BayerDemosaic *self = GST_IMX_V4L2_BAYER_DEMOSAIC(user_data);
+
+	gst_imx_v4l2_bayer_demosaic_process_band(self, band);
+
+	g_mutex_lock(&(self->bands_mutex));
+	g_assert(self->num_pending_bands > 0);
+	self->num_pending_bands--;
+	if (self->num_pending_bands == 0)
+		g_cond_signal(&(self->bands_cond));
+	g_mutex_unlock(&(self->bands_mutex));
+}
+
+
+static inline guint8 clamp_to_uint8(gint value)
+{
+	return (value < 0) ? 0 : ((value > 255) ? 255 : value);
+}
+
+
+/* Returns a pointer to the first pixel of the given row, padded by
+ * ROW_PADDING mirrored pixels on each side. Rows outside of the frame
+ * are mirrored as well. Mirroring across the first/last row and column
+ * preserves the Bayer pattern, since it maps even offsets to even ones. */
+static guint8 const * get_padded_row(GstImxV4L2BayerDemosaic *self, GstImxV4L2BayerDemosaicBand *band, gint row)
+{
+	gint width = self->input_bayer_info.width;
+	gint height = self->input_bayer_info.height;
+	gint slot = (row + NUM_PADDED_ROWS * 2) % NUM_PADDED_ROWS;
+	guint8 *padded_row = band->padded_rows[slot];
+
+	if (band->padded_row_indices[slot] != row)
+	{
+		gint source_row = (row < 0) ? -row : ((row >= height) ? (2 * height - 2 - row) : row);
+		guint8 const *source = band->frame_job->input_data + source_row * band->frame_job->input_stride;
+
+		memcpy(padded_row + ROW_PADDING, source, width);
+		padded_row[0] = source[2];
+		padded_row[1] = source[1];
+		padded_row[width + ROW_PADDING + 0] = source[width - 2];
+		padded_row[width + ROW_PADDING + 1] = source[width - 3];
+
+		band->padded_row_indices[slot] = row;
+	}
+
+	return padded_row + ROW_PADDING;
+}
+
+
+/* Demosaics one row. The row contains color C (red or blue) and green
+ * pixels; the other color D (blue or red) is only present in the rows
+ * above and below. color_start is the column of the first C pixel. */
+static void demosaic_row(
+	GstImxV4L2BayerDemosaicMethod method,
+	guint8 const * restrict above2, guint8 const * restrict above, guint8 const * restrict cur, guint8 const * restrict below, guint8 const * restrict below2,
+	gint width, gint color_start,
+	guint8 * restrict c_out, guint8 * restrict g_out, guint8 * restrict d_out
+)
+{
+	gint x;
+	gint green_start = 1 - color_start;
+
+	if (method == GST_IMX_V4L2_BAYER_DEMOSAIC_METHOD_BILINEAR)
+	{
+		for (x = color_start; x < width; x += 2)
+		{
+			c_out[x] = cur[x];
+			g_out[x] = (cur[x - 1] + cur[x + 1] + above[x] + below[x] + 2) >> 2;
+			d_out[x] = (above[x - 1] + above[x + 1] + below[x - 1] + below[x + 1] + 2) >> 2;
+		}
+
+		for (x = green_start; x < width; x += 2)
+		{
+			c_out[x] = (cur[x - 1] + cur[x + 1] + 1) >> 1;
+			g_out[x] = cur[x];
+			d_out[x] = (above[x] + below[x] + 1) >> 1;
+		}
+	}
+	else
+	{
+		for (x = color_start; x < width; x += 2)
+		{
+			gint laplace_h = 2 * cur[x] - cur[x - 2] - cur[x + 2];
+			gint laplace_v = 2 * cur[x] - above2[x] - below2[x];
+			gint gradient_h = abs(cur[x - 1] - cur[x + 1]) + abs(laplace_h);
+			gint gradient_v = abs(above[x] - below[x]) + abs(laplace_v);
+			gint green_h = (2 * (cur[x - 1] + cur[x + 1]) + laplace_h) >> 2;
+			gint green_v = (2 * (above[x] + below[x]) + laplace_v) >> 2;
+			gint green = (gradient_h < gradient_v) ? green_h : ((gradient_v < gradient_h) ? green_v : ((green_h + green_v) >> 1));
+
+			c_out[x] = cur[x];
+			g_out[x] = clamp_to_uint8(green);
+			d_out[x] = (above[x - 1] + above[x + 1] + below[x - 1] + below[x + 1] + 2) >> 2;
+		}
+
+		/* The color difference interpolation below accesses the
+		 * interpolated green values of the horizontal neighbors,
+		 * so mirror them at the borders. */
+		g_out[-1] = g_out[1];
+		g_out[width] = g_out[width - 2];
+
+		for (x = green_start; x < width; x += 2)
+		{
+			gint color_difference = (cur[x - 1] - g_out[x - 1]) + (cur[x + 1] - g_out[x + 1]);
+
+			c_out[x] = clamp_to_uint8(cur[x] + (color_difference >> 1));
+			g_out[x] = cur[x];
+			d_out[x] = (above[x] + below[x] + 1) >> 1;
+		}
+	}
+}
+
+
+static void write_rgbx_row(guint8 * restrict dest, guint8 const * restrict r, guint8 const * restrict g, guint8 const * restrict b, gint width)
+{
+	gint x;
+
+	for (x = 0; x < width; ++x)
+	{
+		dest[x * 4 + 0] = r[x];
+		dest[x * 4 + 1] = g[x];
+		dest[x * 4 + 2] = b[x];
+		dest[x * 4 + 3] = 0xFF;
+	}
+}
+
+
+/* BT.601 limited range RGB -> YUV conversion in 8.8 fixed point. */
+
+static void write_nv12_luma_row(guint8 * restrict dest, guint8 const * restrict r, guint8 const * restrict g, guint8 const * restrict b, gint width)
+{
+	gint x;
+
+	for (x = 0; x < width; ++x)
+		dest[x] = ((66 * r[x] + 129 * g[x] + 25 * b[x] + 128) >> 8) + 16;
+}
+
+
+static void write_nv12_chroma_row(guint8 * restrict dest, guint8 *rgb_lines[2][3], gint width)
+{
+	gint x;
+
+	for (x = 0; x < width; x += 2)
+	{
+		gint x1 = MIN(x + 1, width - 1);
+		gint r = (rgb_lines[0][0][x] + rgb_lines[0][0][x1] + rgb_lines[1][0][x] + rgb_lines[1][0][x1] + 2) >> 2;
+		gint g = (rgb_lines[0][1][x] + rgb_lines[0][1][x1] + rgb_lines[1][1][x] + rgb_lines[1][1][x1] + 2) >> 2;
+		gint b = (rgb_lines[0][2][x] + rgb_lines[0][2][x1] + rgb_lines[1][2][x] + rgb_lines[1][2][x1] + 2) >> 2;
+
+		dest[x + 0] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+		dest[x + 1] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+	}
+}
+
+
+static void gst_imx_v4l2_bayer_demosaic_process_band(GstImxV4L2BayerDemosaic *self, GstImxV4L2BayerDemosaicBand *band)
+{
+	GstImxV4L2BayerDemosaicFrameJob const *frame_job = band->frame_job;
+	GstVideoFrame *output_frame = frame_job->output_frame;
+	gint width = self->input_bayer_info.width;
+	gint height = self->input_bayer_info.height;
+	gint row, i;
+
+	/* Invalidate the padded row ring, since the input frame changed. */
+	for (i = 0; i < NUM_PADDED_ROWS; ++i)
+		band->padded_row_indices[i] = G_MININT;
+
+	for (row = band->first_row; row < band->last_row; row += 2)
+	{
+		gint num_rows = MIN(2, height - row);
+
+		for (i = 0; i < num_rows; ++i)
+		{
+			gint y = row + i;
+			gboolean is_red_row = ((y & 1) == self->red_y);
+			gint color_start = is_red_row ? self->red_x : (1 - self->red_x);
+			guint8 **rgb = band->rgb_lines[i];
+			guint8 const *above2 = get_padded_row(self, band, y - 2);
+			guint8 const *above = get_padded_row(self, band, y - 1);
+			guint8 const *cur = get_padded_row(self, band, y);
+			guint8 const *below = get_padded_row(self, band, y + 1);
+			guint8 const *below2 = get_padded_row(self, band, y + 2);
+
+			/* The lines are offset by 1 to give demosaic_row()
+			 * room for its mirrored green values at index -1. */
+			demosaic_row(
+				frame_job->method,
+				above2, above, cur, below, below2,
+				width, color_start,
+				(is_red_row ? rgb[0] : rgb[2]) + 1,
+				rgb[1] + 1,
+				(is_red_row ? rgb[2] : rgb[0]) + 1
+			);
+
+			switch (GST_VIDEO_FRAME_FORMAT(output_frame))
+			{
+				case GST_VIDEO_FORMAT_RGBx:
+					write_rgbx_row(
+						(guint8 *)GST_VIDEO_FRAME_PLANE_DATA(output_frame, 0) + y * GST_VIDEO_FRAME_PLANE_STRIDE(output_frame, 0),
+						rgb[0] + 1, rgb[1] + 1, rgb[2] + 1,
+						width
+					);
+					break;
+
+				case GST_VIDEO_FORMAT_NV12:
+					write_nv12_luma_row(
+						(guint8 *)GST_VIDEO_FRAME_PLANE_DATA(output_frame, 0) + y * GST_VIDEO_FRAME_PLANE_STRIDE(output_frame, 0),
+						rgb[0] + 1, rgb[1] + 1, rgb[2] + 1,
+						width
+					);
+					break;
+
+				default:
+					g_assert_not_reached();
+			}
+		}
+
+		if (GST_VIDEO_FRAME_FORMAT(output_frame) == GST_VIDEO_FORMAT_NV12)
+		{
+			guint8 *chroma_lines[2][3];
+
+			/* For an odd frame height, the last chroma row
+			 * is computed from the last luma row alone. */
+			for (i = 0; i < 3; ++i)
+			{
+				chroma_lines[0][i] = band->rgb_lines[0][i] + 1;
+				chroma_lines[1][i] = band->rgb_lines[num_rows - 1][i] + 1;
+			}
+
+			write_nv12_chroma_row(
+				(guint8 *)GST_VIDEO_FRAME_PLANE_DATA(output_frame, 1) + (row / 2) * GST_VIDEO_FRAME_PLANE_STRIDE(output_frame, 1),
+				chroma_lines,
+				width
+			);
+		}
+	}
+}
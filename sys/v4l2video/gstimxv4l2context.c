@@ -18,6 +18,7 @@
 
 #include "gstimxv4l2prelude.h"
 
+#include <config.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -57,6 +58,20 @@ GST_DEBUG_CATEGORY_STATIC(imx_v4l2_context_debug);
 #define GST_CAT_DEFAULT imx_v4l2_context_debug
 
 
+/* Process-wide probe result cache. The results only depend on the
+ * device and its driver, so they can be reused by all elements that
+ * probe the same device. Keys are strings created by
+ * gst_imx_v4l2_create_probe_cache_key(), values are heap allocated
+ * GstImxV4L2ProbeResult instances. */
+G_LOCK_DEFINE_STATIC(probe_cache);
+static GHashTable *probe_cache = NULL;
+
+GST_DEBUG_CATEGORY_STATIC(imx_v4l2_probe_cache_debug);
+
+#define PROBE_CACHE_FILENAME_ENV_VAR "GST_IMX_V4L2_PROBE_CACHE"
+#define PROBE_CACHE_FILE_HEADER_GROUP "gstreamer-imx-v4l2-probe-cache"
+
+
 struct _GstImxV4L2Context
 {
 	GstObject parent;
@@ -88,6 +103,11 @@ static void get_gst_framerate_from_v4l2_frameinterval(guint32 v4l2_num, guint32
 static gboolean fill_caps_with_probed_info(GstImxV4L2Context *self, int fd, GstCaps *probed_device_caps, guint width, guint height, GstImxV4L2VideoFormat const *imx_v4l2_format);
 static void log_capabilities(GstObject *object, guint32 capabilities);
 
+static void free_cached_probe_result(gpointer data);
+static void ensure_probe_cache_unlocked(void);
+static void load_probe_cache_file_unlocked(gchar const *filename);
+static void save_probe_cache_file_unlocked(gchar const *filename);
+
 
 static void gst_imx_v4l2_context_class_init(GstImxV4L2ContextClass *klass)
 {
@@ -179,6 +199,7 @@ gboolean gst_imx_v4l2_context_probe_device(GstImxV4L2Context *imx_v4l2_context)
 	int fd = -1;
 	struct v4l2_capability v4l2_caps;
 	GstImxV4L2ProbeResult *probe_result = &(imx_v4l2_context->probe_result);
+	gchar *cache_key = NULL;
 
 	g_assert(imx_v4l2_context != NULL);
 
@@ -204,6 +225,24 @@ gboolean gst_imx_v4l2_context_probe_device(GstImxV4L2Context *imx_v4l2_context)
 	GST_DEBUG_OBJECT(imx_v4l2_context, "bus info:       [%s]", v4l2_caps.bus_info);
 	GST_DEBUG_OBJECT(imx_v4l2_context, "driver version: %d.%d.%d", ((v4l2_caps.version >> 16) & 0xFF), ((v4l2_caps.version >> 8) & 0xFF), ((v4l2_caps.version >> 0) & 0xFF));
 
+
+	/* Reuse an earlier probe result for this device if there is one. */
+
+	cache_key = gst_imx_v4l2_create_probe_cache_key(
+		(imx_v4l2_context->device_type == GST_IMX_V4L2_DEVICE_TYPE_CAPTURE) ? "capture" : "output",
+		imx_v4l2_context->device_node,
+		&v4l2_caps
+	);
+
+	gst_imx_v4l2_clear_probe_result(probe_result);
+
+	if (gst_imx_v4l2_lookup_cached_probe_result(cache_key, probe_result))
+	{
+		GST_DEBUG_OBJECT(imx_v4l2_context, "using cached probe result; device caps: %" GST_PTR_FORMAT, (gpointer)(probe_result->device_caps));
+		imx_v4l2_context->did_successfully_probe = TRUE;
+		goto finish;
+	}
+
 	probe_result->v4l2_device_capabilities = (v4l2_caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? v4l2_caps.device_caps : v4l2_caps.capabilities;
 
 	GST_DEBUG_OBJECT(imx_v4l2_context, "available capabilities of physical device:");
@@ -293,9 +332,13 @@ gboolean gst_imx_v4l2_context_probe_device(GstImxV4L2Context *imx_v4l2_context)
 
 	GST_DEBUG_OBJECT(imx_v4l2_context, "device caps: %" GST_PTR_FORMAT, (gpointer)(probe_result->device_caps));
 
+	gst_imx_v4l2_store_cached_probe_result(cache_key, probe_result);
+
 	imx_v4l2_context->did_successfully_probe = TRUE;
 
 finish:
+	g_free(cache_key);
+
 	if (fd > 0)
 		close(fd);
 
@@ -431,6 +474,82 @@ GstImxV4L2VideoFormat const * gst_imx_v4l2_get_by_gst_video_format_from_probe_re
 }
 
 
+gchar* gst_imx_v4l2_create_probe_cache_key(gchar const *kind, gchar const *device_node, struct v4l2_capability const *capability)
+{
+	gchar *key;
+
+	g_assert(kind != NULL);
+	g_assert(device_node != NULL);
+	g_assert(capability != NULL);
+
+	key = g_strdup_printf(
+		"%s|%s|%.*s|%.*s|%.*s|%u|%#x",
+		kind,
+		device_node,
+		(int)sizeof(capability->driver), (char const *)(capability->driver),
+		(int)sizeof(capability->card), (char const *)(capability->card),
+		(int)sizeof(capability->bus_info), (char const *)(capability->bus_info),
+		(guint)(capability->version),
+		(guint)(capability->capabilities)
+	);
+
+	/* The key is also used as a group name in the cache file,
+	 * and group names must not contain brackets. */
+	g_strdelimit(key, "[]", '_');
+
+	return key;
+}
+
+
+gboolean gst_imx_v4l2_lookup_cached_probe_result(gchar const *key, GstImxV4L2ProbeResult *probe_result)
+{
+	GstImxV4L2ProbeResult const *cached_probe_result;
+
+	g_assert(key != NULL);
+	g_assert(probe_result != NULL);
+
+	G_LOCK(probe_cache);
+
+	ensure_probe_cache_unlocked();
+
+	cached_probe_result = g_hash_table_lookup(probe_cache, key);
+	if (cached_probe_result != NULL)
+		gst_imx_v4l2_copy_probe_result(probe_result, cached_probe_result);
+
+	G_UNLOCK(probe_cache);
+
+	GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "probe cache %s for key \"%s\"", (cached_probe_result != NULL) ? "hit" : "miss", key);
+
+	return (cached_probe_result != NULL);
+}
+
+
+void gst_imx_v4l2_store_cached_probe_result(gchar const *key, GstImxV4L2ProbeResult const *probe_result)
+{
+	GstImxV4L2ProbeResult *cached_probe_result;
+	gchar const *filename;
+
+	g_assert(key != NULL);
+	g_assert(probe_result != NULL);
+
+	cached_probe_result = g_new0(GstImxV4L2ProbeResult, 1);
+	gst_imx_v4l2_copy_probe_result(cached_probe_result, probe_result);
+
+	G_LOCK(probe_cache);
+
+	ensure_probe_cache_unlocked();
+	g_hash_table_replace(probe_cache, g_strdup(key), cached_probe_result);
+
+	filename = g_getenv(PROBE_CACHE_FILENAME_ENV_VAR);
+	if ((filename != NULL) && (filename[0] != '\0'))
+		save_probe_cache_file_unlocked(filename);
+
+	G_UNLOCK(probe_cache);
+
+	GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "stored probe result in cache with key \"%s\"", key);
+}
+
+
 static gboolean enum_v4l2_format(GstImxV4L2Context *self, int fd, struct v4l2_fmtdesc *v4l2_format_desc, gboolean *reached_end)
 {
 	GstImxV4L2ProbeResult *probe_result = &(self->probe_result);
@@ -1155,3 +1274,206 @@ static void log_capabilities(GstObject *object, guint32 capabilities)
 #endif
 	if ((capabilities & V4L2_CAP_DEVICE_CAPS) != 0)          GST_DEBUG_OBJECT(object, "    V4L2_CAP_DEVICE_CAPS");
 }
+
+
+static void free_cached_probe_result(gpointer data)
+{
+	GstImxV4L2ProbeResult *probe_result = (GstImxV4L2ProbeResult *)data;
+	gst_imx_v4l2_clear_probe_result(probe_result);
+	g_free(probe_result);
+}
+
+
+static void ensure_probe_cache_unlocked(void)
+{
+	gchar const *filename;
+
+	if (G_LIKELY(probe_cache != NULL))
+		return;
+
+	/* Initialized here, since the cache may be used before
+	 * the class of any context object was initialized. */
+	GST_DEBUG_CATEGORY_INIT(imx_v4l2_probe_cache_debug, "imxv4l2probecache", 0, "NXP i.MX V4L2 probe result cache");
+
+	probe_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_cached_probe_result);
+
+	filename = g_getenv(PROBE_CACHE_FILENAME_ENV_VAR);
+	if ((filename != NULL) && (filename[0] != '\0'))
+		load_probe_cache_file_unlocked(filename);
+}
+
+
+static void load_probe_cache_file_unlocked(gchar const *filename)
+{
+	GKeyFile *key_file;
+	GError *error = NULL;
+	gchar *version = NULL;
+	gchar **groups = NULL;
+	gsize group_index, num_groups;
+	GstImxV4L2VideoFormat const *video_formats;
+	gsize num_video_formats;
+
+	key_file = g_key_file_new();
+
+	if (!g_key_file_load_from_file(key_file, filename, G_KEY_FILE_NONE, &error))
+	{
+		GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "could not load probe cache file \"%s\": %s", filename, error->message);
+		goto finish;
+	}
+
+	/* The formats are stored as indices into the format table, and the
+	 * caps may depend on how this version probes, so results written
+	 * by a different version are not usable. */
+	version = g_key_file_get_string(key_file, PROBE_CACHE_FILE_HEADER_GROUP, "version", NULL);
+	if (g_strcmp0(version, VERSION) != 0)
+	{
+		GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "probe cache file \"%s\" was written by a different version; ignoring", filename);
+		goto finish;
+	}
+
+	video_formats = gst_imx_v4l2_get_video_formats();
+	num_video_formats = gst_imx_v4l2_get_num_video_formats();
+
+	groups = g_key_file_get_groups(key_file, &num_groups);
+
+	for (group_index = 0; group_index < num_groups; ++group_index)
+	{
+		gchar const *group = groups[group_index];
+		GstImxV4L2ProbeResult *probe_result;
+		gchar *caps_string;
+		gint *frame_sizes, *format_indices;
+		gsize i, num_frame_size_values = 0, num_format_indices = 0;
+		gboolean valid = TRUE;
+
+		if (g_strcmp0(group, PROBE_CACHE_FILE_HEADER_GROUP) == 0)
+			continue;
+
+		probe_result = g_new0(GstImxV4L2ProbeResult, 1);
+
+		caps_string = g_key_file_get_string(key_file, group, "device-caps", NULL);
+		if ((caps_string != NULL) && (caps_string[0] != '\0'))
+		{
+			probe_result->device_caps = gst_caps_from_string(caps_string);
+			valid = (probe_result->device_caps != NULL);
+		}
+		g_free(caps_string);
+
+		probe_result->capture_chip = g_key_file_get_integer(key_file, group, "capture-chip", NULL);
+		probe_result->v4l2_device_capabilities = (guint32)g_key_file_get_uint64(key_file, group, "device-capabilities", NULL);
+
+		frame_sizes = g_key_file_get_integer_list(key_file, group, "chip-specific-frame-sizes", &num_frame_size_values, NULL);
+		if ((frame_sizes != NULL) && (num_frame_size_values >= 2))
+		{
+			probe_result->num_chip_specific_frame_sizes = num_frame_size_values / 2;
+			probe_result->chip_specific_frame_sizes = g_new0(GstImxV4L2EnumeratedFrameSize, probe_result->num_chip_specific_frame_sizes);
+
+			for (i = 0; i < (gsize)(probe_result->num_chip_specific_frame_sizes); ++i)
+			{
+				probe_result->chip_specific_frame_sizes[i].width = frame_sizes[i * 2 + 0];
+				probe_result->chip_specific_frame_sizes[i].height = frame_sizes[i * 2 + 1];
+			}
+		}
+		g_free(frame_sizes);
+
+		format_indices = g_key_file_get_integer_list(key_file, group, "formats", &num_format_indices, NULL);
+		for (i = 0; i < num_format_indices; ++i)
+		{
+			if ((format_indices[i] < 0) || ((gsize)(format_indices[i]) >= num_video_formats))
+			{
+				valid = FALSE;
+				break;
+			}
+
+			probe_result->enumerated_v4l2_formats = g_list_append(probe_result->enumerated_v4l2_formats, (gpointer)(&(video_formats[format_indices[i]])));
+		}
+		g_free(format_indices);
+
+		if (valid)
+		{
+			GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "loaded cached probe result with key \"%s\" from file \"%s\"", group, filename);
+			g_hash_table_replace(probe_cache, g_strdup(group), probe_result);
+		}
+		else
+		{
+			GST_CAT_WARNING(imx_v4l2_probe_cache_debug, "cached probe result with key \"%s\" in file \"%s\" is invalid; ignoring", group, filename);
+			free_cached_probe_result(probe_result);
+		}
+	}
+
+finish:
+	g_strfreev(groups);
+	g_free(version);
+	g_clear_error(&error);
+	g_key_file_free(key_file);
+}
+
+
+static void save_probe_cache_file_unlocked(gchar const *filename)
+{
+	GKeyFile *key_file;
+	GError *error = NULL;
+	GHashTableIter iter;
+	gpointer key, value;
+	GstImxV4L2VideoFormat const *video_formats;
+
+	key_file = g_key_file_new();
+	video_formats = gst_imx_v4l2_get_video_formats();
+
+	g_key_file_set_string(key_file, PROBE_CACHE_FILE_HEADER_GROUP, "version", VERSION);
+
+	g_hash_table_iter_init(&iter, probe_cache);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		gchar const *group = (gchar const *)key;
+		GstImxV4L2ProbeResult const *probe_result = (GstImxV4L2ProbeResult const *)value;
+		GList *list_elem;
+		gint i;
+
+		if (probe_result->device_caps != NULL)
+		{
+			gchar *caps_string = gst_caps_to_string(probe_result->device_caps);
+			g_key_file_set_string(key_file, group, "device-caps", caps_string);
+			g_free(caps_string);
+		}
+		else
+			g_key_file_set_string(key_file, group, "device-caps", "");
+
+		g_key_file_set_integer(key_file, group, "capture-chip", probe_result->capture_chip);
+		g_key_file_set_uint64(key_file, group, "device-capabilities", probe_result->v4l2_device_capabilities);
+
+		if (probe_result->num_chip_specific_frame_sizes > 0)
+		{
+			gint *frame_sizes = g_new(gint, probe_result->num_chip_specific_frame_sizes * 2);
+
+			for (i = 0; i < probe_result->num_chip_specific_frame_sizes; ++i)
+			{
+				frame_sizes[i * 2 + 0] = probe_result->chip_specific_frame_sizes[i].width;
+				frame_sizes[i * 2 + 1] = probe_result->chip_specific_frame_sizes[i].height;
+			}
+
+			g_key_file_set_integer_list(key_file, group, "chip-specific-frame-sizes", frame_sizes, probe_result->num_chip_specific_frame_sizes * 2);
+			g_free(frame_sizes);
+		}
+
+		if (probe_result->enumerated_v4l2_formats != NULL)
+		{
+			gint *format_indices = g_new(gint, g_list_length(probe_result->enumerated_v4l2_formats));
+
+			for (i = 0, list_elem = probe_result->enumerated_v4l2_formats; list_elem != NULL; list_elem = list_elem->next, ++i)
+				format_indices[i] = (GstImxV4L2VideoFormat const *)(list_elem->data) - video_formats;
+
+			g_key_file_set_integer_list(key_file, group, "formats", format_indices, i);
+			g_free(format_indices);
+		}
+	}
+
+	if (!g_key_file_save_to_file(key_file, filename, &error))
+	{
+		GST_CAT_WARNING(imx_v4l2_probe_cache_debug, "could not save probe cache file \"%s\": %s", filename, error->message);
+		g_clear_error(&error);
+	}
+	else
+		GST_CAT_DEBUG(imx_v4l2_probe_cache_debug, "saved probe cache to file \"%s\"", filename);
+
+	g_key_file_free(key_file);
+}
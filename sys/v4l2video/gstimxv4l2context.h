@@ -26,6 +26,9 @@
 G_BEGIN_DECLS
 
 
+struct v4l2_capability;
+
+
 #define GST_TYPE_IMX_V4L2_CONTEXT             (gst_imx_v4l2_context_get_type())
 #define GST_IMX_V4L2_CONTEXT(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_V4L2_CONTEXT, GstImxV4L2Context))
 #define GST_IMX_V4L2_CONTEXT_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_V4L2_CONTEXT, GstImxV4L2ContextClass))
@@ -292,6 +295,59 @@ void gst_imx_v4l2_clear_probe_result(GstImxV4L2ProbeResult *probe_result);
  */
 GstImxV4L2VideoFormat const * gst_imx_v4l2_get_by_gst_video_format_from_probe_result(GstImxV4L2ProbeResult const *probe_result, GstVideoFormat gst_format);
 
+/**
+ * gst_imx_v4l2_create_probe_cache_key:
+ * @kind: String identifying what was probed, like "capture" or "output".
+ * @device_node: Device node of the probed device, like "/dev/video0".
+ * @capability: V4L2 capabilities of the device, as returned by VIDIOC_QUERYCAP.
+ *
+ * Creates a key for @gst_imx_v4l2_lookup_cached_probe_result and
+ * @gst_imx_v4l2_store_cached_probe_result. The key is made of @kind,
+ * @device_node, and the driver name, card name, bus info, driver version,
+ * and capability flags from @capability, so cached results are not reused
+ * if the device node refers to a different device (for example, if
+ * another sensor is attached to the same capture interface) or if the
+ * driver was updated.
+ *
+ * Returns: (transfer full) Newly allocated key string. Free with g_free.
+ */
+gchar* gst_imx_v4l2_create_probe_cache_key(gchar const *kind, gchar const *device_node, struct v4l2_capability const *capability);
+
+/**
+ * gst_imx_v4l2_lookup_cached_probe_result:
+ * @key: Key created with @gst_imx_v4l2_create_probe_cache_key.
+ * @probe_result: @GstImxV4L2ProbeResult to copy the cached result into.
+ *     Must be empty (that is, zero-initialized or cleared with
+ *     @gst_imx_v4l2_clear_probe_result).
+ *
+ * Looks up a probe result in the process-wide probe result cache. Probing
+ * enumerates formats, frame sizes, and frame intervals with a large number
+ * of ioctls, which can considerably delay the startup of pipelines, so
+ * probe results are cached and reused by later probe attempts.
+ *
+ * If the GST_IMX_V4L2_PROBE_CACHE environment variable is set, it is used as
+ * the filename of a file the cache is loaded from and saved to. This allows
+ * for reusing probe results across processes.
+ *
+ * This function is thread safe.
+ *
+ * Returns: TRUE if a result was found and copied into @probe_result, FALSE otherwise.
+ */
+gboolean gst_imx_v4l2_lookup_cached_probe_result(gchar const *key, GstImxV4L2ProbeResult *probe_result);
+
+/**
+ * gst_imx_v4l2_store_cached_probe_result:
+ * @key: Key created with @gst_imx_v4l2_create_probe_cache_key.
+ * @probe_result: @GstImxV4L2ProbeResult to store a copy of.
+ *
+ * Stores a copy of @probe_result in the process-wide probe result cache.
+ * Any previously cached result with the same key is replaced. See
+ * @gst_imx_v4l2_lookup_cached_probe_result for details.
+ *
+ * This function is thread safe.
+ */
+void gst_imx_v4l2_store_cached_probe_result(gchar const *key, GstImxV4L2ProbeResult const *probe_result);
+
 
 G_END_DECLS
 
@@ -19,6 +19,7 @@
 #include "gstimxv4l2prelude.h"
 
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -34,8 +35,11 @@
 #include <gst/video/video.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gst/imx/common/gstimxdmabufallocator.h"
+#include "gst/imx/common/gstimxdmabufferuploader.h"
 #include "gst/imx/video/gstimxvideodmabufferpool.h"
+#include "gst/imx/video/gstimxvideoutils.h"
 #include "gstimxv4l2videoformat.h"
+#include "gstimxv4l2context.h"
 #include "gstimxv4l2isivideotransform.h"
 
 
@@ -75,11 +79,16 @@ static GstStaticPadTemplate static_src_template = GST_STATIC_PAD_TEMPLATE(
 enum
 {
 	PROP_0,
-	PROP_DEVICE
+	PROP_DEVICE,
+	PROP_PREWARM_BUFFERS,
+	PROP_PIPELINE_DEPTH,
+	PROP_UPLOAD_STATS
 };
 
 
 #define DEFAULT_DEVICE NULL
+#define DEFAULT_PREWARM_BUFFERS 0
+#define DEFAULT_PIPELINE_DEPTH 3
 
 
 typedef struct
@@ -102,6 +111,10 @@ typedef struct
 	gsize driver_plane_sizes[3];
 
 	GstVideoInfo video_info;
+	/* The video info that was passed to setup_v4l2_queue(), before the
+	 * driver adjusted it. Used for checking if new caps require the
+	 * queue to be set up again. */
+	GstVideoInfo requested_video_info;
 
 	GstCaps *available_caps;
 
@@ -129,10 +142,36 @@ struct _GstImxV4L2ISIVideoTransform
 	GstBufferPool *input_buffer_pool, *output_buffer_pool;
 
 	gchar *device;
+	guint prewarm_buffers;
+	guint pipeline_depth;
 
 	int v4l2_fd;
 
+	/* Control pipe for waking up a blocking
+	 * gst_imx_v4l2_isi_video_transform_poll() call.
+	 * See gst_imx_v4l2_isi_video_transform_unlock(). */
+	int control_pipe_fds[2];
+
 	GstImxV4L2ISIVideoTransformQueue v4l2_output_queue, v4l2_capture_queue;
+
+	/* Maximum number of frames that may be inside the ISI at the same
+	 * time. Derived from pipeline_depth and the number of buffers the
+	 * driver actually allocated when the V4L2 queues were set up. */
+	guint pipeline_depth_in_use;
+	/* The pipeline_depth value the V4L2 queues were set up with. */
+	guint configured_pipeline_depth;
+	/* Additional latency introduced by keeping frames in the ISI. */
+	GstClockTime pipeline_latency;
+
+	/* Metadata-only buffers (timestamps, flags etc.) of the frames
+	 * that were queued in the ISI but not yet dequeued, in queuing
+	 * order. Protected by the stream lock. */
+	GQueue pending_frames;
+
+	/* Counts how many input frames could be passed to the ISI directly
+	 * (imported) and how many had to be copied into DMA memory first.
+	 * Protected by the object lock. */
+	GstImxDmaBufferUploaderStats upload_stats;
 };
 
 
@@ -145,6 +184,12 @@ struct _GstImxV4L2ISIVideoTransformClass
 /* Cached quark to avoid contention on the global quark table lock */
 static GQuark meta_tag_video_quark;
 
+/* Device node found by the last successful scan. Scanning opens and
+ * queries every /dev/video* node, so this one is tried first the next
+ * time a scan is needed. */
+G_LOCK_DEFINE_STATIC(scanned_isi_device_node);
+static gchar *scanned_isi_device_node = NULL;
+
 
 G_DEFINE_TYPE(GstImxV4L2ISIVideoTransform, gst_imx_v4l2_isi_video_transform, GST_TYPE_BASE_TRANSFORM)
 
@@ -164,8 +209,14 @@ static gboolean gst_imx_v4l2_isi_video_transform_set_caps(GstBaseTransform *tran
 /* Allocator. */
 static gboolean gst_imx_v4l2_isi_video_transform_decide_allocation(GstBaseTransform *transform, GstQuery *query);
 
+/* Events and queries. */
+static gboolean gst_imx_v4l2_isi_video_transform_sink_event(GstBaseTransform *transform, GstEvent *event);
+static gboolean gst_imx_v4l2_isi_video_transform_query(GstBaseTransform *transform, GstPadDirection direction, GstQuery *query);
+
 /* Frame output. */
-static GstFlowReturn gst_imx_v4l2_isi_video_transform_prepare_output_buffer(GstBaseTransform *transform, GstBuffer *input_buffer, GstBuffer **output_buffer);
+static GstBuffer* gst_imx_v4l2_isi_video_transform_upload_input_buffer(GstImxV4L2ISIVideoTransform *self, GstBuffer *input_buffer);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_submit_input_buffer(GstBaseTransform *transform, gboolean is_discont, GstBuffer *input_buffer);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_generate_output(GstBaseTransform *transform, GstBuffer **output_buffer);
 static GstFlowReturn gst_imx_v4l2_isi_video_transform_transform_frame(GstBaseTransform *transform, GstBuffer *input_buffer, GstBuffer *output_buffer);
 static gboolean gst_imx_v4l2_isi_video_transform_transform_size(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, gsize size, GstCaps *othercaps, gsize *othersize);
 
@@ -178,14 +229,25 @@ static gboolean gst_imx_v4l2_isi_video_transform_copy_metadata(GstBaseTransform
 static gboolean gst_imx_v4l2_isi_video_transform_open(GstImxV4L2ISIVideoTransform *self);
 static void gst_imx_v4l2_isi_video_transform_close(GstImxV4L2ISIVideoTransform *self);
 
-static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV4L2ISIVideoTransform *self);
-static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue);
+static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV4L2ISIVideoTransform *self, gchar **device_node);
+static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue, gchar const *cache_key);
 
 static gboolean gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue, GstVideoInfo const *original_video_info);
 static void gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue);
 static gboolean gst_imx_v4l2_isi_video_transform_queue_buffer(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue, GstBuffer *gstbuffer);
 static GstBuffer* gst_imx_v4l2_isi_video_transform_dequeue_buffer(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue);
 static gboolean gst_imx_v4l2_isi_video_transform_enable_stream(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue, gboolean do_enable);
+static void gst_imx_v4l2_isi_video_transform_reset_v4l2_queue(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue);
+static gboolean gst_imx_v4l2_isi_video_transform_v4l2_queue_needs_setup(GstImxV4L2ISIVideoTransformQueue *queue, GstVideoInfo const *video_info);
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_poll(GstImxV4L2ISIVideoTransform *self, gshort events, gboolean block, gshort *revents);
+static void gst_imx_v4l2_isi_video_transform_unlock(GstImxV4L2ISIVideoTransform *self);
+static void gst_imx_v4l2_isi_video_transform_unlock_stop(GstImxV4L2ISIVideoTransform *self);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_fill_capture_queue(GstImxV4L2ISIVideoTransform *self);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_reclaim_output_buffers(GstImxV4L2ISIVideoTransform *self, gboolean block);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_retrieve_frame(GstImxV4L2ISIVideoTransform *self, gboolean block, GstBuffer **output_buffer);
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_drain(GstImxV4L2ISIVideoTransform *self);
+static void gst_imx_v4l2_isi_video_transform_flush(GstImxV4L2ISIVideoTransform *self);
 
 
 static void gst_imx_v4l2_isi_video_transform_class_init(GstImxV4L2ISIVideoTransformClass *klass)
@@ -215,9 +277,12 @@ static void gst_imx_v4l2_isi_video_transform_class_init(GstImxV4L2ISIVideoTransf
 	base_transform_class->fixate_caps           = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_fixate_caps);
 	base_transform_class->set_caps              = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_set_caps);
 	base_transform_class->decide_allocation     = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_decide_allocation);
+	base_transform_class->sink_event            = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_sink_event);
+	base_transform_class->query                 = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_query);
 	base_transform_class->transform             = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_transform_frame);
 	base_transform_class->transform_size        = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_transform_size);
-	base_transform_class->prepare_output_buffer = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_prepare_output_buffer);
+	base_transform_class->submit_input_buffer   = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_submit_input_buffer);
+	base_transform_class->generate_output       = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_generate_output);
 	base_transform_class->transform_meta        = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_transform_meta);
 	base_transform_class->copy_metadata         = GST_DEBUG_FUNCPTR(gst_imx_v4l2_isi_video_transform_copy_metadata);
 
@@ -234,6 +299,44 @@ static void gst_imx_v4l2_isi_video_transform_class_init(GstImxV4L2ISIVideoTransf
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PREWARM_BUFFERS,
+		g_param_spec_uint(
+			"prewarm-buffers",
+			"Prewarm buffers",
+			"How many input and output buffers to allocate and prefault as soon as the buffer pools are set up "
+			"(0 = allocate buffers on demand; higher values avoid allocation stalls during playback)",
+			0, G_MAXUINT,
+			DEFAULT_PREWARM_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PIPELINE_DEPTH,
+		g_param_spec_uint(
+			"pipeline-depth",
+			"Pipeline depth",
+			"How many frames can be queued in the ISI at the same time "
+			"(1 = convert one frame at a time; higher values keep the ISI busy while frames are pushed downstream, "
+			"at the cost of (pipeline-depth - 1) frames of additional latency); takes effect after the next caps change",
+			1, 16,
+			DEFAULT_PIPELINE_DEPTH,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were passed to the ISI (zero-copy DMA-BUF import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 
 	gst_element_class_set_static_metadata(
 		element_class,
@@ -254,8 +357,18 @@ void gst_imx_v4l2_isi_video_transform_init(GstImxV4L2ISIVideoTransform *self)
 	self->output_buffer_pool = NULL;
 
 	self->device = g_strdup(DEFAULT_DEVICE);
+	self->prewarm_buffers = DEFAULT_PREWARM_BUFFERS;
+	self->pipeline_depth = DEFAULT_PIPELINE_DEPTH;
 
 	self->v4l2_fd = -1;
+	self->control_pipe_fds[0] = -1;
+	self->control_pipe_fds[1] = -1;
+
+	self->pipeline_depth_in_use = 1;
+	self->configured_pipeline_depth = 0;
+	self->pipeline_latency = 0;
+	g_queue_init(&(self->pending_frames));
+	memset(&(self->upload_stats), 0, sizeof(self->upload_stats));
 
 	INIT_V4L2_QUEUE(&(self->v4l2_output_queue), V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
 	INIT_V4L2_QUEUE(&(self->v4l2_capture_queue), V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
@@ -289,6 +402,18 @@ static void gst_imx_v4l2_isi_video_transform_set_property(GObject *object, guint
 			GST_OBJECT_UNLOCK(self);
 			break;
 
+		case PROP_PREWARM_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			self->prewarm_buffers = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_PIPELINE_DEPTH:
+			GST_OBJECT_LOCK(self);
+			self->pipeline_depth = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -308,6 +433,24 @@ static void gst_imx_v4l2_isi_video_transform_get_property(GObject *object, guint
 			GST_OBJECT_UNLOCK(self);
 			break;
 
+		case PROP_PREWARM_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->prewarm_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_PIPELINE_DEPTH:
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->pipeline_depth);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_UPLOAD_STATS:
+			GST_OBJECT_LOCK(self);
+			g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&(self->upload_stats)));
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -331,6 +474,12 @@ static GstStateChangeReturn gst_imx_v4l2_isi_video_transform_change_state(GstEle
 			break;
 		}
 
+		case GST_STATE_CHANGE_PAUSED_TO_READY:
+			/* Wake up the streaming thread if it is waiting for the ISI,
+			 * since the pads cannot be deactivated until it is done. */
+			gst_imx_v4l2_isi_video_transform_unlock(self);
+			break;
+
 		default:
 			break;
 	}
@@ -341,6 +490,11 @@ static GstStateChangeReturn gst_imx_v4l2_isi_video_transform_change_state(GstEle
 
 	switch (transition)
 	{
+		case GST_STATE_CHANGE_PAUSED_TO_READY:
+			gst_imx_v4l2_isi_video_transform_unlock_stop(self);
+			gst_imx_v4l2_isi_video_transform_flush(self);
+			break;
+
 		case GST_STATE_CHANGE_READY_TO_NULL:
 			gst_imx_v4l2_isi_video_transform_close(self);
 			break;
@@ -1156,77 +1310,183 @@ static void gst_imx_v4l2_isi_video_transform_fixate_format_caps(GstBaseTransform
 
 static gboolean gst_imx_v4l2_isi_video_transform_set_caps(GstBaseTransform *transform, GstCaps *input_caps, GstCaps *output_caps)
 {
-	GstVideoInfo video_info;
+	GstVideoInfo input_video_info, output_video_info;
+	guint prewarm_buffers;
+	guint pipeline_depth;
+	gboolean setup_output_queue, setup_capture_queue;
+	GstClockTime pipeline_latency;
+	gboolean latency_changed;
 	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
 
-	/* We do not drain here, since the mem2mem device does not _actually_
-	 * queue frames. As soon as a frame is pushed into the output queue,
-	 * the device begins processing, and eventually puts the converted
-	 * frame into the capture queue. */
-
 	GST_DEBUG_OBJECT(self, "setting caps:  input: %" GST_PTR_FORMAT "  output: %" GST_PTR_FORMAT, (gpointer)input_caps, (gpointer)output_caps);
 
-	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_output_queue));
-	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_capture_queue));
-
-	if (!gst_video_info_from_caps(&video_info, input_caps))
+	if (!gst_video_info_from_caps(&input_video_info, input_caps))
 	{
 		GST_ERROR_OBJECT(self, "could not convert input caps to video info; caps: %" GST_PTR_FORMAT, (gpointer)input_caps);
+		return FALSE;
 	}
 
-	if (!gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(self, &(self->v4l2_output_queue), &video_info))
+	if (!gst_video_info_from_caps(&output_video_info, output_caps))
+	{
+		GST_ERROR_OBJECT(self, "could not convert output caps to video info; caps: %" GST_PTR_FORMAT, (gpointer)output_caps);
 		return FALSE;
+	}
+
+	GST_OBJECT_LOCK(self);
+	prewarm_buffers = self->prewarm_buffers;
+	pipeline_depth = self->pipeline_depth;
+	GST_OBJECT_UNLOCK(self);
+
+	/* Only set up the V4L2 queues whose frame layout changed. The other
+	 * queues keep their V4L2 buffers, and their buffer pools are reused.
+	 * This avoids needless reallocations, for example when only the
+	 * input or only the output resolution changes. The number of V4L2
+	 * buffers depends on the pipeline depth, so if that one changed,
+	 * both queues have to be set up again. */
+	setup_output_queue = (pipeline_depth != self->configured_pipeline_depth)
+	                  || gst_imx_v4l2_isi_video_transform_v4l2_queue_needs_setup(&(self->v4l2_output_queue), &input_video_info);
+	setup_capture_queue = (pipeline_depth != self->configured_pipeline_depth)
+	                   || gst_imx_v4l2_isi_video_transform_v4l2_queue_needs_setup(&(self->v4l2_capture_queue), &output_video_info);
 
-	if (!gst_video_info_from_caps(&video_info, output_caps))
+	GST_DEBUG_OBJECT(
+		self,
+		"need to set up queues:  output: %s  capture: %s",
+		setup_output_queue ? "yes" : "no",
+		setup_capture_queue ? "yes" : "no"
+	);
+
+	if (setup_output_queue || setup_capture_queue)
 	{
-		GST_ERROR_OBJECT(self, "could not convert output caps to video info; caps: %" GST_PTR_FORMAT, (gpointer)output_caps);
+		/* Frames that are still in the ISI were already drained if a
+		 * caps event arrived (see gst_imx_v4l2_isi_video_transform_sink_event()).
+		 * The base class however also calls set_caps when downstream
+		 * requests a reconfiguration, without any caps event. Push out
+		 * such frames before the queues are reset, since they would
+		 * otherwise be lost. The output caps are not set on the srcpad
+		 * until set_caps returns, so these frames still go out with
+		 * the old caps. */
+		gst_imx_v4l2_isi_video_transform_drain(self);
+
+		/* Both streams must be off before either format can be changed.
+		 * Flushing resets both queues, which turns off their streams,
+		 * but keeps their buffers. It also discards the metadata of any
+		 * frames that could not be drained. */
+		gst_imx_v4l2_isi_video_transform_flush(self);
 	}
 
-	if (!gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(self, &(self->v4l2_capture_queue), &video_info))
-		return FALSE;
+	/* setup_v4l2_queue() uses this to determine how many V4L2 buffers to request. */
+	self->pipeline_depth_in_use = pipeline_depth;
+	self->configured_pipeline_depth = pipeline_depth;
 
-	if (self->input_buffer_pool != NULL)
+	if (setup_output_queue)
 	{
-		gst_buffer_pool_set_active(self->input_buffer_pool, FALSE);
-		gst_object_unref(GST_OBJECT(self->input_buffer_pool));
-		self->input_buffer_pool = NULL;
+		gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_output_queue));
+		if (!gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(self, &(self->v4l2_output_queue), &input_video_info))
+			goto error;
 	}
 
-	if (self->output_buffer_pool != NULL)
+	if (setup_capture_queue)
 	{
-		gst_buffer_pool_set_active(self->output_buffer_pool, FALSE);
-		gst_object_unref(GST_OBJECT(self->output_buffer_pool));
-		self->output_buffer_pool = NULL;
+		gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_capture_queue));
+		if (!gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(self, &(self->v4l2_capture_queue), &output_video_info))
+			goto error;
 	}
 
-	self->input_buffer_pool = gst_imx_video_dma_buffer_pool_new(
-		self->imx_dma_buffer_allocator,
-		&(self->v4l2_output_queue.video_info),
-		!(self->v4l2_output_queue.planes_are_contiguous),
-		self->v4l2_output_queue.planes_are_contiguous ? NULL : self->v4l2_output_queue.driver_plane_sizes
-	);
-	gst_buffer_pool_set_active(self->input_buffer_pool, TRUE);
+	/* The driver may have allocated fewer buffers than requested. */
+	self->pipeline_depth_in_use = MIN(pipeline_depth, (guint)(self->v4l2_output_queue.num_buffers));
+	self->pipeline_depth_in_use = MIN(self->pipeline_depth_in_use, (guint)(self->v4l2_capture_queue.num_buffers));
+
+	/* Up to (pipeline_depth_in_use - 1) frames stay in the ISI
+	 * after a frame was submitted, adding that much latency. */
+	if ((GST_VIDEO_INFO_FPS_N(&output_video_info) > 0) && (GST_VIDEO_INFO_FPS_D(&output_video_info) > 0))
+	{
+		pipeline_latency = gst_util_uint64_scale_int(
+			(self->pipeline_depth_in_use - 1) * GST_SECOND,
+			GST_VIDEO_INFO_FPS_D(&output_video_info),
+			GST_VIDEO_INFO_FPS_N(&output_video_info)
+		);
+	}
+	else
+		pipeline_latency = 0;
 
-	self->output_buffer_pool = gst_imx_video_dma_buffer_pool_new(
-		self->imx_dma_buffer_allocator,
-		&(self->v4l2_capture_queue.video_info),
-		!(self->v4l2_capture_queue.planes_are_contiguous),
-		self->v4l2_capture_queue.planes_are_contiguous ? NULL : self->v4l2_capture_queue.driver_plane_sizes
+	GST_DEBUG_OBJECT(
+		self,
+		"pipeline depth: requested %u in use %u; latency: %" GST_TIME_FORMAT,
+		pipeline_depth,
+		self->pipeline_depth_in_use,
+		GST_TIME_ARGS(pipeline_latency)
 	);
-	gst_buffer_pool_set_active(self->output_buffer_pool, TRUE);
+
+	GST_OBJECT_LOCK(self);
+	latency_changed = (self->pipeline_latency != pipeline_latency);
+	self->pipeline_latency = pipeline_latency;
+	GST_OBJECT_UNLOCK(self);
+
+	if (latency_changed)
+		gst_element_post_message(GST_ELEMENT(self), gst_message_new_latency(GST_OBJECT(self)));
+
+	if (setup_output_queue || (self->input_buffer_pool == NULL))
+	{
+		if (self->input_buffer_pool != NULL)
+		{
+			gst_buffer_pool_set_active(self->input_buffer_pool, FALSE);
+			gst_object_unref(GST_OBJECT(self->input_buffer_pool));
+			self->input_buffer_pool = NULL;
+		}
+
+		self->input_buffer_pool = gst_imx_video_dma_buffer_pool_new(
+			self->imx_dma_buffer_allocator,
+			&(self->v4l2_output_queue.video_info),
+			!(self->v4l2_output_queue.planes_are_contiguous),
+			self->v4l2_output_queue.planes_are_contiguous ? NULL : self->v4l2_output_queue.driver_plane_sizes
+		);
+		if (prewarm_buffers > 0)
+			gst_imx_video_dma_buffer_pool_set_prewarm(self->input_buffer_pool, prewarm_buffers, TRUE);
+		gst_buffer_pool_set_active(self->input_buffer_pool, TRUE);
+	}
+	else
+		GST_DEBUG_OBJECT(self, "reusing input buffer pool");
+
+	if (setup_capture_queue || (self->output_buffer_pool == NULL))
+	{
+		if (self->output_buffer_pool != NULL)
+		{
+			gst_buffer_pool_set_active(self->output_buffer_pool, FALSE);
+			gst_object_unref(GST_OBJECT(self->output_buffer_pool));
+			self->output_buffer_pool = NULL;
+		}
+
+		self->output_buffer_pool = gst_imx_video_dma_buffer_pool_new(
+			self->imx_dma_buffer_allocator,
+			&(self->v4l2_capture_queue.video_info),
+			!(self->v4l2_capture_queue.planes_are_contiguous),
+			self->v4l2_capture_queue.planes_are_contiguous ? NULL : self->v4l2_capture_queue.driver_plane_sizes
+		);
+		if (prewarm_buffers > 0)
+			gst_imx_video_dma_buffer_pool_set_prewarm(self->output_buffer_pool, prewarm_buffers, TRUE);
+		gst_buffer_pool_set_active(self->output_buffer_pool, TRUE);
+	}
+	else
+		GST_DEBUG_OBJECT(self, "reusing output buffer pool");
 
 	return TRUE;
+
+error:
+	/* Make sure the next set_caps call sets up both queues again. */
+	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_output_queue));
+	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_capture_queue));
+	return FALSE;
 }
 
 
 static gboolean gst_imx_v4l2_isi_video_transform_decide_allocation(GstBaseTransform *transform, GstQuery *query)
 {
 	/* NOTE: This actually amounts to a no-op, since we install our
-	 * own prepare_output_buffer vfunc. That one does not chain up
-	 * to the base class, and the vfunc of that base class is the
-	 * one that uses the buffer pool and allocator that are picked
-	 * by decide_allocation. Our prepare_output_buffer _doesn't_
-	 * use the contents of the allocation query. */
+	 * own generate_output vfunc. That one does not chain up to the
+	 * base class (except in passthrough mode), and the vfuncs of that
+	 * base class are the ones that use the buffer pool and allocator
+	 * that are picked by decide_allocation. Our generate_output
+	 * _doesn't_ use the contents of the allocation query. */
 
 	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
 	guint buffer_size;
@@ -1247,127 +1507,157 @@ static gboolean gst_imx_v4l2_isi_video_transform_decide_allocation(GstBaseTransf
 }
 
 
-static GstFlowReturn gst_imx_v4l2_isi_video_transform_prepare_output_buffer(GstBaseTransform *transform, GstBuffer *input_buffer, GstBuffer **output_buffer)
+static GstBuffer* gst_imx_v4l2_isi_video_transform_upload_input_buffer(GstImxV4L2ISIVideoTransform *self, GstBuffer *input_buffer)
 {
-	gint i;
-	GstFlowReturn flow_ret = GST_FLOW_OK;
-	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
-	GstBuffer *original_input_buffer = input_buffer;
-
-	*output_buffer = NULL;
-
-	g_assert(self->v4l2_capture_queue.initialized);
-
-	if (gst_is_dmabuf_memory(gst_buffer_peek_memory(input_buffer, 0)))
+	GstFlowReturn flow_ret;
+	GstBuffer *uploaded_input_buffer = NULL;
+	GstVideoInfo *video_info = &(self->v4l2_output_queue.video_info);
+	GstVideoMeta *video_meta;
+	GstVideoFrame src_frame, dest_frame;
+	GstClockTime copy_start_time;
+	gboolean frames_copied;
+
+	flow_ret = gst_buffer_pool_acquire_buffer(self->input_buffer_pool, &uploaded_input_buffer, NULL);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
 	{
-		gst_buffer_ref(input_buffer);
+		GST_ERROR_OBJECT(self, "could not acquire buffer from input buffer pool: %s", gst_flow_get_name(flow_ret));
+		return NULL;
 	}
-	else
-	{
-		gint y, width, height, plane_index;
-		GstBuffer *uploaded_input_buffer;
-		GstVideoInfo *video_info;
-		GstVideoFrame video_frame;
-
-		video_info = &(self->v4l2_output_queue.video_info);
 
-		flow_ret = gst_buffer_pool_acquire_buffer(self->input_buffer_pool, &uploaded_input_buffer, NULL);
-		if (G_UNLIKELY(flow_ret) != GST_FLOW_OK)
-			goto error;
-
-		width = GST_VIDEO_INFO_WIDTH(video_info);
-		height = GST_VIDEO_INFO_HEIGHT(video_info);
+	/* Pool buffers carry no video meta. Add one that describes where the
+	 * planes are, so that gst_video_frame_map() can map each plane on its
+	 * own. This is essential with multi-memory buffers (one DMA-BUF per
+	 * plane), which would otherwise get merged into one system memory
+	 * block. The meta is flagged as pooled so it is only added once. */
+	video_meta = gst_buffer_get_video_meta(uploaded_input_buffer);
+	if (video_meta == NULL)
+	{
+		gint plane_index;
+		gsize offsets[GST_VIDEO_MAX_PLANES];
+		gint strides[GST_VIDEO_MAX_PLANES];
+		gsize offset = 0;
 
-		if (gst_video_frame_map(&video_frame, video_info, input_buffer, GST_MAP_READ))
+		for (plane_index = 0; plane_index < (gint)GST_VIDEO_INFO_N_PLANES(video_info); ++plane_index)
 		{
-			for (plane_index = 0; plane_index < (gint)GST_VIDEO_INFO_N_PLANES(video_info); ++plane_index)
+			strides[plane_index] = GST_VIDEO_INFO_PLANE_STRIDE(video_info, plane_index);
+
+			if (self->v4l2_output_queue.planes_are_contiguous)
+			{
+				offsets[plane_index] = GST_VIDEO_INFO_PLANE_OFFSET(video_info, plane_index);
+			}
+			else
 			{
-				GstMemory *memory;
-				GstMapInfo map_info;
-				guint8 const *src_pixels;
-				guint8 *dest_pixels;
+				offsets[plane_index] = offset;
+				offset += gst_memory_get_sizes(gst_buffer_peek_memory(uploaded_input_buffer, plane_index), NULL, NULL);
+			}
+		}
 
-				memory = gst_buffer_peek_memory(uploaded_input_buffer, plane_index);
-				g_assert(memory != NULL);
+		video_meta = gst_buffer_add_video_meta_full(
+			uploaded_input_buffer,
+			GST_VIDEO_FRAME_FLAG_NONE,
+			GST_VIDEO_INFO_FORMAT(video_info),
+			GST_VIDEO_INFO_WIDTH(video_info),
+			GST_VIDEO_INFO_HEIGHT(video_info),
+			GST_VIDEO_INFO_N_PLANES(video_info),
+			offsets,
+			strides
+		);
+		GST_META_FLAG_SET(video_meta, GST_META_FLAG_POOLED);
+	}
 
-				gst_memory_map(memory, &map_info, GST_MAP_WRITE);
+	if (!gst_video_frame_map(&src_frame, video_info, input_buffer, GST_MAP_READ))
+	{
+		GST_ERROR_OBJECT(self, "could not map input buffer");
+		goto error;
+	}
 
-				src_pixels = GST_VIDEO_FRAME_PLANE_DATA(&video_frame, plane_index);
-				dest_pixels = map_info.data;
+	if (!gst_video_frame_map(&dest_frame, video_info, uploaded_input_buffer, GST_MAP_WRITE))
+	{
+		GST_ERROR_OBJECT(self, "could not map upload buffer");
+		gst_video_frame_unmap(&src_frame);
+		goto error;
+	}
 
-				for (y = 0; y < height; ++y)
-				{
-					memcpy(
-						dest_pixels + y * GST_VIDEO_INFO_PLANE_STRIDE(video_info, plane_index),
-						src_pixels + y * GST_VIDEO_FRAME_PLANE_STRIDE(&video_frame, plane_index),
-						width * GST_VIDEO_FRAME_COMP_PSTRIDE(&video_frame, plane_index)
-					);
-				}
+	copy_start_time = gst_util_get_timestamp();
+	frames_copied = gst_imx_video_utils_copy_frame(&dest_frame, &src_frame, 0);
 
-				gst_memory_unmap(memory, &map_info);
-			}
+	gst_video_frame_unmap(&dest_frame);
+	gst_video_frame_unmap(&src_frame);
 
-			gst_video_frame_unmap(&video_frame);
-		}
-		else
-		{
-			GST_ERROR_OBJECT(self, "could not map input buffer");
-			gst_buffer_unref(uploaded_input_buffer);
-			goto error;
-		}
-
-		input_buffer = uploaded_input_buffer;
+	if (!frames_copied)
+	{
+		GST_ERROR_OBJECT(self, "could not copy input frame into upload buffer");
+		goto error;
 	}
 
-	if (!(self->v4l2_capture_queue.stream_enabled))
-	{
-		for (i = 0; i < self->v4l2_capture_queue.num_buffers; ++i)
-		{
-			GstBuffer *gstbuffer;
-			gboolean ret;
-			flow_ret = gst_buffer_pool_acquire_buffer(self->output_buffer_pool, &gstbuffer, NULL);
-			if (G_UNLIKELY(flow_ret) != GST_FLOW_OK)
-				goto error;
+	GST_OBJECT_LOCK(self);
+	self->upload_stats.num_copied_buffers++;
+	self->upload_stats.num_copied_bytes += gst_buffer_get_size(input_buffer);
+	self->upload_stats.copy_duration += GST_CLOCK_DIFF(copy_start_time, gst_util_get_timestamp());
+	GST_OBJECT_UNLOCK(self);
 
-			GST_LOG_OBJECT(self, "queuing V4L2 capture buffer with index %d", i);
-			ret = gst_imx_v4l2_isi_video_transform_queue_buffer(self, &(self->v4l2_capture_queue), gstbuffer);
+	return uploaded_input_buffer;
 
-			gst_buffer_unref(gstbuffer);
+error:
+	gst_buffer_unref(uploaded_input_buffer);
+	return NULL;
+}
 
-			if (!ret)
-				goto error;
-		}
 
-		if (!gst_imx_v4l2_isi_video_transform_enable_stream(self, &(self->v4l2_capture_queue), TRUE))
-			goto error;
-	}
-	else
-	{
-		GstBuffer *gstbuffer;
-		gboolean ret;
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_submit_input_buffer(GstBaseTransform *transform, gboolean is_discont, GstBuffer *input_buffer)
+{
+	GstFlowReturn flow_ret;
+	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
+	GstBuffer *original_input_buffer;
+	GstBuffer *frame_metadata;
 
-		GST_LOG_OBJECT(self, "acquiring new buffer to queue it in the V4L2 capture queue");
+	/* Let the base class take care of reconfiguration and QoS. If it
+	 * accepts the buffer, it stores it in queued_buf. */
+	flow_ret = GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_isi_video_transform_parent_class)->submit_input_buffer(transform, is_discont, input_buffer);
+	if (flow_ret != GST_FLOW_OK)
+		return flow_ret;
 
-		flow_ret = gst_buffer_pool_acquire_buffer(self->output_buffer_pool, &gstbuffer, NULL);
-		if (G_UNLIKELY(flow_ret) != GST_FLOW_OK)
-			goto error;
+	/* In passthrough mode, the base class' generate_output
+	 * pushes the queued buffer downstream as-is. */
+	if (gst_base_transform_is_passthrough(transform))
+		return GST_FLOW_OK;
 
-		ret = gst_imx_v4l2_isi_video_transform_queue_buffer(self, &(self->v4l2_capture_queue), gstbuffer);
+	original_input_buffer = transform->queued_buf;
+	transform->queued_buf = NULL;
+	input_buffer = NULL;
 
-		gst_buffer_unref(gstbuffer);
+	g_assert(original_input_buffer != NULL);
+	g_assert(self->v4l2_capture_queue.initialized);
 
-		if (!ret)
-			goto error;
-	}
+	if (gst_is_dmabuf_memory(gst_buffer_peek_memory(original_input_buffer, 0)))
+	{
+		input_buffer = gst_buffer_ref(original_input_buffer);
 
-	if (self->v4l2_output_queue.stream_enabled)
+		GST_OBJECT_LOCK(self);
+		self->upload_stats.num_imported_buffers++;
+		GST_OBJECT_UNLOCK(self);
+	}
+	else
 	{
-		GstBuffer *previous_input_buffer;
-		GST_LOG_OBJECT(self, "dequeuing previously queued V4L2 output buffer since associated upstream frame was already processed");
-		previous_input_buffer = gst_imx_v4l2_isi_video_transform_dequeue_buffer(self, &(self->v4l2_output_queue));
-		gst_buffer_unref(previous_input_buffer);
+		input_buffer = gst_imx_v4l2_isi_video_transform_upload_input_buffer(self, original_input_buffer);
+		if (G_UNLIKELY(input_buffer == NULL))
+			goto error;
 	}
 
+	flow_ret = gst_imx_v4l2_isi_video_transform_fill_capture_queue(self);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	/* Get back the output buffers whose frames the ISI already finished
+	 * reading from. If all of them are still in use, we have to wait
+	 * until the ISI is done with at least one of them. */
+	flow_ret = gst_imx_v4l2_isi_video_transform_reclaim_output_buffers(
+		self,
+		self->v4l2_output_queue.num_queued_buffers == self->v4l2_output_queue.num_buffers
+	);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
 	GST_LOG_OBJECT(self, "queuing new V4L2 output buffer to process upstream frame");
 	if (!gst_imx_v4l2_isi_video_transform_queue_buffer(self, &(self->v4l2_output_queue), input_buffer))
 		goto error;
@@ -1375,24 +1665,24 @@ static GstFlowReturn gst_imx_v4l2_isi_video_transform_prepare_output_buffer(GstB
 	if (!(self->v4l2_output_queue.stream_enabled))
 	{
 		if (!gst_imx_v4l2_isi_video_transform_enable_stream(self, &(self->v4l2_output_queue), TRUE))
-			goto error;		
+			goto error;
 	}
 
-	GST_LOG_OBJECT(self, "dequeuing V4L2 capture buffer to retrieve converted frame");
-	*output_buffer = gst_imx_v4l2_isi_video_transform_dequeue_buffer(self, &(self->v4l2_capture_queue));
-	if (G_UNLIKELY(*output_buffer == NULL))
-		goto error;
+	/* The ISI processes frames in the order they are queued, so the
+	 * converted frames come out of the capture queue in that order
+	 * as well. Remember the metadata (timestamps, flags etc.) of this
+	 * frame until its converted version is dequeued. An empty buffer
+	 * is used for this to avoid holding on to the upstream buffer. */
+	frame_metadata = gst_buffer_new();
+	gst_imx_v4l2_isi_video_transform_copy_metadata(transform, original_input_buffer, frame_metadata);
+	g_queue_push_tail(&(self->pending_frames), frame_metadata);
 
-	gst_imx_v4l2_isi_video_transform_copy_metadata(transform, original_input_buffer, *output_buffer);
+	GST_LOG_OBJECT(self, "%u frame(s) now pending in the ISI", g_queue_get_length(&(self->pending_frames)));
 
 finish:
-	if ((flow_ret != GST_FLOW_OK) && (*output_buffer != NULL))
-	{
-		gst_buffer_unref(*output_buffer);
-		*output_buffer = NULL;
-	}
-
-	gst_buffer_unref(input_buffer);
+	if (input_buffer != NULL)
+		gst_buffer_unref(input_buffer);
+	gst_buffer_unref(original_input_buffer);
 
 	return flow_ret;
 
@@ -1403,9 +1693,102 @@ error:
 }
 
 
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_generate_output(GstBaseTransform *transform, GstBuffer **output_buffer)
+{
+	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
+	gboolean block;
+
+	*output_buffer = NULL;
+
+	if (gst_base_transform_is_passthrough(transform))
+		return GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_isi_video_transform_parent_class)->generate_output(transform, output_buffer);
+
+	/* Only wait for the ISI once the pipeline is full. Until then, return
+	 * whatever converted frames are already available (if any), so that
+	 * the ISI can work on the queued frames while upstream produces the
+	 * next one and downstream consumes the previous ones. */
+	block = (g_queue_get_length(&(self->pending_frames)) >= self->pipeline_depth_in_use);
+
+	return gst_imx_v4l2_isi_video_transform_retrieve_frame(self, block, output_buffer);
+}
+
+
+static gboolean gst_imx_v4l2_isi_video_transform_sink_event(GstBaseTransform *transform, GstEvent *event)
+{
+	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
+
+	switch (GST_EVENT_TYPE(event))
+	{
+		case GST_EVENT_EOS:
+		case GST_EVENT_CAPS:
+			/* Push out the frames that are still in the ISI before EOS
+			 * is forwarded or the V4L2 queues get reconfigured. */
+			gst_imx_v4l2_isi_video_transform_drain(self);
+			break;
+
+		case GST_EVENT_FLUSH_START:
+			/* This is not serialized, so the streaming thread
+			 * may currently be waiting for the ISI. */
+			gst_imx_v4l2_isi_video_transform_unlock(self);
+			break;
+
+		case GST_EVENT_FLUSH_STOP:
+			gst_imx_v4l2_isi_video_transform_unlock_stop(self);
+			gst_imx_v4l2_isi_video_transform_flush(self);
+			break;
+
+		default:
+			break;
+	}
+
+	return GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_isi_video_transform_parent_class)->sink_event(transform, event);
+}
+
+
+static gboolean gst_imx_v4l2_isi_video_transform_query(GstBaseTransform *transform, GstPadDirection direction, GstQuery *query)
+{
+	GstImxV4L2ISIVideoTransform *self = GST_IMX_V4L2_ISI_VIDEO_TRANSFORM(transform);
+	gboolean ret;
+
+	ret = GST_BASE_TRANSFORM_CLASS(gst_imx_v4l2_isi_video_transform_parent_class)->query(transform, direction, query);
+
+	if (ret && (direction == GST_PAD_SRC) && (GST_QUERY_TYPE(query) == GST_QUERY_LATENCY))
+	{
+		gboolean live;
+		GstClockTime min_latency, max_latency;
+		GstClockTime pipeline_latency;
+
+		GST_OBJECT_LOCK(self);
+		pipeline_latency = self->pipeline_latency;
+		GST_OBJECT_UNLOCK(self);
+
+		gst_query_parse_latency(query, &live, &min_latency, &max_latency);
+
+		min_latency += pipeline_latency;
+		if (GST_CLOCK_TIME_IS_VALID(max_latency))
+			max_latency += pipeline_latency;
+
+		GST_DEBUG_OBJECT(
+			self,
+			"adding pipeline latency %" GST_TIME_FORMAT "; new min/max latency: %" GST_TIME_FORMAT " / %" GST_TIME_FORMAT,
+			GST_TIME_ARGS(pipeline_latency),
+			GST_TIME_ARGS(min_latency),
+			GST_TIME_ARGS(max_latency)
+		);
+
+		gst_query_set_latency(query, live, min_latency, max_latency);
+	}
+
+	return ret;
+}
+
+
 static GstFlowReturn gst_imx_v4l2_isi_video_transform_transform_frame(G_GNUC_UNUSED GstBaseTransform *transform, G_GNUC_UNUSED GstBuffer *input_buffer, G_GNUC_UNUSED GstBuffer *output_buffer)
 {
-	/* Nothing to do here; processing is done in prepare_output_buffer. */
+	/* Nothing to do here; processing is done in submit_input_buffer
+	 * and generate_output. This vfunc still has to be set, otherwise
+	 * the base class would consider this element to be always in
+	 * passthrough mode. */
 	return GST_FLOW_OK;
 }
 
@@ -1465,6 +1848,13 @@ static gboolean gst_imx_v4l2_isi_video_transform_copy_metadata(G_GNUC_UNUSED Gst
 static gboolean gst_imx_v4l2_isi_video_transform_open(GstImxV4L2ISIVideoTransform *self)
 {
 	gboolean ret = TRUE;
+	gchar *device_node = NULL;
+	gchar *cache_key = NULL;
+	struct v4l2_capability capability;
+
+	GST_OBJECT_LOCK(self);
+	memset(&(self->upload_stats), 0, sizeof(self->upload_stats));
+	GST_OBJECT_UNLOCK(self);
 
 	self->imx_dma_buffer_allocator = gst_imx_dmabuf_allocator_new();
 	if (self->imx_dma_buffer_allocator == NULL)
@@ -1473,24 +1863,46 @@ static gboolean gst_imx_v4l2_isi_video_transform_open(GstImxV4L2ISIVideoTransfor
 		goto error;
 	}
 
+	if (pipe(self->control_pipe_fds) < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not create control pipe: %s (%d)", strerror(errno), errno);
+		self->control_pipe_fds[0] = -1;
+		self->control_pipe_fds[1] = -1;
+		goto error;
+	}
+
 	GST_OBJECT_LOCK(self);
-	self->v4l2_fd = gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(self);
+	self->v4l2_fd = gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(self, &device_node);
 	GST_OBJECT_UNLOCK(self);
 	if (self->v4l2_fd < 0)
 		goto error;
 
-	if (!gst_imx_v4l2_isi_video_transform_probe_available_caps(self, &(self->v4l2_output_queue)))
+	/* The device identity from VIDIOC_QUERYCAP is part
+	 * of the probe cache keys, so query it here. */
+	if (ioctl(self->v4l2_fd, VIDIOC_QUERYCAP, &capability) < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not query V4L2 capability: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	cache_key = gst_imx_v4l2_create_probe_cache_key("isi-output", device_node, &capability);
+	if (!gst_imx_v4l2_isi_video_transform_probe_available_caps(self, &(self->v4l2_output_queue), cache_key))
 	{
 		GST_ERROR_OBJECT(self, "could probe caps for V4L2 output queue");
 		goto error;
 	}
-	if (!gst_imx_v4l2_isi_video_transform_probe_available_caps(self, &(self->v4l2_capture_queue)))
+	g_free(cache_key);
+
+	cache_key = gst_imx_v4l2_create_probe_cache_key("isi-capture", device_node, &capability);
+	if (!gst_imx_v4l2_isi_video_transform_probe_available_caps(self, &(self->v4l2_capture_queue), cache_key))
 	{
 		GST_ERROR_OBJECT(self, "could probe caps for V4L2 capture queue");
 		goto error;
 	}
 
 finish:
+	g_free(cache_key);
+	g_free(device_node);
 	return ret;
 
 error:
@@ -1502,6 +1914,8 @@ error:
 
 static void gst_imx_v4l2_isi_video_transform_close(GstImxV4L2ISIVideoTransform *self)
 {
+	gst_imx_v4l2_isi_video_transform_flush(self);
+
 	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_output_queue));
 	gst_imx_v4l2_isi_video_transform_teardown_v4l2_queue(self, &(self->v4l2_capture_queue));
 
@@ -1511,6 +1925,14 @@ static void gst_imx_v4l2_isi_video_transform_close(GstImxV4L2ISIVideoTransform *
 		self->v4l2_fd = -1;
 	}
 
+	if (self->control_pipe_fds[0] >= 0)
+	{
+		close(self->control_pipe_fds[0]);
+		close(self->control_pipe_fds[1]);
+		self->control_pipe_fds[0] = -1;
+		self->control_pipe_fds[1] = -1;
+	}
+
 	if (self->imx_dma_buffer_allocator != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->imx_dma_buffer_allocator));
@@ -1531,7 +1953,7 @@ static void gst_imx_v4l2_isi_video_transform_close(GstImxV4L2ISIVideoTransform *
 }
 
 
-static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV4L2ISIVideoTransform *self)
+static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV4L2ISIVideoTransform *self, gchar **device_node)
 {
 	int device_fd = -1;
 	DIR *dir = NULL;
@@ -1551,15 +1973,53 @@ static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV
 			GST_DEBUG_OBJECT(self, "opening user specified device node \"%s\"", device);
 
 			device_fd = open(device, O_RDWR);
-			g_free(device);
 
 			if (device_fd < 0)
+			{
 				GST_ERROR_OBJECT(self, "could not open V4L2 device: %s (%d)", strerror(errno), errno);
+				g_free(device);
+			}
+			else
+				*device_node = device;
 
 			goto finish;
 		}
 	}
 
+	/* Try the device node found by an earlier scan first. */
+	{
+		gchar *device;
+
+		G_LOCK(scanned_isi_device_node);
+		device = g_strdup(scanned_isi_device_node);
+		G_UNLOCK(scanned_isi_device_node);
+
+		if (device != NULL)
+		{
+			struct v4l2_capability capability;
+			int fd;
+
+			GST_DEBUG_OBJECT(self, "trying previously found ISI transform device node \"%s\"", device);
+
+			fd = open(device, O_RDWR);
+			if ((fd >= 0)
+			 && (ioctl(fd, VIDIOC_QUERYCAP, &capability) == 0)
+			 && ((capability.capabilities & V4L2_CAP_VIDEO_M2M_MPLANE) != 0)
+			 && ((capability.capabilities & V4L2_CAP_STREAMING) != 0))
+			{
+				device_fd = fd;
+				*device_node = device;
+				goto finish;
+			}
+
+			GST_DEBUG_OBJECT(self, "previously found device node \"%s\" is not usable anymore; rescanning", device);
+
+			if (fd >= 0)
+				close(fd);
+			g_free(device);
+		}
+	}
+
 	GST_DEBUG_OBJECT(self, "scanning for V4L2 ISI transform device node");
 
 	dir = opendir("/dev");
@@ -1703,6 +2163,13 @@ static int gst_imx_v4l2_isi_video_transform_scan_for_and_open_isi_device(GstImxV
 
 		GST_DEBUG_OBJECT(self, "found ISI transform device node \"%s\"", tempstr);
 		device_fd = fd;
+		*device_node = g_strdup(tempstr);
+
+		G_LOCK(scanned_isi_device_node);
+		g_free(scanned_isi_device_node);
+		scanned_isi_device_node = g_strdup(tempstr);
+		G_UNLOCK(scanned_isi_device_node);
+
 		break;
 
 next:
@@ -1721,7 +2188,7 @@ finish:
 }
 
 
-static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue)
+static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue, gchar const *cache_key)
 {
 	guint format_index;
 	struct v4l2_fmtdesc format_desc;
@@ -1729,6 +2196,25 @@ static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2
 	GValue formats_gvalue = G_VALUE_INIT;
 	gboolean ret = TRUE;
 	GstStructure *structure;
+	GstImxV4L2ProbeResult probe_result;
+
+	/* The available caps are stored in the device_caps field of
+	 * cached probe results; the other fields are not used here. */
+	memset(&probe_result, 0, sizeof(probe_result));
+	if (gst_imx_v4l2_lookup_cached_probe_result(cache_key, &probe_result))
+	{
+		gst_caps_replace(&(queue->available_caps), probe_result.device_caps);
+		gst_imx_v4l2_clear_probe_result(&probe_result);
+
+		GST_DEBUG_OBJECT(
+			self,
+			"using cached V4L2 %s queue caps: %" GST_PTR_FORMAT,
+			queue->name,
+			(gpointer)(queue->available_caps)
+		);
+
+		return TRUE;
+	}
 
 	g_value_init(&format_gvalue, G_TYPE_STRING);
 	g_value_init(&formats_gvalue, GST_TYPE_LIST);
@@ -1829,6 +2315,10 @@ static gboolean gst_imx_v4l2_isi_video_transform_probe_available_caps(GstImxV4L2
 		(gpointer)(queue->available_caps)
 	);
 
+	probe_result.device_caps = queue->available_caps;
+	probe_result.capture_chip = GST_IMX_V4L2_CAPTURE_CHIP_UNIDENTIFIED;
+	gst_imx_v4l2_store_cached_probe_result(cache_key, &probe_result);
+
 finish:
 	g_value_unset(&format_gvalue);
 	return ret;
@@ -1872,6 +2362,8 @@ static gboolean gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(GstImxV4L2ISIV
 
 	num_planes = (gint)(GST_VIDEO_INFO_N_PLANES(original_video_info));
 
+	memcpy(&(queue->requested_video_info), original_video_info, sizeof(GstVideoInfo));
+
 	queue_video_info = &(queue->video_info);
 	memcpy(queue_video_info, original_video_info, sizeof(GstVideoInfo));
 
@@ -1940,10 +2432,13 @@ static gboolean gst_imx_v4l2_isi_video_transform_setup_v4l2_queue(GstImxV4L2ISIV
 	memset(&v4l2_reqbuf, 0, sizeof(v4l2_reqbuf));
 	v4l2_reqbuf.type = queue->buf_type;
 	v4l2_reqbuf.memory = V4L2_MEMORY_DMABUF;
-	v4l2_reqbuf.count = queue->min_num_required_buffers;
+	/* Request extra buffers so that several frames can be in flight
+	 * at the same time. With a pipeline depth of 1, the minimum
+	 * number of buffers is sufficient. */
+	v4l2_reqbuf.count = queue->min_num_required_buffers + (self->pipeline_depth_in_use - 1);
 	if (ioctl(self->v4l2_fd, VIDIOC_REQBUFS, &v4l2_reqbuf) < 0)
 	{
-		GST_ERROR_OBJECT(self, "could not request %d V4L2 %s buffers: %s (%d)", queue->min_num_required_buffers, queue->name, strerror(errno), errno);
+		GST_ERROR_OBJECT(self, "could not request %u V4L2 %s buffers: %s (%d)", v4l2_reqbuf.count, queue->name, strerror(errno), errno);
 		return FALSE;
 	}
 	queue->num_buffers = v4l2_reqbuf.count;
@@ -2231,3 +2726,299 @@ static gboolean gst_imx_v4l2_isi_video_transform_enable_stream(GstImxV4L2ISIVide
 		return TRUE;
 	}
 }
+
+
+static void gst_imx_v4l2_isi_video_transform_reset_v4l2_queue(GstImxV4L2ISIVideoTransform *self, GstImxV4L2ISIVideoTransformQueue *queue)
+{
+	gint buffer_index;
+
+	if (!queue->initialized)
+		return;
+
+	/* VIDIOC_STREAMOFF implicitly dequeues all buffers. */
+	gst_imx_v4l2_isi_video_transform_enable_stream(self, queue, FALSE);
+
+	for (buffer_index = 0; buffer_index < queue->num_buffers; ++buffer_index)
+	{
+		gst_buffer_replace(&(queue->queued_gstbuffers[buffer_index]), NULL);
+		queue->unqueued_buffer_indices[buffer_index] = buffer_index;
+	}
+
+	queue->num_queued_buffers = 0;
+
+	GST_DEBUG_OBJECT(self, "reset V4L2 %s queue", queue->name);
+}
+
+
+static gboolean gst_imx_v4l2_isi_video_transform_v4l2_queue_needs_setup(GstImxV4L2ISIVideoTransformQueue *queue, GstVideoInfo const *video_info)
+{
+	guint plane_index;
+	GstVideoInfo const *requested_video_info = &(queue->requested_video_info);
+
+	if (!queue->initialized)
+		return TRUE;
+
+	/* Only check the values that are passed to the driver in
+	 * setup_v4l2_queue(). Other changes like a different frame
+	 * rate do not require the queue to be set up again. */
+
+	if ((GST_VIDEO_INFO_FORMAT(requested_video_info) != GST_VIDEO_INFO_FORMAT(video_info))
+	 || (GST_VIDEO_INFO_WIDTH(requested_video_info) != GST_VIDEO_INFO_WIDTH(video_info))
+	 || (GST_VIDEO_INFO_HEIGHT(requested_video_info) != GST_VIDEO_INFO_HEIGHT(video_info)))
+		return TRUE;
+
+	for (plane_index = 0; plane_index < GST_VIDEO_INFO_N_PLANES(video_info); ++plane_index)
+	{
+		if ((GST_VIDEO_INFO_PLANE_STRIDE(requested_video_info, plane_index) != GST_VIDEO_INFO_PLANE_STRIDE(video_info, plane_index))
+		 || (GST_VIDEO_INFO_PLANE_OFFSET(requested_video_info, plane_index) != GST_VIDEO_INFO_PLANE_OFFSET(video_info, plane_index)))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_poll(GstImxV4L2ISIVideoTransform *self, gshort events, gboolean block, gshort *revents)
+{
+	struct pollfd pfds[2];
+	int ret;
+
+	/* The control pipe is also polled, so that unlock()
+	 * can wake up a blocking poll() call. */
+	pfds[0].fd = self->control_pipe_fds[0];
+	pfds[0].events = POLLIN;
+	pfds[0].revents = 0;
+	pfds[1].fd = self->v4l2_fd;
+	pfds[1].events = events;
+	pfds[1].revents = 0;
+
+	do
+	{
+		ret = poll(pfds, 2, block ? -1 : 0);
+	}
+	while ((ret < 0) && (errno == EINTR));
+
+	if (ret < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not poll V4L2 device: %s (%d)", strerror(errno), errno);
+		return GST_FLOW_ERROR;
+	}
+
+	if (pfds[0].revents & POLLIN)
+	{
+		GST_DEBUG_OBJECT(self, "poll was canceled");
+		return GST_FLOW_FLUSHING;
+	}
+
+	if (pfds[1].revents & (POLLERR | POLLNVAL))
+	{
+		GST_ERROR_OBJECT(self, "error while polling V4L2 device; revents: %#x", (guint)(pfds[1].revents));
+		return GST_FLOW_ERROR;
+	}
+
+	*revents = pfds[1].revents;
+
+	return GST_FLOW_OK;
+}
+
+
+static void gst_imx_v4l2_isi_video_transform_unlock(GstImxV4L2ISIVideoTransform *self)
+{
+	static char const dummy = 0;
+	int ret;
+
+	if (self->control_pipe_fds[1] < 0)
+		return;
+
+	/* The byte stays in the pipe until unlock_stop() is called,
+	 * so any further poll() calls are canceled right away. */
+	GST_DEBUG_OBJECT(self, "sending request to any ongoing poll call to wake up");
+	ret = write(self->control_pipe_fds[1], &dummy, 1);
+	if (ret < 0)
+		GST_ERROR_OBJECT(self, "could not write to control pipe: %s (%d)", strerror(errno), errno);
+}
+
+
+static void gst_imx_v4l2_isi_video_transform_unlock_stop(GstImxV4L2ISIVideoTransform *self)
+{
+	struct pollfd pfd;
+	char dummy;
+
+	if (self->control_pipe_fds[0] < 0)
+		return;
+
+	/* Discard the wakeup requests from unlock(). */
+	pfd.fd = self->control_pipe_fds[0];
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN))
+	{
+		if (read(self->control_pipe_fds[0], &dummy, 1) <= 0)
+			break;
+	}
+}
+
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_fill_capture_queue(GstImxV4L2ISIVideoTransform *self)
+{
+	GstFlowReturn flow_ret;
+	GstImxV4L2ISIVideoTransformQueue *queue = &(self->v4l2_capture_queue);
+
+	/* Keep all capture buffers queued, so the ISI always has
+	 * somewhere to write converted frames into. */
+	while (queue->num_queued_buffers < queue->num_buffers)
+	{
+		GstBuffer *gstbuffer;
+		gboolean ret;
+
+		GST_LOG_OBJECT(self, "acquiring new buffer to queue it in the V4L2 capture queue");
+
+		flow_ret = gst_buffer_pool_acquire_buffer(self->output_buffer_pool, &gstbuffer, NULL);
+		if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+			return flow_ret;
+
+		ret = gst_imx_v4l2_isi_video_transform_queue_buffer(self, queue, gstbuffer);
+
+		gst_buffer_unref(gstbuffer);
+
+		if (!ret)
+			return GST_FLOW_ERROR;
+	}
+
+	if (!(queue->stream_enabled))
+	{
+		if (!gst_imx_v4l2_isi_video_transform_enable_stream(self, queue, TRUE))
+			return GST_FLOW_ERROR;
+	}
+
+	return GST_FLOW_OK;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_reclaim_output_buffers(GstImxV4L2ISIVideoTransform *self, gboolean block)
+{
+	GstImxV4L2ISIVideoTransformQueue *queue = &(self->v4l2_output_queue);
+	GstFlowReturn flow_ret;
+
+	/* If block is TRUE, wait until at least one output buffer can be
+	 * dequeued. After that, dequeue any others that are ready, without
+	 * blocking. Dequeuing releases our reference to the input frames,
+	 * which lets upstream reuse them earlier. */
+	while (queue->num_queued_buffers > 0)
+	{
+		GstBuffer *previous_input_buffer;
+		gshort revents;
+
+		flow_ret = gst_imx_v4l2_isi_video_transform_poll(self, POLLOUT, block, &revents);
+		if (flow_ret != GST_FLOW_OK)
+			return flow_ret;
+
+		if (!(revents & POLLOUT))
+			break;
+
+		GST_LOG_OBJECT(self, "dequeuing previously queued V4L2 output buffer since associated upstream frame was already processed");
+		previous_input_buffer = gst_imx_v4l2_isi_video_transform_dequeue_buffer(self, queue);
+		if (G_UNLIKELY(previous_input_buffer == NULL))
+			return GST_FLOW_ERROR;
+
+		gst_buffer_unref(previous_input_buffer);
+
+		block = FALSE;
+	}
+
+	return GST_FLOW_OK;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_retrieve_frame(GstImxV4L2ISIVideoTransform *self, gboolean block, GstBuffer **output_buffer)
+{
+	GstFlowReturn flow_ret;
+	GstBuffer *frame_metadata;
+	gshort revents;
+
+	*output_buffer = NULL;
+
+	if (g_queue_is_empty(&(self->pending_frames)))
+		return GST_FLOW_OK;
+
+	flow_ret = gst_imx_v4l2_isi_video_transform_poll(self, POLLIN, block, &revents);
+	if (flow_ret != GST_FLOW_OK)
+		return flow_ret;
+
+	if (!(revents & POLLIN))
+	{
+		GST_LOG_OBJECT(self, "no converted frame available yet");
+		return GST_FLOW_OK;
+	}
+
+	GST_LOG_OBJECT(self, "dequeuing V4L2 capture buffer to retrieve converted frame");
+	*output_buffer = gst_imx_v4l2_isi_video_transform_dequeue_buffer(self, &(self->v4l2_capture_queue));
+	if (G_UNLIKELY(*output_buffer == NULL))
+		return GST_FLOW_ERROR;
+
+	frame_metadata = g_queue_pop_head(&(self->pending_frames));
+	gst_imx_v4l2_isi_video_transform_copy_metadata(GST_BASE_TRANSFORM(self), frame_metadata, *output_buffer);
+	gst_buffer_unref(frame_metadata);
+
+	/* Immediately replace the dequeued capture buffer so the
+	 * ISI can continue with the next frame while this one is
+	 * pushed downstream. */
+	flow_ret = gst_imx_v4l2_isi_video_transform_fill_capture_queue(self);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	flow_ret = gst_imx_v4l2_isi_video_transform_reclaim_output_buffers(self, FALSE);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	return GST_FLOW_OK;
+
+error:
+	gst_buffer_unref(*output_buffer);
+	*output_buffer = NULL;
+	return flow_ret;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_isi_video_transform_drain(GstImxV4L2ISIVideoTransform *self)
+{
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+
+	if (!g_queue_is_empty(&(self->pending_frames)))
+		GST_DEBUG_OBJECT(self, "draining %u pending frame(s)", g_queue_get_length(&(self->pending_frames)));
+
+	while (!g_queue_is_empty(&(self->pending_frames)))
+	{
+		GstBuffer *output_buffer;
+
+		flow_ret = gst_imx_v4l2_isi_video_transform_retrieve_frame(self, TRUE, &output_buffer);
+		if (flow_ret != GST_FLOW_OK)
+			break;
+
+		flow_ret = gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(self), output_buffer);
+		if (flow_ret != GST_FLOW_OK)
+		{
+			GST_DEBUG_OBJECT(self, "could not push drained frame: %s", gst_flow_get_name(flow_ret));
+			break;
+		}
+	}
+
+	/* If pushing failed, the remaining frames can't go anywhere. */
+	if (flow_ret != GST_FLOW_OK)
+		gst_imx_v4l2_isi_video_transform_flush(self);
+
+	return flow_ret;
+}
+
+
+static void gst_imx_v4l2_isi_video_transform_flush(GstImxV4L2ISIVideoTransform *self)
+{
+	GstBuffer *frame_metadata;
+
+	gst_imx_v4l2_isi_video_transform_reset_v4l2_queue(self, &(self->v4l2_output_queue));
+	gst_imx_v4l2_isi_video_transform_reset_v4l2_queue(self, &(self->v4l2_capture_queue));
+
+	while ((frame_metadata = g_queue_pop_head(&(self->pending_frames))) != NULL)
+		gst_buffer_unref(frame_metadata);
+}
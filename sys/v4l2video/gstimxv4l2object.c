@@ -21,6 +21,7 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -29,6 +30,7 @@
 #include <gst/gst.h>
 #include <gst/allocators/allocators.h>
 #include <gst/video/video.h>
+#include "gst/imx/common/gstimxdmabufallocator.h"
 #include "gstimxv4l2object.h"
 
 
@@ -55,6 +57,10 @@ struct _GstImxV4L2Object
 	GstImxV4L2DeviceType device_type;
 	GstImxV4L2VideoInfo video_info;
 
+	/* Row stride (= V4L2 bytesperline) of Bayer frames. Only
+	 * valid if video_info contains Bayer video information. */
+	gint bayer_stride;
+
 	/* Control pipe for unblocking gst_imx_v4l2_object_dequeue_buffer(). */
 	int control_pipe_fds[2];
 
@@ -105,8 +111,15 @@ struct _GstImxV4L2Object
 	GMutex dequeuing_mutex;
 	GCond dequeuing_cond;
 
+	/* V4L2 sequence number of the most recently dequeued buffer.
+	 * Gaps in the sequence numbers reveal frames that the driver
+	 * dropped because no buffer was queued when they came in. */
+	guint32 last_sequence_number;
+	gboolean last_sequence_number_valid;
+	guint num_skipped_frames;
+
 	/* Copy of the argument that is passed to gst_imx_v4l2_object_new(). */
-	gboolean use_dma_buf;
+	GstImxV4L2IOMode io_mode;
 };
 
 
@@ -122,9 +135,13 @@ G_DEFINE_TYPE(GstImxV4L2Object, gst_imx_v4l2_object, GST_TYPE_OBJECT)
 static void gst_imx_v4l2_object_finalize(GObject *object);
 static gboolean setup_device(GstImxV4L2Object *self);
 static gboolean start_v4l2_stream(GstImxV4L2Object *self, gboolean do_start);
+static void release_queued_buffers(GstImxV4L2Object *self);
 static gboolean set_streaming_parm_capture_mode(GstImxV4L2Object *self, gint width, gint height, struct v4l2_captureparm *capture_parm);
 static gboolean is_v4l2_queue_empty(GstImxV4L2Object *self);
 static gboolean is_v4l2_queue_full(GstImxV4L2Object *self);
+static guint32 get_v4l2_memory_type(GstImxV4L2Object *self);
+static GQuark export_buffer_index_quark(void);
+static GstFlowReturn dequeue_buffer(GstImxV4L2Object *self, GstBuffer **buffer, gboolean block);
 
 
 static void gst_imx_v4l2_object_class_init(GstImxV4L2ObjectClass *klass)
@@ -146,6 +163,7 @@ static void gst_imx_v4l2_object_init(GstImxV4L2Object *self)
 	g_assert(ret == 0);
 
 	self->num_buffers = 0;
+	self->bayer_stride = 0;
 
 	self->v4l2_fd = -1;
 
@@ -162,6 +180,10 @@ static void gst_imx_v4l2_object_init(GstImxV4L2Object *self)
 
 	g_mutex_init(&(self->dequeuing_mutex));
 	g_cond_init(&(self->dequeuing_cond));
+
+	self->last_sequence_number = 0;
+	self->last_sequence_number_valid = FALSE;
+	self->num_skipped_frames = 0;
 }
 
 
@@ -209,7 +231,7 @@ static void gst_imx_v4l2_object_finalize(GObject *object)
 }
 
 
-GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, GstImxV4L2VideoInfo const *video_info, gboolean use_dma_buf)
+GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, GstImxV4L2VideoInfo const *video_info, GstImxV4L2IOMode io_mode)
 {
 	gint i;
 	GstImxV4L2Object *imx_v4l2_object;
@@ -220,9 +242,9 @@ GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, G
 
 
 	imx_v4l2_object = (GstImxV4L2Object *)g_object_new(gst_imx_v4l2_object_get_type(), NULL);
-	imx_v4l2_object->use_dma_buf = use_dma_buf;
+	imx_v4l2_object->io_mode = io_mode;
 
-	GST_DEBUG_OBJECT(imx_v4l2_object, "created new imxv4l2 object %" GST_PTR_FORMAT "; use_dma_buf: %d", (gpointer)(imx_v4l2_object), use_dma_buf);
+	GST_DEBUG_OBJECT(imx_v4l2_object, "created new imxv4l2 object %" GST_PTR_FORMAT "; io_mode: %d", (gpointer)(imx_v4l2_object), io_mode);
 
 
 	memcpy(&(imx_v4l2_object->video_info), video_info, sizeof(GstImxV4L2VideoInfo));
@@ -251,6 +273,16 @@ GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, G
 		goto error;
 	}
 
+	/* mxc_v4l2 devices and the mxc_vout output device always use
+	 * the USERPTR hack (see gst_imx_v4l2_object_queue_buffer()),
+	 * so they cannot hand out driver allocated buffers. */
+	if ((io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	 && ((imx_v4l2_object->device_type == GST_IMX_V4L2_DEVICE_TYPE_OUTPUT) || (imx_v4l2_object->probe_result.capture_chip != GST_IMX_V4L2_CAPTURE_CHIP_UNIDENTIFIED)))
+	{
+		GST_ERROR_OBJECT(imx_v4l2_object, "DMA-BUF export is not supported by mxc_v4l2 based devices");
+		goto error;
+	}
+
 	imx_v4l2_object->v4l2_fd = gst_imx_v4l2_context_open_fd(imx_v4l2_context);
 	if (imx_v4l2_object->v4l2_fd < 0)
 		goto error;
@@ -287,6 +319,30 @@ GstImxV4L2VideoInfo const *gst_imx_v4l2_object_get_video_info(GstImxV4L2Object *
 }
 
 
+GstImxV4L2IOMode gst_imx_v4l2_object_get_io_mode(GstImxV4L2Object *imx_v4l2_object)
+{
+	return imx_v4l2_object->io_mode;
+}
+
+
+gint gst_imx_v4l2_object_get_num_buffers(GstImxV4L2Object *imx_v4l2_object)
+{
+	return imx_v4l2_object->num_buffers;
+}
+
+
+gint gst_imx_v4l2_object_get_num_queued_buffers(GstImxV4L2Object *imx_v4l2_object)
+{
+	return imx_v4l2_object->num_buffers - (gint)(imx_v4l2_object->unused_v4l2_buffer_indices.length);
+}
+
+
+guint gst_imx_v4l2_object_get_num_skipped_frames(GstImxV4L2Object *imx_v4l2_object)
+{
+	return imx_v4l2_object->num_skipped_frames;
+}
+
+
 GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer *buffer)
 {
 	GstFlowReturn flow_ret = GST_FLOW_OK;
@@ -327,7 +383,32 @@ GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object
 	memblock = gst_buffer_peek_memory(buffer, 0);
 	g_assert(memblock != NULL);
 
-	v4l2_buf_index = GPOINTER_TO_INT(g_queue_pop_head(&(imx_v4l2_object->unused_v4l2_buffer_indices)));
+	if (imx_v4l2_object->io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	{
+		/* Exported buffers are permanently associated with the V4L2
+		 * buffer whose memory they contain, so we cannot just pick
+		 * any unused index. Use the buffer's own index instead. */
+		gpointer index_qdata = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(buffer), export_buffer_index_quark());
+
+		if (G_UNLIKELY(index_qdata == NULL))
+		{
+			GST_ERROR_OBJECT(imx_v4l2_object, "supplied gstbuffer does not come from the DMA-BUF export buffer pool; buffer: %" GST_PTR_FORMAT, (gpointer)buffer);
+			flow_ret = GST_FLOW_ERROR;
+			goto finish;
+		}
+
+		v4l2_buf_index = GPOINTER_TO_INT(index_qdata) - 1;
+
+		if (G_UNLIKELY(!g_queue_remove(&(imx_v4l2_object->unused_v4l2_buffer_indices), GINT_TO_POINTER(v4l2_buf_index))))
+		{
+			GST_ERROR_OBJECT(imx_v4l2_object, "V4L2 buffer with index %d is already queued", v4l2_buf_index);
+			flow_ret = GST_FLOW_ERROR;
+			goto finish;
+		}
+	}
+	else
+		v4l2_buf_index = GPOINTER_TO_INT(g_queue_pop_head(&(imx_v4l2_object->unused_v4l2_buffer_indices)));
+
 	g_assert(v4l2_buf_index < imx_v4l2_object->num_buffers);
 
 	memset(&v4l2_buf, 0, sizeof(v4l2_buf));
@@ -343,7 +424,7 @@ GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object
 		 *
 		 * cam->frame[buf->index].buffer.m.offset = cam->frame[buf->index].paddress = buf->m.offset;
 		 *
-		 * Note that we do this even if use_dma_buf is TRUE. That's
+		 * Note that we do this even if io_mode is set to DMA-BUF import. That's
 		 * because mxc_v4l2 has no support for DMA-BUF.
 		 */
 
@@ -372,7 +453,20 @@ GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object
 		v4l2_buf.m.offset = physical_address;
 		v4l2_buf.length = memblock->size;
 	}
-	else if (imx_v4l2_object->use_dma_buf)
+	else if (imx_v4l2_object->io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	{
+		GST_LOG_OBJECT(
+			imx_v4l2_object,
+			"will use V4L2 buffer index %d for queuing exported gstbuffer %" GST_PTR_FORMAT,
+			v4l2_buf_index,
+			(gpointer)buffer
+		);
+
+		v4l2_buf.type = imx_v4l2_object->v4l2_buffer_type;
+		v4l2_buf.memory = V4L2_MEMORY_MMAP;
+		v4l2_buf.index = v4l2_buf_index;
+	}
+	else if (imx_v4l2_object->io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT)
 	{
 		gint dmabuf_fd;
 
@@ -399,7 +493,7 @@ GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object
 	}
 	else
 	{
-		GST_FIXME_OBJECT(imx_v4l2_object, "currently, using non-mxc_v4l2 devices without DMA-BUF enabled is not supported");
+		GST_ERROR_OBJECT(imx_v4l2_object, "non-mxc_v4l2 devices require DMA-BUF import or export");
 		flow_ret = GST_FLOW_ERROR;
 		goto finish;
 	}
@@ -474,6 +568,18 @@ finish:
 
 
 GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer **buffer)
+{
+	return dequeue_buffer(imx_v4l2_object, buffer, TRUE);
+}
+
+
+GstFlowReturn gst_imx_v4l2_object_try_dequeue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer **buffer)
+{
+	return dequeue_buffer(imx_v4l2_object, buffer, FALSE);
+}
+
+
+static GstFlowReturn dequeue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer **buffer, gboolean block)
 {
 	GstFlowReturn flow_ret = GST_FLOW_OK;
 	struct pollfd pfd[2];
@@ -524,7 +630,7 @@ GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_obje
 	/* Prepare the v4l2_buffer. */
 	memset(&v4l2_buf, 0, sizeof(v4l2_buf));
 	v4l2_buf.type = imx_v4l2_object->v4l2_buffer_type;
-	v4l2_buf.memory = imx_v4l2_object->use_dma_buf ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_USERPTR;
+	v4l2_buf.memory = get_v4l2_memory_type(imx_v4l2_object);
 
 	/* Prepare the pollfd array. The first entry will contain the
 	 * control pipe that we'll use to wake up a poll() call
@@ -541,7 +647,7 @@ GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_obje
 	while (TRUE)
 	{
 		GST_LOG_OBJECT(imx_v4l2_object, "poll() loop");
-		if (poll(pfd, sizeof(pfd) / sizeof(struct pollfd), -1) < 0)
+		if (poll(pfd, sizeof(pfd) / sizeof(struct pollfd), block ? -1 : 0) < 0)
 		{
 			switch (errno)
 			{
@@ -602,6 +708,25 @@ GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_obje
 		/* Sanity check to see that the index is OK. */
 		g_assert(v4l2_buf_index < imx_v4l2_object->num_buffers);
 
+		/* Drivers that do not fill in the sequence number (like
+		 * mxc_v4l2) always set it to 0, which never produces a gap. */
+		if (imx_v4l2_object->last_sequence_number_valid && (v4l2_buf.sequence > (imx_v4l2_object->last_sequence_number + 1)))
+		{
+			imx_v4l2_object->num_skipped_frames = v4l2_buf.sequence - imx_v4l2_object->last_sequence_number - 1;
+			GST_DEBUG_OBJECT(
+				imx_v4l2_object,
+				"driver skipped %u frame(s) between sequence numbers %" G_GUINT32_FORMAT " and %" G_GUINT32_FORMAT,
+				imx_v4l2_object->num_skipped_frames,
+				imx_v4l2_object->last_sequence_number,
+				(guint32)(v4l2_buf.sequence)
+			);
+		}
+		else
+			imx_v4l2_object->num_skipped_frames = 0;
+
+		imx_v4l2_object->last_sequence_number = v4l2_buf.sequence;
+		imx_v4l2_object->last_sequence_number_valid = TRUE;
+
 		/* The index of the dequeued buffer is no longer in used, so put it back
 		 * in the unused_v4l2_buffer_indices queue to be able to reuse it later. */
 		g_queue_push_tail(&(imx_v4l2_object->unused_v4l2_buffer_indices), GINT_TO_POINTER(v4l2_buf_index));
@@ -628,6 +753,13 @@ GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_obje
 
 		GST_LOG_OBJECT(imx_v4l2_object, "got buffer for dequeued frame: %" GST_PTR_FORMAT, (gpointer)(*buffer));
 	}
+	else
+	{
+		/* Only possible when not blocking: poll() timed out immediately. */
+		g_assert(!block);
+		GST_LOG_OBJECT(imx_v4l2_object, "no captured frame available at the moment");
+		flow_ret = GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE;
+	}
 
 finish:
 	GST_LOG_OBJECT(imx_v4l2_object, "dequeue attempt finished with return value %s", gst_flow_get_name(flow_ret));
@@ -644,7 +776,6 @@ finish:
 
 void gst_imx_v4l2_object_unlock(GstImxV4L2Object *imx_v4l2_object)
 {
-	gint i;
 	int ret;
 	static char const dummy = 0;
 
@@ -672,32 +803,13 @@ void gst_imx_v4l2_object_unlock(GstImxV4L2Object *imx_v4l2_object)
 	if (imx_v4l2_object->stream_on)
 		start_v4l2_stream(imx_v4l2_object, FALSE);
 
-	/* Reset the unused_v4l2_buffer_indices queue to its initial value
-	 * when no frames were in the V4L2 queue, and then unref any buffers
-	 * that may still be in the queued_gstbuffers array. That's because
-	 * we just flushed the V4L2 queue by shutting down stream, so these
-	 * buffers are not in use by V4L2 anymore, so their references that
-	 * are stored in the queued_gstbuffers array need to be removed. */
-	GST_DEBUG_OBJECT(imx_v4l2_object, "unref any queued gstbuffers");
-	g_queue_clear(&(imx_v4l2_object->unused_v4l2_buffer_indices));
-	for (i = 0; i < imx_v4l2_object->num_buffers; ++i)
-	{
-		g_queue_push_tail(&(imx_v4l2_object->unused_v4l2_buffer_indices), GINT_TO_POINTER(i));
-		if (imx_v4l2_object->queued_gstbuffers[i] != NULL)
-		{
-			GstBuffer *queued_gstbuffer = imx_v4l2_object->queued_gstbuffers[i];
-
-			GST_DEBUG_OBJECT(
-				imx_v4l2_object,
-				"unref'ing queued buffer with refcount %d during unlock: %" GST_PTR_FORMAT,
-				GST_MINI_OBJECT_REFCOUNT_VALUE(queued_gstbuffer),
-				(gpointer)queued_gstbuffer
-			);
-			gst_buffer_unref(queued_gstbuffer);
+	/* Turning off the stream restarts the sequence numbering. */
+	imx_v4l2_object->last_sequence_number_valid = FALSE;
+	imx_v4l2_object->num_skipped_frames = 0;
 
-			imx_v4l2_object->queued_gstbuffers[i] = NULL;
-		}
-	}
+	/* We just flushed the V4L2 queue by shutting down stream, so
+	 * the queued buffers are not in use by V4L2 anymore. */
+	release_queued_buffers(imx_v4l2_object);
 
 	GST_DEBUG_OBJECT(imx_v4l2_object, "unlocking done");
 }
@@ -710,6 +822,373 @@ void gst_imx_v4l2_object_unlock_stop(GstImxV4L2Object *imx_v4l2_object)
 }
 
 
+gboolean gst_imx_v4l2_object_reconfigure(GstImxV4L2Object *imx_v4l2_object, GstImxV4L2VideoInfo const *video_info)
+{
+	struct v4l2_requestbuffers v4l2_bufrequest;
+
+	g_assert(imx_v4l2_object != NULL);
+	g_assert(video_info != NULL);
+
+	/* The mxc_v4l2 and mxc_vout drivers cannot be reliably reconfigured
+	 * once buffers were requested; they need to be reopened instead. */
+	if ((imx_v4l2_object->device_type == GST_IMX_V4L2_DEVICE_TYPE_OUTPUT) || (imx_v4l2_object->probe_result.capture_chip != GST_IMX_V4L2_CAPTURE_CHIP_UNIDENTIFIED))
+	{
+		GST_DEBUG_OBJECT(imx_v4l2_object, "mxc_v4l2 based devices cannot be reconfigured in place");
+		return FALSE;
+	}
+
+	/* Exported buffers are owned by the driver. Downstream may still hold
+	 * some of them, so the driver's buffers cannot be reallocated here. */
+	if (imx_v4l2_object->io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	{
+		GST_DEBUG_OBJECT(imx_v4l2_object, "objects using DMA-BUF export cannot be reconfigured in place");
+		return FALSE;
+	}
+
+	GST_DEBUG_OBJECT(imx_v4l2_object, "reconfiguring imxv4l2 object %" GST_PTR_FORMAT " in place", (gpointer)(imx_v4l2_object));
+
+	/* The caller must make sure that no dequeue call is ongoing. */
+	if (imx_v4l2_object->stream_on && !start_v4l2_stream(imx_v4l2_object, FALSE))
+		return FALSE;
+
+	release_queued_buffers(imx_v4l2_object);
+
+	/* A preceding unlock() call may have been used to wake up a blocking
+	 * dequeue call. Discard its wakeup request from the control pipe,
+	 * otherwise the next dequeue call would immediately be canceled. */
+	{
+		struct pollfd pfd;
+		char dummy;
+
+		pfd.fd = CONTROL_PIPE_READ_FD(imx_v4l2_object);
+		pfd.events = POLLIN;
+
+		while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN))
+		{
+			if (read(CONTROL_PIPE_READ_FD(imx_v4l2_object), &dummy, 1) <= 0)
+				break;
+		}
+	}
+	g_atomic_int_set(&(imx_v4l2_object->unlocked), 0);
+
+	imx_v4l2_object->last_sequence_number_valid = FALSE;
+	imx_v4l2_object->num_skipped_frames = 0;
+
+	/* Free the V4L2 buffers. Formats cannot be changed while buffers are allocated. */
+	memset(&v4l2_bufrequest, 0, sizeof(v4l2_bufrequest));
+	v4l2_bufrequest.type = imx_v4l2_object->v4l2_buffer_type;
+	v4l2_bufrequest.memory = get_v4l2_memory_type(imx_v4l2_object);
+	v4l2_bufrequest.count = 0;
+
+	if (ioctl(imx_v4l2_object->v4l2_fd, VIDIOC_REQBUFS, &v4l2_bufrequest) < 0)
+	{
+		GST_ERROR_OBJECT(imx_v4l2_object, "could not free V4L2 buffers: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	memcpy(&(imx_v4l2_object->video_info), video_info, sizeof(GstImxV4L2VideoInfo));
+
+	/* This sets the new format and requests the buffers again. */
+	return setup_device(imx_v4l2_object);
+}
+
+
+/* GstImxV4L2ExportBufferPool: buffer pool that hands out GstBuffers
+ * around driver allocated V4L2 buffers, exported with VIDIOC_EXPBUF. */
+
+
+typedef struct
+{
+	GstBufferPool parent;
+
+	GstImxV4L2Object *imx_v4l2_object;
+
+	/* Used for wrapping exported DMA-BUF FDs in ImxDmaBuffer memory.
+	 * NULL if no GstImxDmaBufAllocator was passed to
+	 * gst_imx_v4l2_object_create_export_buffer_pool(). */
+	GstAllocator *imx_dmabuf_allocator;
+	/* Used if imx_dmabuf_allocator is NULL or cannot wrap an FD. */
+	GstAllocator *fallback_dmabuf_allocator;
+
+	gboolean add_video_meta;
+
+	/* Indices of V4L2 buffers that are not yet exported in any
+	 * of the pool's GstBuffers. alloc_buffer() takes indices
+	 * from here, free_buffer() puts them back. */
+	GQueue unexported_v4l2_buffer_indices;
+}
+GstImxV4L2ExportBufferPool;
+
+
+typedef struct
+{
+	GstBufferPoolClass parent_class;
+}
+GstImxV4L2ExportBufferPoolClass;
+
+
+GType gst_imx_v4l2_export_buffer_pool_get_type(void);
+G_DEFINE_TYPE(GstImxV4L2ExportBufferPool, gst_imx_v4l2_export_buffer_pool, GST_TYPE_BUFFER_POOL)
+
+
+static void gst_imx_v4l2_export_buffer_pool_finalize(GObject *object);
+static gchar const ** gst_imx_v4l2_export_buffer_pool_get_options(GstBufferPool *pool);
+static gboolean gst_imx_v4l2_export_buffer_pool_set_config(GstBufferPool *pool, GstStructure *config);
+static GstFlowReturn gst_imx_v4l2_export_buffer_pool_alloc_buffer(GstBufferPool *pool, GstBuffer **buffer, GstBufferPoolAcquireParams *params);
+static void gst_imx_v4l2_export_buffer_pool_free_buffer(GstBufferPool *pool, GstBuffer *buffer);
+
+
+static void gst_imx_v4l2_export_buffer_pool_class_init(GstImxV4L2ExportBufferPoolClass *klass)
+{
+	GObjectClass *object_class;
+	GstBufferPoolClass *buffer_pool_class;
+
+	object_class = G_OBJECT_CLASS(klass);
+	buffer_pool_class = GST_BUFFER_POOL_CLASS(klass);
+
+	object_class->finalize           = GST_DEBUG_FUNCPTR(gst_imx_v4l2_export_buffer_pool_finalize);
+	buffer_pool_class->get_options   = GST_DEBUG_FUNCPTR(gst_imx_v4l2_export_buffer_pool_get_options);
+	buffer_pool_class->set_config    = GST_DEBUG_FUNCPTR(gst_imx_v4l2_export_buffer_pool_set_config);
+	buffer_pool_class->alloc_buffer  = GST_DEBUG_FUNCPTR(gst_imx_v4l2_export_buffer_pool_alloc_buffer);
+	buffer_pool_class->free_buffer   = GST_DEBUG_FUNCPTR(gst_imx_v4l2_export_buffer_pool_free_buffer);
+}
+
+
+static void gst_imx_v4l2_export_buffer_pool_init(GstImxV4L2ExportBufferPool *self)
+{
+	self->imx_v4l2_object = NULL;
+	self->imx_dmabuf_allocator = NULL;
+	self->fallback_dmabuf_allocator = NULL;
+	self->add_video_meta = FALSE;
+	g_queue_init(&(self->unexported_v4l2_buffer_indices));
+}
+
+
+static void gst_imx_v4l2_export_buffer_pool_finalize(GObject *object)
+{
+	GstImxV4L2ExportBufferPool *self = (GstImxV4L2ExportBufferPool *)object;
+
+	g_queue_clear(&(self->unexported_v4l2_buffer_indices));
+
+	if (self->fallback_dmabuf_allocator != NULL)
+		gst_object_unref(GST_OBJECT(self->fallback_dmabuf_allocator));
+	if (self->imx_dmabuf_allocator != NULL)
+		gst_object_unref(GST_OBJECT(self->imx_dmabuf_allocator));
+	if (self->imx_v4l2_object != NULL)
+		gst_object_unref(GST_OBJECT(self->imx_v4l2_object));
+
+	G_OBJECT_CLASS(gst_imx_v4l2_export_buffer_pool_parent_class)->finalize(object);
+}
+
+
+static gchar const ** gst_imx_v4l2_export_buffer_pool_get_options(G_GNUC_UNUSED GstBufferPool *pool)
+{
+	static gchar const *options[] =
+	{
+		GST_BUFFER_POOL_OPTION_VIDEO_META,
+		NULL
+	};
+
+	return options;
+}
+
+
+static gboolean gst_imx_v4l2_export_buffer_pool_set_config(GstBufferPool *pool, GstStructure *config)
+{
+	GstImxV4L2ExportBufferPool *self = (GstImxV4L2ExportBufferPool *)pool;
+	guint max_num_buffers;
+
+	if (!gst_buffer_pool_config_get_params(config, NULL, NULL, NULL, &max_num_buffers))
+	{
+		GST_ERROR_OBJECT(self, "could not parse buffer pool config");
+		return FALSE;
+	}
+
+	/* Each buffer is tied to one V4L2 buffer, so the pool
+	 * must not try to allocate more buffers than that. */
+	if ((max_num_buffers == 0) || (max_num_buffers > (guint)(self->imx_v4l2_object->num_buffers)))
+	{
+		GST_ERROR_OBJECT(self, "maximum number of buffers must be in the 1..%d range; got %u", self->imx_v4l2_object->num_buffers, max_num_buffers);
+		return FALSE;
+	}
+
+	self->add_video_meta = gst_buffer_pool_config_has_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+	return GST_BUFFER_POOL_CLASS(gst_imx_v4l2_export_buffer_pool_parent_class)->set_config(pool, config);
+}
+
+
+static GstFlowReturn gst_imx_v4l2_export_buffer_pool_alloc_buffer(GstBufferPool *pool, GstBuffer **buffer, G_GNUC_UNUSED GstBufferPoolAcquireParams *params)
+{
+	GstImxV4L2ExportBufferPool *self = (GstImxV4L2ExportBufferPool *)pool;
+	GstImxV4L2Object *imx_v4l2_object = self->imx_v4l2_object;
+	struct v4l2_buffer v4l2_buf;
+	struct v4l2_exportbuffer v4l2_expbuf;
+	GstMemory *memory = NULL;
+	GstBuffer *new_buffer;
+	gint v4l2_buf_index;
+
+	GST_OBJECT_LOCK(self);
+	if (G_UNLIKELY(g_queue_is_empty(&(self->unexported_v4l2_buffer_indices))))
+	{
+		GST_OBJECT_UNLOCK(self);
+		GST_ERROR_OBJECT(self, "all %d V4L2 buffers are already exported", imx_v4l2_object->num_buffers);
+		return GST_FLOW_ERROR;
+	}
+	v4l2_buf_index = GPOINTER_TO_INT(g_queue_pop_head(&(self->unexported_v4l2_buffer_indices)));
+	GST_OBJECT_UNLOCK(self);
+
+	/* Get the size of the driver allocated buffer. */
+	memset(&v4l2_buf, 0, sizeof(v4l2_buf));
+	v4l2_buf.type = imx_v4l2_object->v4l2_buffer_type;
+	v4l2_buf.memory = V4L2_MEMORY_MMAP;
+	v4l2_buf.index = v4l2_buf_index;
+
+	if (ioctl(imx_v4l2_object->v4l2_fd, VIDIOC_QUERYBUF, &v4l2_buf) < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not query V4L2 buffer with index %d: %s (%d)", v4l2_buf_index, strerror(errno), errno);
+		goto error;
+	}
+
+	memset(&v4l2_expbuf, 0, sizeof(v4l2_expbuf));
+	v4l2_expbuf.type = imx_v4l2_object->v4l2_buffer_type;
+	v4l2_expbuf.index = v4l2_buf_index;
+	v4l2_expbuf.flags = O_CLOEXEC | O_RDWR;
+
+	if (ioctl(imx_v4l2_object->v4l2_fd, VIDIOC_EXPBUF, &v4l2_expbuf) < 0)
+	{
+		GST_ERROR_OBJECT(self, "could not export V4L2 buffer with index %d: %s (%d)", v4l2_buf_index, strerror(errno), errno);
+		goto error;
+	}
+
+	/* Prefer ImxDmaBuffer memory, since that one can be used by other
+	 * i.MX elements directly. If the exported buffer is not physically
+	 * contiguous, wrapping it fails, since there is no physical address
+	 * for it. In that case, fall back to regular DMA-BUF memory. In both
+	 * cases, the memory takes ownership over the exported FD. */
+	if (self->imx_dmabuf_allocator != NULL)
+		memory = gst_imx_dmabuf_allocator_try_wrap_dmabuf(self->imx_dmabuf_allocator, v4l2_expbuf.fd, v4l2_buf.length);
+	if (memory == NULL)
+	{
+		if (self->imx_dmabuf_allocator != NULL)
+			GST_DEBUG_OBJECT(self, "could not wrap exported DMA-BUF FD %d in ImxDmaBuffer memory; using regular DMA-BUF memory instead", v4l2_expbuf.fd);
+		memory = gst_dmabuf_allocator_alloc(self->fallback_dmabuf_allocator, v4l2_expbuf.fd, v4l2_buf.length);
+	}
+
+	new_buffer = gst_buffer_new();
+	gst_buffer_append_memory(new_buffer, memory);
+
+	gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(new_buffer), export_buffer_index_quark(), GINT_TO_POINTER(v4l2_buf_index + 1), NULL);
+
+	if (self->add_video_meta && (imx_v4l2_object->video_info.type == GST_IMX_V4L2_VIDEO_FORMAT_TYPE_RAW))
+	{
+		GstVideoInfo *gst_info = &(imx_v4l2_object->video_info.info.gst_info);
+		GstVideoMeta *video_meta;
+
+		video_meta = gst_buffer_add_video_meta_full(
+			new_buffer,
+			GST_VIDEO_FRAME_FLAG_NONE,
+			GST_VIDEO_INFO_FORMAT(gst_info),
+			GST_VIDEO_INFO_WIDTH(gst_info),
+			GST_VIDEO_INFO_HEIGHT(gst_info),
+			GST_VIDEO_INFO_N_PLANES(gst_info),
+			&(GST_VIDEO_INFO_PLANE_OFFSET(gst_info, 0)),
+			&(GST_VIDEO_INFO_PLANE_STRIDE(gst_info, 0))
+		);
+		/* Mark the meta as pooled, otherwise the pool removes it
+		 * when the buffer is returned to it. */
+		GST_META_FLAG_SET(video_meta, GST_META_FLAG_POOLED);
+	}
+	else if (self->add_video_meta && (imx_v4l2_object->video_info.type == GST_IMX_V4L2_VIDEO_FORMAT_TYPE_BAYER))
+	{
+		GstImxV4L2BayerInfo *bayer_info = &(imx_v4l2_object->video_info.info.bayer_info);
+		GstVideoMeta *video_meta;
+		gsize offsets[GST_VIDEO_MAX_PLANES] = { 0 };
+		gint strides[GST_VIDEO_MAX_PLANES] = { imx_v4l2_object->bayer_stride };
+
+		/* There is no GstVideoFormat for Bayer data. The meta
+		 * is only used for passing on the row stride. */
+		video_meta = gst_buffer_add_video_meta_full(
+			new_buffer,
+			GST_VIDEO_FRAME_FLAG_NONE,
+			GST_VIDEO_FORMAT_ENCODED,
+			bayer_info->width,
+			bayer_info->height,
+			1,
+			offsets,
+			strides
+		);
+		GST_META_FLAG_SET(video_meta, GST_META_FLAG_POOLED);
+	}
+
+	GST_DEBUG_OBJECT(
+		self,
+		"exported V4L2 buffer with index %d as DMA-BUF FD %d size %u; buffer: %" GST_PTR_FORMAT,
+		v4l2_buf_index,
+		v4l2_expbuf.fd,
+		v4l2_buf.length,
+		(gpointer)new_buffer
+	);
+
+	*buffer = new_buffer;
+	return GST_FLOW_OK;
+
+error:
+	GST_OBJECT_LOCK(self);
+	g_queue_push_tail(&(self->unexported_v4l2_buffer_indices), GINT_TO_POINTER(v4l2_buf_index));
+	GST_OBJECT_UNLOCK(self);
+	return GST_FLOW_ERROR;
+}
+
+
+static void gst_imx_v4l2_export_buffer_pool_free_buffer(GstBufferPool *pool, GstBuffer *buffer)
+{
+	GstImxV4L2ExportBufferPool *self = (GstImxV4L2ExportBufferPool *)pool;
+	gpointer index_qdata = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(buffer), export_buffer_index_quark());
+
+	/* The V4L2 buffer itself stays allocated in the driver, so it
+	 * can be exported again the next time a buffer is allocated.
+	 * This happens when the pool discards buffers whose memory
+	 * was modified, and when the pool is deactivated. */
+	if (index_qdata != NULL)
+	{
+		GST_OBJECT_LOCK(self);
+		g_queue_push_tail(&(self->unexported_v4l2_buffer_indices), GINT_TO_POINTER(GPOINTER_TO_INT(index_qdata) - 1));
+		GST_OBJECT_UNLOCK(self);
+	}
+
+	GST_BUFFER_POOL_CLASS(gst_imx_v4l2_export_buffer_pool_parent_class)->free_buffer(pool, buffer);
+}
+
+
+GstBufferPool* gst_imx_v4l2_object_create_export_buffer_pool(GstImxV4L2Object *imx_v4l2_object, GstAllocator *imx_dma_buffer_allocator)
+{
+	gint i;
+	GstImxV4L2ExportBufferPool *pool;
+
+	g_assert(imx_v4l2_object != NULL);
+
+	if (imx_v4l2_object->io_mode != GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	{
+		GST_ERROR_OBJECT(imx_v4l2_object, "cannot create export buffer pool; object is not using DMA-BUF export");
+		return NULL;
+	}
+
+	pool = (GstImxV4L2ExportBufferPool *)g_object_new(gst_imx_v4l2_export_buffer_pool_get_type(), NULL);
+
+	pool->imx_v4l2_object = gst_object_ref(imx_v4l2_object);
+	if ((imx_dma_buffer_allocator != NULL) && GST_IS_IMX_DMABUF_ALLOCATOR(imx_dma_buffer_allocator))
+		pool->imx_dmabuf_allocator = gst_object_ref(imx_dma_buffer_allocator);
+	pool->fallback_dmabuf_allocator = gst_dmabuf_allocator_new();
+
+	for (i = 0; i < imx_v4l2_object->num_buffers; ++i)
+		g_queue_push_tail(&(pool->unexported_v4l2_buffer_indices), GINT_TO_POINTER(i));
+
+	GST_DEBUG_OBJECT(imx_v4l2_object, "created DMA-BUF export buffer pool %" GST_PTR_FORMAT, (gpointer)pool);
+
+	return GST_BUFFER_POOL_CAST(pool);
+}
+
 static gboolean setup_device(GstImxV4L2Object *self)
 {
 	gboolean retval = TRUE;
@@ -1207,6 +1686,11 @@ static gboolean setup_device(GstImxV4L2Object *self)
 				bayer_info->height = v4l2_fmt.fmt.pix.height;
 				bayer_info->interlace_mode = actual_interlace_mode;
 
+				/* Bayer caps cannot convey this, so it is passed
+				 * downstream in GstVideoMeta instead (see
+				 * gst_imx_v4l2_export_buffer_pool_alloc_buffer()). */
+				self->bayer_stride = (v4l2_fmt.fmt.pix.bytesperline != 0) ? (gint)(v4l2_fmt.fmt.pix.bytesperline) : bayer_info->width;
+
 				break;
 			}
 
@@ -1236,7 +1720,7 @@ static gboolean setup_device(GstImxV4L2Object *self)
 
 		memset(&v4l2_bufrequest, 0, sizeof(v4l2_bufrequest));
 		v4l2_bufrequest.type = self->v4l2_buffer_type;
-		v4l2_bufrequest.memory = self->use_dma_buf ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_USERPTR;
+		v4l2_bufrequest.memory = get_v4l2_memory_type(self);
 		v4l2_bufrequest.count = self->num_buffers;
 
 		if (ioctl(self->v4l2_fd, VIDIOC_REQBUFS, &v4l2_bufrequest) < 0)
@@ -1245,6 +1729,26 @@ static gboolean setup_device(GstImxV4L2Object *self)
 			goto error;
 		}
 
+		/* When the driver allocates the buffers itself, it may
+		 * not be able to allocate as many as we requested. */
+		if ((self->io_mode == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT) && ((int)(v4l2_bufrequest.count) < self->num_buffers))
+		{
+			gint i;
+
+			if (v4l2_bufrequest.count < 2)
+			{
+				GST_ERROR_OBJECT(self, "driver allocated only %u buffer(s); need at least 2", v4l2_bufrequest.count);
+				goto error;
+			}
+
+			GST_WARNING_OBJECT(self, "requested %d buffer(s), but driver allocated only %u", self->num_buffers, v4l2_bufrequest.count);
+
+			self->num_buffers = v4l2_bufrequest.count;
+			g_queue_clear(&(self->unused_v4l2_buffer_indices));
+			for (i = 0; i < self->num_buffers; ++i)
+				g_queue_push_tail(&(self->unused_v4l2_buffer_indices), GINT_TO_POINTER(i));
+		}
+
 		GST_DEBUG_OBJECT(self, "requested %d buffer(s)", self->num_buffers);
 	}
 
@@ -1276,6 +1780,40 @@ static gboolean start_v4l2_stream(GstImxV4L2Object *self, gboolean do_start)
 }
 
 
+static void release_queued_buffers(GstImxV4L2Object *self)
+{
+	gint i;
+
+	/* Reset the unused_v4l2_buffer_indices queue to its initial value
+	 * when no frames were in the V4L2 queue, and then unref any buffers
+	 * that may still be in the queued_gstbuffers array. This must only
+	 * be called after the V4L2 queue was flushed by turning off the
+	 * stream, since only then the buffers are not in use by V4L2 anymore,
+	 * and their references that are stored in the queued_gstbuffers
+	 * array need to be removed. */
+	GST_DEBUG_OBJECT(self, "unref any queued gstbuffers");
+	g_queue_clear(&(self->unused_v4l2_buffer_indices));
+	for (i = 0; i < self->num_buffers; ++i)
+	{
+		g_queue_push_tail(&(self->unused_v4l2_buffer_indices), GINT_TO_POINTER(i));
+		if (self->queued_gstbuffers[i] != NULL)
+		{
+			GstBuffer *queued_gstbuffer = self->queued_gstbuffers[i];
+
+			GST_DEBUG_OBJECT(
+				self,
+				"unref'ing queued buffer with refcount %d: %" GST_PTR_FORMAT,
+				GST_MINI_OBJECT_REFCOUNT_VALUE(queued_gstbuffer),
+				(gpointer)queued_gstbuffer
+			);
+			gst_buffer_unref(queued_gstbuffer);
+
+			self->queued_gstbuffers[i] = NULL;
+		}
+	}
+}
+
+
 static gboolean set_streaming_parm_capture_mode(GstImxV4L2Object *self, gint width, gint height, struct v4l2_captureparm *capture_parm)
 {
 	/* The mxc_v4l2 driver may require v4l2_captureparm's capturemode
@@ -1332,3 +1870,30 @@ static gboolean is_v4l2_queue_full(GstImxV4L2Object *self)
 	 * tells us whether or not the V4L2 queue is full. */
 	return (self->unused_v4l2_buffer_indices.length == 0);
 }
+
+
+static guint32 get_v4l2_memory_type(GstImxV4L2Object *self)
+{
+	switch (self->io_mode)
+	{
+		case GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT: return V4L2_MEMORY_DMABUF;
+		case GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT: return V4L2_MEMORY_MMAP;
+		default: return V4L2_MEMORY_USERPTR;
+	}
+}
+
+
+static GQuark export_buffer_index_quark(void)
+{
+	/* The quark is used for storing the V4L2 buffer index of exported
+	 * buffers as qdata. That index is stored with an offset of 1,
+	 * since qdata with value 0 (= NULL) cannot be told apart from
+	 * missing qdata. Qdata is preserved when buffers are returned
+	 * to their pool, so the index stays associated with the buffer. */
+	static GQuark quark = 0;
+
+	if (G_UNLIKELY(quark == 0))
+		quark = g_quark_from_static_string("gst-imx-v4l2-export-buffer-index");
+
+	return quark;
+}
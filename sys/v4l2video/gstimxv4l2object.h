@@ -37,6 +37,30 @@ G_BEGIN_DECLS
 
 #define GST_IMX_V4L2_FLOW_NEEDS_MORE_BUFFERS_QUEUED (GST_FLOW_CUSTOM_SUCCESS + 0)
 #define GST_IMX_V4L2_FLOW_QUEUE_IS_FULL (GST_FLOW_CUSTOM_SUCCESS + 1)
+#define GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE (GST_FLOW_CUSTOM_SUCCESS + 2)
+
+
+/**
+ * GstImxV4L2IOMode:
+ * @GST_IMX_V4L2_IO_MODE_USERPTR: Buffers are passed to the driver through
+ *     USERPTR. Only supported by mxc_v4l2 based devices, which expect the
+ *     physical address of the memory block in the m.offset field.
+ * @GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT: Buffers that contain DMA-BUF memory
+ *     are imported by the driver (V4L2_MEMORY_DMABUF).
+ * @GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT: The driver allocates the buffers
+ *     (V4L2_MEMORY_MMAP), and these are exported as DMA-BUF FDs with
+ *     VIDIOC_EXPBUF. Buffers that are queued must come from the pool
+ *     that is returned by @gst_imx_v4l2_object_create_export_buffer_pool.
+ *
+ * How the memory of the queued buffers is shared with the V4L2 driver.
+ */
+typedef enum
+{
+	GST_IMX_V4L2_IO_MODE_USERPTR,
+	GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT,
+	GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT
+}
+GstImxV4L2IOMode;
 
 
 /**
@@ -74,7 +98,7 @@ GType gst_imx_v4l2_object_get_type(void);
  * @imx_v4l2_context: @GstImxV4L2Context to use for setting up the object.
  * @video_info: @GstImxV4L2VideoInfo for configuring the capture frame size,
  *     video format etc.
- * @use_dma_buf: Whether or not to use DMA-BUF import.
+ * @io_mode: How buffer memory is shared with the driver.
  *
  * Creates a new @GstImxV4L2Object. An internal copy of the the probe result
  * from imx_v4l2_context is made with @gst_imx_v4l2_copy_probe_result,
@@ -86,19 +110,98 @@ GType gst_imx_v4l2_object_get_type(void);
  * video format, frame width/height, framerate. The object keeps an internal
  * copy of video_info.
  *
- * Normally, memory blocks will be imported through USERPTR. If use_dma_buf
- * is set to TRUE, the DMA-BUF import memory mode is used instead. This
- * requires that the gstbuffer that is passed to gst_imx_v4l2_object_queue_buffer()
- * contains one gstmemory block, and that gst_is_dmabuf_memory() returns
- * TRUE if it is given that block. Note that the value of use_dma_buf is
- * ignored if an mxc_v4l2 based device is used - in that case, USERPTR
- * is always used instead, and the memory block in the gstbuffers that get
- * queued must be compatible with GstPhysMemory (= gst_is_phys_memory()
- * must return TRUE if passed the gstbuffer's memory block).
+ * If io_mode is GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT, the DMA-BUF import memory
+ * mode is used. This requires that the gstbuffer that is passed to
+ * gst_imx_v4l2_object_queue_buffer() contains one gstmemory block, and that
+ * gst_is_dmabuf_memory() returns TRUE if it is given that block. If io_mode
+ * is GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT, the driver allocates the buffers
+ * itself, and only buffers from the pool created by
+ * @gst_imx_v4l2_object_create_export_buffer_pool can be queued. Note that
+ * io_mode is ignored when queuing if an mxc_v4l2 based device is used - in
+ * that case, USERPTR is always used instead, and the memory block in the
+ * gstbuffers that get queued must be compatible with GstPhysMemory
+ * (= gst_is_phys_memory() must return TRUE if passed the gstbuffer's memory
+ * block). GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT is not supported by such devices.
  *
  * Returns: Pointer to a newly created object, or NULL in case of an error.
  */
-GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, GstImxV4L2VideoInfo const *video_info, gboolean use_dma_buf);
+GstImxV4L2Object* gst_imx_v4l2_object_new(GstImxV4L2Context *imx_v4l2_context, GstImxV4L2VideoInfo const *video_info, GstImxV4L2IOMode io_mode);
+
+/**
+ * gst_imx_v4l2_object_get_io_mode:
+ * @imx_v4l2_object: @GstImxV4L2Object to get the I/O mode of.
+ *
+ * Returns: The @GstImxV4L2IOMode that was passed to @gst_imx_v4l2_object_new.
+ */
+GstImxV4L2IOMode gst_imx_v4l2_object_get_io_mode(GstImxV4L2Object *imx_v4l2_object);
+
+/**
+ * gst_imx_v4l2_object_get_num_buffers:
+ * @imx_v4l2_object: @GstImxV4L2Object to get the number of V4L2 buffers of.
+ *
+ * This is normally the number of buffers that is configured in the context.
+ * With GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT, the driver may however allocate
+ * fewer buffers than requested.
+ *
+ * Returns: Number of V4L2 buffers that the driver set up.
+ */
+gint gst_imx_v4l2_object_get_num_buffers(GstImxV4L2Object *imx_v4l2_object);
+
+/**
+ * gst_imx_v4l2_object_get_num_queued_buffers:
+ * @imx_v4l2_object: @GstImxV4L2Object to get the number of queued buffers of.
+ *
+ * When capturing, this is the number of buffers the driver can still write
+ * frames into before it has to drop frames.
+ *
+ * Returns: Number of buffers that are currently queued in the V4L2 device.
+ */
+gint gst_imx_v4l2_object_get_num_queued_buffers(GstImxV4L2Object *imx_v4l2_object);
+
+/**
+ * gst_imx_v4l2_object_get_num_skipped_frames:
+ * @imx_v4l2_object: @GstImxV4L2Object to get the number of skipped frames of.
+ *
+ * Drivers number captured frames with a sequence number. If there is a gap
+ * between the sequence numbers of two consecutively dequeued buffers, the
+ * driver dropped frames in between, typically because no buffer was queued
+ * at that time. Drivers that do not fill in sequence numbers never report
+ * a gap.
+ *
+ * Returns: Number of frames the driver dropped right before the frame that
+ *     was most recently dequeued with @gst_imx_v4l2_object_dequeue_buffer.
+ */
+guint gst_imx_v4l2_object_get_num_skipped_frames(GstImxV4L2Object *imx_v4l2_object);
+
+/**
+ * gst_imx_v4l2_object_create_export_buffer_pool:
+ * @imx_v4l2_object: @GstImxV4L2Object to create a buffer pool for.
+ * @imx_dma_buffer_allocator: Allocator to wrap exported DMA-BUF FDs with,
+ *     or NULL.
+ *
+ * Creates a @GstBufferPool whose buffers contain the driver allocated
+ * V4L2 buffers, exported as DMA-BUF FDs with VIDIOC_EXPBUF. The object
+ * must have been created with the GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT mode.
+ *
+ * Each buffer is permanently associated with one V4L2 buffer index, so the
+ * pool allocates at most as many buffers as the context that was passed to
+ * @gst_imx_v4l2_object_new specified. The pool must therefore be configured
+ * with that number as its maximum. Pass these buffers to
+ * @gst_imx_v4l2_object_queue_buffer like any other buffer. Once downstream
+ * releases a buffer, it returns to the pool and can be queued again.
+ *
+ * If imx_dma_buffer_allocator is a #GstImxDmaBufAllocator, the exported
+ * FDs are wrapped with @gst_imx_dmabuf_allocator_try_wrap_dmabuf, so the
+ * buffers contain ImxDmaBuffer memory that other i.MX elements can use
+ * directly. If that is not possible (for example because the exported
+ * buffer is not physically contiguous), a plain DMA-BUF memory block is
+ * used instead.
+ *
+ * The pool keeps a reference to the object.
+ *
+ * Returns: (transfer full) Newly created buffer pool, or NULL in case of an error.
+ */
+GstBufferPool* gst_imx_v4l2_object_create_export_buffer_pool(GstImxV4L2Object *imx_v4l2_object, GstAllocator *imx_dma_buffer_allocator);
 
 /**
  * gst_imx_v4l2_object_get_video_info:
@@ -181,6 +284,22 @@ GstFlowReturn gst_imx_v4l2_object_queue_buffer(GstImxV4L2Object *imx_v4l2_object
  */
 GstFlowReturn gst_imx_v4l2_object_dequeue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer **buffer);
 
+/**
+ * gst_imx_v4l2_object_try_dequeue_buffer:
+ * @imx_v4l2_object: @GstImxV4L2Object to dequeue a buffer out of.
+ * @buffer: @GstBuffer pointer to set to a dequeued buffer.
+ *
+ * Non-blocking version of @gst_imx_v4l2_object_dequeue_buffer. If no
+ * buffer can be dequeued right away, this returns immediately. This is
+ * useful for draining all buffers that became ready while the caller was
+ * busy, after a blocking @gst_imx_v4l2_object_dequeue_buffer call woke up.
+ *
+ * Returns:
+ *     The same values as @gst_imx_v4l2_object_dequeue_buffer, plus
+ *     @GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE if no buffer was ready.
+ */
+GstFlowReturn gst_imx_v4l2_object_try_dequeue_buffer(GstImxV4L2Object *imx_v4l2_object, GstBuffer **buffer);
+
 /**
  * gst_imx_v4l2_object_unlock:
  * @imx_v4l2_object: @GstImxV4L2Object to unlock.
@@ -208,6 +327,31 @@ void gst_imx_v4l2_object_unlock(GstImxV4L2Object *imx_v4l2_object);
  */
 void gst_imx_v4l2_object_unlock_stop(GstImxV4L2Object *imx_v4l2_object);
 
+/**
+ * gst_imx_v4l2_object_reconfigure:
+ * @imx_v4l2_object: @GstImxV4L2Object to reconfigure.
+ * @video_info: New video information to configure the device with.
+ *
+ * Reconfigures the object for new video information without closing and
+ * reopening the V4L2 device. The stream is turned off, queued buffers are
+ * released, the V4L2 buffers are freed, and then the new format is set
+ * and the V4L2 buffers are requested again. Like with
+ * @gst_imx_v4l2_object_new, the driver may adjust the video information;
+ * use @gst_imx_v4l2_object_get_video_info to get the adjusted version.
+ *
+ * The caller must make sure that no queue or dequeue call is ongoing.
+ * Any preceding @gst_imx_v4l2_object_unlock call is undone.
+ *
+ * This is not supported with mxc_v4l2 based devices and with
+ * @GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT. In these cases, the object is
+ * left unchanged, and FALSE is returned. If FALSE is returned for any
+ * other reason, the object is in an undefined state and must be discarded.
+ * In both cases, callers must create a new object instead.
+ *
+ * Returns: TRUE if the object could be reconfigured, FALSE otherwise.
+ */
+gboolean gst_imx_v4l2_object_reconfigure(GstImxV4L2Object *imx_v4l2_object, GstImxV4L2VideoInfo const *video_info);
+
 
 G_END_DECLS
 
@@ -36,12 +36,15 @@ enum
 {
 	PROP_0,
 	PROP_DEVICE,
-	PROP_NUM_V4L2_BUFFERS
+	PROP_NUM_V4L2_BUFFERS,
+	PROP_MAX_IN_FLIGHT_BUFFERS,
+	PROP_UPLOAD_STATS
 };
 
 
 #define DEFAULT_DEVICE "/dev/video0"
 #define DEFAULT_NUM_V4L2_BUFFERS 4
+#define DEFAULT_MAX_IN_FLIGHT_BUFFERS 0
 
 
 struct _GstImxV4L2VideoSink
@@ -73,6 +76,11 @@ struct _GstImxV4L2VideoSink
 	 * So, if necessary, we create a new object and unref the old one
 	 * (both of these steps are done in gst_imx_v4l2_video_sink_set_caps()). */
 	GstImxV4L2Object *current_v4l2_object;
+
+	/* How many frames may remain queued in the V4L2 device after
+	 * show_frame() returns. 0 means that show_frame() waits until
+	 * the driver is done with the frame (synchronous display). */
+	guint max_in_flight_buffers;
 };
 
 
@@ -95,9 +103,13 @@ static gboolean gst_imx_v4l2_video_sink_start(GstBaseSink *sink);
 static gboolean gst_imx_v4l2_video_sink_stop(GstBaseSink *sink);
 static gboolean gst_imx_v4l2_video_sink_unlock(GstBaseSink *sink);
 static gboolean gst_imx_v4l2_video_sink_unlock_stop(GstBaseSink *sink);
+static gboolean gst_imx_v4l2_video_sink_propose_allocation(GstBaseSink *sink, GstQuery *query);
 
 static GstFlowReturn gst_imx_v4l2_video_sink_show_frame(GstVideoSink *video_sink, GstBuffer *input_buffer);
 
+static guint gst_imx_v4l2_video_sink_get_max_in_flight_buffers(GstImxV4L2VideoSink *self);
+static GstFlowReturn gst_imx_v4l2_video_sink_reclaim_displayed_buffers(GstImxV4L2VideoSink *self, guint max_queued_buffers);
+
 
 
 
@@ -131,6 +143,7 @@ static void gst_imx_v4l2_video_sink_class_init(GstImxV4L2VideoSinkClass *klass)
 	base_sink_class->stop = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_sink_stop);
 	base_sink_class->unlock = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_sink_unlock);
 	base_sink_class->unlock_stop = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_sink_unlock_stop);
+	base_sink_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_sink_propose_allocation);
 
 	video_sink_class->show_frame = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_sink_show_frame);
 
@@ -159,6 +172,30 @@ static void gst_imx_v4l2_video_sink_class_init(GstImxV4L2VideoSinkClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_MAX_IN_FLIGHT_BUFFERS,
+		g_param_spec_uint(
+			"max-in-flight-buffers",
+			"Maximum number of in-flight buffers",
+			"How many frames may stay queued in the V4L2 device while the sink already accepts the next frame "
+			"(0 = wait until each frame was displayed; 1 = double buffering; values are limited to num-v4l2-buffers minus 1)",
+			0, G_MAXINT,
+			DEFAULT_MAX_IN_FLIGHT_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_UPLOAD_STATS,
+		g_param_spec_boxed(
+			"upload-stats",
+			"Upload statistics",
+			"Statistics about how input frames were uploaded into DMA memory (passthrough, zero-copy import, CPU copy)",
+			GST_TYPE_STRUCTURE,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 
 	gst_element_class_set_static_metadata(
 		element_class,
@@ -182,6 +219,7 @@ void gst_imx_v4l2_video_sink_init(GstImxV4L2VideoSink *self)
 	gst_imx_v4l2_context_set_num_buffers(self->context, DEFAULT_NUM_V4L2_BUFFERS);
 
 	self->current_v4l2_object = NULL;
+	self->max_in_flight_buffers = DEFAULT_MAX_IN_FLIGHT_BUFFERS;
 }
 
 
@@ -217,6 +255,12 @@ static void gst_imx_v4l2_video_sink_set_property(GObject *object, guint prop_id,
 			GST_OBJECT_UNLOCK(self->context);
 			break;
 
+		case PROP_MAX_IN_FLIGHT_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			self->max_in_flight_buffers = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -242,6 +286,28 @@ static void gst_imx_v4l2_video_sink_get_property(GObject *object, guint prop_id,
 			GST_OBJECT_UNLOCK(self->context);
 			break;
 
+		case PROP_MAX_IN_FLIGHT_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->max_in_flight_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_UPLOAD_STATS:
+		{
+			GstImxDmaBufferUploaderStats stats;
+
+			GST_OBJECT_LOCK(self);
+			if (self->uploader != NULL)
+			{
+				gst_imx_dma_buffer_uploader_get_stats(self->uploader, &stats);
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(&stats));
+			}
+			else
+				g_value_take_boxed(value, gst_imx_dma_buffer_uploader_stats_to_structure(NULL));
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -311,8 +377,8 @@ static gboolean gst_imx_v4l2_video_sink_set_caps(GstBaseSink *sink, GstCaps *cap
 		goto error;
 	}
 
-	/* Set use_dma_buf to FALSE since mxc_v4l2 devices don't support DMA-BUF. */
-	v4l2_object = gst_imx_v4l2_object_new(self->context, &initial_video_info, FALSE);
+	/* Use USERPTR since mxc_v4l2 devices don't support DMA-BUF. */
+	v4l2_object = gst_imx_v4l2_object_new(self->context, &initial_video_info, GST_IMX_V4L2_IO_MODE_USERPTR);
 	if (v4l2_object == NULL)
 	{
 		GST_ERROR_OBJECT(self, "could not create imxv4l2 object");
@@ -372,11 +438,14 @@ static gboolean gst_imx_v4l2_video_sink_stop(GstBaseSink *sink)
 		self->current_v4l2_object = NULL;
 	}
 
+	/* See gst_imx_dma_buffer_uploader_get_stats() for why the object lock is needed here. */
+	GST_OBJECT_LOCK(self);
 	if (self->uploader != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->uploader));
 		self->uploader = NULL;
 	}
+	GST_OBJECT_UNLOCK(self);
 
 	if (self->imx_dma_buffer_allocator != NULL)
 	{
@@ -410,15 +479,97 @@ static gboolean gst_imx_v4l2_video_sink_unlock_stop(GstBaseSink *sink)
 }
 
 
+static gboolean gst_imx_v4l2_video_sink_propose_allocation(GstBaseSink *sink, GstQuery *query)
+{
+	GstImxV4L2VideoSink *self = GST_IMX_V4L2_VIDEO_SINK(sink);
+	GstCaps *caps;
+	gboolean need_pool;
+	GstVideoInfo const *gst_video_info;
+	GstVideoInfo caps_video_info;
+	guint plane_index;
+	GstBufferPool *buffer_pool;
+	GstStructure *pool_config;
+	guint num_buffers;
+
+	/* Not chaining up to the base class since it does not have
+	 * its own propose_allocation implementation - its vmethod
+	 * propose_allocation pointer is set to NULL. */
+
+	gst_query_parse_allocation(query, &caps, &need_pool);
+
+	/* We can only propose a pool if we know the frame layout the
+	 * driver expects. That layout is known once set_caps() created
+	 * the V4L2 object. Encoded and Bayer data cannot be displayed
+	 * anyway, so only raw video is considered here. */
+	if (!need_pool || (caps == NULL) || (self->current_v4l2_object == NULL) || (self->imx_dma_buffer_allocator == NULL)
+	 || (self->current_video_info.type != GST_IMX_V4L2_VIDEO_FORMAT_TYPE_RAW))
+		return TRUE;
+
+	gst_video_info = &(self->current_video_info.info.gst_info);
+
+	/* The proposed pool lays out frames according to the caps, while
+	 * the driver reads frames according to the layout it reported when
+	 * the V4L2 object was set up. Only propose the pool if both match. */
+	if (!gst_video_info_from_caps(&caps_video_info, caps))
+		return TRUE;
+	for (plane_index = 0; plane_index < GST_VIDEO_INFO_N_PLANES(gst_video_info); ++plane_index)
+	{
+		if ((GST_VIDEO_INFO_PLANE_STRIDE(&caps_video_info, plane_index) != GST_VIDEO_INFO_PLANE_STRIDE(gst_video_info, plane_index))
+		 || (GST_VIDEO_INFO_PLANE_OFFSET(&caps_video_info, plane_index) != GST_VIDEO_INFO_PLANE_OFFSET(gst_video_info, plane_index)))
+		{
+			GST_DEBUG_OBJECT(self, "driver frame layout differs from the default layout for caps %" GST_PTR_FORMAT "; not proposing a pool", (gpointer)caps);
+			return TRUE;
+		}
+	}
+
+	/* Upstream needs enough buffers to keep filling new frames
+	 * while the in-flight frames are still held by the driver. */
+	num_buffers = gst_imx_v4l2_video_sink_get_max_in_flight_buffers(self) + 1;
+
+	/* Propose a pool that allocates ImxDmaBuffer backed memory with
+	 * the driver's frame layout. If upstream uses this pool, the
+	 * uploader passes its buffers through, and their physical
+	 * addresses are queued directly without any CPU copy. */
+	buffer_pool = gst_video_buffer_pool_new();
+	pool_config = gst_buffer_pool_get_config(buffer_pool);
+	gst_buffer_pool_config_set_params(pool_config, caps, GST_VIDEO_INFO_SIZE(gst_video_info), num_buffers, 0);
+	gst_buffer_pool_config_set_allocator(pool_config, self->imx_dma_buffer_allocator, NULL);
+	if (!gst_buffer_pool_set_config(buffer_pool, pool_config))
+	{
+		GST_WARNING_OBJECT(self, "could not configure proposed buffer pool; not proposing a pool");
+		gst_object_unref(GST_OBJECT(buffer_pool));
+		return TRUE;
+	}
+
+	GST_DEBUG_OBJECT(
+		self,
+		"proposing buffer pool %" GST_PTR_FORMAT " with buffer size %" G_GSIZE_FORMAT " and minimum %u buffer(s)",
+		(gpointer)buffer_pool,
+		(gsize)GST_VIDEO_INFO_SIZE(gst_video_info),
+		num_buffers
+	);
+
+	gst_query_add_allocation_pool(query, buffer_pool, GST_VIDEO_INFO_SIZE(gst_video_info), num_buffers, 0);
+	gst_query_add_allocation_param(query, self->imx_dma_buffer_allocator, NULL);
+
+	gst_object_unref(GST_OBJECT(buffer_pool));
+
+	return TRUE;
+}
+
+
 static GstFlowReturn gst_imx_v4l2_video_sink_show_frame(GstVideoSink *video_sink, GstBuffer *input_buffer)
 {
 	GstFlowReturn flow_ret;
 	GstBuffer *uploaded_input_buffer = NULL;
 	GstImxV4L2VideoSink *self = GST_IMX_V4L2_VIDEO_SINK(video_sink);
 	gboolean loop = TRUE;
+	guint max_in_flight_buffers;
 
 	g_assert(self->current_v4l2_object != NULL);
 
+	max_in_flight_buffers = gst_imx_v4l2_video_sink_get_max_in_flight_buffers(self);
+
 	GST_LOG_OBJECT(self, "showing video frame");
 
 
@@ -457,6 +608,11 @@ static GstFlowReturn gst_imx_v4l2_video_sink_show_frame(GstVideoSink *video_sink
 		{
 			/* Don't keep looping if the output went OK. */
 			loop = FALSE;
+
+			/* With in-flight buffering enabled, the displayed
+			 * frames are reclaimed below instead. */
+			if (max_in_flight_buffers > 0)
+				break;
 		}
 
 		flow_ret = gst_imx_v4l2_object_dequeue_buffer(self->current_v4l2_object, &dequeued_buffer);
@@ -466,6 +622,13 @@ static GstFlowReturn gst_imx_v4l2_video_sink_show_frame(GstVideoSink *video_sink
 		gst_buffer_unref(dequeued_buffer);
 	}
 
+	/* The frame is now queued. The driver displays queued frames
+	 * in order at the next vertical blanking interval. Only wait
+	 * for displayed frames if more than max_in_flight_buffers
+	 * frames are still held by the driver; this lets upstream
+	 * prepare the next frame while the driver shows this one. */
+	if ((flow_ret == GST_FLOW_OK) && (max_in_flight_buffers > 0))
+		flow_ret = gst_imx_v4l2_video_sink_reclaim_displayed_buffers(self, max_in_flight_buffers);
 
 finish:
 	/* Discard the uploaded version of the input buffer. */
@@ -478,3 +641,81 @@ error:
 		flow_ret = GST_FLOW_ERROR;
 	goto finish;
 }
+
+
+static guint gst_imx_v4l2_video_sink_get_max_in_flight_buffers(GstImxV4L2VideoSink *self)
+{
+	guint max_in_flight_buffers;
+	gint num_buffers;
+
+	GST_OBJECT_LOCK(self);
+	max_in_flight_buffers = self->max_in_flight_buffers;
+	GST_OBJECT_UNLOCK(self);
+
+	/* At least one V4L2 buffer must stay free for queuing the next frame. */
+	num_buffers = (self->current_v4l2_object != NULL) ? gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object) : DEFAULT_NUM_V4L2_BUFFERS;
+	return MIN(max_in_flight_buffers, (guint)(num_buffers - 1));
+}
+
+
+static GstFlowReturn gst_imx_v4l2_video_sink_reclaim_displayed_buffers(GstImxV4L2VideoSink *self, guint max_queued_buffers)
+{
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstBuffer *dequeued_buffer;
+
+	/* First, reclaim all frames the driver is already done with
+	 * without blocking. This releases the buffers back to upstream
+	 * (typically to its buffer pool) as early as possible. */
+	while (TRUE)
+	{
+		dequeued_buffer = NULL;
+
+		flow_ret = gst_imx_v4l2_object_try_dequeue_buffer(self->current_v4l2_object, &dequeued_buffer);
+		if (flow_ret != GST_FLOW_OK)
+			break;
+
+		gst_buffer_unref(dequeued_buffer);
+	}
+
+	switch (flow_ret)
+	{
+		case GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE:
+		case GST_IMX_V4L2_FLOW_NEEDS_MORE_BUFFERS_QUEUED:
+			flow_ret = GST_FLOW_OK;
+			break;
+
+		default:
+			goto finish;
+	}
+
+	/* Then, block until no more than max_queued_buffers
+	 * frames remain in the driver's queue. Never drain the
+	 * queue completely: output drivers like mxc_vout keep the
+	 * currently displayed frame until the next one is queued,
+	 * so waiting for the last queued frame would stall. */
+	max_queued_buffers = MAX(max_queued_buffers, 1);
+	while ((guint)gst_imx_v4l2_object_get_num_queued_buffers(self->current_v4l2_object) > max_queued_buffers)
+	{
+		dequeued_buffer = NULL;
+
+		flow_ret = gst_imx_v4l2_object_dequeue_buffer(self->current_v4l2_object, &dequeued_buffer);
+		if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		{
+			if (flow_ret == GST_IMX_V4L2_FLOW_NEEDS_MORE_BUFFERS_QUEUED)
+				flow_ret = GST_FLOW_OK;
+			break;
+		}
+
+		gst_buffer_unref(dequeued_buffer);
+	}
+
+	GST_LOG_OBJECT(
+		self,
+		"%d frame(s) still in flight after reclaiming displayed frames (maximum: %u)",
+		gst_imx_v4l2_object_get_num_queued_buffers(self->current_v4l2_object),
+		max_queued_buffers
+	);
+
+finish:
+	return flow_ret;
+}
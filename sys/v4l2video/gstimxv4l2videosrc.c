@@ -18,11 +18,14 @@
 
 #include "gstimxv4l2prelude.h"
 
+#include <string.h>
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
+#include <gst/base/gstqueuearray.h>
 #include <gst/video/video.h>
 #include <gst/allocators/allocators.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gst/imx/video/gstimxvideoutils.h"
 #include "gstimxv4l2videosrc.h"
 #include "gstimxv4l2videoformat.h"
 #include "gstimxv4l2context.h"
@@ -37,12 +40,30 @@ enum
 {
 	PROP_0,
 	PROP_DEVICE,
-	PROP_NUM_V4L2_BUFFERS
+	PROP_NUM_V4L2_BUFFERS,
+	PROP_IO_MODE,
+	PROP_MIN_QUEUED_V4L2_BUFFERS,
+	PROP_TIMESTAMP_MODE,
+	PROP_CAPTURE_THREAD
 };
 
 
 #define DEFAULT_DEVICE "/dev/video0"
 #define DEFAULT_NUM_V4L2_BUFFERS 4
+#define DEFAULT_IO_MODE GST_IMX_V4L2_VIDEO_SRC_IO_MODE_AUTO
+#define DEFAULT_MIN_QUEUED_V4L2_BUFFERS 1
+#define DEFAULT_TIMESTAMP_MODE GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_DELAY_ESTIMATE
+#define DEFAULT_CAPTURE_THREAD FALSE
+
+/* Maximum number of frames the capture thread dequeues per wakeup. */
+#define MAX_CAPTURE_BATCH_SIZE 16
+
+/* Number of system clock / pipeline clock sample pairs that are used
+ * for estimating the mapping between these clocks, and how many samples
+ * are needed before the mapping is used. The values match the defaults
+ * of the GstClock calibration window. */
+#define CLOCK_MAPPING_WINDOW_SIZE 32
+#define CLOCK_MAPPING_MIN_NUM_SAMPLES 4
 
 
 struct _GstImxV4L2VideoSrc
@@ -57,6 +78,51 @@ struct _GstImxV4L2VideoSrc
 	gint current_framerate[2];
 	GstClockTime current_frame_duration;
 	GstAllocator *imx_dma_buffer_allocator;
+
+	GstImxV4L2VideoSrcIOMode io_mode;
+	gint min_queued_v4l2_buffers;
+
+	/* TRUE if the buffer pool that was picked in decide_allocation()
+	 * has an upper limit for its number of buffers. Then, downstream
+	 * can starve the V4L2 queue by holding on to captured buffers. */
+	gboolean uses_bounded_pool;
+	/* Pool with buffers that frames are copied into when the
+	 * V4L2 queue is starving. Created on demand. */
+	GstBufferPool *spare_buffer_pool;
+
+	/* Statistics for the QoS messages that are posted when the driver drops frames. */
+	guint64 num_processed_frames;
+	guint64 num_dropped_frames;
+
+	GstImxV4L2VideoSrcTimestampMode timestamp_mode;
+
+	/* State for the clock-mapping timestamp mode. The samples array contains
+	 * pairs of (system clock time, pipeline clock time) values, in the format
+	 * gst_calculate_linear_regression() expects. The clock pointer is only
+	 * used for detecting pipeline clock changes, and is not ref'd. */
+	GstClockTime clock_mapping_samples[CLOCK_MAPPING_WINDOW_SIZE * 2];
+	GstClockTime clock_mapping_temp[CLOCK_MAPPING_WINDOW_SIZE * 2];
+	guint clock_mapping_num_samples;
+	guint clock_mapping_next_sample_index;
+	gpointer clock_mapping_pipeline_clock;
+	gboolean clock_mapping_uses_realtime_clock;
+
+	/* Capture thread states. use_capture_thread is the property value;
+	 * capture_thread_enabled is a copy that is made in start() so that
+	 * changing the property during streaming has no effect. The thread
+	 * dequeues frames and puts them into captured_frames, create() takes
+	 * them out. capture_thread_running, capture_thread_flow_ret,
+	 * captured_frames, and captured_frames_flushing are protected
+	 * by captured_frames_mutex. */
+	gboolean use_capture_thread;
+	gboolean capture_thread_enabled;
+	GMutex captured_frames_mutex;
+	GCond captured_frames_cond;
+	GThread *capture_thread;
+	gboolean capture_thread_running;
+	GstFlowReturn capture_thread_flow_ret;
+	GstQueueArray *captured_frames;
+	gboolean captured_frames_flushing;
 };
 
 
@@ -76,6 +142,7 @@ G_DEFINE_TYPE_WITH_CODE(
 
 
 static void gst_imx_v4l2_video_src_dispose(GObject *object);
+static void gst_imx_v4l2_video_src_finalize(GObject *object);
 static void gst_imx_v4l2_video_src_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_v4l2_video_src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 
@@ -96,9 +163,67 @@ static gchar* gst_imx_v4l2_video_src_uri_get_uri(GstURIHandler *handler);
 static gboolean gst_imx_v4l2_video_src_uri_set_uri(GstURIHandler *handler, const gchar *uri, GError **error);
 
 static GstCaps* gst_imx_v4l2_video_src_fixate_caps(GstImxV4L2VideoSrc *self, GstCaps *negotiated_caps, GstStructure *preferred_values_structure);
+static GstImxV4L2IOMode gst_imx_v4l2_video_src_select_io_mode(GstImxV4L2VideoSrc *self);
+static gboolean gst_imx_v4l2_video_src_use_downstream_pool(GstImxV4L2VideoSrc *self, GstQuery *query);
+static GstFlowReturn gst_imx_v4l2_video_src_replenish_bounded_queue(GstImxV4L2VideoSrc *self, GstBuffer **buf);
+static void gst_imx_v4l2_video_src_release_spare_pool(GstImxV4L2VideoSrc *self);
+static void gst_imx_v4l2_video_src_report_skipped_frames(GstImxV4L2VideoSrc *self, GstBuffer *buf);
+static void gst_imx_v4l2_video_src_reset_clock_mapping(GstImxV4L2VideoSrc *self);
+static GstFlowReturn gst_imx_v4l2_video_src_capture_frame(GstImxV4L2VideoSrc *self, GstBuffer **buf, gboolean block);
+static GstFlowReturn gst_imx_v4l2_video_src_pop_captured_frame(GstImxV4L2VideoSrc *self, GstBuffer **buf);
+static gpointer gst_imx_v4l2_video_src_capture_thread_func(gpointer user_data);
+static void gst_imx_v4l2_video_src_stop_capture_thread(GstImxV4L2VideoSrc *self);
+static gboolean gst_imx_v4l2_video_src_map_capture_timestamp(GstImxV4L2VideoSrc *self, GstClockTime capture_timestamp, GstClockTime sysclock_time, gboolean sysclock_is_realtime, gpointer pipeline_clock, GstClockTime pipeline_clock_time, GstClockTime *mapped_timestamp);
+
 
 
 
+GType gst_imx_v4l2_video_src_io_mode_get_type(void)
+{
+	static GType gst_imx_v4l2_video_src_io_mode_type = 0;
+
+	if (!gst_imx_v4l2_video_src_io_mode_type)
+	{
+		static GEnumValue io_mode_values[] =
+		{
+			{ GST_IMX_V4L2_VIDEO_SRC_IO_MODE_AUTO, "Pick DMA-BUF import if the allocator supports it, DMA-BUF export otherwise", "auto" },
+			{ GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_IMPORT, "Driver imports DMA-BUF buffers that are allocated by GStreamer", "dmabuf-import" },
+			{ GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_EXPORT, "Driver allocates buffers and exports them as DMA-BUF", "dmabuf-export" },
+			{ 0, NULL, NULL },
+		};
+
+		gst_imx_v4l2_video_src_io_mode_type = g_enum_register_static(
+			"GstImxV4L2VideoSrcIOMode",
+			io_mode_values
+		);
+	}
+
+	return gst_imx_v4l2_video_src_io_mode_type;
+}
+
+
+GType gst_imx_v4l2_video_src_timestamp_mode_get_type(void)
+{
+	static GType gst_imx_v4l2_video_src_timestamp_mode_type = 0;
+
+	if (!gst_imx_v4l2_video_src_timestamp_mode_type)
+	{
+		static GEnumValue timestamp_mode_values[] =
+		{
+			{ GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_DELAY_ESTIMATE, "Subtract the capture delay measured per frame from the current pipeline clock time", "delay-estimate" },
+			{ GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_CLOCK_MAPPING, "Map V4L2 timestamps to the pipeline clock with a continuously filtered clock mapping", "clock-mapping" },
+			{ 0, NULL, NULL },
+		};
+
+		gst_imx_v4l2_video_src_timestamp_mode_type = g_enum_register_static(
+			"GstImxV4L2VideoSrcTimestampMode",
+			timestamp_mode_values
+		);
+	}
+
+	return gst_imx_v4l2_video_src_timestamp_mode_type;
+}
+
 
 static void gst_imx_v4l2_video_src_class_init(GstImxV4L2VideoSrcClass *klass)
 {
@@ -121,6 +246,7 @@ static void gst_imx_v4l2_video_src_class_init(GstImxV4L2VideoSrcClass *klass)
 	gst_element_class_add_pad_template(element_class, src_template);
 
 	object_class->dispose = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_src_dispose);
+	object_class->finalize = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_src_finalize);
 	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_src_set_property);
 	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_video_src_get_property);
 
@@ -161,6 +287,61 @@ static void gst_imx_v4l2_video_src_class_init(GstImxV4L2VideoSrcClass *klass)
 		)
 	);
 
+	g_object_class_install_property(
+		object_class,
+		PROP_IO_MODE,
+		g_param_spec_enum(
+			"io-mode",
+			"I/O mode",
+			"How captured frames are shared with the V4L2 driver (ignored with mxc_v4l2 devices, which always use their own physical address based mode)",
+			gst_imx_v4l2_video_src_io_mode_get_type(),
+			DEFAULT_IO_MODE,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_MIN_QUEUED_V4L2_BUFFERS,
+		g_param_spec_int(
+			"min-queued-v4l2-buffers",
+			"Minimum number of queued V4L2 buffers",
+			"If downstream holds on to captured frames and fewer than this many V4L2 buffers remain queued, "
+			"captured frames are copied so their V4L2 buffers can be requeued right away, preventing the driver "
+			"from dropping frames (only relevant with DMA-BUF export or downstream pools; 0 = never copy)",
+			0, G_MAXINT,
+			DEFAULT_MIN_QUEUED_V4L2_BUFFERS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_TIMESTAMP_MODE,
+		g_param_spec_enum(
+			"timestamp-mode",
+			"Timestamp mode",
+			"How V4L2 capture timestamps are converted to buffer timestamps",
+			gst_imx_v4l2_video_src_timestamp_mode_get_type(),
+			DEFAULT_TIMESTAMP_MODE,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_CAPTURE_THREAD,
+		g_param_spec_boolean(
+			"capture-thread",
+			"Capture thread",
+			"Dequeue frames in a separate thread that drains all ready frames per wakeup, "
+			"decoupling capturing from the streaming thread (useful for high framerates; "
+			"takes effect the next time the element is started)",
+			DEFAULT_CAPTURE_THREAD,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
 	gst_element_class_set_static_metadata(
 		element_class,
 		"NXP i.MX V4L2 video source",
@@ -183,6 +364,25 @@ void gst_imx_v4l2_video_src_init(GstImxV4L2VideoSrc *self)
 	gst_imx_v4l2_context_set_num_buffers(self->context, DEFAULT_NUM_V4L2_BUFFERS);
 
 	self->current_v4l2_object = NULL;
+
+	self->io_mode = DEFAULT_IO_MODE;
+	self->min_queued_v4l2_buffers = DEFAULT_MIN_QUEUED_V4L2_BUFFERS;
+
+	self->uses_bounded_pool = FALSE;
+	self->spare_buffer_pool = NULL;
+
+	self->timestamp_mode = DEFAULT_TIMESTAMP_MODE;
+	gst_imx_v4l2_video_src_reset_clock_mapping(self);
+
+	self->use_capture_thread = DEFAULT_CAPTURE_THREAD;
+	self->capture_thread_enabled = FALSE;
+	g_mutex_init(&(self->captured_frames_mutex));
+	g_cond_init(&(self->captured_frames_cond));
+	self->capture_thread = NULL;
+	self->capture_thread_running = FALSE;
+	self->capture_thread_flow_ret = GST_FLOW_OK;
+	self->captured_frames = gst_queue_array_new(MAX_CAPTURE_BATCH_SIZE);
+	self->captured_frames_flushing = FALSE;
 }
 
 
@@ -211,6 +411,18 @@ static void gst_imx_v4l2_video_src_dispose(GObject *object)
 }
 
 
+static void gst_imx_v4l2_video_src_finalize(GObject *object)
+{
+	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(object);
+
+	gst_queue_array_free(self->captured_frames);
+	g_mutex_clear(&(self->captured_frames_mutex));
+	g_cond_clear(&(self->captured_frames_cond));
+
+	G_OBJECT_CLASS(gst_imx_v4l2_video_src_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_v4l2_video_src_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(object);
@@ -229,6 +441,30 @@ static void gst_imx_v4l2_video_src_set_property(GObject *object, guint prop_id,
 			GST_OBJECT_UNLOCK(self->context);
 			break;
 
+		case PROP_IO_MODE:
+			GST_OBJECT_LOCK(self);
+			self->io_mode = g_value_get_enum(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_MIN_QUEUED_V4L2_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			self->min_queued_v4l2_buffers = g_value_get_int(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_TIMESTAMP_MODE:
+			GST_OBJECT_LOCK(self);
+			self->timestamp_mode = g_value_get_enum(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_CAPTURE_THREAD:
+			GST_OBJECT_LOCK(self);
+			self->use_capture_thread = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -254,6 +490,30 @@ static void gst_imx_v4l2_video_src_get_property(GObject *object, guint prop_id,
 			GST_OBJECT_UNLOCK(self->context);
 			break;
 
+		case PROP_IO_MODE:
+			GST_OBJECT_LOCK(self);
+			g_value_set_enum(value, self->io_mode);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_MIN_QUEUED_V4L2_BUFFERS:
+			GST_OBJECT_LOCK(self);
+			g_value_set_int(value, self->min_queued_v4l2_buffers);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_TIMESTAMP_MODE:
+			GST_OBJECT_LOCK(self);
+			g_value_set_enum(value, self->timestamp_mode);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
+		case PROP_CAPTURE_THREAD:
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->use_capture_thread);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -314,6 +574,7 @@ static gboolean gst_imx_v4l2_video_src_negotiate(GstBaseSrc *src)
 	GstStructure *preferred_values_structure = NULL;
 	GstImxV4L2VideoInfo initial_video_info;
 	GstImxV4L2Object *v4l2_object = NULL;
+	GstImxV4L2IOMode io_mode;
 
 	/* Query the caps our src pad supports. This will issue a caps
 	 * query, which will cause our get_caps() function to be called.
@@ -378,25 +639,56 @@ static gboolean gst_imx_v4l2_video_src_negotiate(GstBaseSrc *src)
 		goto error;
 	}
 
-	/* Unref an old V4L2 object if one exists. The old object cannot
-	 * be used anymore, since it is configured for different caps. */
+	io_mode = gst_imx_v4l2_video_src_select_io_mode(self);
+
+	/* If an old V4L2 object exists, it is configured for different caps.
+	 * If the capture thread is using it, shut that thread down first.
+	 * create() starts a new one for the new object. Then try to reconfigure
+	 * the old object in place, since this avoids closing and reopening the
+	 * device. This is only possible if its I/O mode and its number of
+	 * buffers did not change. Otherwise, or if the device does not support
+	 * in-place reconfiguration, unref the old object and create a new one. */
 	if (self->current_v4l2_object != NULL)
 	{
-		gst_object_unref(GST_OBJECT(self->current_v4l2_object));
+		gint num_buffers;
+
+		if (self->capture_thread != NULL)
+		{
+			gst_imx_v4l2_object_unlock(self->current_v4l2_object);
+			gst_imx_v4l2_video_src_stop_capture_thread(self);
+		}
+
+		GST_OBJECT_LOCK(self->context);
+		num_buffers = gst_imx_v4l2_context_get_num_buffers(self->context);
+		GST_OBJECT_UNLOCK(self->context);
+
+		if ((gst_imx_v4l2_object_get_io_mode(self->current_v4l2_object) == io_mode)
+		 && (gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object) == num_buffers)
+		 && gst_imx_v4l2_object_reconfigure(self->current_v4l2_object, &initial_video_info))
+		{
+			GST_DEBUG_OBJECT(self, "reconfigured existing imxv4l2 object in place");
+			v4l2_object = self->current_v4l2_object;
+		}
+		else
+			gst_object_unref(GST_OBJECT(self->current_v4l2_object));
+
 		self->current_v4l2_object = NULL;
 	}
 
-	v4l2_object = gst_imx_v4l2_object_new(
-		self->context,
-		&initial_video_info,
-		GST_IS_DMABUF_ALLOCATOR(self->imx_dma_buffer_allocator)
-	);
 	if (v4l2_object == NULL)
 	{
-		GST_ERROR_OBJECT(self, "could not create imxv4l2 object");
-		goto error;
+		v4l2_object = gst_imx_v4l2_object_new(
+			self->context,
+			&initial_video_info,
+			io_mode
+		);
+		if (v4l2_object == NULL)
+		{
+			GST_ERROR_OBJECT(self, "could not create imxv4l2 object");
+			goto error;
+		}
+		gst_object_ref_sink(GST_OBJECT(v4l2_object));
 	}
-	gst_object_ref_sink(GST_OBJECT(v4l2_object));
 
 	/* The video info may have been adjusted by the driver,
 	 * so copy the video info back from the V4L2 object.
@@ -518,29 +810,70 @@ static gboolean gst_imx_v4l2_video_src_decide_allocation(GstBaseSrc *src, GstQue
 	 * convert those caps here. We just use them for the buffer pool config. */
 	gst_query_parse_allocation(query, &negotiated_caps, NULL);
 
+	/* The spare buffers may have been allocated for different caps. */
+	gst_imx_v4l2_video_src_release_spare_pool(self);
+	self->uses_bounded_pool = FALSE;
+
+	/* With DMA-BUF import, a downstream pool can be used directly
+	 * if it hands out DMA-BUF memory. Captured frames then end up
+	 * in downstream's memory without any copying. */
+	if ((gst_imx_v4l2_object_get_io_mode(self->current_v4l2_object) == GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT)
+	 && gst_imx_v4l2_video_src_use_downstream_pool(self, query))
+	{
+		self->uses_bounded_pool = TRUE;
+		return GST_BASE_SRC_CLASS(gst_imx_v4l2_video_src_parent_class)->decide_allocation(src, query);
+	}
+
 	/* Select our own allocator. This ensures that we allocate physically
-	 * contiguous memory, which is currently a strict requirement.
-	 * XXX: See if for non-mxc_v4l2 devices regular virtual memory can be
-	 * used in case downstream offers its own custom buffer pool and/or
-	 * allocator. */
+	 * contiguous memory, which is currently a strict requirement. */
 	gst_allocation_params_init(&allocation_params);
 	selected_allocator = self->imx_dma_buffer_allocator;
 	gst_object_ref(GST_OBJECT_CAST(self->imx_dma_buffer_allocator));
 
-	/* Create our own buffer pool, and use the calculated buffer size
-	 * as its buffer size. This ensures that it allocates DMA memory;
-	 * other pools are not required to use the allocators from this query. */
-	new_buffer_pool = gst_video_buffer_pool_new();
-	GST_DEBUG_OBJECT(
-		self,
-		"created new video buffer pool, using calculated buffer size %u; new pool %p: %" GST_PTR_FORMAT,
-		self->calculated_output_buffer_size,
-		(gpointer)new_buffer_pool,
-		(gpointer)new_buffer_pool
-	);
-	min_num_buffers = max_num_buffers = 0;
 	buffer_size = self->calculated_output_buffer_size;
 
+	if (gst_imx_v4l2_object_get_io_mode(self->current_v4l2_object) == GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT)
+	{
+		/* With DMA-BUF export, the driver allocates the buffers, and
+		 * the pool hands them out. Each pool buffer corresponds to one
+		 * V4L2 buffer, so the pool size is fixed to the V4L2 buffer count.
+		 * Since all of them are queued before streaming starts, the pool
+		 * is empty while a dequeued buffer is held. A blocking acquire
+		 * would then never return. This is why uses_bounded_pool is set,
+		 * which makes gst_imx_v4l2_video_src_capture_frame() replenish
+		 * the queue with GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT instead. */
+		new_buffer_pool = gst_imx_v4l2_object_create_export_buffer_pool(self->current_v4l2_object, self->imx_dma_buffer_allocator);
+		if (new_buffer_pool == NULL)
+		{
+			gst_object_unref(GST_OBJECT(selected_allocator));
+			return FALSE;
+		}
+		min_num_buffers = max_num_buffers = gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object);
+		self->uses_bounded_pool = TRUE;
+		GST_DEBUG_OBJECT(
+			self,
+			"created new DMA-BUF export buffer pool with %u buffer(s); new pool %p: %" GST_PTR_FORMAT,
+			min_num_buffers,
+			(gpointer)new_buffer_pool,
+			(gpointer)new_buffer_pool
+		);
+	}
+	else
+	{
+		/* Create our own buffer pool, and use the calculated buffer size
+		 * as its buffer size. This ensures that it allocates DMA memory;
+		 * other pools are not required to use the allocators from this query. */
+		new_buffer_pool = gst_video_buffer_pool_new();
+		GST_DEBUG_OBJECT(
+			self,
+			"created new video buffer pool, using calculated buffer size %u; new pool %p: %" GST_PTR_FORMAT,
+			self->calculated_output_buffer_size,
+			(gpointer)new_buffer_pool,
+			(gpointer)new_buffer_pool
+		);
+		min_num_buffers = max_num_buffers = 0;
+	}
+
 	/* Make sure the selected allocator is picked by setting
 	 * it as the first entry in the allocation param list. */
 	if (gst_query_get_n_allocation_params(query) == 0)
@@ -570,7 +903,7 @@ static gboolean gst_imx_v4l2_video_src_decide_allocation(GstBaseSrc *src, GstQue
 	/* Enable the videometa and videoalignment options in the
 	 * buffer pool to make sure they get added. */
 	pool_config = gst_buffer_pool_get_config(new_buffer_pool);
-	gst_buffer_pool_config_set_params(pool_config, negotiated_caps, buffer_size, 0, 0);
+	gst_buffer_pool_config_set_params(pool_config, negotiated_caps, buffer_size, min_num_buffers, max_num_buffers);
 	gst_buffer_pool_config_add_option(pool_config, GST_BUFFER_POOL_OPTION_VIDEO_META);
 	gst_buffer_pool_set_config(new_buffer_pool, pool_config);
 
@@ -599,6 +932,20 @@ static gboolean gst_imx_v4l2_video_src_start(GstBaseSrc *src)
 		goto error;
 
 	GST_OBJECT_UNLOCK(self->context);
+
+	self->num_processed_frames = 0;
+	self->num_dropped_frames = 0;
+
+	gst_imx_v4l2_video_src_reset_clock_mapping(self);
+
+	GST_OBJECT_LOCK(self);
+	self->capture_thread_enabled = self->use_capture_thread;
+	GST_OBJECT_UNLOCK(self);
+
+	g_mutex_lock(&(self->captured_frames_mutex));
+	self->captured_frames_flushing = FALSE;
+	g_mutex_unlock(&(self->captured_frames_mutex));
+
 	return TRUE;
 
 error:
@@ -612,6 +959,12 @@ static gboolean gst_imx_v4l2_video_src_stop(GstBaseSrc *src)
 {
 	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(src);
 
+	if (self->current_v4l2_object != NULL)
+		gst_imx_v4l2_object_unlock(self->current_v4l2_object);
+	gst_imx_v4l2_video_src_stop_capture_thread(self);
+
+	gst_imx_v4l2_video_src_release_spare_pool(self);
+
 	if (self->current_v4l2_object != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->current_v4l2_object));
@@ -635,6 +988,12 @@ static gboolean gst_imx_v4l2_video_src_unlock(GstBaseSrc *src)
 	if (self->current_v4l2_object != NULL)
 		gst_imx_v4l2_object_unlock(self->current_v4l2_object);
 
+	/* Wake up create() if it is waiting for the capture thread. */
+	g_mutex_lock(&(self->captured_frames_mutex));
+	self->captured_frames_flushing = TRUE;
+	g_cond_broadcast(&(self->captured_frames_cond));
+	g_mutex_unlock(&(self->captured_frames_mutex));
+
 	return TRUE;
 }
 
@@ -643,6 +1002,14 @@ static gboolean gst_imx_v4l2_video_src_unlock_stop(GstBaseSrc *src)
 {
 	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(src);
 
+	/* The capture thread exits once the object is unlocked, so it is
+	 * safe to wait for it here. create() starts a new one afterwards. */
+	gst_imx_v4l2_video_src_stop_capture_thread(self);
+
+	g_mutex_lock(&(self->captured_frames_mutex));
+	self->captured_frames_flushing = FALSE;
+	g_mutex_unlock(&(self->captured_frames_mutex));
+
 	if (self->current_v4l2_object != NULL)
 		gst_imx_v4l2_object_unlock_stop(self->current_v4l2_object);
 
@@ -696,12 +1063,22 @@ static gboolean gst_imx_v4l2_video_src_query(GstBaseSrc *src, GstQuery *query)
 
 static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **buf)
 {
-	GstFlowReturn flow_ret = GST_FLOW_OK;
 	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(src);
-	gboolean loop = TRUE;
 
 	g_assert(self->current_v4l2_object != NULL);
 
+	if (self->capture_thread_enabled)
+		return gst_imx_v4l2_video_src_pop_captured_frame(self, buf);
+	else
+		return gst_imx_v4l2_video_src_capture_frame(self, buf, TRUE);
+}
+
+
+static GstFlowReturn gst_imx_v4l2_video_src_capture_frame(GstImxV4L2VideoSrc *self, GstBuffer **buf, gboolean block)
+{
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	gboolean loop = TRUE;
+
 	GST_LOG_OBJECT(self, "producing video frame");
 
 	while (loop)
@@ -713,11 +1090,17 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 		*buf = NULL;
 
 		/* Dequeue a previously queued buffer. */
-		flow_ret = gst_imx_v4l2_object_dequeue_buffer(self->current_v4l2_object, buf);
+		if (block)
+			flow_ret = gst_imx_v4l2_object_dequeue_buffer(self->current_v4l2_object, buf);
+		else
+			flow_ret = gst_imx_v4l2_object_try_dequeue_buffer(self->current_v4l2_object, buf);
 		if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
 		{
 			switch (flow_ret)
 			{
+				case GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE:
+					goto finish;
+
 				/* This may happen if either the V4L2 object ran out of queued buffers
 				 * (not expected to happen) or the capture is starting up (V4L2 capturing
 				 * requires a minimum set of buffers to be queued before the streaming
@@ -740,10 +1123,13 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 			GstClock *pipeline_clock;
 			GstClockTime pipeline_clock_now = GST_CLOCK_TIME_NONE;
 			GstClockTime pipeline_base_time;
-			GstClockTime current_sysclock_time;
+			GstClockTime current_sysclock_time = GST_CLOCK_TIME_NONE;
+			gboolean sysclock_is_realtime = FALSE;
 			GstClockTimeDiff capture_delay;
 			GstClockTime capture_timestamp;
+			GstClockTime mapped_timestamp;
 			GstClockTime final_timestamp;
+			GstImxV4L2VideoSrcTimestampMode timestamp_mode;
 
 			capture_timestamp = GST_BUFFER_PTS(*buf);
 
@@ -763,6 +1149,7 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 			 * to running-time (which is what the pipeline expects from us). */
 
 			GST_OBJECT_LOCK(self);
+			timestamp_mode = self->timestamp_mode;
 			pipeline_clock = GST_ELEMENT_CLOCK(self);
 			if (G_LIKELY(pipeline_clock != NULL))
 			{
@@ -775,6 +1162,8 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 			}
 			GST_OBJECT_UNLOCK(self);
 
+			/* The clock is unref'd here, but the pointer itself is still
+			 * used below for detecting pipeline clock changes. */
 			if (pipeline_clock != NULL)
 			{
 				pipeline_clock_now = gst_clock_get_time(pipeline_clock);
@@ -798,6 +1187,7 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 				{
 					clock_gettime(CLOCK_REALTIME, &now);
 					current_sysclock_time = GST_TIMESPEC_TO_TIME(now);
+					sysclock_is_realtime = TRUE;
 				}
 
 				capture_delay = GST_CLOCK_DIFF(capture_timestamp, current_sysclock_time);
@@ -820,7 +1210,27 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 					capture_delay = 0;
 			}
 
-			if (G_LIKELY(GST_CLOCK_TIME_IS_VALID(pipeline_clock_now)))
+			if (G_LIKELY(GST_CLOCK_TIME_IS_VALID(pipeline_clock_now))
+			 && (timestamp_mode == GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_CLOCK_MAPPING)
+			 && GST_CLOCK_TIME_IS_VALID(capture_timestamp)
+			 && gst_imx_v4l2_video_src_map_capture_timestamp(self, capture_timestamp, current_sysclock_time, sysclock_is_realtime, pipeline_clock, pipeline_clock_now, &mapped_timestamp))
+			{
+				/* The V4L2 timestamp was directly translated to pipeline clock time,
+				 * so only the base-time has to be subtracted to get running-time.
+				 * Since this does not depend on when the buffer was dequeued,
+				 * scheduling jitter does not affect the timestamp. */
+				final_timestamp = (mapped_timestamp > pipeline_base_time) ? (mapped_timestamp - pipeline_base_time) : 0;
+
+				GST_LOG_OBJECT(
+					self,
+					"V4L2 timestamp %" GST_TIME_FORMAT " mapped to pipeline clock time %" GST_TIME_FORMAT " - base time %" GST_TIME_FORMAT " -> final timestamp: %" GST_TIME_FORMAT,
+					GST_TIME_ARGS(capture_timestamp),
+					GST_TIME_ARGS(mapped_timestamp),
+					GST_TIME_ARGS(pipeline_base_time),
+					GST_TIME_ARGS(final_timestamp)
+				);
+			}
+			else if (G_LIKELY(GST_CLOCK_TIME_IS_VALID(pipeline_clock_now)))
 			{
 				final_timestamp = pipeline_clock_now - pipeline_base_time;
 
@@ -843,6 +1253,20 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 			GST_BUFFER_PTS(*buf) = GST_BUFFER_DTS(*buf) = final_timestamp;
 			GST_BUFFER_DURATION(*buf) = self->current_frame_duration;
 
+			gst_imx_v4l2_video_src_report_skipped_frames(self, *buf);
+
+			/* With a bounded pool, blocking in alloc() below would wait until
+			 * downstream releases a buffer, while the driver runs out of
+			 * queued buffers and drops frames. Replenish the queue without
+			 * blocking instead. */
+			if (self->uses_bounded_pool)
+			{
+				flow_ret = gst_imx_v4l2_video_src_replenish_bounded_queue(self, buf);
+				if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+					goto error;
+				break;
+			}
+
 			/* Not exiting loop right away; instead, we just set loop to FALSE, and
 			 * resume the current iteration to queue a new buffer. Otherwise, we can
 			 * run out of queued buffers, and V4L2 will miss frames, resulting in
@@ -851,7 +1275,7 @@ static GstFlowReturn gst_imx_v4l2_video_src_create(GstPushSrc *src, GstBuffer **
 		}
 
 		/* Acquire a new buffer to queue into the V4L2 object. */
-		flow_ret = GST_BASE_SRC_CLASS(gst_imx_v4l2_video_src_parent_class)->alloc(GST_BASE_SRC(src), 0, self->calculated_output_buffer_size, &new_buffer);
+		flow_ret = GST_BASE_SRC_CLASS(gst_imx_v4l2_video_src_parent_class)->alloc(GST_BASE_SRC(self), 0, self->calculated_output_buffer_size, &new_buffer);
 		if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
 		{
 			/* Only log this if it actually is an error. (Flushing is not an error.) */
@@ -1111,3 +1535,541 @@ static GstCaps* gst_imx_v4l2_video_src_fixate_caps(GstImxV4L2VideoSrc *self, Gst
 	GST_DEBUG_OBJECT(self, "fixated caps: %" GST_PTR_FORMAT, (gpointer)fixated_caps);
 	return fixated_caps;
 }
+
+
+static GstImxV4L2IOMode gst_imx_v4l2_video_src_select_io_mode(GstImxV4L2VideoSrc *self)
+{
+	GstImxV4L2VideoSrcIOMode io_mode;
+	GstImxV4L2ProbeResult const *probe_result;
+	gboolean is_mxc_v4l2_device;
+	gboolean allocator_supports_dmabuf = GST_IS_DMABUF_ALLOCATOR(self->imx_dma_buffer_allocator);
+
+	GST_OBJECT_LOCK(self);
+	io_mode = self->io_mode;
+	GST_OBJECT_UNLOCK(self);
+
+	GST_OBJECT_LOCK(self->context);
+	probe_result = gst_imx_v4l2_context_get_probe_result(self->context);
+	is_mxc_v4l2_device = (probe_result != NULL) && (probe_result->capture_chip != GST_IMX_V4L2_CAPTURE_CHIP_UNIDENTIFIED);
+	GST_OBJECT_UNLOCK(self->context);
+
+	/* mxc_v4l2 devices always use their own USERPTR hack, so
+	 * keep selecting what was always selected for them. */
+	if (is_mxc_v4l2_device)
+		return allocator_supports_dmabuf ? GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT : GST_IMX_V4L2_IO_MODE_USERPTR;
+
+	switch (io_mode)
+	{
+		case GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_IMPORT:
+			GST_DEBUG_OBJECT(self, "using DMA-BUF import");
+			return GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT;
+
+		case GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_EXPORT:
+			GST_DEBUG_OBJECT(self, "using DMA-BUF export");
+			return GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT;
+
+		default:
+			/* Without a DMA-BUF capable allocator, we cannot allocate
+			 * buffers the driver can import, so let it allocate them. */
+			GST_DEBUG_OBJECT(self, "automatically picked DMA-BUF %s", allocator_supports_dmabuf ? "import" : "export");
+			return allocator_supports_dmabuf ? GST_IMX_V4L2_IO_MODE_DMABUF_IMPORT : GST_IMX_V4L2_IO_MODE_DMABUF_EXPORT;
+	}
+}
+
+
+static gboolean gst_imx_v4l2_video_src_use_downstream_pool(GstImxV4L2VideoSrc *self, GstQuery *query)
+{
+	GstBufferPool *downstream_pool = NULL;
+	GstStructure *pool_config;
+	GstAllocator *pool_allocator = NULL;
+	guint buffer_size, min_num_buffers, max_num_buffers;
+	guint num_v4l2_buffers;
+	gboolean retval = FALSE;
+
+	if (gst_query_get_n_allocation_pools(query) == 0)
+		return FALSE;
+
+	gst_query_parse_nth_allocation_pool(query, 0, &downstream_pool, &buffer_size, &min_num_buffers, &max_num_buffers);
+	if (downstream_pool == NULL)
+		return FALSE;
+
+	/* The V4L2 object can only import DMA-BUF memory, so only
+	 * accept pools whose allocator produces such memory. */
+	pool_config = gst_buffer_pool_get_config(downstream_pool);
+	gst_buffer_pool_config_get_allocator(pool_config, &pool_allocator, NULL);
+	if ((pool_allocator == NULL) || !GST_IS_DMABUF_ALLOCATOR(pool_allocator))
+	{
+		GST_DEBUG_OBJECT(self, "downstream pool %" GST_PTR_FORMAT " does not allocate DMA-BUF memory; not using it", (gpointer)downstream_pool);
+		goto finish;
+	}
+
+	if (buffer_size < self->calculated_output_buffer_size)
+	{
+		GST_DEBUG_OBJECT(self, "downstream pool buffer size %u is smaller than the required size %u; not using it", buffer_size, self->calculated_output_buffer_size);
+		goto finish;
+	}
+
+	/* All V4L2 buffers are queued at the same time, and one
+	 * more buffer is needed for the frame that is pushed. */
+	num_v4l2_buffers = gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object);
+	if ((max_num_buffers != 0) && (max_num_buffers < (num_v4l2_buffers + 1)))
+	{
+		GST_DEBUG_OBJECT(self, "downstream pool can hold at most %u buffer(s), need at least %u; not using it", max_num_buffers, num_v4l2_buffers + 1);
+		goto finish;
+	}
+	min_num_buffers = MAX(min_num_buffers, num_v4l2_buffers + 1);
+
+	GST_DEBUG_OBJECT(self, "using downstream DMA-BUF pool %" GST_PTR_FORMAT " for capturing", (gpointer)downstream_pool);
+	gst_query_set_nth_allocation_pool(query, 0, downstream_pool, buffer_size, min_num_buffers, max_num_buffers);
+	retval = TRUE;
+
+finish:
+	gst_structure_free(pool_config);
+	gst_object_unref(GST_OBJECT(downstream_pool));
+	return retval;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_video_src_replenish_bounded_queue(GstImxV4L2VideoSrc *self, GstBuffer **buf)
+{
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstBufferPool *buffer_pool;
+	GstBufferPoolAcquireParams acquire_params;
+	GstBuffer *spare_buffer = NULL;
+	gint min_queued_v4l2_buffers;
+	gint num_queued_buffers;
+
+	GST_OBJECT_LOCK(self);
+	min_queued_v4l2_buffers = self->min_queued_v4l2_buffers;
+	GST_OBJECT_UNLOCK(self);
+
+	/* The buffer that was just dequeued is not in the queue,
+	 * so the queue can hold at most one buffer less than that. */
+	min_queued_v4l2_buffers = MIN(min_queued_v4l2_buffers, gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object) - 1);
+
+	/* First, queue all buffers that downstream released in the meantime. */
+
+	buffer_pool = gst_base_src_get_buffer_pool(GST_BASE_SRC(self));
+	g_assert(buffer_pool != NULL);
+
+	memset(&acquire_params, 0, sizeof(acquire_params));
+	acquire_params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+	while (TRUE)
+	{
+		GstBuffer *new_buffer = NULL;
+
+		flow_ret = gst_buffer_pool_acquire_buffer(buffer_pool, &new_buffer, &acquire_params);
+		if (flow_ret == GST_FLOW_EOS)
+		{
+			/* With DONTWAIT, EOS means that the pool is currently empty. */
+			flow_ret = GST_FLOW_OK;
+			break;
+		}
+		else if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		{
+			if (flow_ret != GST_FLOW_FLUSHING)
+				GST_ERROR_OBJECT(self, "could not acquire buffer for next captured frame: %s", gst_flow_get_name(flow_ret));
+			goto finish;
+		}
+
+		flow_ret = gst_imx_v4l2_object_queue_buffer(self->current_v4l2_object, new_buffer);
+		gst_buffer_unref(new_buffer);
+
+		if (flow_ret == GST_IMX_V4L2_FLOW_QUEUE_IS_FULL)
+		{
+			flow_ret = GST_FLOW_OK;
+			break;
+		}
+		else if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+			goto finish;
+	}
+
+	num_queued_buffers = gst_imx_v4l2_object_get_num_queued_buffers(self->current_v4l2_object);
+	if (num_queued_buffers >= min_queued_v4l2_buffers)
+		goto finish;
+
+	/* Downstream is holding on to too many buffers. Copy the captured
+	 * frame into a spare buffer and give the V4L2 buffer right back to
+	 * the driver, otherwise it would soon have to drop frames. */
+
+	GST_LOG_OBJECT(
+		self,
+		"only %d V4L2 buffer(s) queued, minimum is %d; copying captured frame to requeue its V4L2 buffer",
+		num_queued_buffers,
+		min_queued_v4l2_buffers
+	);
+
+	if (self->spare_buffer_pool == NULL)
+	{
+		GstStructure *pool_config;
+		GstCaps *current_caps;
+
+		current_caps = gst_pad_get_current_caps(GST_BASE_SRC_PAD(self));
+
+		self->spare_buffer_pool = gst_video_buffer_pool_new();
+		pool_config = gst_buffer_pool_get_config(self->spare_buffer_pool);
+		gst_buffer_pool_config_set_params(pool_config, current_caps, self->calculated_output_buffer_size, 0, 0);
+		gst_buffer_pool_config_set_allocator(pool_config, self->imx_dma_buffer_allocator, NULL);
+		gst_buffer_pool_set_config(self->spare_buffer_pool, pool_config);
+
+		if (current_caps != NULL)
+			gst_caps_unref(current_caps);
+
+		if (!gst_buffer_pool_set_active(self->spare_buffer_pool, TRUE))
+		{
+			GST_ERROR_OBJECT(self, "could not activate spare buffer pool");
+			gst_imx_v4l2_video_src_release_spare_pool(self);
+			flow_ret = GST_FLOW_ERROR;
+			goto finish;
+		}
+
+		GST_DEBUG_OBJECT(self, "created spare buffer pool %" GST_PTR_FORMAT, (gpointer)(self->spare_buffer_pool));
+	}
+
+	flow_ret = gst_buffer_pool_acquire_buffer(self->spare_buffer_pool, &spare_buffer, NULL);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+	{
+		GST_ERROR_OBJECT(self, "could not acquire spare buffer: %s", gst_flow_get_name(flow_ret));
+		goto finish;
+	}
+
+	if (self->current_video_info.type == GST_IMX_V4L2_VIDEO_FORMAT_TYPE_RAW)
+	{
+		/* The spare buffer gets the same layout as the captured
+		 * frame, since the video meta is copied over below. */
+		GstVideoInfo *gst_info = &(self->current_video_info.info.gst_info);
+		GstVideoFrame in_frame, out_frame;
+		gboolean frame_copied;
+
+		if (!gst_video_frame_map(&in_frame, gst_info, *buf, GST_MAP_READ))
+		{
+			GST_ERROR_OBJECT(self, "could not map captured frame");
+			goto copy_error;
+		}
+
+		if (!gst_video_frame_map(&out_frame, gst_info, spare_buffer, GST_MAP_WRITE))
+		{
+			GST_ERROR_OBJECT(self, "could not map spare buffer");
+			gst_video_frame_unmap(&in_frame);
+			goto copy_error;
+		}
+
+		frame_copied = gst_imx_video_utils_copy_frame(&out_frame, &in_frame, 0);
+
+		gst_video_frame_unmap(&out_frame);
+		gst_video_frame_unmap(&in_frame);
+
+		if (!frame_copied)
+		{
+			GST_ERROR_OBJECT(self, "could not copy captured frame into spare buffer");
+			goto copy_error;
+		}
+	}
+	else
+	{
+		/* Bayer and encoded frames have no video frame layout. */
+		GstMapInfo in_map_info, out_map_info;
+
+		gst_buffer_map(*buf, &in_map_info, GST_MAP_READ);
+		gst_buffer_map(spare_buffer, &out_map_info, GST_MAP_WRITE);
+		memcpy(out_map_info.data, in_map_info.data, MIN(in_map_info.size, out_map_info.size));
+		gst_buffer_unmap(spare_buffer, &out_map_info);
+		gst_buffer_unmap(*buf, &in_map_info);
+	}
+
+	/* Also copy the flags, timestamps, and metas like the video meta. */
+	gst_buffer_copy_into(spare_buffer, *buf, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_META, 0, -1);
+
+	flow_ret = gst_imx_v4l2_object_queue_buffer(self->current_v4l2_object, *buf);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+	{
+		gst_buffer_unref(spare_buffer);
+		goto finish;
+	}
+
+	gst_buffer_unref(*buf);
+	*buf = spare_buffer;
+
+
+finish:
+	gst_object_unref(GST_OBJECT(buffer_pool));
+	return flow_ret;
+
+copy_error:
+	gst_buffer_unref(spare_buffer);
+	flow_ret = GST_FLOW_ERROR;
+	goto finish;
+}
+
+
+static void gst_imx_v4l2_video_src_release_spare_pool(GstImxV4L2VideoSrc *self)
+{
+	if (self->spare_buffer_pool != NULL)
+	{
+		gst_buffer_pool_set_active(self->spare_buffer_pool, FALSE);
+		gst_object_unref(GST_OBJECT(self->spare_buffer_pool));
+		self->spare_buffer_pool = NULL;
+	}
+}
+
+
+static void gst_imx_v4l2_video_src_report_skipped_frames(GstImxV4L2VideoSrc *self, GstBuffer *buf)
+{
+	guint num_skipped_frames = gst_imx_v4l2_object_get_num_skipped_frames(self->current_v4l2_object);
+
+	self->num_processed_frames++;
+
+	if (num_skipped_frames > 0)
+	{
+		GstMessage *qos_message;
+		GstClockTime timestamp = GST_BUFFER_PTS(buf);
+
+		self->num_dropped_frames += num_skipped_frames;
+
+		GST_DEBUG_OBJECT(
+			self,
+			"driver dropped %u frame(s) before frame with timestamp %" GST_TIME_FORMAT "; processed: %" G_GUINT64_FORMAT " dropped: %" G_GUINT64_FORMAT,
+			num_skipped_frames,
+			GST_TIME_ARGS(timestamp),
+			self->num_processed_frames,
+			self->num_dropped_frames
+		);
+
+		/* The dropped frames came in right before this one, so
+		 * estimate their timestamp by going back in time. */
+		if (GST_CLOCK_TIME_IS_VALID(timestamp) && GST_CLOCK_TIME_IS_VALID(self->current_frame_duration))
+		{
+			GstClockTime gap_duration = num_skipped_frames * self->current_frame_duration;
+			timestamp = (timestamp > gap_duration) ? (timestamp - gap_duration) : 0;
+		}
+
+		qos_message = gst_message_new_qos(
+			GST_OBJECT_CAST(self),
+			TRUE,
+			timestamp,
+			timestamp,
+			timestamp,
+			GST_CLOCK_TIME_IS_VALID(self->current_frame_duration) ? (num_skipped_frames * self->current_frame_duration) : GST_CLOCK_TIME_NONE
+		);
+		gst_message_set_qos_stats(qos_message, GST_FORMAT_BUFFERS, self->num_processed_frames, self->num_dropped_frames);
+		gst_element_post_message(GST_ELEMENT_CAST(self), qos_message);
+	}
+}
+
+
+static void gst_imx_v4l2_video_src_reset_clock_mapping(GstImxV4L2VideoSrc *self)
+{
+	self->clock_mapping_num_samples = 0;
+	self->clock_mapping_next_sample_index = 0;
+	self->clock_mapping_pipeline_clock = NULL;
+	self->clock_mapping_uses_realtime_clock = FALSE;
+}
+
+
+static gboolean gst_imx_v4l2_video_src_map_capture_timestamp(GstImxV4L2VideoSrc *self, GstClockTime capture_timestamp, GstClockTime sysclock_time, gboolean sysclock_is_realtime, gpointer pipeline_clock, GstClockTime pipeline_clock_time, GstClockTime *mapped_timestamp)
+{
+	GstClockTime m_num, m_denom, b, xbase;
+	gdouble r_squared;
+	guint sample_index;
+
+	/* The samples are only valid for one particular pair of clocks. */
+	if ((pipeline_clock != self->clock_mapping_pipeline_clock) || (sysclock_is_realtime != self->clock_mapping_uses_realtime_clock))
+	{
+		GST_DEBUG_OBJECT(
+			self,
+			"resetting clock mapping; pipeline clock: %p system clock: %s",
+			pipeline_clock,
+			sysclock_is_realtime ? "realtime" : "monotonic"
+		);
+
+		gst_imx_v4l2_video_src_reset_clock_mapping(self);
+		self->clock_mapping_pipeline_clock = pipeline_clock;
+		self->clock_mapping_uses_realtime_clock = sysclock_is_realtime;
+	}
+
+	/* Record the current time of both clocks as one more sample.
+	 * Each sample is disturbed by the time that passes between the
+	 * two clock reads, which is why a linear regression over many
+	 * samples is used instead of the most recent offset. */
+	sample_index = self->clock_mapping_next_sample_index;
+	self->clock_mapping_samples[sample_index * 2 + 0] = sysclock_time;
+	self->clock_mapping_samples[sample_index * 2 + 1] = pipeline_clock_time;
+	self->clock_mapping_next_sample_index = (sample_index + 1) % CLOCK_MAPPING_WINDOW_SIZE;
+	self->clock_mapping_num_samples = MIN(self->clock_mapping_num_samples + 1, CLOCK_MAPPING_WINDOW_SIZE);
+
+	if (self->clock_mapping_num_samples < CLOCK_MAPPING_MIN_NUM_SAMPLES)
+		return FALSE;
+
+	if (!gst_calculate_linear_regression(
+		self->clock_mapping_samples,
+		self->clock_mapping_temp,
+		self->clock_mapping_num_samples,
+		&m_num, &m_denom,
+		&b, &xbase,
+		&r_squared
+	))
+	{
+		GST_DEBUG_OBJECT(self, "could not compute clock mapping; falling back to capture delay estimate");
+		return FALSE;
+	}
+
+	*mapped_timestamp = gst_clock_adjust_with_calibration(NULL, capture_timestamp, xbase, b, m_num, m_denom);
+
+	/* A frame cannot have been captured after the current time. This
+	 * can only happen if the estimate is still poor right after startup. */
+	if (*mapped_timestamp > pipeline_clock_time)
+		*mapped_timestamp = pipeline_clock_time;
+
+	GST_LOG_OBJECT(
+		self,
+		"clock mapping: xbase %" GST_TIME_FORMAT " b %" GST_TIME_FORMAT " rate %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " r_squared %f",
+		GST_TIME_ARGS(xbase),
+		GST_TIME_ARGS(b),
+		m_num, m_denom,
+		r_squared
+	);
+
+	return TRUE;
+}
+
+
+static GstFlowReturn gst_imx_v4l2_video_src_pop_captured_frame(GstImxV4L2VideoSrc *self, GstBuffer **buf)
+{
+	GstFlowReturn flow_ret;
+
+	g_mutex_lock(&(self->captured_frames_mutex));
+
+	/* Start the capture thread if it isn't running yet. This happens
+	 * with the first create() call, and after flushing stopped or the
+	 * V4L2 object was replaced, since the thread is shut down then. */
+	if ((self->capture_thread == NULL) && !(self->captured_frames_flushing))
+	{
+		GST_DEBUG_OBJECT(self, "starting capture thread");
+		self->capture_thread_running = TRUE;
+		self->capture_thread_flow_ret = GST_FLOW_OK;
+		self->capture_thread = g_thread_new("imxv4l2videosrc-capture", gst_imx_v4l2_video_src_capture_thread_func, self);
+	}
+
+	while (gst_queue_array_is_empty(self->captured_frames) && self->capture_thread_running && !(self->captured_frames_flushing))
+		g_cond_wait(&(self->captured_frames_cond), &(self->captured_frames_mutex));
+
+	if (self->captured_frames_flushing)
+	{
+		GST_DEBUG_OBJECT(self, "we are flushing; not waiting for captured frames");
+		flow_ret = GST_FLOW_FLUSHING;
+	}
+	else if (!gst_queue_array_is_empty(self->captured_frames))
+	{
+		*buf = gst_queue_array_pop_head(self->captured_frames);
+		flow_ret = GST_FLOW_OK;
+		GST_LOG_OBJECT(self, "got captured frame from capture thread: %" GST_PTR_FORMAT, (gpointer)(*buf));
+	}
+	else
+	{
+		/* The capture thread ended, and all of its frames were consumed. */
+		flow_ret = self->capture_thread_flow_ret;
+		GST_DEBUG_OBJECT(self, "capture thread ended with return value %s", gst_flow_get_name(flow_ret));
+	}
+
+	g_mutex_unlock(&(self->captured_frames_mutex));
+
+	return flow_ret;
+}
+
+
+static gpointer gst_imx_v4l2_video_src_capture_thread_func(gpointer user_data)
+{
+	GstImxV4L2VideoSrc *self = GST_IMX_V4L2_VIDEO_SRC(user_data);
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstBuffer *frames[MAX_CAPTURE_BATCH_SIZE];
+	guint max_num_captured_frames;
+
+	/* Frames that create() did not pick up yet are not queued in the
+	 * driver. Limit how many of them can pile up; if there are more,
+	 * create() is too slow, and the oldest ones are stale anyway. */
+	max_num_captured_frames = gst_imx_v4l2_object_get_num_buffers(self->current_v4l2_object);
+
+	GST_DEBUG_OBJECT(self, "capture thread started");
+
+	while (TRUE)
+	{
+		guint num_frames, i;
+
+		/* Wait until at least one frame is ready ... */
+		flow_ret = gst_imx_v4l2_video_src_capture_frame(self, &(frames[0]), TRUE);
+		if (flow_ret != GST_FLOW_OK)
+			break;
+		num_frames = 1;
+
+		/* ... then drain all others that are ready as well without waiting
+		 * again. This way, high framerates do not require one wakeup
+		 * per frame if this thread does not get scheduled in time. */
+		while (num_frames < MAX_CAPTURE_BATCH_SIZE)
+		{
+			GstFlowReturn drain_flow_ret = gst_imx_v4l2_video_src_capture_frame(self, &(frames[num_frames]), FALSE);
+
+			if (drain_flow_ret != GST_FLOW_OK)
+			{
+				if (drain_flow_ret != GST_IMX_V4L2_FLOW_NO_BUFFER_AVAILABLE)
+					flow_ret = drain_flow_ret;
+				break;
+			}
+
+			num_frames++;
+		}
+
+		GST_LOG_OBJECT(self, "captured %u frame(s) in this batch", num_frames);
+
+		g_mutex_lock(&(self->captured_frames_mutex));
+
+		for (i = 0; i < num_frames; ++i)
+		{
+			if (gst_queue_array_get_length(self->captured_frames) >= max_num_captured_frames)
+			{
+				GstBuffer *stale_frame = gst_queue_array_pop_head(self->captured_frames);
+				GST_DEBUG_OBJECT(self, "too many captured frames pending; dropping oldest frame %" GST_PTR_FORMAT, (gpointer)stale_frame);
+				gst_buffer_unref(stale_frame);
+				self->num_dropped_frames++;
+			}
+
+			gst_queue_array_push_tail(self->captured_frames, frames[i]);
+		}
+
+		g_cond_signal(&(self->captured_frames_cond));
+		g_mutex_unlock(&(self->captured_frames_mutex));
+
+		if (flow_ret != GST_FLOW_OK)
+			break;
+	}
+
+	GST_DEBUG_OBJECT(self, "capture thread ending with return value %s", gst_flow_get_name(flow_ret));
+
+	g_mutex_lock(&(self->captured_frames_mutex));
+	self->capture_thread_running = FALSE;
+	self->capture_thread_flow_ret = flow_ret;
+	g_cond_signal(&(self->captured_frames_cond));
+	g_mutex_unlock(&(self->captured_frames_mutex));
+
+	return NULL;
+}
+
+
+static void gst_imx_v4l2_video_src_stop_capture_thread(GstImxV4L2VideoSrc *self)
+{
+	/* The caller must have unlocked the V4L2 object before calling
+	 * this, otherwise the thread may keep waiting for frames. */
+
+	if (self->capture_thread != NULL)
+	{
+		GST_DEBUG_OBJECT(self, "waiting for capture thread to end");
+		g_thread_join(self->capture_thread);
+		self->capture_thread = NULL;
+	}
+
+	g_mutex_lock(&(self->captured_frames_mutex));
+	while (!gst_queue_array_is_empty(self->captured_frames))
+		gst_buffer_unref(gst_queue_array_pop_head(self->captured_frames));
+	self->capture_thread_running = FALSE;
+	g_mutex_unlock(&(self->captured_frames_mutex));
+}
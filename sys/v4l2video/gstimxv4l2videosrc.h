@@ -38,7 +38,26 @@ typedef struct _GstImxV4L2VideoSrc GstImxV4L2VideoSrc;
 typedef struct _GstImxV4L2VideoSrcClass GstImxV4L2VideoSrcClass;
 
 
+typedef enum
+{
+	GST_IMX_V4L2_VIDEO_SRC_IO_MODE_AUTO,
+	GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_IMPORT,
+	GST_IMX_V4L2_VIDEO_SRC_IO_MODE_DMABUF_EXPORT
+}
+GstImxV4L2VideoSrcIOMode;
+
+
+typedef enum
+{
+	GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_DELAY_ESTIMATE,
+	GST_IMX_V4L2_VIDEO_SRC_TIMESTAMP_MODE_CLOCK_MAPPING
+}
+GstImxV4L2VideoSrcTimestampMode;
+
+
 GType gst_imx_v4l2_video_src_get_type(void);
+GType gst_imx_v4l2_video_src_io_mode_get_type(void);
+GType gst_imx_v4l2_video_src_timestamp_mode_get_type(void);
 
 
 G_END_DECLS
@@ -27,6 +27,9 @@
 #ifdef WITH_IMX_V4L2_ISI_VIDEO_TRANSFORM
 #include "gstimxv4l2isivideotransform.h"
 #endif
+#ifdef WITH_IMX_V4L2_BAYER_DEMOSAIC
+#include "gstimxv4l2bayerdemosaic.h"
+#endif
 #ifdef WITH_IMX_V4L2_AMPHION_DECODER
 #include "gstimxv4l2amphiondec.h"
 #endif
@@ -53,6 +56,9 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_IMX_V4L2_ISI_VIDEO_TRANSFORM
 	ret = ret && gst_element_register(plugin, "imxv4l2isivideotransform", GST_RANK_NONE, gst_imx_v4l2_isi_video_transform_get_type());
 #endif
+#ifdef WITH_IMX_V4L2_BAYER_DEMOSAIC
+	ret = ret && gst_element_register(plugin, "imxv4l2bayerdemosaic", GST_RANK_NONE, gst_imx_v4l2_bayer_demosaic_get_type());
+#endif
 #ifdef WITH_IMX_V4L2_AMPHION_DECODER
 	ret = gst_imx_v4l2_amphion_dec_register_decoder_types(plugin);
 #endif